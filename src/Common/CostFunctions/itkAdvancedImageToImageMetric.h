@@ -19,10 +19,16 @@
 
 #include "itkImageSamplerBase.h"
 #include "itkGradientImageFilter.h"
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction2.h"
 #include "itkLimiterFunctionBase.h"
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
+#include "itkMultiThreader.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkTransformEvaluationCache.h"
+#include "itkBSplineValueAndDerivativeKernel.h"
+#include "elxProfiler.h"
 #include "vnl/vnl_sparse_matrix.h"
 
 namespace itk
@@ -53,6 +59,15 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li Multi-threading support: inheriting metrics may distribute the loop over
+ *   the image samples over several threads. Each thread evaluates with its own
+ *   evaluation context, which holds its accumulators and scratch memory, and
+ *   only reads the shared data. GetValueAndDerivativeMultiThreaded() loops over
+ *   the samples, and an inheriting metric only has to implement the
+ *   contribution of one sample, ThreadedUpdateValueAndDerivativeTerms(), and
+ *   the combination of the contexts, AfterThreadedGetValueAndDerivative().
+ *   The moving mask is tested without modifying it, see IsInsideMovingMask(),
+ *   so that the threads can share it.
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -147,6 +162,11 @@ public:
     FixedImageDimension,
     MovingImageDimension >                                AdvancedTransformType;
 
+  /** Typedefs for a cache of transform evaluations at the image samples. */
+  typedef TransformEvaluationCache<
+    AdvancedTransformType, ImageSampleContainerType >     TransformEvaluationCacheType;
+  typedef typename TransformEvaluationCacheType::Pointer  TransformEvaluationCachePointer;
+
   /** Hessian type; for SelfHessian (experimental feature) */
   typedef typename DerivativeType::ValueType              HessianValueType;
   //typedef Array2D<HessianValueType>                       HessianType;
@@ -219,6 +239,58 @@ public:
   itkSetMacro( MovingImageDerivativeScales, MovingImageDerivativeScalesType );
   itkGetConstReferenceMacro( MovingImageDerivativeScales, MovingImageDerivativeScalesType );
 
+  /** Set/Get whether the metric is allowed to distribute its loop over
+   * the image samples over multiple threads. Only metrics that implement
+   * the ThreadedGetValueAndDerivative() method make use of this; default: true.
+   */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Set/Get the number of threads used by the threaded metric computation.
+   * The default is the global default of the itk::MultiThreader, which is
+   * bounded by the global maximum number of threads (the elastix
+   * MaximumNumberOfThreads setting).
+   */
+  virtual void SetNumberOfThreads( unsigned int numberOfThreads );
+  virtual unsigned int GetNumberOfThreads( void ) const;
+
+  /** Set/Get whether the transform parameters are set by the owner of the
+   * transform, before GetValue() etc. are called. In that case the metric
+   * does not pass the parameters to the transform itself, which allows
+   * several metrics that share the transform to be evaluated concurrently,
+   * as done by the CombinationImageToImageMetric. Default: false.
+   */
+  itkSetMacro( TransformParametersAreSetExternally, bool );
+  itkGetConstMacro( TransformParametersAreSetExternally, bool );
+
+  /** Set/Get whether the image sampler is updated by the owner of the
+   * metric, before GetValue() etc. are called. In that case the metric does
+   * not call Update() on the image sampler itself. This is set by
+   * InitializeEvaluator(), since the evaluators share the image sampler and
+   * are evaluated concurrently, and the pipeline Update() of the sampler is
+   * not thread-safe. Default: false.
+   */
+  itkSetMacro( SamplerIsPreUpdated, bool );
+  itkGetConstMacro( SamplerIsPreUpdated, bool );
+
+  /** Set the parameters defining the transform, unless
+   * TransformParametersAreSetExternally is true. Hides the non-virtual
+   * superclass implementation, which is called by all subclasses.
+   */
+  void SetTransformParameters( const ParametersType & parameters ) const;
+
+  /** Set/Get a cache of transform evaluations at the image samples. When set,
+   * the TransformPoint() and EvaluateTransformJacobian() variants that take
+   * a sample index take their results from the cache whenever it contains
+   * the sample. The cache is set and filled by the
+   * CombinationImageToImageMetric, for all metrics that share the same
+   * samples, and should contain the output of the image sampler of this
+   * metric. Default: 0.
+   */
+  itkSetObjectMacro( TransformEvaluationCache, TransformEvaluationCacheType );
+  itkGetConstObjectMacro( TransformEvaluationCache, TransformEvaluationCacheType );
+
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    * \li Call the superclass' implementation
@@ -233,6 +305,26 @@ public:
    * This base class just returns an identity matrix of the right size. */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Create an evaluator: a metric of the same type and with the same
+   * settings, which computes the same values as this metric, but which can
+   * be evaluated concurrently with other evaluators, for example to
+   * evaluate a population of parameter vectors in parallel. The evaluator
+   * shares the data that is only read during an evaluation with this metric:
+   * the images, masks, interpolator, image sampler and limiters. It has its
+   * own transform and its own scratch variables. The transform is a copy
+   * of the transform of this metric, see
+   * AdvancedTransform::CreateEvaluationCopy(), unless a transform is passed.
+   *
+   * This metric should be initialized first. The evaluators do not use
+   * multi-threading themselves, and the image sampler should be up to date
+   * before they are evaluated concurrently; the evaluators do not update
+   * it, see SamplerIsPreUpdated.
+   *
+   * Returns 0 if the metric does not support evaluators, which is the
+   * default, or if the transform can not be copied.
+   */
+  virtual Pointer CreateEvaluator( AdvancedTransformType * transform = 0 ) const;
+
 protected:
 
   /** Constructor. */
@@ -259,6 +351,10 @@ protected:
     MovingImageType, CoordinateRepresentationType, double>      BSplineInterpolatorType;
   typedef BSplineInterpolateImageFunction<
     MovingImageType, CoordinateRepresentationType, float>       BSplineInterpolatorFloatType;
+  typedef BSplineInterpolateImageFunction2<
+    MovingImageType, CoordinateRepresentationType, double>      BSplineKernelInterpolatorType;
+  typedef BSplineInterpolateImageFunction2<
+    MovingImageType, CoordinateRepresentationType, float>       BSplineKernelInterpolatorFloatType;
   typedef typename BSplineInterpolatorType::CovariantVectorType MovingImageDerivativeType;
   typedef GradientImageFilter<
     MovingImageType, RealType, RealType>                        CentralDifferenceGradientFilterType;
@@ -267,6 +363,54 @@ protected:
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType           NonZeroJacobianIndicesType;
 
+  /** Typedefs for the thread-safe test of the moving mask. */
+  typedef ImageMaskSpatialObject2<
+    itkGetStaticConstMacro( MovingImageDimension ) >            MovingImageMaskSpatialObjectType;
+  typedef typename MovingImageMaskSpatialObjectType
+    ::TransformType                                             MovingImageMaskTransformType;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader                                    ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct                        ThreadInfoType;
+
+  /** The parameters that are passed to the threader callbacks. */
+  struct MultiThreaderParameterType
+  {
+    const Self *      st_Metric;
+    DerivativeType *  st_DerivativePointer;
+    double            st_NormalizationFactor;
+  };
+
+  /** The private context of one thread in a threaded evaluation. It owns
+   * everything a thread writes to: its accumulators, and its scratch memory
+   * for the sparse transform Jacobian and the image Jacobian. All other data,
+   * the images, the B-spline coefficients, the masks, the limiters and the
+   * image samples, is shared by the threads and only read.
+   *
+   * The contexts do not have their own mask evaluator. The moving mask is
+   * tested through IsInsideMovingMask(), which only reads the mask and a
+   * world-to-index transform that is computed once by InitializeMovingMask().
+   * So the threads can share the mask, and multi-threading does not have to
+   * be disabled when a moving mask is set. Masks that can only be tested by
+   * modifying them are tested by one thread at a time.
+   *
+   * st_ImageJacobianIndices points to the parameter indices of
+   * st_ImageJacobian: either to st_NonZeroJacobianIndices, or into the
+   * transform evaluation cache.
+   */
+  struct EvaluationContextStruct
+  {
+    unsigned int                        st_ThreadID;
+    unsigned long                       st_NumberOfPixelsCounted;
+    MeasureType                         st_Value;
+    DerivativeType                      st_Derivative;
+    TransformJacobianType               st_Jacobian;
+    NonZeroJacobianIndicesType          st_NonZeroJacobianIndices;
+    DerivativeType                      st_ImageJacobian;
+    const NonZeroJacobianIndicesType *  st_ImageJacobianIndices;
+  };
+  typedef std::vector< EvaluationContextStruct >                EvaluationContextContainerType;
+
   /** Protected Variables **************/
 
   /** Variables for ImageSampler support. m_ImageSampler is mutable, because it is
@@ -278,12 +422,21 @@ protected:
   bool m_InterpolatorIsBSplineFloat;
   typename BSplineInterpolatorType::Pointer             m_BSplineInterpolator;
   typename BSplineInterpolatorFloatType::Pointer             m_BSplineInterpolatorFloat;
+
+  /** The B-spline interpolator, if it gives access to its coefficients, for
+   * the BSplineValueAndDerivativeKernel; 0 otherwise.
+   */
+  typename BSplineKernelInterpolatorType::Pointer       m_BSplineKernelInterpolator;
+  typename BSplineKernelInterpolatorFloatType::Pointer  m_BSplineKernelInterpolatorFloat;
   typename CentralDifferenceGradientFilterType::Pointer m_CentralDifferenceGradientFilter;
 
   /** Variables to store the AdvancedTransform. */
   bool m_TransformIsAdvanced;
   typename AdvancedTransformType::Pointer           m_AdvancedTransform;
 
+  /** The cache of transform evaluations; may be 0. */
+  TransformEvaluationCachePointer                   m_TransformEvaluationCache;
+
   /** Variables for the Limiters. */
   typename FixedImageLimiterType::Pointer            m_FixedImageLimiter;
   typename MovingImageLimiterType::Pointer           m_MovingImageLimiter;
@@ -296,6 +449,19 @@ protected:
   MovingImageLimiterOutputType                       m_MovingImageMinLimit;
   MovingImageLimiterOutputType                       m_MovingImageMaxLimit;
 
+  /** Variables for the thread-safe test of the moving mask. The mutex
+   * serializes masks that are not an ImageMaskSpatialObject2; it is shared
+   * by all metrics, since they may share the mask.
+   */
+  const MovingImageMaskSpatialObjectType *           m_MovingImageMaskSpatialObject;
+  typename MovingImageMaskTransformType::Pointer     m_MovingImageMaskWorldToIndexTransform;
+  static SimpleFastMutexLock                         m_MovingImageMaskMutex;
+
+  /** Variables for multi-threading. */
+  ThreaderType::Pointer                              m_Threader;
+  mutable MultiThreaderParameterType                 m_ThreaderMetricParameters;
+  mutable EvaluationContextContainerType             m_EvaluationContexts;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -308,7 +474,9 @@ protected:
   itkSetMacro( UseImageSampler, bool );
 
   /** Check if enough samples have been found to compute a reliable
-   * estimate of the value/derivative; throws an exception if not. */
+   * estimate of the value/derivative; throws an exception if not.
+   * Stores found in m_NumberOfPixelsCounted, so it should not be called
+   * by the threads of a threaded evaluation. */
   virtual void CheckNumberOfSamples(
     unsigned long wanted, unsigned long found ) const;
 
@@ -330,11 +498,48 @@ protected:
     RealType & movingImageValue,
     MovingImageDerivativeType * gradient ) const;
 
+  /** Compute the image value (and possibly derivative) at a continuous index
+   * with the BSplineValueAndDerivativeKernel, which is specialized for the
+   * spline orders 1, 2 and 3. The interpolator should give access to its
+   * coefficients. Returns false if this is not possible, for other spline
+   * orders, or when the support of the spline is not inside the image.
+   * The gradient is in physical space, but not yet scaled by the
+   * MovingImageDerivativeScales. */
+  template < class TBSplineInterpolator >
+  bool EvaluateBSplineValueAndDerivative(
+    const TBSplineInterpolator * interpolator,
+    const MovingImageContinuousIndexType & cindex,
+    RealType & movingImageValue,
+    MovingImageDerivativeType * gradient ) const;
+
   /** Methods to support transforms with sparse Jacobians, like the BSplineTransform **********/
 
   /** Check if the transform is an AdvancedTransform. Called by Initialize. */
   virtual void CheckForAdvancedTransform( void );
 
+  /** Methods for evaluator support. ***************/
+
+  /** Pass the shared data and the settings of this metric to an evaluator
+   * of the same class, and set the transform of the evaluator, or a copy of
+   * the transform of this metric if transform is 0. Used by the
+   * CreateEvaluator() of inheriting classes. Returns false if the transform
+   * can not be copied.
+   */
+  bool InitializeEvaluator( Self * evaluator,
+    AdvancedTransformType * transform ) const;
+
+  /** Update the image sampler, unless SamplerIsPreUpdated is true. */
+  void UpdateImageSampler( void ) const;
+
+  /** Computes the inner product of the transform Jacobian with the moving
+   * image gradient, (dM/dx)^T (dT/dmu). The results are stored in
+   * imageJacobian, which is supposed to have the right size (same length
+   * as the number of columns of the Jacobian). */
+  virtual void EvaluateTransformJacobianInnerProduct(
+    const TransformJacobianType & jacobian,
+    const MovingImageDerivativeType & movingImageDerivative,
+    DerivativeType & imageJacobian ) const;
+
   /** Transform a point from FixedImage domain to MovingImage domain.
    * This function also checks if mapped point is within support region of
    * the transform. It returns true if so, and false otherwise.
@@ -354,9 +559,45 @@ protected:
     TransformJacobianType & jacobian,
     NonZeroJacobianIndicesType & nzji ) const;
 
-  /** Convenience method: check if point is inside the moving mask. *****************/
+  /** Transform the sample with index sampleIndex in the output of the image
+   * sampler, of which fixedImagePoint are the coordinates. The mapped point
+   * is taken from the transform evaluation cache, if that holds the sample.
+   */
+  bool TransformPoint(
+    const FixedImagePointType & fixedImagePoint,
+    unsigned long sampleIndex,
+    MovingImagePointType & mappedPoint ) const;
+
+  /** Get the transform Jacobian of the sample with index sampleIndex in the
+   * output of the image sampler. If the transform evaluation cache holds the
+   * sample, jacobian and nzji point into the cache, so that nothing is copied.
+   * Otherwise the Jacobian is computed in jacobianBuffer and nzjiBuffer, to
+   * which jacobian and nzji then point.
+   */
+  bool EvaluateTransformJacobian(
+    const FixedImagePointType & fixedImagePoint,
+    unsigned long sampleIndex,
+    TransformJacobianType & jacobianBuffer,
+    NonZeroJacobianIndicesType & nzjiBuffer,
+    const TransformJacobianType * & jacobian,
+    const NonZeroJacobianIndicesType * & nzji ) const;
+
+  /** Convenience method: check if point is inside the moving mask. *****************
+   * This method may be called by several threads at the same time. The
+   * IsInside() method of a spatial object is not thread-safe, since it
+   * updates an internal transform. Therefore, for an ImageMaskSpatialObject2,
+   * the map from world coordinates to mask indices is computed once, by
+   * InitializeMovingMask(), and the mask is tested with that map. Other
+   * kinds of masks are tested by one thread at a time.
+   */
   virtual bool IsInsideMovingMask( const MovingImagePointType & point ) const;
 
+  /** Prepare the thread-safe test of IsInsideMovingMask(). Called by
+   * Initialize(); call it again when the moving mask is replaced or modified
+   * after Initialize().
+   */
+  virtual void InitializeMovingMask( void );
+
   /** Methods for the support of gray value limiters. ***************/
 
   /** Compute the extrema of fixed image over a region
@@ -382,6 +623,119 @@ protected:
   itkSetMacro( UseFixedImageLimiter, bool );
   itkSetMacro( UseMovingImageLimiter, bool );
 
+  /** Methods for multi-threading support. ***************/
+
+  /** Make sure there is an evaluation context for every thread, of the right
+   * size. The derivatives and the Jacobian scratch memory are only reallocated
+   * when the number of threads, the number of parameters, or the number of
+   * nonzero Jacobian indices changed. Called at the start of a threaded
+   * computation.
+   */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Compute the range [begin, end) of samples that is processed by the
+   * thread with id threadID, when numberOfSamples samples are distributed
+   * evenly over the threads.
+   */
+  virtual void GetThreadSampleRange( unsigned int threadID,
+    unsigned long numberOfSamples,
+    unsigned long & begin, unsigned long & end ) const;
+
+  /** Set the transform parameters and update the image sampler, before
+   * the threads are launched.
+   */
+  virtual void BeforeThreadedGetValueAndDerivative(
+    const TransformParametersType & parameters ) const;
+
+  /** The generic threaded GetValueAndDerivative(): sets the parameters,
+   * launches the threads that execute ThreadedGetValueAndDerivative(), and
+   * combines their results with AfterThreadedGetValueAndDerivative().
+   */
+  void GetValueAndDerivativeMultiThreaded(
+    const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** The generic threaded GetValue(), which uses ThreadedGetValue() and
+   * AfterThreadedGetValue().
+   */
+  MeasureType GetValueMultiThreaded(
+    const TransformParametersType & parameters ) const;
+
+  /** Launch the threads that execute ThreadedGetValueAndDerivative(). */
+  virtual void LaunchGetValueAndDerivativeThreaderCallback( void ) const;
+
+  /** Compute the contribution of a part of the samples to the value and
+   * derivative. Each thread only writes to its own evaluation context.
+   * The default implementation loops over the samples of the thread, and
+   * for every valid sample computes the moving image value, the transform
+   * Jacobian and the image Jacobian in the context, and passes them to
+   * ThreadedUpdateValueAndDerivativeTerms(). Inheriting classes that
+   * support multi-threading should override that method, or this one.
+   */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Compute the contribution of one valid sample to the accumulators of
+   * the evaluation context, of which st_ImageJacobian and
+   * st_ImageJacobianIndices hold the image Jacobian of the sample.
+   * Called by the default ThreadedGetValueAndDerivative(). This default
+   * does nothing.
+   */
+  virtual void ThreadedUpdateValueAndDerivativeTerms(
+    const RealType itkNotUsed( fixedImageValue ),
+    const RealType itkNotUsed( movingImageValue ),
+    EvaluationContextStruct & itkNotUsed( context ) ) const {};
+
+  /** Combine the results of the threads. Inheriting classes that support
+   * multi-threading should override this method.
+   */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Launch the threads that execute ThreadedGetValue(). Call
+   * BeforeThreadedGetValueAndDerivative() first.
+   */
+  virtual void LaunchGetValueThreaderCallback( void ) const;
+
+  /** Compute the contribution of a part of the samples to the value only,
+   * without any derivative work. Each thread only writes the accumulators
+   * of its own evaluation context. The default implementation loops over
+   * the samples of the thread and passes the valid ones to
+   * ThreadedUpdateValueTerms(). Inheriting classes that support a
+   * multi-threaded GetValue() should override that method, or this one.
+   */
+  virtual void ThreadedGetValue( unsigned int threadID ) const;
+
+  /** Compute the contribution of one valid sample to the value accumulators
+   * of the evaluation context. Called by the default ThreadedGetValue().
+   * This default does nothing.
+   */
+  virtual void ThreadedUpdateValueTerms(
+    const RealType itkNotUsed( fixedImageValue ),
+    const RealType itkNotUsed( movingImageValue ),
+    EvaluationContextStruct & itkNotUsed( context ) ) const {};
+
+  /** Combine the values of the threads. Inheriting classes that support a
+   * multi-threaded GetValue() should override this method.
+   */
+  virtual void AfterThreadedGetValue( MeasureType & value ) const;
+
+  /** Sum the numbers of pixels counted and the values of all evaluation
+   * contexts, store the number of pixels in m_NumberOfPixelsCounted, and
+   * check if enough samples were valid. For use in the After* methods.
+   */
+  virtual void GatherThreadedValues( MeasureType & value ) const;
+
+  /** Sum the per-thread derivatives into derivative, scaled by
+   * normalizationFactor. The parameter range is distributed over the threads.
+   */
+  virtual void AccumulateDerivatives( DerivativeType & derivative,
+    const double normalizationFactor ) const;
+
+  /** The threader callbacks. */
+  static ITK_THREAD_RETURN_TYPE GetValueAndDerivativeThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE GetValueThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
+
 private:
   AdvancedImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -395,6 +749,9 @@ private:
   double  m_RequiredRatioOfValidSamples;
   bool    m_UseMovingImageDerivativeScales;
   MovingImageDerivativeScalesType m_MovingImageDerivativeScales;
+  bool    m_UseMultiThread;
+  bool    m_TransformParametersAreSetExternally;
+  bool    m_SamplerIsPreUpdated;
 
 }; // end class AdvancedImageToImageMetric
 
@@ -22,6 +22,16 @@
 namespace itk
 {
 
+/**
+ * ********************* Static member variables ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+SimpleFastMutexLock
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::m_MovingImageMaskMutex;
+
+
 /**
  * ********************* Constructor ****************************
  */
@@ -44,6 +54,8 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 
   this->m_BSplineInterpolator = 0;
   this->m_BSplineInterpolatorFloat = 0;
+  this->m_BSplineKernelInterpolator = 0;
+  this->m_BSplineKernelInterpolatorFloat = 0;
   this->m_InterpolatorIsBSpline = false;
   this->m_InterpolatorIsBSplineFloat = false;
   this->m_CentralDifferenceGradientFilter = 0;
@@ -67,9 +79,89 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   this->m_MovingImageMinLimit = NumericTraits< MovingImageLimiterOutputType >::Zero;
   this->m_MovingImageMaxLimit = NumericTraits< MovingImageLimiterOutputType >::One;
 
+  this->m_MovingImageMaskSpatialObject = 0;
+  this->m_MovingImageMaskWorldToIndexTransform = MovingImageMaskTransformType::New();
+
+  /** Threading related variables. */
+  this->m_UseMultiThread = true;
+  this->m_TransformParametersAreSetExternally = false;
+  this->m_SamplerIsPreUpdated = false;
+  this->m_Threader = ThreaderType::New();
+  this->m_ThreaderMetricParameters.st_Metric = this;
+  this->m_ThreaderMetricParameters.st_DerivativePointer = 0;
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+
 } // end Constructor
 
 
+/**
+ * ********************* SetNumberOfThreads ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::SetNumberOfThreads( unsigned int numberOfThreads )
+{
+  /** The threader clamps the number to [1, GlobalMaximumNumberOfThreads]. */
+  if ( static_cast<unsigned int>( this->m_Threader->GetNumberOfThreads() )
+    != numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfThreads( numberOfThreads );
+    this->Modified();
+  }
+
+} // end SetNumberOfThreads()
+
+
+/**
+ * ********************* GetNumberOfThreads ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+unsigned int
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetNumberOfThreads( void ) const
+{
+  return static_cast<unsigned int>( this->m_Threader->GetNumberOfThreads() );
+
+} // end GetNumberOfThreads()
+
+
+/**
+ * ********************* SetTransformParameters ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::SetTransformParameters( const ParametersType & parameters ) const
+{
+  if ( !this->m_TransformParametersAreSetExternally )
+  {
+    this->Superclass::SetTransformParameters( parameters );
+  }
+
+} // end SetTransformParameters()
+
+
+/**
+ * ********************* UpdateImageSampler ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::UpdateImageSampler( void ) const
+{
+  if ( !this->m_SamplerIsPreUpdated )
+  {
+    this->UpdateImageSampler();
+  }
+
+} // end UpdateImageSampler()
+
+
 /**
  * ********************* Initialize ****************************
  */
@@ -94,9 +186,37 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   /** Check if the transform is an advanced transform. */
   this->CheckForAdvancedTransform();
 
+  /** Prepare the thread-safe test of the moving mask. */
+  this->InitializeMovingMask();
+
 } // end Initialize()
 
 
+/**
+ * ********************* InitializeMovingMask ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeMovingMask( void )
+{
+  this->m_MovingImageMaskSpatialObject = 0;
+  if ( this->m_MovingImageMask.IsNull() ) return;
+
+  /** Compute the world-to-index transform of an image mask once. */
+  const MovingImageMaskSpatialObjectType * mask
+    = dynamic_cast<const MovingImageMaskSpatialObjectType *>(
+    this->m_MovingImageMask.GetPointer() );
+  if ( mask && mask->ComputeWorldToIndexTransform(
+    this->m_MovingImageMaskWorldToIndexTransform ) )
+  {
+    this->m_MovingImageMaskSpatialObject = mask;
+  }
+
+} // end InitializeMovingMask()
+
+
 /**
  * ****************** ComputeFixedImageExtrema ***************************
  */
@@ -350,6 +470,14 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
     itkDebugMacro( "Interpolator is not BSplineFloat" );
   }
 
+  /** Check if the B-spline interpolator gives access to its coefficients,
+   * so that the BSplineValueAndDerivativeKernel can be used.
+   */
+  this->m_BSplineKernelInterpolator = dynamic_cast<BSplineKernelInterpolatorType *>(
+    this->m_BSplineInterpolator.GetPointer() );
+  this->m_BSplineKernelInterpolatorFloat = dynamic_cast<BSplineKernelInterpolatorFloatType *>(
+    this->m_BSplineInterpolatorFloat.GetPointer() );
+
   /** Don't overwrite the gradient image if GetComputeGradient() == true.
    * Otherwise we can use a forward difference derivative, or the derivative
    * provided by the B-spline interpolator.
@@ -408,6 +536,103 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end CheckForBSplineTransform()
 
 
+/**
+ * ****************** CreateEvaluator **********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename AdvancedImageToImageMetric<TFixedImage,TMovingImage>::Pointer
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::CreateEvaluator( AdvancedTransformType * ) const
+{
+  /** Inheriting classes that support evaluators override this method. */
+  return 0;
+
+} // end CreateEvaluator()
+
+
+/**
+ * ****************** InitializeEvaluator **********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeEvaluator( Self * evaluator, AdvancedTransformType * transform ) const
+{
+  /** Set the transform, or a copy of the transform of this metric. */
+  typename AdvancedTransformType::Pointer evaluatorTransform = transform;
+  if ( evaluatorTransform.IsNull() && this->m_AdvancedTransform.IsNotNull() )
+  {
+    evaluatorTransform = this->m_AdvancedTransform->CreateEvaluationCopy();
+  }
+  if ( evaluatorTransform.IsNull() )
+  {
+    return false;
+  }
+  evaluator->SetTransform( evaluatorTransform );
+
+  /** Share the images, masks and interpolator. The evaluator is not
+   * initialized, since that would for example recompute the coefficients
+   * of a B-spline interpolator; the results of the initialization of this
+   * metric are copied instead.
+   */
+  evaluator->m_FixedImage = this->m_FixedImage;
+  evaluator->m_MovingImage = this->m_MovingImage;
+  evaluator->m_FixedImageMask = this->m_FixedImageMask;
+  evaluator->m_MovingImageMask = this->m_MovingImageMask;
+  evaluator->InitializeMovingMask();
+  evaluator->m_FixedImageRegion = this->m_FixedImageRegion;
+  evaluator->m_Interpolator = this->m_Interpolator;
+  evaluator->m_ComputeGradient = this->m_ComputeGradient;
+  evaluator->m_GradientImage = this->m_GradientImage;
+
+  /** Share the image sampler. The evaluators never update it, since they
+   * run concurrently; it is updated before they are evaluated, see
+   * ParallelCostFunctionEvaluator::AddSharedDataSource().
+   */
+  evaluator->m_UseImageSampler = this->m_UseImageSampler;
+  evaluator->m_ImageSampler = this->m_ImageSampler;
+  evaluator->m_SamplerIsPreUpdated = true;
+  evaluator->m_RequiredRatioOfValidSamples = this->m_RequiredRatioOfValidSamples;
+
+  /** Share the image derivative computation. */
+  evaluator->m_InterpolatorIsBSpline = this->m_InterpolatorIsBSpline;
+  evaluator->m_InterpolatorIsBSplineFloat = this->m_InterpolatorIsBSplineFloat;
+  evaluator->m_BSplineInterpolator = this->m_BSplineInterpolator;
+  evaluator->m_BSplineInterpolatorFloat = this->m_BSplineInterpolatorFloat;
+  evaluator->m_BSplineKernelInterpolator = this->m_BSplineKernelInterpolator;
+  evaluator->m_BSplineKernelInterpolatorFloat = this->m_BSplineKernelInterpolatorFloat;
+  evaluator->m_CentralDifferenceGradientFilter = this->m_CentralDifferenceGradientFilter;
+  evaluator->m_UseMovingImageDerivativeScales = this->m_UseMovingImageDerivativeScales;
+  evaluator->m_MovingImageDerivativeScales = this->m_MovingImageDerivativeScales;
+
+  /** Share the limiters. */
+  evaluator->m_UseFixedImageLimiter = this->m_UseFixedImageLimiter;
+  evaluator->m_UseMovingImageLimiter = this->m_UseMovingImageLimiter;
+  evaluator->m_FixedImageLimiter = this->m_FixedImageLimiter;
+  evaluator->m_MovingImageLimiter = this->m_MovingImageLimiter;
+  evaluator->m_FixedLimitRangeRatio = this->m_FixedLimitRangeRatio;
+  evaluator->m_MovingLimitRangeRatio = this->m_MovingLimitRangeRatio;
+  evaluator->m_FixedImageTrueMin = this->m_FixedImageTrueMin;
+  evaluator->m_FixedImageTrueMax = this->m_FixedImageTrueMax;
+  evaluator->m_MovingImageTrueMin = this->m_MovingImageTrueMin;
+  evaluator->m_MovingImageTrueMax = this->m_MovingImageTrueMax;
+  evaluator->m_FixedImageMinLimit = this->m_FixedImageMinLimit;
+  evaluator->m_FixedImageMaxLimit = this->m_FixedImageMaxLimit;
+  evaluator->m_MovingImageMinLimit = this->m_MovingImageMinLimit;
+  evaluator->m_MovingImageMaxLimit = this->m_MovingImageMaxLimit;
+
+  /** The evaluators themselves are evaluated concurrently. */
+  evaluator->m_UseMultiThread = false;
+  evaluator->m_TransformParametersAreSetExternally = false;
+  evaluator->m_TransformEvaluationCache = 0;
+
+  return true;
+
+} // end InitializeEvaluator()
+
+
 /**
  * ******************* EvaluateMovingImageValueAndDerivative ******************
  *
@@ -422,17 +647,45 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   RealType & movingImageValue,
   MovingImageDerivativeType * gradient ) const
 {
+  tmr::ProfilerScope profilerScope( tmr::Profiler::Interpolation );
+
   /** Check if mapped point inside image buffer. */
   MovingImageContinuousIndexType cindex;
   this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
   bool sampleOk = this->m_Interpolator->IsInsideBuffer( cindex );
   if ( sampleOk )
   {
+    /** For B-spline interpolators, first try to compute the value and
+     * the derivative at once, with the fixed-order kernel.
+     */
+    MovingImageDerivativeType * bsplineGradient
+      = this->GetComputeGradient() ? 0 : gradient;
+    bool computedByKernel = false;
+    if ( this->m_BSplineKernelInterpolator.IsNotNull() )
+    {
+      computedByKernel = this->EvaluateBSplineValueAndDerivative(
+        this->m_BSplineKernelInterpolator.GetPointer(), cindex,
+        movingImageValue, bsplineGradient );
+    }
+    else if ( this->m_BSplineKernelInterpolatorFloat.IsNotNull() )
+    {
+      computedByKernel = this->EvaluateBSplineValueAndDerivative(
+        this->m_BSplineKernelInterpolatorFloat.GetPointer(), cindex,
+        movingImageValue, bsplineGradient );
+    }
+
     /** Compute value and possibly derivative. */
-    movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex( cindex );
+    if ( !computedByKernel )
+    {
+      movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex( cindex );
+    }
     if ( gradient )
     {
-      if ( this->m_InterpolatorIsBSpline && !this->GetComputeGradient() )
+      if ( computedByKernel && bsplineGradient )
+      {
+        /** The kernel already computed the gradient. */
+      }
+      else if ( this->m_InterpolatorIsBSpline && !this->GetComputeGradient() )
       {
         /** Computed moving image gradient using derivative B-spline kernel. */
         (*gradient)
@@ -471,6 +724,90 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end EvaluateMovingImageValueAndDerivative()
 
 
+/**
+ * ******************* EvaluateBSplineValueAndDerivative ******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+template < class TBSplineInterpolator >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateBSplineValueAndDerivative(
+  const TBSplineInterpolator * interpolator,
+  const MovingImageContinuousIndexType & cindex,
+  RealType & movingImageValue,
+  MovingImageDerivativeType * gradient ) const
+{
+  typedef typename TBSplineInterpolator::CoefficientImageType CoefficientImageType;
+  typedef typename CoefficientImageType::PixelType            CoefficientType;
+
+  const unsigned int splineOrder = interpolator->GetSplineOrder();
+  const CoefficientImageType * coefficientImage = interpolator->GetCoefficients();
+  if ( splineOrder < 1 || splineOrder > 3 || coefficientImage == 0 )
+  {
+    return false;
+  }
+
+  /** The continuous index relative to the start of the buffer. */
+  const typename CoefficientImageType::RegionType & region
+    = coefficientImage->GetBufferedRegion();
+  double relativeIndex[ MovingImageDimension ];
+  unsigned long size[ MovingImageDimension ];
+  for ( unsigned int d = 0; d < MovingImageDimension; ++d )
+  {
+    relativeIndex[ d ] = cindex[ d ] - static_cast<double>( region.GetIndex()[ d ] );
+    size[ d ] = region.GetSize()[ d ];
+  }
+
+  /** Evaluate the kernel of the spline order. It computes in the
+   * coefficient type, so in single precision for the float interpolator.
+   */
+  const CoefficientType * buffer = coefficientImage->GetBufferPointer();
+  CoefficientType value;
+  CoefficientType derivative[ MovingImageDimension ];
+  CoefficientType * derivativePointer = gradient ? derivative : 0;
+  bool inside = false;
+  switch ( splineOrder )
+  {
+    case 1:
+      inside = BSplineValueAndDerivativeKernel< MovingImageDimension, 1, CoefficientType >
+        ::Evaluate( buffer, size, relativeIndex, value, derivativePointer );
+      break;
+    case 2:
+      inside = BSplineValueAndDerivativeKernel< MovingImageDimension, 2, CoefficientType >
+        ::Evaluate( buffer, size, relativeIndex, value, derivativePointer );
+      break;
+    case 3:
+      inside = BSplineValueAndDerivativeKernel< MovingImageDimension, 3, CoefficientType >
+        ::Evaluate( buffer, size, relativeIndex, value, derivativePointer );
+      break;
+  }
+  if ( !inside ) return false;
+
+  movingImageValue = static_cast<RealType>( value );
+  if ( gradient )
+  {
+    /** Convert the derivative to physical space, like the interpolator does. */
+    for ( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      (*gradient)[ d ] = derivative[ d ] / coefficientImage->GetSpacing()[ d ];
+    }
+#ifdef ITK_USE_ORIENTED_IMAGE_DIRECTION
+    if ( interpolator->GetUseImageDirection() )
+    {
+      MovingImageDerivativeType orientedGradient;
+      this->m_MovingImage->TransformLocalVectorToPhysicalVector(
+        *gradient, orientedGradient );
+      (*gradient) = orientedGradient;
+    }
+#endif
+  }
+
+  return true;
+
+} // end EvaluateBSplineValueAndDerivative()
+
+
 /**
  * ********************** TransformPoint ************************
  *
@@ -486,6 +823,8 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   const FixedImagePointType & fixedImagePoint,
   MovingImagePointType & mappedPoint ) const
 {
+  tmr::ProfilerScope profilerScope( tmr::Profiler::TransformPoint );
+
   mappedPoint = this->m_Transform->TransformPoint( fixedImagePoint );
 
   /** For future use: return whether the sample is valid */
@@ -507,6 +846,8 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   TransformJacobianType & jacobian,
   NonZeroJacobianIndicesType & nzji) const
 {
+  tmr::ProfilerScope profilerScope( tmr::Profiler::GetJacobian );
+
   /** Advanced transform: generic sparse Jacobian support */
   this->m_AdvancedTransform->GetJacobian(
     fixedImagePoint, jacobian, nzji );
@@ -518,6 +859,102 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end EvaluateTransformJacobian()
 
 
+/**
+ * ********************** TransformPoint ************************
+ *
+ * Transform an image sample, using the transform evaluation cache.
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::TransformPoint(
+  const FixedImagePointType & fixedImagePoint,
+  unsigned long sampleIndex,
+  MovingImagePointType & mappedPoint ) const
+{
+  /** Take the mapped point from the cache, if possible. Its computation
+   * was already profiled by the cache.
+   */
+  if ( this->m_TransformEvaluationCache.IsNotNull()
+    && this->m_TransformEvaluationCache->GetMappedPoint(
+    sampleIndex, fixedImagePoint, mappedPoint ) )
+  {
+    return true;
+  }
+
+  return this->TransformPoint( fixedImagePoint, mappedPoint );
+
+} // end TransformPoint()
+
+
+/**
+ * *************** EvaluateTransformJacobian ****************
+ *
+ * Get the transform Jacobian of an image sample, using the transform
+ * evaluation cache.
+ */
+
+template < class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateTransformJacobian(
+  const FixedImagePointType & fixedImagePoint,
+  unsigned long sampleIndex,
+  TransformJacobianType & jacobianBuffer,
+  NonZeroJacobianIndicesType & nzjiBuffer,
+  const TransformJacobianType * & jacobian,
+  const NonZeroJacobianIndicesType * & nzji ) const
+{
+  /** Refer to the Jacobian in the cache, if possible. */
+  if ( this->m_TransformEvaluationCache.IsNotNull()
+    && this->m_TransformEvaluationCache->GetJacobian(
+    sampleIndex, fixedImagePoint, jacobian, nzji ) )
+  {
+    return true;
+  }
+
+  jacobian = &jacobianBuffer;
+  nzji = &nzjiBuffer;
+  return this->EvaluateTransformJacobian(
+    fixedImagePoint, jacobianBuffer, nzjiBuffer );
+
+} // end EvaluateTransformJacobian()
+
+
+/**
+ * *************** EvaluateTransformJacobianInnerProduct ****************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::EvaluateTransformJacobianInnerProduct(
+  const TransformJacobianType & jacobian,
+  const MovingImageDerivativeType & movingImageDerivative,
+  DerivativeType & imageJacobian ) const
+{
+  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
+  typedef typename DerivativeType::iterator              DerivativeIteratorType;
+  JacobianIteratorType jac = jacobian.begin();
+  imageJacobian.Fill( 0.0 );
+  const unsigned int sizeImageJacobian = imageJacobian.GetSize();
+  for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
+  {
+    const double imDeriv = movingImageDerivative[ dim ];
+    DerivativeIteratorType imjac = imageJacobian.begin();
+
+    for ( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
+    {
+      (*imjac) += (*jac) * imDeriv;
+      ++imjac;
+      ++jac;
+    }
+  }
+
+} // end EvaluateTransformJacobianInnerProduct()
+
+
 /**
  * ************************** IsInsideMovingMask *************************
  * Check if point is inside moving mask
@@ -528,14 +965,28 @@ bool
 AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 ::IsInsideMovingMask( const MovingImagePointType & point ) const
 {
-  /** If a mask has been set: */
-  if ( this->m_MovingImageMask.IsNotNull() )
+  /** If no mask has been set, just return true. */
+  if ( this->m_MovingImageMask.IsNull() )
   {
-    return this->m_MovingImageMask->IsInside( point );
+    return true;
   }
 
-  /** If no mask has been set, just return true. */
-  return true;
+  /** Use the precomputed world-to-index transform of an image mask, which
+   * does not modify the mask. The pointers are compared, in case the mask
+   * was replaced after InitializeMovingMask().
+   */
+  if ( this->m_MovingImageMaskSpatialObject != 0
+    && this->m_MovingImageMaskSpatialObject == this->m_MovingImageMask.GetPointer() )
+  {
+    return this->m_MovingImageMaskSpatialObject->IsInsideUsingWorldToIndexTransform(
+      point, this->m_MovingImageMaskWorldToIndexTransform );
+  }
+
+  /** Other masks modify themselves in IsInside(), so one thread at a time. */
+  this->m_MovingImageMaskMutex.Lock();
+  const bool inside = this->m_MovingImageMask->IsInside( point );
+  this->m_MovingImageMaskMutex.Unlock();
+  return inside;
 
 } // end IsInsideMovingMask()
 
@@ -586,6 +1037,536 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
 } // end CheckNumberOfSamples()
 
 
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  /** The global maximum may have changed since the threader was created,
+   * for example by the MaximumNumberOfThreads setting of elastix. Setting
+   * the number of threads again makes sure it is within bounds.
+   */
+  this->m_Threader->SetNumberOfThreads( this->m_Threader->GetNumberOfThreads() );
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  const unsigned long nnzji = this->m_AdvancedTransform.IsNotNull()
+    ? this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() : 0;
+
+  /** Only resize the evaluation contexts if needed, since the derivatives
+   * may be large. They are zeroed by the threads themselves.
+   */
+  if ( this->m_EvaluationContexts.size() != numberOfThreads )
+  {
+    this->m_EvaluationContexts.resize( numberOfThreads );
+  }
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    EvaluationContextStruct & context = this->m_EvaluationContexts[ i ];
+    context.st_ThreadID = i;
+    context.st_NumberOfPixelsCounted = 0;
+    context.st_Value = NumericTraits<MeasureType>::Zero;
+    context.st_ImageJacobianIndices = &context.st_NonZeroJacobianIndices;
+    if ( context.st_Derivative.GetSize() != numberOfParameters )
+    {
+      context.st_Derivative.SetSize( numberOfParameters );
+    }
+    if ( context.st_NonZeroJacobianIndices.size() != nnzji )
+    {
+      context.st_NonZeroJacobianIndices.resize( nnzji );
+    }
+    if ( context.st_ImageJacobian.GetSize() != nnzji )
+    {
+      context.st_ImageJacobian.SetSize( nnzji );
+    }
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* GetThreadSampleRange *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetThreadSampleRange( unsigned int threadID,
+  unsigned long numberOfSamples,
+  unsigned long & begin, unsigned long & end ) const
+{
+  const unsigned long numberOfThreads = this->GetNumberOfThreads();
+  const unsigned long chunk
+    = ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads;
+
+  begin = vnl_math_min( numberOfSamples, threadID * chunk );
+  end = vnl_math_min( numberOfSamples, begin + chunk );
+
+} // end GetThreadSampleRange()
+
+
+/**
+ * ******************* BeforeThreadedGetValueAndDerivative *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::BeforeThreadedGetValueAndDerivative(
+  const TransformParametersType & parameters ) const
+{
+  /** Make sure the transform parameters are up to date. */
+  this->SetTransformParameters( parameters );
+
+  /** Update the image sampler, which is not thread-safe. */
+  if ( this->m_UseImageSampler )
+  {
+    this->UpdateImageSampler();
+  }
+
+  /** Prepare the per-thread variables. */
+  this->InitializeThreadingParameters();
+
+} // end BeforeThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivativeMultiThreaded *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeMultiThreaded(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Set the parameters, update the sampler and prepare the contexts. */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Launch the threads. */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Gather the results of all threads. */
+  this->AfterThreadedGetValueAndDerivative( value, derivative );
+
+} // end GetValueAndDerivativeMultiThreaded()
+
+
+/**
+ * ******************* GetValueMultiThreaded *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+typename AdvancedImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueMultiThreaded( const TransformParametersType & parameters ) const
+{
+  /** Set the parameters, update the sampler and prepare the contexts. */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** Launch the threads. */
+  this->LaunchGetValueThreaderCallback();
+
+  /** Gather the results of all threads. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetValue( value );
+  return value;
+
+} // end GetValueMultiThreaded()
+
+
+/**
+ * ******************* LaunchGetValueAndDerivativeThreaderCallback *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::LaunchGetValueAndDerivativeThreaderCallback( void ) const
+{
+  this->m_Threader->SetSingleMethod(
+    this->GetValueAndDerivativeThreaderCallback,
+    const_cast<void *>( static_cast<const void *>(
+    &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * ******************* GetValueAndDerivativeThreaderCallback *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+
+  MultiThreaderParameterType * temp
+    = static_cast<MultiThreaderParameterType *>( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetValueAndDerivative( threadID );
+
+  /** Add the profiled times of this thread, before it ends. */
+  tmr::Profiler::FlushThread();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  /** The context of this thread, which holds its accumulators and scratch. */
+  EvaluationContextStruct & context = this->m_EvaluationContexts[ threadID ];
+  context.st_Derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+
+  /** Get a handle to the sample container and the part of it for this thread. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  unsigned long posBegin = 0;
+  unsigned long posEnd = 0;
+  this->GetThreadSampleRange( threadID, sampleContainer->Size(), posBegin, posEnd );
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+  fbegin += posBegin;
+  fend += posEnd;
+
+  /** Loop over the part of the fixed image samples of this thread. */
+  unsigned long numberOfPixelsCounted = 0;
+  for ( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+    RealType movingImageValue;
+    MovingImagePointType mappedPoint;
+    MovingImageDerivativeType movingImageDerivative;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
+
+    /** Check if point is inside mask. */
+    if ( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+     * the point is inside the moving image buffer.
+     */
+    if ( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, &movingImageDerivative );
+    }
+
+    if ( sampleOk )
+    {
+      ++numberOfPixelsCounted;
+
+      /** Get the fixed image value. */
+      const RealType fixedImageValue
+        = static_cast<RealType>( (*fiter).Value().m_ImageValue );
+
+      /** Get the TransformJacobian dT/dmu, from the cache or in the scratch
+       * of this thread.
+       */
+      const TransformJacobianType * jacobian = 0;
+      this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+        context.st_Jacobian, context.st_NonZeroJacobianIndices,
+        jacobian, context.st_ImageJacobianIndices );
+
+      /** Compute the inner products (dM/dx)^T (dT/dmu). */
+      this->EvaluateTransformJacobianInnerProduct(
+        *jacobian, movingImageDerivative, context.st_ImageJacobian );
+
+      /** Compute this sample's contribution to the accumulators. */
+      this->ThreadedUpdateValueAndDerivativeTerms(
+        fixedImageValue, movingImageValue, context );
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+  /** Store the number of valid samples of this thread. */
+  context.st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & itkNotUsed( value ),
+  DerivativeType & itkNotUsed( derivative ) ) const
+{
+  itkExceptionMacro( << "AfterThreadedGetValueAndDerivative() is not "
+    << "implemented by this metric." );
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* LaunchGetValueThreaderCallback *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::LaunchGetValueThreaderCallback( void ) const
+{
+  this->m_Threader->SetSingleMethod(
+    this->GetValueThreaderCallback,
+    const_cast<void *>( static_cast<const void *>(
+    &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetValueThreaderCallback()
+
+
+/**
+ * ******************* GetValueThreaderCallback *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+
+  MultiThreaderParameterType * temp
+    = static_cast<MultiThreaderParameterType *>( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetValue( threadID );
+
+  /** Add the profiled times of this thread, before it ends. */
+  tmr::Profiler::FlushThread();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetValueThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValue( unsigned int threadID ) const
+{
+  /** The context of this thread. */
+  EvaluationContextStruct & context = this->m_EvaluationContexts[ threadID ];
+
+  /** Get a handle to the sample container and the part of it for this thread. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  unsigned long posBegin = 0;
+  unsigned long posEnd = 0;
+  this->GetThreadSampleRange( threadID, sampleContainer->Size(), posBegin, posEnd );
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+  fbegin += posBegin;
+  fend += posEnd;
+
+  /** Loop over the part of the fixed image samples of this thread. */
+  unsigned long numberOfPixelsCounted = 0;
+  for ( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+    RealType movingImageValue;
+    MovingImagePointType mappedPoint;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
+
+    /** Check if point is inside mask. */
+    if ( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value and check if the point is
+     * inside the moving image buffer. No derivative is needed.
+     */
+    if ( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, 0 );
+    }
+
+    if ( sampleOk )
+    {
+      ++numberOfPixelsCounted;
+
+      /** Get the fixed image value. */
+      const RealType fixedImageValue
+        = static_cast<RealType>( (*fiter).Value().m_ImageValue );
+
+      /** Compute this sample's contribution to the accumulators. */
+      this->ThreadedUpdateValueTerms( fixedImageValue, movingImageValue, context );
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+  /** Store the number of valid samples of this thread. */
+  context.st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValue( MeasureType & itkNotUsed( value ) ) const
+{
+  itkExceptionMacro( << "AfterThreadedGetValue() is not implemented "
+    << "by this metric." );
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ******************* GatherThreadedValues *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::GatherThreadedValues( MeasureType & value ) const
+{
+  /** Sum the number of valid samples and the value of all threads. */
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  unsigned long numberOfPixelsCounted = 0;
+  value = NumericTraits< MeasureType >::Zero;
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    numberOfPixelsCounted += this->m_EvaluationContexts[ i ].st_NumberOfPixelsCounted;
+    value += this->m_EvaluationContexts[ i ].st_Value;
+  }
+
+  /** Check if enough samples were valid; stores m_NumberOfPixelsCounted. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples( sampleContainer->Size(), numberOfPixelsCounted );
+
+} // end GatherThreadedValues()
+
+
+/**
+ * ******************* AccumulateDerivatives *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::AccumulateDerivatives( DerivativeType & derivative,
+  const double normalizationFactor ) const
+{
+  tmr::ProfilerScope profilerScope( tmr::Profiler::MetricAccumulation );
+
+  /** Make sure the derivative has the right size. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if ( derivative.GetSize() != numberOfParameters )
+  {
+    derivative.SetSize( numberOfParameters );
+  }
+
+  /** For a single thread there is nothing to distribute. */
+  if ( this->GetNumberOfThreads() == 1 )
+  {
+    derivative = this->m_EvaluationContexts[ 0 ].st_Derivative;
+    derivative *= normalizationFactor;
+    return;
+  }
+
+  /** Distribute the summation over the threads. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer = &derivative;
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = normalizationFactor;
+  this->m_Threader->SetSingleMethod(
+    this->AccumulateDerivativesThreaderCallback,
+    const_cast<void *>( static_cast<const void *>(
+    &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+  this->m_ThreaderMetricParameters.st_DerivativePointer = 0;
+
+} // end AccumulateDerivatives()
+
+
+/**
+ * ******************* AccumulateDerivativesThreaderCallback *******************
+ */
+
+template < class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage,TMovingImage>
+::AccumulateDerivativesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+
+  MultiThreaderParameterType * temp
+    = static_cast<MultiThreaderParameterType *>( infoStruct->UserData );
+  const Self * metric = temp->st_Metric;
+
+  /** Get the range of parameters that this thread sums. */
+  unsigned long jmin = 0;
+  unsigned long jmax = 0;
+  metric->GetThreadSampleRange( threadID,
+    metric->GetNumberOfParameters(), jmin, jmax );
+
+  /** Sum the contributions of all threads and normalize. */
+  const EvaluationContextContainerType & perThread
+    = metric->m_EvaluationContexts;
+  const unsigned int numberOfThreads = perThread.size();
+  DerivativeType & derivative = *( temp->st_DerivativePointer );
+  const double normal = temp->st_NormalizationFactor;
+  for ( unsigned long j = jmin; j < jmax; ++j )
+  {
+    DerivativeValueType sum = NumericTraits<DerivativeValueType>::Zero;
+    for ( unsigned int i = 0; i < numberOfThreads; ++i )
+    {
+      sum += perThread[ i ].st_Derivative[ j ];
+    }
+    derivative[ j ] = sum * normal;
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end AccumulateDerivativesThreaderCallback()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -654,6 +1635,8 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
     << this->m_TransformIsAdvanced << std::endl;
   os << indent.GetNextIndent() << "AdvancedTransform: "
     << this->m_AdvancedTransform.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "TransformEvaluationCache: "
+    << this->m_TransformEvaluationCache.GetPointer() << std::endl;
 
   /** Other variables. */
   os << indent << "Other variables of the AdvancedImageToImageMetric: " << std::endl;
@@ -664,6 +1647,17 @@ AdvancedImageToImageMetric<TFixedImage,TMovingImage>
   os << indent.GetNextIndent() << "MovingImageDerivativeScales: "
     << this->m_MovingImageDerivativeScales << std::endl;
 
+  /** Variables related to multi-threading. */
+  os << indent << "Variables related to multi-threading: " << std::endl;
+  os << indent.GetNextIndent() << "UseMultiThread: "
+    << this->m_UseMultiThread << std::endl;
+  os << indent.GetNextIndent() << "TransformParametersAreSetExternally: "
+    << this->m_TransformParametersAreSetExternally << std::endl;
+  os << indent.GetNextIndent() << "SamplerIsPreUpdated: "
+    << this->m_SamplerIsPreUpdated << std::endl;
+  os << indent.GetNextIndent() << "Threader: "
+    << this->m_Threader.GetPointer() << std::endl;
+
 } // end PrintSelf()
 
 
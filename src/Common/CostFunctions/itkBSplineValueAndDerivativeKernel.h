@@ -0,0 +1,282 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBSplineValueAndDerivativeKernel_h
+#define __itkBSplineValueAndDerivativeKernel_h
+
+#include "itkMacro.h"
+#include "vcl_cmath.h"
+
+namespace itk
+{
+
+/** \class BSplineValueAndDerivativeKernel
+ *
+ * \brief Evaluates a B-spline interpolated image and its derivative at once,
+ * for a fixed dimension and spline order.
+ *
+ * The BSplineInterpolateImageFunction supports any dimension and spline
+ * order, and therefore stores its weights in dynamically allocated matrices
+ * and loops over a table of support points. Moreover, the value and the
+ * derivative are computed in separate calls, which both compute the weights
+ * and read the coefficients. This class does the same computation with the
+ * dimension and the spline order known at compile time: all storage is on
+ * the stack, the weight loops have fixed lengths, and the value and the
+ * derivative are accumulated in one pass over the coefficients, along the
+ * contiguous first dimension. The weights and the sums are computed in
+ * TRealType, which is the coefficient type by default, so single precision
+ * for float coefficients. The BSplineInterpolateImageFunction computes in
+ * double precision; use TRealType = double to do the same.
+ *
+ * The result equals that of the BSplineInterpolateImageFunction up to
+ * round-off, but only when the support of the spline lies entirely inside
+ * the coefficient image. Evaluate() returns false otherwise, in which case
+ * the caller should fall back to the interpolator, which applies the mirror
+ * boundary conditions.
+ *
+ * Spline orders 1, 2 and 3 are supported.
+ *
+ * \ingroup ImageFunctions
+ */
+
+template < unsigned int VDimension, unsigned int VSplineOrder,
+  class TCoefficient, class TRealType = TCoefficient >
+class BSplineValueAndDerivativeKernel
+{
+public:
+
+  /** Standard typedefs. */
+  typedef BSplineValueAndDerivativeKernel   Self;
+  typedef TCoefficient                      CoefficientType;
+  typedef TRealType                         RealType;
+
+  /** The dimension, the spline order and the support size. */
+  itkStaticConstMacro( Dimension, unsigned int, VDimension );
+  itkStaticConstMacro( SplineOrder, unsigned int, VSplineOrder );
+  itkStaticConstMacro( SupportSize, unsigned int, VSplineOrder + 1 );
+
+  /** Evaluate the value and optionally the derivative.
+   *
+   * \param coefficients The buffer of the coefficient image.
+   * \param size The size of the coefficient image.
+   * \param cindex The continuous index, relative to the start of the buffer.
+   * \param value The interpolated value.
+   * \param derivative If not null, the derivative with respect to the
+   *   continuous index, so not yet divided by the spacing.
+   * \return Whether the support lies inside the buffer; if not, nothing is
+   *   computed.
+   */
+  static bool Evaluate(
+    const CoefficientType * coefficients,
+    const unsigned long * size,
+    const double * cindex,
+    RealType & value,
+    RealType * derivative )
+  {
+    /** Compute the first index of the support and the weights per dimension. */
+    long start[ VDimension ];
+    long stride[ VDimension ];
+    RealType weights[ VDimension ][ VSplineOrder + 1 ];
+    RealType derivativeWeights[ VDimension ][ VSplineOrder + 1 ];
+    long offset = 0;
+    for ( unsigned int d = 0; d < VDimension; ++d )
+    {
+      /** The same support as the BSplineInterpolateImageFunction. */
+      if ( VSplineOrder & 1 )
+      {
+        start[ d ] = static_cast<long>( vcl_floor( static_cast<float>( cindex[ d ] ) ) )
+          - static_cast<long>( VSplineOrder / 2 );
+      }
+      else
+      {
+        start[ d ] = static_cast<long>( vcl_floor( static_cast<float>( cindex[ d ] ) + 0.5f ) )
+          - static_cast<long>( VSplineOrder / 2 );
+      }
+      if ( start[ d ] < 0
+        || start[ d ] + static_cast<long>( VSplineOrder ) >= static_cast<long>( size[ d ] ) )
+      {
+        return false;
+      }
+
+      stride[ d ] = ( d == 0 ) ? 1 : stride[ d - 1 ] * static_cast<long>( size[ d - 1 ] );
+      offset += start[ d ] * stride[ d ];
+
+      /** The position relative to the centre of the support. */
+      const RealType t = static_cast<RealType>(
+        cindex[ d ] - static_cast<double>( start[ d ] + ( VSplineOrder / 2 ) ) );
+      Self::ComputeWeights( t, weights[ d ] );
+      if ( derivative )
+      {
+        Self::ComputeDerivativeWeights( t, derivativeWeights[ d ] );
+      }
+    }
+
+    /** The number of rows of the support along the first dimension. */
+    unsigned int numberOfRows = 1;
+    for ( unsigned int d = 1; d < VDimension; ++d )
+    {
+      numberOfRows *= VSplineOrder + 1;
+    }
+
+    /** Accumulate the value and the derivative row by row. */
+    value = 0;
+    if ( derivative )
+    {
+      for ( unsigned int d = 0; d < VDimension; ++d ) derivative[ d ] = 0;
+    }
+    unsigned int rowIndex[ VDimension ];
+    for ( unsigned int d = 0; d < VDimension; ++d ) rowIndex[ d ] = 0;
+
+    for ( unsigned int row = 0; row < numberOfRows; ++row )
+    {
+      /** Interpolate along the first, contiguous, dimension. */
+      long rowOffset = offset;
+      for ( unsigned int d = 1; d < VDimension; ++d )
+      {
+        rowOffset += rowIndex[ d ] * stride[ d ];
+      }
+      const CoefficientType * c = coefficients + rowOffset;
+      RealType rowValue = 0;
+      for ( unsigned int i = 0; i <= VSplineOrder; ++i )
+      {
+        rowValue += weights[ 0 ][ i ] * c[ i ];
+      }
+
+      /** The weight of this row. */
+      RealType rowWeight = 1;
+      for ( unsigned int d = 1; d < VDimension; ++d )
+      {
+        rowWeight *= weights[ d ][ rowIndex[ d ] ];
+      }
+      value += rowWeight * rowValue;
+
+      if ( derivative )
+      {
+        RealType rowDerivative = 0;
+        for ( unsigned int i = 0; i <= VSplineOrder; ++i )
+        {
+          rowDerivative += derivativeWeights[ 0 ][ i ] * c[ i ];
+        }
+        derivative[ 0 ] += rowWeight * rowDerivative;
+
+        /** For the other dimensions, replace the weight of that dimension
+         * by its derivative weight.
+         */
+        for ( unsigned int d = 1; d < VDimension; ++d )
+        {
+          RealType weight = derivativeWeights[ d ][ rowIndex[ d ] ];
+          for ( unsigned int e = 1; e < VDimension; ++e )
+          {
+            if ( e != d ) weight *= weights[ e ][ rowIndex[ e ] ];
+          }
+          derivative[ d ] += weight * rowValue;
+        }
+      }
+
+      /** Go to the next row. */
+      for ( unsigned int d = 1; d < VDimension; ++d )
+      {
+        if ( ++rowIndex[ d ] <= VSplineOrder ) break;
+        rowIndex[ d ] = 0;
+      }
+    }
+
+    return true;
+
+  } // end Evaluate()
+
+protected:
+
+  /** Structures to select the weight functions of a spline order. */
+  struct DispatchBase {};
+  template < unsigned int >
+  struct Dispatch : DispatchBase {};
+
+  /** Compute the weights of the support, given the position t relative
+   * to its centre. The formulas are those of the BSplineInterpolateImageFunction.
+   */
+  static void ComputeWeights( RealType t, RealType * weights )
+  {
+    Self::ComputeWeights( Dispatch<VSplineOrder>(), t, weights );
+  }
+
+  /** Compute the derivative weights of the support. */
+  static void ComputeDerivativeWeights( RealType t, RealType * weights )
+  {
+    Self::ComputeDerivativeWeights( Dispatch<VSplineOrder>(), t, weights );
+  }
+
+  /** First order: t is in [0,1). */
+  static void ComputeWeights( const Dispatch<1> &,
+    RealType t, RealType * weights )
+  {
+    weights[ 0 ] = 1 - t;
+    weights[ 1 ] = t;
+  }
+
+  static void ComputeDerivativeWeights( const Dispatch<1> &,
+    RealType, RealType * weights )
+  {
+    weights[ 0 ] = -1;
+    weights[ 1 ] = 1;
+  }
+
+  /** Second order: t is in [-0.5,0.5). */
+  static void ComputeWeights( const Dispatch<2> &,
+    RealType t, RealType * weights )
+  {
+    const RealType half = static_cast<RealType>( 0.5 );
+    weights[ 1 ] = static_cast<RealType>( 0.75 ) - t * t;
+    weights[ 2 ] = half * ( t - weights[ 1 ] + 1 );
+    weights[ 0 ] = 1 - weights[ 1 ] - weights[ 2 ];
+  }
+
+  static void ComputeDerivativeWeights( const Dispatch<2> &,
+    RealType t, RealType * weights )
+  {
+    const RealType half = static_cast<RealType>( 0.5 );
+    weights[ 0 ] = t - half;
+    weights[ 1 ] = -2 * t;
+    weights[ 2 ] = t + half;
+  }
+
+  /** Third order: t is in [0,1). */
+  static void ComputeWeights( const Dispatch<3> &,
+    RealType t, RealType * weights )
+  {
+    const RealType half = static_cast<RealType>( 0.5 );
+    const RealType sixth = static_cast<RealType>( 1.0 / 6.0 );
+    weights[ 3 ] = sixth * t * t * t;
+    weights[ 0 ] = sixth + half * t * ( t - 1 ) - weights[ 3 ];
+    weights[ 2 ] = t + weights[ 0 ] - 2 * weights[ 3 ];
+    weights[ 1 ] = 1 - weights[ 0 ] - weights[ 2 ] - weights[ 3 ];
+  }
+
+  static void ComputeDerivativeWeights( const Dispatch<3> &,
+    RealType t, RealType * weights )
+  {
+    const RealType half = static_cast<RealType>( 0.5 );
+    const RealType onehalf = static_cast<RealType>( 1.5 );
+    const RealType tt = t * t;
+    weights[ 0 ] = -half * ( 1 - t ) * ( 1 - t );
+    weights[ 1 ] = onehalf * tt - 2 * t;
+    weights[ 2 ] = -onehalf * tt + t + half;
+    weights[ 3 ] = half * tt;
+  }
+
+}; // end class BSplineValueAndDerivativeKernel
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineValueAndDerivativeKernel_h
@@ -331,9 +331,11 @@ namespace itk
     /** If no moving image masks are present 'true' is returned,
      * meaning that this sample is taken into account. Otherwise, the
      * AND of all masks is returned, i.e. the sample should be inside
-     * all masks.
+     * all masks. The masks modify themselves in IsInside(), so they are
+     * tested by one thread at a time.
      */
     bool inside = true;
+    this->m_MovingImageMaskMutex.Lock();
     for ( unsigned int i = 0; i < this->GetNumberOfMovingImageMasks(); ++i )
     {
       MovingImageMaskPointer movingImageMask = this->GetMovingImageMask( i );
@@ -345,9 +347,10 @@ namespace itk
       /** If the point falls outside one mask, we can skip the rest. */
       if ( !inside )
       {
-        return false;
+        break;
       }
     }
+    this->m_MovingImageMaskMutex.Unlock();
     return inside;
 
   } // end IsInsideMovingMask()
@@ -0,0 +1,225 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkParallelCostFunctionEvaluator_cxx
+#define __itkParallelCostFunctionEvaluator_cxx
+
+#include "itkParallelCostFunctionEvaluator.h"
+#include "elxProfiler.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * **************** Constructor *****************************
+ */
+
+ParallelCostFunctionEvaluator
+::ParallelCostFunctionEvaluator()
+{
+  this->m_Threader = ThreaderType::New();
+
+} // end Constructor
+
+
+/**
+ * **************** SetEvaluators *****************************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::SetEvaluators( const EvaluatorContainerType & evaluators )
+{
+  this->m_Evaluators = evaluators;
+  this->Modified();
+
+} // end SetEvaluators()
+
+
+/**
+ * **************** Clear *****************************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::Clear( void )
+{
+  this->m_Evaluators.clear();
+  this->m_SharedDataSources.clear();
+  this->Modified();
+
+} // end Clear()
+
+
+/**
+ * **************** AddSharedDataSource *****************************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::AddSharedDataSource( ProcessObject * source )
+{
+  if ( !source ) return;
+
+  /** Add every source only once. */
+  for ( unsigned int i = 0; i < this->m_SharedDataSources.size(); ++i )
+  {
+    if ( this->m_SharedDataSources[ i ] == source ) return;
+  }
+  this->m_SharedDataSources.push_back( source );
+  this->Modified();
+
+} // end AddSharedDataSource()
+
+
+/**
+ * **************** GetValues *****************************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::GetValues( const ParametersContainerType & positions,
+  MeasureContainerType & values,
+  ExceptionContainerType & exceptions )
+{
+  tmr::ProfilerScope profilerScope( tmr::Profiler::CostFunction );
+
+  if ( this->m_Evaluators.empty() )
+  {
+    itkExceptionMacro( << "No evaluators have been set." );
+  }
+
+  /** Reset the output. */
+  const unsigned int numberOfPositions = positions.size();
+  values.resize( numberOfPositions );
+  exceptions.resize( numberOfPositions );
+  for ( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    exceptions[ k ].st_Caught = false;
+  }
+  if ( numberOfPositions == 0 ) return;
+
+  /** Update the shared data, for example select new samples, before
+   * starting the threads, so that the evaluators only read it.
+   */
+  for ( unsigned int i = 0; i < this->m_SharedDataSources.size(); ++i )
+  {
+    this->m_SharedDataSources[ i ]->Update();
+  }
+
+  /** Evaluate in the calling thread if there is no need for threads. */
+  const unsigned int numberOfThreads = std::min(
+    numberOfPositions, this->GetNumberOfEvaluators() );
+  if ( numberOfThreads == 1 )
+  {
+    this->ThreadedGetValues( 0, 1, positions, values, exceptions );
+    return;
+  }
+
+  /** Launch the threads. */
+  ThreaderParameterType userData;
+  userData.st_Self = this;
+  userData.st_Positions = &positions;
+  userData.st_Values = &values;
+  userData.st_Exceptions = &exceptions;
+  this->m_Threader->SetNumberOfThreads( numberOfThreads );
+  this->m_Threader->SetSingleMethod( GetValuesThreaderCallback, &userData );
+  this->m_Threader->SingleMethodExecute();
+
+} // end GetValues()
+
+
+/**
+ * **************** ThreadedGetValues *****************************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::ThreadedGetValues( unsigned int threadID, unsigned int numberOfThreads,
+  const ParametersContainerType & positions,
+  MeasureContainerType & values,
+  ExceptionContainerType & exceptions )
+{
+  const CostFunctionType * evaluator = this->m_Evaluators[ threadID ];
+  for ( unsigned int k = threadID; k < positions.size(); k += numberOfThreads )
+  {
+    try
+    {
+      values[ k ] = evaluator->GetValue( positions[ k ] );
+    }
+    catch ( ExceptionObject & err )
+    {
+      exceptions[ k ].st_Caught = true;
+      exceptions[ k ].st_Exception = err;
+    }
+    catch ( std::exception & err )
+    {
+      exceptions[ k ].st_Caught = true;
+      exceptions[ k ].st_Exception = ExceptionObject( __FILE__, __LINE__,
+        err.what(), "ParallelCostFunctionEvaluator" );
+    }
+  }
+
+} // end ThreadedGetValues()
+
+
+/**
+ * **************** GetValuesThreaderCallback *****************************
+ */
+
+ITK_THREAD_RETURN_TYPE
+ParallelCostFunctionEvaluator
+::GetValuesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+  ThreaderParameterType * userData
+    = static_cast<ThreaderParameterType *>( infoStruct->UserData );
+
+  userData->st_Self->ThreadedGetValues( threadID, numberOfThreads,
+    *userData->st_Positions, *userData->st_Values, *userData->st_Exceptions );
+
+  /** Add the profiled times of this thread, before it ends. */
+  tmr::Profiler::FlushThread();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end GetValuesThreaderCallback()
+
+
+/**
+ * *************** PrintSelf ********************
+ */
+
+void
+ParallelCostFunctionEvaluator
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  /** Call the superclass' PrintSelf. */
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfEvaluators: "
+    << this->m_Evaluators.size() << std::endl;
+  os << indent << "NumberOfSharedDataSources: "
+    << this->m_SharedDataSources.size() << std::endl;
+
+} // end PrintSelf()
+
+
+} //end namespace itk
+
+#endif // #ifndef __itkParallelCostFunctionEvaluator_cxx
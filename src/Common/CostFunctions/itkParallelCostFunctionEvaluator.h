@@ -0,0 +1,167 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkParallelCostFunctionEvaluator_h
+#define __itkParallelCostFunctionEvaluator_h
+
+#include "itkSingleValuedCostFunction.h"
+#include "itkProcessObject.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
+
+namespace itk
+{
+  /**
+   * \class ParallelCostFunctionEvaluator
+   * \brief Evaluates a cost function at several parameter vectors at once.
+   *
+   * Optimizers that need the value of the cost function at a number of
+   * independent positions, such as the population of the CMA evolution
+   * strategy, or the points of a full search, can pass them all at once
+   * to GetValues(). The positions are then divided over a number of
+   * threads, each of which has its own evaluator: an independent copy of
+   * the cost function, with its own transform and scratch memory, for
+   * example created by AdvancedImageToImageMetric::CreateEvaluator().
+   *
+   * The evaluators may share read-only data, such as the images and the
+   * image samplers. The pipeline objects that produce shared data, should
+   * be added with AddSharedDataSource(); they are updated once, before the
+   * threads are started, so that the evaluators find them up to date.
+   *
+   * If less than two evaluators are set, the concurrent evaluation is not
+   * used; the optimizer should then evaluate its own cost function. Note
+   * that the evaluators are not scaled; scaling is left to the optimizer.
+   *
+   * \ingroup Numerics
+   */
+
+  class ParallelCostFunctionEvaluator : public Object
+  {
+  public:
+
+    /** Standard ITK-stuff. */
+    typedef ParallelCostFunctionEvaluator   Self;
+    typedef Object                          Superclass;
+    typedef SmartPointer<Self>              Pointer;
+    typedef SmartPointer<const Self>        ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro( Self );
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro( ParallelCostFunctionEvaluator, Object );
+
+    /** Typedefs for the evaluators. */
+    typedef SingleValuedCostFunction                  CostFunctionType;
+    typedef CostFunctionType::Pointer                 CostFunctionPointer;
+    typedef CostFunctionType::MeasureType             MeasureType;
+    typedef CostFunctionType::ParametersType          ParametersType;
+    typedef std::vector< CostFunctionPointer >        EvaluatorContainerType;
+    typedef std::vector< ParametersType >             ParametersContainerType;
+    typedef std::vector< MeasureType >                MeasureContainerType;
+
+    /** An exception thrown by an evaluator for one of the positions. */
+    struct EvaluationExceptionStruct
+    {
+      bool            st_Caught;
+      ExceptionObject st_Exception;
+    };
+    typedef std::vector< EvaluationExceptionStruct >  ExceptionContainerType;
+
+    /** Set the evaluators; at most one thread is used per evaluator. */
+    virtual void SetEvaluators( const EvaluatorContainerType & evaluators );
+
+    /** Remove all evaluators and shared data sources. */
+    virtual void Clear( void );
+
+    /** Get the number of evaluators. */
+    virtual unsigned int GetNumberOfEvaluators( void ) const
+    {
+      return static_cast<unsigned int>( this->m_Evaluators.size() );
+    }
+
+    /** Whether there are enough evaluators to evaluate concurrently. */
+    virtual bool GetUseConcurrentEvaluation( void ) const
+    {
+      return this->m_Evaluators.size() > 1;
+    }
+
+    /** Add a pipeline object, that produces data shared by the evaluators,
+     * for example an image sampler. It is updated before the evaluation.
+     */
+    virtual void AddSharedDataSource( ProcessObject * source );
+
+    /** Compute the values of the cost function at all given positions.
+     * An exception thrown for one position is stored in exceptions, and
+     * does not stop the evaluation of the other positions. The value of
+     * such a position is not defined.
+     */
+    virtual void GetValues( const ParametersContainerType & positions,
+      MeasureContainerType & values,
+      ExceptionContainerType & exceptions );
+
+  protected:
+
+    /** The constructor. */
+    ParallelCostFunctionEvaluator();
+    /** The destructor. */
+    virtual ~ParallelCostFunctionEvaluator() {};
+
+    /** PrintSelf. */
+    void PrintSelf( std::ostream & os, Indent indent ) const;
+
+    /** Typedefs for the threader. */
+    typedef MultiThreader                             ThreaderType;
+    typedef ThreaderType::ThreadInfoStruct            ThreadInfoType;
+
+    /** The parameters that are passed to the threader callback. */
+    struct ThreaderParameterType
+    {
+      Self *                          st_Self;
+      const ParametersContainerType * st_Positions;
+      MeasureContainerType *          st_Values;
+      ExceptionContainerType *        st_Exceptions;
+    };
+
+    /** Evaluate the positions threadID, threadID + numberOfThreads, etc.
+     * with evaluator threadID.
+     */
+    void ThreadedGetValues( unsigned int threadID, unsigned int numberOfThreads,
+      const ParametersContainerType & positions,
+      MeasureContainerType & values,
+      ExceptionContainerType & exceptions );
+
+    /** The threader callback. */
+    static ITK_THREAD_RETURN_TYPE GetValuesThreaderCallback( void * arg );
+
+  private:
+
+    /** The private constructor. */
+    ParallelCostFunctionEvaluator( const Self& );  // purposely not implemented
+    /** The private copy constructor. */
+    void operator=( const Self& );                 // purposely not implemented
+
+    /** Member variables. */
+    EvaluatorContainerType                m_Evaluators;
+    std::vector< ProcessObject::Pointer > m_SharedDataSources;
+    ThreaderType::Pointer                 m_Threader;
+
+  }; // end class ParallelCostFunctionEvaluator
+
+} //end namespace itk
+
+
+#endif // #ifndef __itkParallelCostFunctionEvaluator_h
+
@@ -48,9 +48,22 @@ namespace itk
    *  - A fixed and moving number of histogram bins can be chosen.
    *  - More use of iterators instead of raw buffer pointers.
    *  - An optional FiniteDifference derivative estimation.
+   *  - Multi-threaded computation of the joint histogram and its analytic
+   *    derivatives, see ComputePDFs() and ComputePDFsAndPDFDerivatives().
    *
-   * \warning This class is not thread safe due the member data structures
-   *  used to the store the sampled points and the marginal and joint pdfs.
+   * When multi-threading is enabled (see SetUseMultiThread()), every thread
+   * processes a part of the samples and accumulates into a private joint
+   * histogram. The private histograms are summed afterwards by a threaded
+   * reduction. The joint histogram derivatives are computed in a second
+   * threaded pass, in which every thread owns a block of fixed image bins,
+   * so that no two threads write to the same derivative bins. The threads
+   * test the moving mask with IsInsideMovingMask() of the superclass, which
+   * does not modify the mask, so the selected samples, and thus the joint
+   * histogram, do not depend on the number of threads.
+   *
+   * \warning The GetValue and GetValueAndDerivative methods of this class
+   *  are not reentrant, due the member data structures used to the store
+   *  the marginal and joint pdfs.
    *
    * References:\n
    * [1] "Nonrigid multimodality image registration"\n
@@ -129,6 +142,7 @@ namespace itk
       Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
     typedef typename
       Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+    typedef typename Superclass::AdvancedTransformType      AdvancedTransformType;
 
     /** The fixed image dimension. */
     itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -216,6 +230,15 @@ namespace itk
     itkSetMacro( FiniteDifferencePerturbation, double );
     itkGetConstMacro( FiniteDifferencePerturbation, double );
 
+    /** The maximum amount of memory, in megabytes, that may be used to store
+     * the image Jacobians of the samples, which are used to compute the pdf
+     * derivatives without a second pass over the samples. If the samples do
+     * not fit, the pdf derivatives are computed without storing them;
+     * default: 128.
+     */
+    itkSetMacro( MaximumPDFDerivativesMemory, double );
+    itkGetConstMacro( MaximumPDFDerivativesMemory, double );
+
   protected:
 
     /** The constructor. */
@@ -241,6 +264,7 @@ namespace itk
     typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
     typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
     typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+    typedef typename NonZeroJacobianIndicesType::value_type         NonZeroJacobianIndexType;
 
     /** Typedefs for the PDFs and PDF derivatives. */
     typedef float                                   PDFValueType;
@@ -259,6 +283,42 @@ namespace itk
     typedef IncrementalMarginalPDFType::SizeType    IncrementalMarginalPDFSizeType;
     typedef Array<double>                           ParzenValueContainerType;
 
+    /** Typedefs for multi-threading. */
+    typedef typename Superclass::ThreaderType       ThreaderType;
+    typedef typename Superclass::ThreadInfoType     ThreadInfoType;
+
+    /** The tasks that can be executed by the threads. */
+    enum ParzenWindowHistogramThreadTaskType {
+      ComputePDFsTask,
+      ComputePDFsAndStoreSamplesTask,
+      ReduceJointPDFsTask,
+      ComputeJointPDFDerivativesTask };
+
+    /** The parameters that are passed to the threader callback. */
+    struct ParzenWindowHistogramMultiThreaderParameterType
+    {
+      const Self *                          st_Metric;
+      ParzenWindowHistogramThreadTaskType   st_Task;
+    };
+
+    /** The variables of each thread: a private joint histogram, and, when the
+     * pdf derivatives are computed, the data of the valid samples, which are
+     * needed in the second pass. The image Jacobians and the nonzero Jacobian
+     * indices of the samples are stored in flat buffers, with room for all
+     * samples of the thread; those of stored sample n start at n * nnzji.
+     */
+    struct ParzenWindowHistogramPerThreadStruct
+    {
+      typename JointPDFType::Pointer            st_JointPDF;
+      unsigned long                             st_NumberOfStoredSamples;
+      std::vector<RealType>                     st_FixedImageValues;
+      std::vector<RealType>                     st_MovingImageValues;
+      DerivativeType                            st_ImageJacobians;
+      NonZeroJacobianIndicesType                st_NonZeroJacobianIndices;
+    };
+    typedef std::vector<
+      ParzenWindowHistogramPerThreadStruct >    ParzenWindowHistogramPerThreadType;
+
     /** Typedefs for Parzen kernel. */
     typedef KernelFunction KernelFunctionType;
 
@@ -293,14 +353,12 @@ namespace itk
     typename KernelFunctionType::Pointer m_MovingKernel;
     typename KernelFunctionType::Pointer m_DerivativeMovingKernel;
 
-    /** Computes the inner product of transform Jacobian with moving image gradient
-     * The results are stored in imageJacobian, which is supposed to have the
-     * right size (same length as Jacobian's number of columns).
+    /** Variables for multi-threading. The fixed histogram bin boundaries
+     * determine which block of the joint pdf derivatives each thread fills.
      */
-    void EvaluateTransformJacobianInnerProduct(
-      const TransformJacobianType & jacobian,
-      const MovingImageDerivativeType & movingImageDerivative,
-      DerivativeType & imageJacobian ) const;
+    mutable ParzenWindowHistogramMultiThreaderParameterType m_ParzenWindowHistogramThreaderParameters;
+    mutable ParzenWindowHistogramPerThreadType  m_ParzenWindowHistogramPerThreadVariables;
+    mutable std::vector<unsigned long>          m_FixedHistogramBinThreadBoundaries;
 
     /** Compute the Parzen values given an image value and a starting histogram index
      * Compute the values at (parzenWindowIndex - parzenWindowTerm + k) for
@@ -314,10 +372,14 @@ namespace itk
 
     /** Update the joint PDF with a pixel pair; on demand also updates the
      * pdf derivatives (if the Jacobian pointers are nonzero).
+     * The histogram is accumulated in jointPDF, which is either m_JointPDF,
+     * or a thread's private joint PDF. In the latter case the Jacobian
+     * pointers should be zero.
      */
     virtual void UpdateJointPDFAndDerivatives(
       RealType fixedImageValue, RealType movingImageValue,
-      const DerivativeType * imageJacobian, const NonZeroJacobianIndicesType * nzji ) const;
+      const DerivativeType * imageJacobian, const NonZeroJacobianIndicesType * nzji,
+      JointPDFType * jointPDF ) const;
 
     /** Update the joint PDF and the incremental pdfs.
      * The input is a pixel pair (fixed, moving, moving mask) and
@@ -340,12 +402,13 @@ namespace itk
     /** Update the pdf derivatives
      * adds -image_jac[mu]*factor to the bin
      * with index [ mu, pdfIndex[0], pdfIndex[1] ] for all mu.
+     * nzji points to the imageJacobian.GetSize() nonzero Jacobian indices.
      * This function should only be called from UpdateJointPDFAndDerivatives.
      */
     void UpdateJointPDFDerivatives(
       const JointPDFIndexType & pdfIndex, double factor,
       const DerivativeType & imageJacobian,
-      const NonZeroJacobianIndicesType & nzji ) const;
+      const NonZeroJacobianIndexType * nzji ) const;
 
     /** Multiply the pdf entries by the given normalization factor. */
     virtual void NormalizeJointPDF(
@@ -383,6 +446,12 @@ namespace itk
      */
     virtual void ComputePDFsAndPDFDerivatives( const ParametersType & parameters ) const;
 
+    /** The single-threaded implementation of ComputePDFsAndPDFDerivatives.
+     * Expects that the transform parameters are set and that the image
+     * sampler is updated.
+     */
+    virtual void ComputePDFsAndPDFDerivativesSingleThreaded( void ) const;
+
     /** Compute PDFs and incremental pdfs (which you can use to compute finite
      * difference estimate of the derivative).
      * Loops over the fixed image samples and constructs the m_JointPDF,
@@ -418,10 +487,90 @@ namespace itk
      */
     virtual void ComputePDFs( const ParametersType & parameters ) const;
 
+    /** The single-threaded implementation of ComputePDFs. Expects that the
+     * transform parameters are set and that the image sampler is updated.
+     */
+    virtual void ComputePDFsSingleThreaded( void ) const;
+
+    /** Compute PDFs, like ComputePDFs, and store the fixed and moving image
+     * values and the sparse image Jacobian of each valid sample in the
+     * per-thread variables. This is a compact representation of the pdf
+     * derivatives: its size is proportional to the number of samples times
+     * the number of nonzero Jacobian indices, instead of to the number of
+     * parameters times the number of histogram bins.
+     * Uses multiple threads only if UseMultiThread is true.
+     */
+    virtual void ComputePDFsAndStoreSamples( const ParametersType & parameters ) const;
+
+    /** Compute PDFs, and store the samples if storeSamples is true, without
+     * setting the transform parameters and updating the image sampler first.
+     * Used when the output of the sampler is needed before the PDFs are
+     * computed, for example to decide how to compute the derivative.
+     */
+    virtual void ComputePDFsOfUpdatedSamples( bool storeSamples ) const;
+
+    /** Returns true if the image Jacobians of numberOfSamples samples fit in
+     * MaximumPDFDerivativesMemory.
+     */
+    virtual bool StoredSamplesFitInMemory( unsigned long numberOfSamples ) const;
+
+    /** Methods for multi-threading support. ***************/
+
+    /** Make sure the per-thread joint PDFs exist and have the right size. */
+    virtual void InitializeThreadingParameters( void ) const;
+
+    /** Compute the contribution of a part of the samples to the thread's
+     * private joint PDF. If storeSamples is true, the fixed and moving image
+     * values and the image Jacobian of each valid sample are stored as well.
+     */
+    virtual void ThreadedComputePDFs( unsigned int threadID, bool storeSamples ) const;
+
+    /** Sum the private joint PDFs of the threads into m_JointPDF. The bins
+     * are distributed over the threads.
+     */
+    virtual void ThreadedReduceJointPDFs( unsigned int threadID ) const;
+
+    /** Compute the block of m_JointPDFDerivatives that belongs to the fixed
+     * histogram bins owned by this thread, using the samples that were
+     * stored by ThreadedComputePDFs().
+     */
+    virtual void ThreadedComputeJointPDFDerivatives( unsigned int threadID ) const;
+
+    /** Sum the number of valid samples, check it, reduce the joint PDFs and
+     * compute alpha.
+     */
+    virtual void AfterThreadedComputePDFs( void ) const;
+
+    /** Distribute the fixed histogram bins over the threads, such that each
+     * thread gets a similar number of joint histogram entries.
+     */
+    virtual void ComputeFixedHistogramBinThreadBoundaries( void ) const;
+
+    /** Launch the threads that execute the given task. If UseMultiThread
+     * is false, the task is executed for all thread ids in the calling thread.
+     */
+    void LaunchParzenWindowHistogramThreaderCallback(
+      ParzenWindowHistogramThreadTaskType task ) const;
+
+    /** Execute the given task for the given thread id. */
+    void ExecuteParzenWindowHistogramThreadTask( unsigned int threadID,
+      ParzenWindowHistogramThreadTaskType task ) const;
+
+    /** The threader callback. */
+    static ITK_THREAD_RETURN_TYPE ParzenWindowHistogramThreaderCallback( void * arg );
+
     /** Some initialization functions, called by Initialize. */
     virtual void InitializeHistograms( void );
     virtual void InitializeKernels( void );
 
+    /** Pass the shared data and the settings of this metric to an evaluator,
+     * like the superclass, and initialize the histograms and kernels of the
+     * evaluator. Inheriting classes should copy their own settings before
+     * calling this method, since InitializeHistograms() may depend on them.
+     */
+    bool InitializeEvaluator( Self * evaluator,
+      AdvancedTransformType * transform ) const;
+
     /** Get the value and analytic derivatives for single valued optimizers.
      * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false
      * Implement this method in subclasses.
@@ -455,6 +604,7 @@ namespace itk
     bool m_UseDerivative;
     bool m_UseFiniteDifferenceDerivative;
     double m_FiniteDifferencePerturbation;
+    double m_MaximumPDFDerivativesMemory;
 
     bool m_UseExplicitPDFDerivatives;
 
@@ -22,6 +22,7 @@
 #include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageSliceIteratorWithIndex.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -59,6 +60,7 @@ namespace itk
     this->m_UseDerivative = false;
     this->m_UseFiniteDifferenceDerivative = false;
     this->m_FiniteDifferencePerturbation = 1.0;
+    this->m_MaximumPDFDerivativesMemory = 128.0;
 
     this->SetUseImageSampler( true );
     this->SetUseFixedImageLimiter( true );
@@ -66,6 +68,10 @@ namespace itk
 
     this->m_UseExplicitPDFDerivatives = true;
 
+    /** Threading related variables. */
+    this->m_ParzenWindowHistogramThreaderParameters.st_Metric = this;
+    this->m_ParzenWindowHistogramThreaderParameters.st_Task = ComputePDFsTask;
+
   } // end Constructor
 
 
@@ -92,6 +98,8 @@ namespace itk
       << this->m_FixedKernelBSplineOrder << std::endl;
     os << indent << "MovingKernelBSplineOrder: "
       << this->m_MovingKernelBSplineOrder << std::endl;
+    os << indent << "MaximumPDFDerivativesMemory: "
+      << this->m_MaximumPDFDerivativesMemory << std::endl;
 
     /*double m_MovingImageNormalizedMin;
     double m_FixedImageNormalizedMin;
@@ -144,6 +152,43 @@ namespace itk
   } // end Initialize()
 
 
+  /**
+   * ****************** InitializeEvaluator *****************************
+   */
+
+  template <class TFixedImage, class TMovingImage>
+    bool
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::InitializeEvaluator( Self * evaluator, AdvancedTransformType * transform ) const
+  {
+    /** Share the images etc., and set the transform. */
+    if ( !this->Superclass::InitializeEvaluator( evaluator, transform ) )
+    {
+      return false;
+    }
+
+    /** Copy the settings. */
+    evaluator->m_NumberOfFixedHistogramBins = this->m_NumberOfFixedHistogramBins;
+    evaluator->m_NumberOfMovingHistogramBins = this->m_NumberOfMovingHistogramBins;
+    evaluator->m_FixedKernelBSplineOrder = this->m_FixedKernelBSplineOrder;
+    evaluator->m_MovingKernelBSplineOrder = this->m_MovingKernelBSplineOrder;
+    evaluator->m_UseDerivative = this->m_UseDerivative;
+    evaluator->m_UseFiniteDifferenceDerivative = this->m_UseFiniteDifferenceDerivative;
+    evaluator->m_FiniteDifferencePerturbation = this->m_FiniteDifferencePerturbation;
+    evaluator->m_MaximumPDFDerivativesMemory = this->m_MaximumPDFDerivativesMemory;
+    evaluator->m_UseExplicitPDFDerivatives = this->m_UseExplicitPDFDerivatives;
+
+    /** The evaluator gets its own histograms, like in Initialize(). */
+    evaluator->InitializeHistograms();
+    evaluator->InitializeKernels();
+    evaluator->m_PerturbedAlphaRight.SetSize( this->m_PerturbedAlphaRight.GetSize() );
+    evaluator->m_PerturbedAlphaLeft.SetSize( this->m_PerturbedAlphaLeft.GetSize() );
+
+    return true;
+
+  } // end InitializeEvaluator()
+
+
   /**
    * ****************** InitializeHistograms *****************************
    */
@@ -495,7 +540,8 @@ namespace itk
     ::UpdateJointPDFAndDerivatives(
       RealType fixedImageValue, RealType movingImageValue,
       const DerivativeType * imageJacobian,
-      const NonZeroJacobianIndicesType * nzji) const
+      const NonZeroJacobianIndicesType * nzji,
+      JointPDFType * jointPDF ) const
   {
     typedef ImageSliceIteratorWithIndex< JointPDFType >  PDFIteratorType;
 
@@ -523,13 +569,16 @@ namespace itk
       movingImageParzenWindowTerm, movingImageParzenWindowIndex,
       this->m_MovingKernel, movingParzenValues );
 
-    /** Position the JointPDFWindow. */
+    /** Position the JointPDFWindow. A local copy is used, so that this
+     * function can be called by several threads simultaneously.
+     */
     JointPDFIndexType pdfWindowIndex;
     pdfWindowIndex[ 0 ] = movingImageParzenWindowIndex;
     pdfWindowIndex[ 1 ] = fixedImageParzenWindowIndex;
-    this->m_JointPDFWindow.SetIndex( pdfWindowIndex );
+    JointPDFRegionType jointPDFWindow = this->m_JointPDFWindow;
+    jointPDFWindow.SetIndex( pdfWindowIndex );
 
-    PDFIteratorType it( this->m_JointPDF, this->m_JointPDFWindow );
+    PDFIteratorType it( jointPDF, jointPDFWindow );
     it.GoToBegin();
     it.SetFirstDirection( 0 );
     it.SetSecondDirection( 1 );
@@ -571,7 +620,7 @@ namespace itk
           it.Value() += static_cast<PDFValueType>( fv * movingParzenValues[ m ] );
           this->UpdateJointPDFDerivatives(
             it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
-            *imageJacobian, *nzji );
+            *imageJacobian, &( *nzji )[ 0 ] );
           ++it;
         }
         it.NextLine();
@@ -591,14 +640,14 @@ namespace itk
     ::UpdateJointPDFDerivatives(
     const JointPDFIndexType & pdfIndex, double factor,
     const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji  ) const
+    const NonZeroJacobianIndexType * nzji ) const
   {
     /** Get the pointer to the element with index [0, pdfIndex[0], pdfIndex[1]]. */
     PDFValueType * derivPtr = this->m_JointPDFDerivatives->GetBufferPointer() +
       ( pdfIndex[0] * this->m_JointPDFDerivatives->GetOffsetTable()[1] ) +
       ( pdfIndex[1] * this->m_JointPDFDerivatives->GetOffsetTable()[2] );
 
-    if ( nzji.size() == this->GetNumberOfParameters() )
+    if ( imageJacobian.GetSize() == this->GetNumberOfParameters() )
     {
       /** Loop over all Jacobians. */
       typename DerivativeType::const_iterator imjac = imageJacobian.begin();
@@ -623,39 +672,6 @@ namespace itk
   } // end UpdateJointPDFDerivatives()
 
 
-  /**
-   * *************** EvaluateTransformJacobianInnerProduct ****************
-   */
-
-  template < class TFixedImage, class TMovingImage >
-    void
-    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
-    ::EvaluateTransformJacobianInnerProduct(
-    const TransformJacobianType & jacobian,
-    const MovingImageDerivativeType & movingImageDerivative,
-    DerivativeType & imageJacobian ) const
-  {
-    typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-    typedef typename DerivativeType::iterator              DerivativeIteratorType;
-    JacobianIteratorType jac = jacobian.begin();
-    imageJacobian.Fill( 0.0 );
-    const unsigned int sizeImageJacobian = imageJacobian.GetSize();
-    for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
-    {
-      const double imDeriv = movingImageDerivative[ dim ];
-      DerivativeIteratorType imjac = imageJacobian.begin();
-
-      for ( unsigned int mu = 0; mu < sizeImageJacobian ; mu++ )
-      {
-        (*imjac) += (*jac) * imDeriv;
-        ++imjac;
-        ++jac;
-      }
-    }
-
-  } // end EvaluateTransformJacobianInnerProduct()
-
-
   /**
    * *********************** NormalizeJointPDF ***********************
    * Multiply the pdf entries by the given normalization factor
@@ -992,17 +1008,63 @@ namespace itk
     void
     ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
     ::ComputePDFs( const ParametersType& parameters ) const
+  {
+    /** Set up the parameters in the transform and update the imageSampler. */
+    this->SetTransformParameters( parameters );
+    this->UpdateImageSampler();
+
+    /** Loop over the samples. */
+    this->ComputePDFsOfUpdatedSamples( false );
+
+  } // end ComputePDFs()
+
+
+  /**
+   * ******************* ComputePDFsOfUpdatedSamples *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsOfUpdatedSamples( bool storeSamples ) const
+  {
+    /** Option for now to still use the single threaded code. */
+    if ( !storeSamples && !this->GetUseMultiThread() )
+    {
+      this->ComputePDFsSingleThreaded();
+      return;
+    }
+
+    /** Initialize the per-thread variables. */
+    this->InitializeThreadingParameters();
+
+    /** Launch the threads that fill the private joint PDFs, and store
+     * the data of the valid samples, if requested.
+     */
+    this->LaunchParzenWindowHistogramThreaderCallback(
+      storeSamples ? ComputePDFsAndStoreSamplesTask : ComputePDFsTask );
+
+    /** Reduce the joint PDFs and compute alpha. */
+    this->AfterThreadedComputePDFs();
+
+  } // end ComputePDFsOfUpdatedSamples()
+
+
+  /**
+   * ******************* ComputePDFsSingleThreaded *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsSingleThreaded( void ) const
   {
     /** Initialize some variables. */
     this->m_JointPDF->FillBuffer( 0.0 );
     this->m_NumberOfPixelsCounted = 0;
     this->m_Alpha = 0.0;
 
-    /** Set up the parameters in the transform. */
-    this->SetTransformParameters( parameters );
-
-    /** Update the imageSampler and get a handle to the sample container. */
-    this->GetImageSampler()->Update();
+    /** Get a handle to the sample container, which is up to date. */
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
     /** Create iterator over the sample container. */
@@ -1019,7 +1081,7 @@ namespace itk
       MovingImagePointType mappedPoint;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
       /** Check if point is inside mask. */
       if ( sampleOk )
@@ -1049,7 +1111,7 @@ namespace itk
 
         /** Compute this sample's contribution to the joint distributions. */
         this->UpdateJointPDFAndDerivatives(
-          fixedImageValue, movingImageValue, 0, 0 );
+          fixedImageValue, movingImageValue, 0, 0, this->m_JointPDF.GetPointer() );
       }
 
     } // end iterating over fixed image spatial sample container for loop
@@ -1064,7 +1126,7 @@ namespace itk
       this->m_Alpha = 1.0 / static_cast<double>( this->m_NumberOfPixelsCounted );
     }
 
-  } // end ComputePDFs()
+  } // end ComputePDFsSingleThreaded()
 
 
   /**
@@ -1075,6 +1137,44 @@ namespace itk
     void
     ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
     ::ComputePDFsAndPDFDerivatives( const ParametersType& parameters ) const
+  {
+    /** Set up the parameters in the transform and update the imageSampler. */
+    this->SetTransformParameters( parameters );
+    this->UpdateImageSampler();
+
+    /** The threaded version stores the image Jacobians of the samples.
+     * Use the single threaded code if that is not desired or too expensive.
+     */
+    if ( !this->GetUseMultiThread() || !this->StoredSamplesFitInMemory(
+      this->GetImageSampler()->GetOutput()->Size() ) )
+    {
+      this->ComputePDFsAndPDFDerivativesSingleThreaded();
+      return;
+    }
+
+    /** First pass: fill the private joint PDFs, and store the data of the
+     * valid samples that is needed for the pdf derivatives.
+     */
+    this->ComputePDFsOfUpdatedSamples( true );
+
+    /** Second pass: compute the joint PDF derivatives. Every thread owns a
+     * block of fixed histogram bins, and thereby a contiguous block of
+     * m_JointPDFDerivatives, so no synchronization is needed.
+     */
+    this->ComputeFixedHistogramBinThreadBoundaries();
+    this->LaunchParzenWindowHistogramThreaderCallback( ComputeJointPDFDerivativesTask );
+
+  } // end ComputePDFsAndPDFDerivatives()
+
+
+  /**
+   * ******************* ComputePDFsAndPDFDerivativesSingleThreaded *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsAndPDFDerivativesSingleThreaded( void ) const
   {
     /** Initialize some variables. */
     this->m_JointPDF->FillBuffer( 0.0 );
@@ -1087,11 +1187,7 @@ namespace itk
     DerivativeType imageJacobian( nzji.size() );
     TransformJacobianType jacobian;
 
-    /** Set up the parameters in the transform. */
-    this->SetTransformParameters( parameters );
-
-    /** Update the imageSampler and get a handle to the sample container. */
-    this->GetImageSampler()->Update();
+    /** Get a handle to the sample container, which is up to date. */
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
     /** Create iterator over the sample container. */
@@ -1109,7 +1205,7 @@ namespace itk
       MovingImageDerivativeType movingImageDerivative;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint);
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
       /** Check if point is inside mask. */
       if ( sampleOk )
@@ -1139,15 +1235,19 @@ namespace itk
           movingImageValue, movingImageDerivative );
 
         /** Get the TransformJacobian dT/dmu. */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        const TransformJacobianType * sampleJacobian = 0;
+        const NonZeroJacobianIndicesType * sampleNzji = 0;
+        this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+          jacobian, nzji, sampleJacobian, sampleNzji );
 
         /** Compute the inner product (dM/dx)^T (dT/dmu). */
         this->EvaluateTransformJacobianInnerProduct(
-          jacobian, movingImageDerivative, imageJacobian );
+          *sampleJacobian, movingImageDerivative, imageJacobian );
 
         /** Update the joint pdf and the joint pdf derivatives. */
         this->UpdateJointPDFAndDerivatives(
-          fixedImageValue, movingImageValue, &imageJacobian, &nzji );
+          fixedImageValue, movingImageValue, &imageJacobian, sampleNzji,
+          this->m_JointPDF.GetPointer() );
 
       } //end if-block check sampleOk
     } // end iterating over fixed image spatial sample container for loop
@@ -1163,7 +1263,7 @@ namespace itk
       this->m_Alpha = 1.0 / static_cast<double>( this->m_NumberOfPixelsCounted );
     }
 
-  } // end ComputePDFsAndPDFDerivatives()
+  } // end ComputePDFsAndPDFDerivativesSingleThreaded()
 
 
    /**
@@ -1201,7 +1301,7 @@ namespace itk
     this->SetTransformParameters( parameters );
 
     /** Update the imageSampler and get a handle to the sample container. */
-    this->GetImageSampler()->Update();
+    this->UpdateImageSampler();
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
     /** Create iterator over the sample container. */
@@ -1219,7 +1319,7 @@ namespace itk
        * if not, skip this sample.
        */
       MovingImagePointType mappedPoint;
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
       if ( sampleOk )
       {
@@ -1269,18 +1369,21 @@ namespace itk
          * function of its parameters, so that we can evaluate T(x;\mu+delta_ek)
          * as T(x) + delta * dT/dmu_k.
          */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        const TransformJacobianType * sampleJacobian = 0;
+        const NonZeroJacobianIndicesType * sampleNzji = 0;
+        this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+          jacobian, nzji, sampleJacobian, sampleNzji );
 
         MovingImagePointType mappedPointRight;
         MovingImagePointType mappedPointLeft;
 
         /** Loop over all parameters to perturb (parameters with nonzero Jacobian). */
-        for ( unsigned int i = 0; i < nzji.size(); ++i )
+        for ( unsigned int i = 0; i < sampleNzji->size(); ++i )
         {
           /** Compute the transformed input point after perturbation. */
           for ( unsigned int j = 0; j < MovingImageDimension; ++j )
           {
-            const double delta_jac = delta * jacobian[ j ][ i ];
+            const double delta_jac = delta * ( *sampleJacobian )[ j ][ i ];
             mappedPointRight[ j ] = mappedPoint[ j ] + delta_jac;
             mappedPointLeft[ j ] = mappedPoint[ j ] - delta_jac;
           }
@@ -1339,7 +1442,7 @@ namespace itk
         this->UpdateJointPDFAndIncrementalPDFs(
           fixedImageValue, movingImageValue, movingMaskValue,
           movingImageValuesRight, movingImageValuesLeft,
-          movingMaskValuesRight, movingMaskValuesLeft, nzji );
+          movingMaskValuesRight, movingMaskValuesLeft, *sampleNzji );
 
       } //end if-block check sampleOk
     } // end iterating over fixed image spatial sample container for loop
@@ -1379,6 +1482,551 @@ namespace itk
   } // end ComputePDFsAndIncrementalPDFs()
 
 
+  /**
+   * ******************* ComputePDFsAndStoreSamples *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputePDFsAndStoreSamples( const ParametersType& parameters ) const
+  {
+    /** Set up the parameters in the transform and update the imageSampler. */
+    this->SetTransformParameters( parameters );
+    this->UpdateImageSampler();
+
+    /** Fill the private joint PDFs, and store the data of the valid samples. */
+    this->ComputePDFsOfUpdatedSamples( true );
+
+  } // end ComputePDFsAndStoreSamples()
+
+
+  /**
+   * ******************* StoredSamplesFitInMemory *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    bool
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::StoredSamplesFitInMemory( unsigned long numberOfSamples ) const
+  {
+    typedef typename NonZeroJacobianIndicesType::value_type NonZeroJacobianIndexType;
+    const double bytesPerSample = static_cast<double>(
+      this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() )
+      * ( sizeof( DerivativeValueType ) + sizeof( NonZeroJacobianIndexType ) )
+      + 2.0 * sizeof( RealType );
+    const double megaBytes
+      = static_cast<double>( numberOfSamples ) * bytesPerSample / 1048576.0;
+
+    return megaBytes <= this->m_MaximumPDFDerivativesMemory;
+
+  } // end StoredSamplesFitInMemory()
+
+
+  /**
+   * ******************* InitializeThreadingParameters *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::InitializeThreadingParameters( void ) const
+  {
+    /** Call the superclass implementation. */
+    this->Superclass::InitializeThreadingParameters();
+
+    /** Make sure every thread has a private joint PDF of the right size.
+     * The joint PDFs are only reallocated when the number of threads or
+     * the number of histogram bins changed. They are zeroed by the threads.
+     */
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    if ( this->m_ParzenWindowHistogramPerThreadVariables.size() != numberOfThreads )
+    {
+      this->m_ParzenWindowHistogramPerThreadVariables.resize( numberOfThreads );
+    }
+
+    const JointPDFRegionType jointPDFRegion = this->m_JointPDF->GetLargestPossibleRegion();
+    for ( unsigned int i = 0; i < numberOfThreads; ++i )
+    {
+      ParzenWindowHistogramPerThreadStruct & perThread
+        = this->m_ParzenWindowHistogramPerThreadVariables[ i ];
+      if ( perThread.st_JointPDF.IsNull()
+        || perThread.st_JointPDF->GetLargestPossibleRegion() != jointPDFRegion )
+      {
+        perThread.st_JointPDF = JointPDFType::New();
+        perThread.st_JointPDF->SetRegions( jointPDFRegion );
+        perThread.st_JointPDF->Allocate();
+      }
+      perThread.st_NumberOfStoredSamples = 0;
+    }
+
+  } // end InitializeThreadingParameters()
+
+
+  /**
+   * ******************* ThreadedComputePDFs *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedComputePDFs( unsigned int threadID, bool storeSamples ) const
+  {
+    /** Get a handle to the private variables of this thread. */
+    ParzenWindowHistogramPerThreadStruct & perThread
+      = this->m_ParzenWindowHistogramPerThreadVariables[ threadID ];
+    JointPDFType * jointPDF = perThread.st_JointPDF.GetPointer();
+    jointPDF->FillBuffer( 0.0 );
+    unsigned long numberOfPixelsCounted = 0;
+    unsigned long numberOfStoredSamples = 0;
+
+    /** The number of nonzero Jacobian indices, and the Jacobian in the
+     * evaluation context of this thread.
+     */
+    const unsigned long nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+    TransformJacobianType & jacobian = this->m_EvaluationContexts[ threadID ].st_Jacobian;
+    NonZeroJacobianIndicesType & nzji
+      = this->m_EvaluationContexts[ threadID ].st_NonZeroJacobianIndices;
+
+    /** Get a handle to the sample container. */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    const unsigned long sampleContainerSize = sampleContainer->Size();
+
+    /** Get the samples for this thread. */
+    unsigned long posBegin = 0;
+    unsigned long posEnd = 0;
+    this->GetThreadSampleRange( threadID, sampleContainerSize, posBegin, posEnd );
+
+    /** Make sure the buffers for the stored samples can hold all samples of
+     * this thread. They are only reallocated when the number of samples or
+     * the number of nonzero Jacobian indices changed, so normally once per
+     * resolution.
+     */
+    if ( storeSamples )
+    {
+      const unsigned long numberOfSamples = posEnd - posBegin;
+      if ( perThread.st_FixedImageValues.size() != numberOfSamples
+        || perThread.st_NonZeroJacobianIndices.size() != numberOfSamples * nnzji )
+      {
+        perThread.st_FixedImageValues.resize( numberOfSamples );
+        perThread.st_MovingImageValues.resize( numberOfSamples );
+        perThread.st_ImageJacobians.SetSize( numberOfSamples * nnzji );
+        perThread.st_NonZeroJacobianIndices.resize( numberOfSamples * nnzji );
+      }
+    }
+
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator fiter;
+    typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+    fbegin += posBegin;
+    fend += posEnd;
+
+    /** Loop over the samples of this thread and compute their contribution
+     * to the private joint PDF.
+     */
+    for ( fiter = fbegin; fiter != fend; ++fiter )
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImagePointType mappedPoint;
+      MovingImageDerivativeType movingImageDerivative;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
+
+      /** Check if point is inside mask. This test does not modify the
+       * mask, so it is safe in the threads.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Compute the moving image value, and if needed its derivative,
+       * and check if the point is inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue,
+          storeSamples ? &movingImageDerivative : 0 );
+      }
+
+      if ( sampleOk )
+      {
+        ++numberOfPixelsCounted;
+
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>( (*fiter).Value().m_ImageValue );
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+        if ( storeSamples )
+        {
+          movingImageValue = this->GetMovingImageLimiter()->Evaluate(
+            movingImageValue, movingImageDerivative );
+        }
+        else
+        {
+          movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
+        }
+
+        /** Compute this sample's contribution to the private joint histogram. */
+        this->UpdateJointPDFAndDerivatives(
+          fixedImageValue, movingImageValue, 0, 0, jointPDF );
+
+        /** Store what is needed to compute the pdf derivatives. */
+        if ( storeSamples )
+        {
+          const unsigned long offset = numberOfStoredSamples * nnzji;
+          perThread.st_FixedImageValues[ numberOfStoredSamples ] = fixedImageValue;
+          perThread.st_MovingImageValues[ numberOfStoredSamples ] = movingImageValue;
+
+          /** Get the TransformJacobian dT/dmu, and store its indices. */
+          const TransformJacobianType * sampleJacobian = 0;
+          const NonZeroJacobianIndicesType * sampleNzji = 0;
+          this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+            jacobian, nzji, sampleJacobian, sampleNzji );
+          std::copy( sampleNzji->begin(), sampleNzji->end(),
+            perThread.st_NonZeroJacobianIndices.begin() + offset );
+
+          /** Compute the inner product (dM/dx)^T (dT/dmu) directly into
+           * the buffer, through an array that does not own its memory.
+           */
+          DerivativeType imageJacobian(
+            perThread.st_ImageJacobians.data_block() + offset, nnzji, false );
+          this->EvaluateTransformJacobianInnerProduct(
+            *sampleJacobian, movingImageDerivative, imageJacobian );
+
+          ++numberOfStoredSamples;
+        }
+
+      } // end if-block check sampleOk
+    } // end loop over the samples of this thread
+
+    /** Only update the per-thread variables at the end. */
+    this->m_EvaluationContexts[ threadID ]
+      .st_NumberOfPixelsCounted = numberOfPixelsCounted;
+    perThread.st_NumberOfStoredSamples = numberOfStoredSamples;
+
+  } // end ThreadedComputePDFs()
+
+
+  /**
+   * ******************* ThreadedReduceJointPDFs *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedReduceJointPDFs( unsigned int threadID ) const
+  {
+    /** Get the range of joint histogram bins that this thread sums. */
+    const unsigned long numberOfBins
+      = this->m_JointPDF->GetPixelContainer()->Size();
+    unsigned long binBegin = 0;
+    unsigned long binEnd = 0;
+    this->GetThreadSampleRange( threadID, numberOfBins, binBegin, binEnd );
+
+    /** Sum the private joint histograms. The sum is accumulated in double,
+     * as is done in the other histogram summations of this class.
+     */
+    const unsigned int numberOfThreads
+      = this->m_ParzenWindowHistogramPerThreadVariables.size();
+    PDFValueType * jointPDFPtr = this->m_JointPDF->GetBufferPointer();
+    for ( unsigned long b = binBegin; b < binEnd; ++b )
+    {
+      double sum = 0.0;
+      for ( unsigned int i = 0; i < numberOfThreads; ++i )
+      {
+        sum += this->m_ParzenWindowHistogramPerThreadVariables[ i ]
+          .st_JointPDF->GetBufferPointer()[ b ];
+      }
+      jointPDFPtr[ b ] = static_cast<PDFValueType>( sum );
+    }
+
+  } // end ThreadedReduceJointPDFs()
+
+
+  /**
+   * ******************* ThreadedComputeJointPDFDerivatives *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedComputeJointPDFDerivatives( unsigned int threadID ) const
+  {
+    /** The block of fixed histogram bins owned by this thread. */
+    const OffsetValueType fixedBinBegin = static_cast<OffsetValueType>(
+      this->m_FixedHistogramBinThreadBoundaries[ threadID ] );
+    const OffsetValueType fixedBinEnd = static_cast<OffsetValueType>(
+      this->m_FixedHistogramBinThreadBoundaries[ threadID + 1 ] );
+    if ( fixedBinBegin >= fixedBinEnd ) return;
+
+    /** Zero the block of the pdf derivatives that belongs to these bins.
+     * The fixed bin index is the slowest varying index, so it is contiguous.
+     */
+    const unsigned long fixedBinOffset
+      = this->m_JointPDFDerivatives->GetOffsetTable()[ 2 ];
+    PDFValueType * derivBegin = this->m_JointPDFDerivatives->GetBufferPointer()
+      + fixedBinBegin * fixedBinOffset;
+    PDFValueType * derivEnd = this->m_JointPDFDerivatives->GetBufferPointer()
+      + fixedBinEnd * fixedBinOffset;
+    std::fill( derivBegin, derivEnd, NumericTraits<PDFValueType>::Zero );
+
+    /** The Parzen values. */
+    ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+    ParzenValueContainerType derivativeMovingParzenValues(
+      this->m_JointPDFWindow.GetSize()[ 0 ] );
+    const OffsetValueType fixedWindowSize
+      = static_cast<OffsetValueType>( fixedParzenValues.GetSize() );
+    const double et = static_cast<double>( this->m_MovingImageBinSize );
+
+    /** Loop over the samples stored by all threads. */
+    const unsigned long nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+    const unsigned int numberOfThreads
+      = this->m_ParzenWindowHistogramPerThreadVariables.size();
+    for ( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      ParzenWindowHistogramPerThreadStruct & perThread
+        = this->m_ParzenWindowHistogramPerThreadVariables[ t ];
+      for ( unsigned long n = 0; n < perThread.st_NumberOfStoredSamples; ++n )
+      {
+        /** Determine the fixed Parzen window (see eq. 6 of Mattes paper [2]),
+         * and skip the sample if it does not affect the bins of this thread.
+         */
+        const double fixedImageParzenWindowTerm
+          = perThread.st_FixedImageValues[ n ] / this->m_FixedImageBinSize
+          - this->m_FixedImageNormalizedMin;
+        const OffsetValueType fixedImageParzenWindowIndex =
+          static_cast<OffsetValueType>( vcl_floor(
+          fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+        if ( fixedImageParzenWindowIndex + fixedWindowSize <= fixedBinBegin
+          || fixedImageParzenWindowIndex >= fixedBinEnd )
+        {
+          continue;
+        }
+
+        /** Determine the moving Parzen window. */
+        const double movingImageParzenWindowTerm
+          = perThread.st_MovingImageValues[ n ] / this->m_MovingImageBinSize
+          - this->m_MovingImageNormalizedMin;
+        const OffsetValueType movingImageParzenWindowIndex =
+          static_cast<OffsetValueType>( vcl_floor(
+          movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
+
+        /** Compute the Parzen values. */
+        this->EvaluateParzenValues(
+          fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
+          this->m_FixedKernel, fixedParzenValues );
+        this->EvaluateParzenValues(
+          movingImageParzenWindowTerm, movingImageParzenWindowIndex,
+          this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
+
+        /** The stored image Jacobian and indices of this sample. */
+        const DerivativeType imageJacobian(
+          perThread.st_ImageJacobians.data_block() + n * nnzji, nnzji, false );
+        const NonZeroJacobianIndexType * nzji
+          = &perThread.st_NonZeroJacobianIndices[ n * nnzji ];
+
+        /** Update the pdf derivatives of the bins owned by this thread. */
+        JointPDFIndexType pdfIndex;
+        for ( OffsetValueType f = 0; f < fixedWindowSize; ++f )
+        {
+          const OffsetValueType fixedBin = fixedImageParzenWindowIndex + f;
+          if ( fixedBin < fixedBinBegin || fixedBin >= fixedBinEnd ) continue;
+
+          const double fv_et = fixedParzenValues[ f ] / et;
+          pdfIndex[ 1 ] = fixedBin;
+          pdfIndex[ 0 ] = movingImageParzenWindowIndex;
+          for ( unsigned int m = 0; m < derivativeMovingParzenValues.GetSize(); ++m )
+          {
+            this->UpdateJointPDFDerivatives(
+              pdfIndex, fv_et * derivativeMovingParzenValues[ m ],
+              imageJacobian, nzji );
+            ++( pdfIndex[ 0 ] );
+          }
+        } // end for f
+      } // end for n
+    } // end for t
+
+  } // end ThreadedComputeJointPDFDerivatives()
+
+
+  /**
+   * ******************* AfterThreadedComputePDFs *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::AfterThreadedComputePDFs( void ) const
+  {
+    /** Accumulate the number of pixels, and check if enough samples were valid. */
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+    this->GatherThreadedValues( dummyValue );
+
+    /** Sum the private joint PDFs into m_JointPDF. */
+    if ( numberOfThreads == 1 )
+    {
+      const JointPDFType * jointPDF
+        = this->m_ParzenWindowHistogramPerThreadVariables[ 0 ].st_JointPDF;
+      std::copy( jointPDF->GetBufferPointer(),
+        jointPDF->GetBufferPointer() + jointPDF->GetPixelContainer()->Size(),
+        this->m_JointPDF->GetBufferPointer() );
+    }
+    else
+    {
+      this->LaunchParzenWindowHistogramThreaderCallback( ReduceJointPDFsTask );
+    }
+
+    /** Compute alpha. */
+    this->m_Alpha = 0.0;
+    if ( this->m_NumberOfPixelsCounted > 0 )
+    {
+      this->m_Alpha = 1.0 / static_cast<double>( this->m_NumberOfPixelsCounted );
+    }
+
+  } // end AfterThreadedComputePDFs()
+
+
+  /**
+   * ******************* ComputeFixedHistogramBinThreadBoundaries *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ComputeFixedHistogramBinThreadBoundaries( void ) const
+  {
+    /** The work of a fixed bin in ThreadedComputeJointPDFDerivatives() is
+     * roughly proportional to its histogram mass, i.e. to the (unnormalized)
+     * fixed marginal histogram. Distribute the bins such that every thread
+     * gets about the same mass.
+     */
+    const unsigned int numberOfThreads = this->GetNumberOfThreads();
+    const unsigned long numberOfFixedBins = this->m_NumberOfFixedHistogramBins;
+    const unsigned long numberOfMovingBins = this->m_NumberOfMovingHistogramBins;
+
+    std::vector<double> fixedBinMass( numberOfFixedBins, 0.0 );
+    double totalMass = 0.0;
+    const PDFValueType * jointPDFPtr = this->m_JointPDF->GetBufferPointer();
+    for ( unsigned long f = 0; f < numberOfFixedBins; ++f )
+    {
+      for ( unsigned long m = 0; m < numberOfMovingBins; ++m )
+      {
+        fixedBinMass[ f ] += *jointPDFPtr;
+        ++jointPDFPtr;
+      }
+      totalMass += fixedBinMass[ f ];
+    }
+
+    /** Thread t owns the fixed bins [ boundaries[t], boundaries[t+1] ). */
+    this->m_FixedHistogramBinThreadBoundaries.assign(
+      numberOfThreads + 1, numberOfFixedBins );
+    this->m_FixedHistogramBinThreadBoundaries[ 0 ] = 0;
+    unsigned int t = 1;
+    double cumulativeMass = 0.0;
+    for ( unsigned long f = 0; f < numberOfFixedBins && t < numberOfThreads; ++f )
+    {
+      cumulativeMass += fixedBinMass[ f ];
+      while ( t < numberOfThreads
+        && cumulativeMass >= totalMass * static_cast<double>( t ) / numberOfThreads )
+      {
+        this->m_FixedHistogramBinThreadBoundaries[ t ] = f + 1;
+        ++t;
+      }
+    }
+
+  } // end ComputeFixedHistogramBinThreadBoundaries()
+
+
+  /**
+   * ******************* LaunchParzenWindowHistogramThreaderCallback *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::LaunchParzenWindowHistogramThreaderCallback(
+    ParzenWindowHistogramThreadTaskType task ) const
+  {
+    /** Execute the task for all thread ids in this thread. */
+    if ( !this->GetUseMultiThread() )
+    {
+      const unsigned int numberOfThreads = this->GetNumberOfThreads();
+      for ( unsigned int threadID = 0; threadID < numberOfThreads; ++threadID )
+      {
+        this->ExecuteParzenWindowHistogramThreadTask( threadID, task );
+      }
+      return;
+    }
+
+    this->m_ParzenWindowHistogramThreaderParameters.st_Task = task;
+    this->m_Threader->SetSingleMethod(
+      this->ParzenWindowHistogramThreaderCallback,
+      const_cast<void *>( static_cast<const void *>(
+      &this->m_ParzenWindowHistogramThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+
+  } // end LaunchParzenWindowHistogramThreaderCallback()
+
+
+  /**
+   * ******************* ParzenWindowHistogramThreaderCallback *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    ITK_THREAD_RETURN_TYPE
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ParzenWindowHistogramThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+    const unsigned int threadID = infoStruct->ThreadID;
+
+    ParzenWindowHistogramMultiThreaderParameterType * temp
+      = static_cast<ParzenWindowHistogramMultiThreaderParameterType *>(
+      infoStruct->UserData );
+
+    temp->st_Metric->ExecuteParzenWindowHistogramThreadTask( threadID, temp->st_Task );
+
+    /** Add the profiled times of this thread, before it ends. */
+    tmr::Profiler::FlushThread();
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end ParzenWindowHistogramThreaderCallback()
+
+
+  /**
+   * ******************* ExecuteParzenWindowHistogramThreadTask *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    void
+    ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::ExecuteParzenWindowHistogramThreadTask( unsigned int threadID,
+    ParzenWindowHistogramThreadTaskType task ) const
+  {
+    switch ( task )
+    {
+      case ComputePDFsTask:
+        this->ThreadedComputePDFs( threadID, false ); break;
+      case ComputePDFsAndStoreSamplesTask:
+        this->ThreadedComputePDFs( threadID, true ); break;
+      case ReduceJointPDFsTask:
+        this->ThreadedReduceJointPDFs( threadID ); break;
+      case ComputeJointPDFDerivativesTask:
+        this->ThreadedComputeJointPDFDerivatives( threadID ); break;
+    }
+
+  } // end ExecuteParzenWindowHistogramThreadTask()
+
+
 } // end namespace itk
 
 
@@ -16,6 +16,7 @@
 #define __itkScaledSingleValuedCostFunction_cxx
 
 #include "itkScaledSingleValuedCostFunction.h"
+#include "elxProfiler.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -45,6 +46,8 @@ ScaledSingleValuedCostFunction
 {
   /** F(y)= f(y/s) */
 
+  tmr::ProfilerScope profilerScope( tmr::Profiler::CostFunction );
+
   /** This function also checks if the UnscaledCostFunction has been set */
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   if ( parameters.GetSize() != numberOfParameters )
@@ -85,6 +88,8 @@ ScaledSingleValuedCostFunction
 {
   /** dF/dy(y)= 1/s * df/dx(y/s) */
 
+  tmr::ProfilerScope profilerScope( tmr::Profiler::CostFunction );
+
   /** This function also checks if the UnscaledCostFunction has been set */
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   if ( parameters.GetSize() != numberOfParameters )
@@ -130,6 +135,8 @@ ScaledSingleValuedCostFunction
   /** F(y)= f(y/s) */
   /** dF/dy(y)= 1/s * df/dx(y/s) */
 
+  tmr::ProfilerScope profilerScope( tmr::Profiler::CostFunction );
+
   /** This function also checks if the UnscaledCostFunction has been set */
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   if ( parameters.GetSize() != numberOfParameters )
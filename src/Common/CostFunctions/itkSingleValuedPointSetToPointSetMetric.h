@@ -122,9 +122,18 @@ public:
   /** Get a pointer to the Transform.  */
   itkGetConstObjectMacro( Transform, TransformType );
 
-  /** Set the parameters defining the Transform. */
+  /** Set the parameters defining the Transform, unless
+   * TransformParametersAreSetExternally is true.
+   */
   void SetTransformParameters( const ParametersType & parameters ) const;
 
+  /** Set/Get whether the transform parameters are set by the owner of the
+   * transform, before GetValue() etc. are called. See the
+   * AdvancedImageToImageMetric. Default: false.
+   */
+  itkSetMacro( TransformParametersAreSetExternally, bool );
+  itkGetConstMacro( TransformParametersAreSetExternally, bool );
+
   /** Return the number of parameters required by the transform. */
   unsigned int GetNumberOfParameters( void ) const
   { return this->m_Transform->GetNumberOfParameters(); }
@@ -162,6 +171,7 @@ protected:
   mutable TransformPointer    m_Transform;
 
   mutable unsigned int        m_NumberOfPointsCounted;
+  bool                        m_TransformParametersAreSetExternally;
 
 private:
   SingleValuedPointSetToPointSetMetric(const Self&); //purposely not implemented
@@ -37,6 +37,7 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet,TMovingPointSet>
   this->m_MovingImageMask = 0;
 
   this->m_NumberOfPointsCounted = 0;
+  this->m_TransformParametersAreSetExternally = false;
 
 } // end Constructor
 
@@ -54,7 +55,10 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet,TMovingPointSet>
   {
     itkExceptionMacro( << "Transform has not been assigned" );
   }
-  this->m_Transform->SetParameters( parameters );
+  if ( !this->m_TransformParametersAreSetExternally )
+  {
+    this->m_Transform->SetParameters( parameters );
+  }
 
 } // end SetTransformParameters()
 
@@ -0,0 +1,187 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTransformEvaluationCache_h
+#define __itkTransformEvaluationCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class TransformEvaluationCache
+ *
+ * \brief Stores the mapped points and the sparse Jacobians of a transform,
+ * evaluated at a set of image samples.
+ *
+ * When several metrics sample the fixed image at the same points, they
+ * all compute the same TransformPoint() and GetJacobian() per sample. This
+ * class computes them once, for a group of sample containers with identical
+ * sample coordinates, after which all metrics read them from the cache.
+ *
+ * A metric looks up a sample by its index in its own sample container,
+ * which is one of the containers of the group, and passes the coordinates
+ * it is about to transform. If these still equal the cached coordinates,
+ * the cached values are returned. Otherwise the lookup fails, and the metric
+ * should evaluate the transform itself. This makes the cache safe for metrics
+ * that modify the sample coordinates.
+ *
+ * The cache is not updated automatically: call Compute() whenever the
+ * transform parameters or the samples change.
+ *
+ * \ingroup RegistrationMetrics
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+class TransformEvaluationCache : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef TransformEvaluationCache    Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer<Self>          Pointer;
+  typedef SmartPointer<const Self>    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformEvaluationCache, Object );
+
+  /** Typedefs. */
+  typedef TAdvancedTransform                              TransformType;
+  typedef typename TransformType::InputPointType          InputPointType;
+  typedef typename TransformType::OutputPointType         OutputPointType;
+  typedef typename TransformType::JacobianType            JacobianType;
+  typedef typename
+    TransformType::NonZeroJacobianIndicesType             NonZeroJacobianIndicesType;
+  typedef TImageSampleContainer                           ImageSampleContainerType;
+  typedef typename ImageSampleContainerType::ConstPointer ImageSampleContainerConstPointer;
+  typedef typename ImageSampleContainerType::Element      ImageSampleType;
+
+  /** Set/Get the transform. */
+  itkSetConstObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set/Get the maximum number of samples for which the Jacobians are
+   * cached. For larger sample sets only the mapped points are cached,
+   * to bound the memory use. The cache itself is sized to the actual
+   * number of samples. Default: 20000.
+   */
+  itkSetMacro( MaximumNumberOfJacobians, unsigned long );
+  itkGetConstMacro( MaximumNumberOfJacobians, unsigned long );
+
+  /** Set/Get the number of threads used by Compute(). */
+  itkSetMacro( NumberOfThreads, unsigned int );
+  itkGetConstMacro( NumberOfThreads, unsigned int );
+
+  /** Remove all sample containers and invalidate the cached values. */
+  void Initialize( void );
+
+  /** Add a sample container to the group. The first container defines the
+   * sample coordinates; further containers are only added if they have
+   * exactly the same coordinates. Returns whether the container was added.
+   */
+  bool AddSampleContainer( const ImageSampleContainerType * samples );
+
+  /** Get the number of sample containers in the group. */
+  unsigned int GetNumberOfSampleContainers( void ) const
+  {
+    return this->m_SampleContainers.size();
+  };
+
+  /** Evaluate the transform at all samples, and optionally its Jacobian. */
+  void Compute( bool computeJacobians );
+
+  /** Get the cached mapped point of the sample with index sampleIndex.
+   * Returns false if the sample is not cached, or if fixedPoint differs
+   * from the cached sample coordinates.
+   */
+  bool GetMappedPoint( unsigned long sampleIndex,
+    const InputPointType & fixedPoint,
+    OutputPointType & mappedPoint ) const;
+
+  /** Get the cached Jacobian of the sample with index sampleIndex. On
+   * success, jacobian and nonZeroJacobianIndices point into the cache, so
+   * nothing is copied. Returns false if the sample is not cached, if
+   * fixedPoint differs from the cached sample coordinates, or if no
+   * Jacobians were cached.
+   */
+  bool GetJacobian( unsigned long sampleIndex,
+    const InputPointType & fixedPoint,
+    const JacobianType * & jacobian,
+    const NonZeroJacobianIndicesType * & nonZeroJacobianIndices ) const;
+
+protected:
+
+  /** The constructor. */
+  TransformEvaluationCache();
+
+  /** The destructor. */
+  virtual ~TransformEvaluationCache() {};
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream& os, Indent indent ) const;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader                              ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct                  ThreadInfoType;
+
+  /** Check that a sample index is cached, with the given coordinates. */
+  bool IsCachedSample( unsigned long sampleIndex,
+    const InputPointType & fixedPoint ) const
+  {
+    return sampleIndex < this->m_FixedPoints.size()
+      && fixedPoint == this->m_FixedPoints[ sampleIndex ];
+  };
+
+  /** Evaluate the transform for the samples of one thread. */
+  void ThreadedCompute( unsigned int threadID, unsigned int numberOfThreads );
+
+  /** The threader callback. */
+  static ITK_THREAD_RETURN_TYPE ComputeThreaderCallback( void * arg );
+
+private:
+
+  TransformEvaluationCache( const Self& );  // purposely not implemented
+  void operator=( const Self& );            // purposely not implemented
+
+  /** Member variables. */
+  typename TransformType::ConstPointer                m_Transform;
+  std::vector< ImageSampleContainerConstPointer >     m_SampleContainers;
+  std::vector< InputPointType >                       m_FixedPoints;
+  std::vector< OutputPointType >                      m_MappedPoints;
+  std::vector< JacobianType >                         m_Jacobians;
+  std::vector< NonZeroJacobianIndicesType >           m_NonZeroJacobianIndices;
+  bool                                                m_MappedPointsAreComputed;
+  bool                                                m_JacobiansAreComputed;
+  bool                                                m_ComputeJacobians;
+  unsigned long                                       m_MaximumNumberOfJacobians;
+  unsigned int                                        m_NumberOfThreads;
+  ThreaderType::Pointer                               m_Threader;
+
+}; // end class TransformEvaluationCache
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformEvaluationCache.hxx"
+#endif
+
+#endif // end #ifndef __itkTransformEvaluationCache_h
@@ -0,0 +1,294 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTransformEvaluationCache_hxx
+#define __itkTransformEvaluationCache_hxx
+
+#include "itkTransformEvaluationCache.h"
+#include "elxProfiler.h"
+#include "vnl/vnl_math.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::TransformEvaluationCache()
+{
+  this->m_MappedPointsAreComputed = false;
+  this->m_JacobiansAreComputed = false;
+  this->m_ComputeJacobians = false;
+  this->m_MaximumNumberOfJacobians = 20000;
+  this->m_Threader = ThreaderType::New();
+  this->m_NumberOfThreads = this->m_Threader->GetNumberOfThreads();
+
+} // end Constructor
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+void
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::PrintSelf( std::ostream& os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "NumberOfSampleContainers: "
+    << this->m_SampleContainers.size() << std::endl;
+  os << indent << "NumberOfSamples: " << this->m_FixedPoints.size() << std::endl;
+  os << indent << "MappedPointsAreComputed: "
+    << ( this->m_MappedPointsAreComputed ? "true" : "false" ) << std::endl;
+  os << indent << "JacobiansAreComputed: "
+    << ( this->m_JacobiansAreComputed ? "true" : "false" ) << std::endl;
+  os << indent << "MaximumNumberOfJacobians: "
+    << this->m_MaximumNumberOfJacobians << std::endl;
+  os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ********************* Initialize ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+void
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::Initialize( void )
+{
+  /** The buffers are kept, to avoid reallocation in the next iteration. */
+  this->m_SampleContainers.clear();
+  this->m_MappedPointsAreComputed = false;
+  this->m_JacobiansAreComputed = false;
+
+} // end Initialize()
+
+
+/**
+ * ********************* AddSampleContainer ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+bool
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::AddSampleContainer( const ImageSampleContainerType * samples )
+{
+  if ( samples == 0 ) return false;
+
+  /** The first container defines the samples. */
+  if ( this->m_SampleContainers.empty() )
+  {
+    this->m_SampleContainers.push_back( samples );
+    this->m_MappedPointsAreComputed = false;
+    this->m_JacobiansAreComputed = false;
+    return true;
+  }
+
+  /** Other containers should have exactly the same coordinates. */
+  const ImageSampleContainerType * first = this->m_SampleContainers[ 0 ];
+  if ( samples != first )
+  {
+    if ( samples->Size() != first->Size() ) return false;
+    typename ImageSampleContainerType::ConstIterator it1 = first->Begin();
+    typename ImageSampleContainerType::ConstIterator it2 = samples->Begin();
+    typename ImageSampleContainerType::ConstIterator end = first->End();
+    for ( ; it1 != end; ++it1, ++it2 )
+    {
+      if ( it1.Value().m_ImageCoordinates != it2.Value().m_ImageCoordinates )
+      {
+        return false;
+      }
+    }
+  }
+
+  this->m_SampleContainers.push_back( samples );
+  return true;
+
+} // end AddSampleContainer()
+
+
+/**
+ * ********************* Compute ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+void
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::Compute( bool computeJacobians )
+{
+  this->m_MappedPointsAreComputed = false;
+  this->m_JacobiansAreComputed = false;
+  if ( this->m_Transform.IsNull() || this->m_SampleContainers.empty() )
+  {
+    return;
+  }
+
+  /** Copy the sample coordinates, so that the lookup can check that the
+   * metric transforms the same coordinates as were cached.
+   */
+  const ImageSampleContainerType * samples = this->m_SampleContainers[ 0 ];
+  const unsigned long numberOfSamples = samples->Size();
+  this->m_FixedPoints.resize( numberOfSamples );
+  typename ImageSampleContainerType::ConstIterator it = samples->Begin();
+  for ( unsigned long i = 0; i < numberOfSamples; ++i, ++it )
+  {
+    this->m_FixedPoints[ i ] = it.Value().m_ImageCoordinates;
+  }
+  this->m_MappedPoints.resize( numberOfSamples );
+
+  /** Only cache the Jacobians if they fit in memory. */
+  this->m_ComputeJacobians = computeJacobians
+    && numberOfSamples <= this->m_MaximumNumberOfJacobians;
+  if ( this->m_ComputeJacobians )
+  {
+    this->m_Jacobians.resize( numberOfSamples );
+    this->m_NonZeroJacobianIndices.resize( numberOfSamples );
+  }
+
+  /** Launch the threads. */
+  this->m_Threader->SetNumberOfThreads( this->m_NumberOfThreads );
+  this->m_Threader->SetSingleMethod( ComputeThreaderCallback, this );
+  this->m_Threader->SingleMethodExecute();
+
+  this->m_MappedPointsAreComputed = true;
+  this->m_JacobiansAreComputed = this->m_ComputeJacobians;
+
+} // end Compute()
+
+
+/**
+ * ********************* ThreadedCompute ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+void
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::ThreadedCompute( unsigned int threadID, unsigned int numberOfThreads )
+{
+  /** Compute the range of samples of this thread. */
+  const unsigned long numberOfSamples = this->m_FixedPoints.size();
+  const unsigned long chunk
+    = ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads;
+  const unsigned long begin = vnl_math_min( threadID * chunk, numberOfSamples );
+  const unsigned long end = vnl_math_min( begin + chunk, numberOfSamples );
+  if ( begin == end ) return;
+
+  /** Use the batched methods of the transform. */
+  const bool profile = tmr::Profiler::GetEnabled();
+  double startTime = profile ? tmr::Timer::GetWallClockTime() : 0.0;
+  this->m_Transform->TransformPoints( end - begin,
+    &this->m_FixedPoints[ begin ], &this->m_MappedPoints[ begin ] );
+  if ( profile )
+  {
+    const double stopTime = tmr::Timer::GetWallClockTime();
+    tmr::Profiler::AddTime( tmr::Profiler::TransformPoint,
+      stopTime - startTime, end - begin );
+    startTime = stopTime;
+  }
+  if ( this->m_ComputeJacobians )
+  {
+    this->m_Transform->GetJacobians( end - begin,
+      &this->m_FixedPoints[ begin ], &this->m_Jacobians[ begin ],
+      &this->m_NonZeroJacobianIndices[ begin ] );
+    if ( profile )
+    {
+      tmr::Profiler::AddTime( tmr::Profiler::GetJacobian,
+        tmr::Timer::GetWallClockTime() - startTime, end - begin );
+    }
+  }
+
+} // end ThreadedCompute()
+
+
+/**
+ * ********************* ComputeThreaderCallback ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+ITK_THREAD_RETURN_TYPE
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::ComputeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  Self * cache = static_cast<Self *>( infoStruct->UserData );
+
+  cache->ThreadedCompute( infoStruct->ThreadID, infoStruct->NumberOfThreads );
+
+  /** Add the profiled times of this thread, before it ends. */
+  tmr::Profiler::FlushThread();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeThreaderCallback()
+
+
+/**
+ * ********************* GetMappedPoint ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+bool
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::GetMappedPoint( unsigned long sampleIndex,
+  const InputPointType & fixedPoint,
+  OutputPointType & mappedPoint ) const
+{
+  if ( !this->m_MappedPointsAreComputed
+    || !this->IsCachedSample( sampleIndex, fixedPoint ) )
+  {
+    return false;
+  }
+
+  mappedPoint = this->m_MappedPoints[ sampleIndex ];
+  return true;
+
+} // end GetMappedPoint()
+
+
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template < class TAdvancedTransform, class TImageSampleContainer >
+bool
+TransformEvaluationCache<TAdvancedTransform,TImageSampleContainer>
+::GetJacobian( unsigned long sampleIndex,
+  const InputPointType & fixedPoint,
+  const JacobianType * & jacobian,
+  const NonZeroJacobianIndicesType * & nonZeroJacobianIndices ) const
+{
+  if ( !this->m_JacobiansAreComputed
+    || !this->IsCachedSample( sampleIndex, fixedPoint ) )
+  {
+    return false;
+  }
+
+  jacobian = &this->m_Jacobians[ sampleIndex ];
+  nonZeroJacobianIndices = &this->m_NonZeroJacobianIndices[ sampleIndex ];
+  return true;
+
+} // end GetJacobian()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformEvaluationCache_hxx
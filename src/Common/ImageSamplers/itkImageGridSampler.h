@@ -33,6 +33,10 @@ namespace itk
    *    index coordinates. \n
    *    example: <tt>(SampleGridSpacing 4 4 4)</tt> \n
    *    Default is 2 in each dimension.
+   *
+   * When UseMultiThread is set and no mask is used, the grid points are
+   * distributed over multiple threads. The result is identical to that of
+   * the single-threaded code.
 	 *
 	 *
 	 * \ingroup ImageSamplers
@@ -131,6 +135,12 @@ namespace itk
       return false;
     }
 
+    /** This sampler generates its samples with multiple threads, if enabled. */
+    virtual bool ThreadedGenerateDataSupported( void ) const
+    {
+      return true;
+    }
+
   protected:
 
     /** The constructor. */
@@ -148,12 +158,19 @@ namespace itk
     /** Function that does the work. */
     virtual void GenerateData( void );
 
+    /** Generate the samples of one thread. */
+    virtual void ThreadedGenerateData( unsigned int threadID );
+
     /** An array of integer spacing factors */
     SampleGridSpacingType m_SampleGridSpacing;
 
     /** The number of samples entered in the SetNumberOfSamples method */
     unsigned long m_RequestedNumberOfSamples;
 
+    /** The first grid point and the grid size, used by the threads. */
+    SampleGridIndexType   m_ThreaderSampleGridIndex;
+    SampleGridSizeType    m_ThreaderSampleGridSize;
+
   private:
 
     /** The private constructor. */
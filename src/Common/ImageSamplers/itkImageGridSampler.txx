@@ -71,6 +71,17 @@ namespace itk
       numberOfSamplesOnGrid *= sampleGridSize[dim];
     }
 
+    /** Generate the samples using multiple threads, if requested. Masks are
+     * not thread-safe, so with a mask the single-threaded code is used.
+     */
+    if ( this->m_UseMultiThread && mask.IsNull() )
+    {
+      this->m_ThreaderSampleGridIndex = sampleGridIndex;
+      this->m_ThreaderSampleGridSize = sampleGridSize;
+      this->LaunchThreadedGenerateData( numberOfSamplesOnGrid );
+      return;
+    }
+
     /** Prepare for looping over the grid. */
     unsigned int dim_z = 1;
     unsigned int dim_t = 1;
@@ -184,6 +195,51 @@ namespace itk
   } // end GenerateData
 
 
+  /**
+   * ******************* ThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageGridSampler< TInputImage >
+    ::ThreadedGenerateData( unsigned int threadID )
+  {
+    /** Get handles to the input image and output sample container. */
+    const InputImageType * inputImage = this->GetInput();
+    ImageSampleContainerType * sampleContainer = this->GetOutput();
+
+    /** Get the range of samples of this thread. */
+    unsigned long pos_begin, pos_end;
+    this->GetThreadSampleRange( threadID, pos_begin, pos_end );
+    typename ImageSampleContainerType::Iterator iter = sampleContainer->Begin();
+    iter += pos_begin;
+
+    /** Loop over the grid points of this thread. The x-index runs fastest,
+     * just like in the single-threaded loop.
+     */
+    SampleGridIndexType index;
+    for ( unsigned long pos = pos_begin; pos < pos_end; ++pos, ++iter )
+    {
+      /** Convert the sample number to a grid position. */
+      unsigned long remainder = pos;
+      for ( unsigned int dim = 0; dim < InputImageDimension; ++dim )
+      {
+        const unsigned long gridSize = this->m_ThreaderSampleGridSize[ dim ];
+        index[ dim ] = this->m_ThreaderSampleGridIndex[ dim ]
+          + static_cast<long>( remainder % gridSize ) * this->m_SampleGridSpacing[ dim ];
+        remainder /= gridSize;
+      }
+
+      /** Put the sampled fixed image value and the point in the sample. */
+      (*iter).Value().m_ImageValue = inputImage->GetPixel( index );
+      inputImage->TransformIndexToPhysicalPoint(
+        index, (*iter).Value().m_ImageCoordinates );
+
+    } // end for loop
+
+  } // end ThreadedGenerateData()
+
+
   /**
    * ******************* SetNumberOfSamples *******************
    */
@@ -19,6 +19,7 @@
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <vector>
 
 namespace itk
 {
@@ -29,6 +30,25 @@ namespace itk
    *
    * This image sampler generates not only samples that correspond with
    * pixel locations, but selects points in physical space.
+   *
+   * If a mask is given and UseDirectMaskSampling is true (the default), the
+   * sampler first builds a run-length index of the voxels of the (cropped)
+   * input image region whose centre lies inside the mask. Every sample then
+   * picks one of these voxels uniformly, and a uniformly distributed position
+   * within that voxel. This avoids the rejection sampling that is otherwise
+   * used, which wastes most of its draws for small masks, and which gives up
+   * after 10 * NumberOfSamples tries. The index is rebuilt only when the
+   * input image, the mask or the cropped region changes. Note that near the
+   * mask boundary a sample may lie up to half a voxel outside the mask.
+   * Direct mask sampling is not used in combination with
+   * UseRandomSampleRegion.
+   *
+   * When UseMultiThread is set, the samples are generated by multiple
+   * threads, each drawing from its own random number stream (see
+   * ImageRandomSamplerBase). Masks are not thread-safe, so this is only done
+   * when no mask is used or when the mask is sampled directly. The
+   * interpolator is evaluated concurrently, so it must be reentrant, which is
+   * the case for the default B-spline interpolator.
 	 *
 	 * \ingroup ImageSamplers
    */
@@ -99,9 +119,24 @@ namespace itk
     itkGetConstMacro(UseRandomSampleRegion, bool);
     itkSetMacro(UseRandomSampleRegion, bool);
 
+    /** Set/Get whether to draw samples directly from the voxels inside the
+     * mask, instead of using rejection sampling. Default: true. */
+    itkGetConstMacro( UseDirectMaskSampling, bool );
+    itkSetMacro( UseDirectMaskSampling, bool );
+    itkBooleanMacro( UseDirectMaskSampling );
+
+    /** This sampler generates its samples with multiple threads, if enabled. */
+    virtual bool ThreadedGenerateDataSupported( void ) const
+    {
+      return true;
+    }
+
   protected:
 
     typedef typename InterpolatorType::ContinuousIndexType   InputImageContinuousIndexType;
+    typedef typename InputImageContinuousIndexType::VectorType
+      InputImageContinuousIndexVectorType;
+    typedef typename Superclass::ThreadRandomGeneratorType   ThreadRandomGeneratorType;
 
     /** The constructor. */
     ImageRandomCoordinateSampler();
@@ -121,6 +156,20 @@ namespace itk
       const InputImageContinuousIndexType & largestContIndex,
       InputImageContinuousIndexType &       randomContIndex);
 
+    /** Generate a point randomly in a bounding box, using the given random
+     * number stream. Used by the multi-threaded GenerateData(). */
+    virtual void GenerateRandomCoordinate(
+      const InputImageContinuousIndexType & smallestContIndex,
+      const InputImageContinuousIndexType & largestContIndex,
+      InputImageContinuousIndexType &       randomContIndex,
+      ThreadRandomGeneratorType &           randomGenerator ) const;
+
+    /** Initialize the random streams and select the sample region. */
+    virtual void BeforeThreadedGenerateData( void );
+
+    /** Generate the samples of one thread. */
+    virtual void ThreadedGenerateData( unsigned int threadID );
+
     typename InterpolatorType::Pointer    m_Interpolator;
     typename RandomGeneratorType::Pointer m_RandomGenerator;
     InputImageSpacingType                 m_SampleRegionSize;
@@ -136,6 +185,59 @@ namespace itk
       InputImageContinuousIndexType & smallestContIndex,
       InputImageContinuousIndexType & largestContIndex );
 
+    /** Compute the size of a sample region in continuous index units and the
+     * largest allowed smallest corner of a sample region. */
+    virtual void ComputeSampleRegionBounds(
+      const InputImageContinuousIndexType & smallestImageContIndex,
+      const InputImageContinuousIndexType & largestImageContIndex,
+      InputImageContinuousIndexVectorType & sampleRegionSize,
+      InputImageContinuousIndexType & maxSmallestContIndex ) const;
+
+    /** Build the run-length index of the voxels inside the mask, if the
+     * input image, the mask or the cropped input image region has changed
+     * since it was last built.
+     */
+    virtual void UpdateMaskRunLengthIndex( void );
+
+    /** Map a number u in [0,1) to a voxel inside the mask, and return the
+     * continuous index of that voxel, shifted by the given offset. The offset
+     * should lie in [-0.5,0.5) for each dimension. The result is clamped to
+     * the cropped input image region.
+     */
+    void ComputeContinuousIndexInMask( double u,
+      const InputImageContinuousIndexVectorType & offset,
+      InputImageContinuousIndexType & contIndex ) const;
+
+    /** Generate a random point inside the mask, using the run-length index. */
+    void GenerateRandomCoordinateInMask(
+      InputImageContinuousIndexType & randomContIndex );
+
+    /** Generate a random point inside the mask, using the run-length index
+     * and the given random number stream. */
+    void GenerateRandomCoordinateInMask(
+      InputImageContinuousIndexType & randomContIndex,
+      ThreadRandomGeneratorType & randomGenerator ) const;
+
+    /** The run-length index of the voxels inside the mask. For each run of
+     * inside voxels along the x-direction we store the offset of its first
+     * voxel in the cropped input image region, and the total number of inside
+     * voxels up to and including that run.
+     */
+    std::vector< unsigned long >          m_MaskRunStartOffsets;
+    std::vector< unsigned long >          m_MaskRunCumulativeLengths;
+    InputImageRegionType                  m_MaskRunLengthIndexRegion;
+    const MaskType *                      m_MaskRunLengthIndexMask;
+    TimeStamp                             m_MaskRunLengthIndexUpdateTime;
+
+    /** Whether the current sample set is drawn using the run-length index. */
+    bool                                  m_UseMaskRunLengthIndex;
+
+    /** The image and sample region corners used by the threads. */
+    InputImageContinuousIndexType         m_ThreaderSmallestImageContIndex;
+    InputImageContinuousIndexType         m_ThreaderLargestImageContIndex;
+    InputImageContinuousIndexType         m_ThreaderSmallestContIndex;
+    InputImageContinuousIndexType         m_ThreaderLargestContIndex;
+
   private:
 
     /** The private constructor. */
@@ -144,6 +246,7 @@ namespace itk
     void operator=( const Self& );            // purposely not implemented
 
     bool          m_UseRandomSampleRegion;
+    bool          m_UseDirectMaskSampling;
 
   }; // end class ImageRandomCoordinateSampler
 
@@ -16,7 +16,9 @@
 #define __ImageRandomCoordinateSampler_txx
 
 #include "itkImageRandomCoordinateSampler.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
 
 
 namespace itk
@@ -43,6 +45,10 @@ namespace itk
     this->m_UseRandomSampleRegion = false;
     this->m_SampleRegionSize.Fill( 1.0 );
 
+    this->m_UseDirectMaskSampling = true;
+    this->m_UseMaskRunLengthIndex = false;
+    this->m_MaskRunLengthIndexMask = 0;
+
   } // end constructor
 
 
@@ -73,6 +79,34 @@ namespace itk
       = smallestIndex + this->GetCroppedInputImageRegion().GetSize() - unitSize;
     InputImageContinuousIndexType smallestImageContIndex( smallestIndex );
     InputImageContinuousIndexType largestImageContIndex( largestIndex );
+
+    /** Update the mask, and decide whether to sample the mask directly. */
+    this->m_UseMaskRunLengthIndex = false;
+    if ( mask.IsNotNull() )
+    {
+      if ( mask->GetSource() )
+      {
+        mask->GetSource()->Update();
+      }
+      if ( this->m_UseDirectMaskSampling && !this->GetUseRandomSampleRegion() )
+      {
+        this->UpdateMaskRunLengthIndex();
+        this->m_UseMaskRunLengthIndex = true;
+      }
+    }
+
+    /** Generate the samples using multiple threads, if requested. Masks are
+     * not thread-safe, so this is not done when the mask has to be evaluated.
+     */
+    if ( this->m_UseMultiThread
+      && ( mask.IsNull() || this->m_UseMaskRunLengthIndex ) )
+    {
+      this->m_ThreaderSmallestImageContIndex = smallestImageContIndex;
+      this->m_ThreaderLargestImageContIndex = largestImageContIndex;
+      this->LaunchThreadedGenerateData( this->GetNumberOfSamples() );
+      return;
+    }
+
     InputImageContinuousIndexType smallestContIndex;
     InputImageContinuousIndexType largestContIndex;
     this->GenerateSampleRegion( smallestImageContIndex, largestImageContIndex,
@@ -112,13 +146,27 @@ namespace itk
 
       } // end for loop
     } // end if no mask
-    else
+    else if ( this->m_UseMaskRunLengthIndex )
     {
-      /** Update the mask. */
-      if ( mask->GetSource() )
+      /** Start looping over the sample container. */
+      for ( iter = sampleContainer->Begin(); iter != end; ++iter )
       {
-        mask->GetSource()->Update();
-      }
+        /** Make a reference to the current sample in the container. */
+        InputImagePointType & samplePoint = (*iter).Value().m_ImageCoordinates;
+        ImageSampleValueType & sampleValue = (*iter).Value().m_ImageValue;
+
+        /** Generate a point inside the mask, and convert it to a point. */
+        this->GenerateRandomCoordinateInMask( sampleContIndex );
+        inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, samplePoint );
+
+        /** Compute the value at the contindex. */
+        sampleValue = static_cast<ImageSampleValueType>(
+          this->m_Interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+
+      } // end for loop
+    } // end if direct mask sampling
+    else
+    {
       /** Set up some variable that are used to make sure we are not forever
        * walking around on this image, trying to look for valid samples. */
       unsigned long numberOfSamplesTried = 0;
@@ -164,6 +212,162 @@ namespace itk
   } // end GenerateData()
 
 
+  /**
+   * ******************* UpdateMaskRunLengthIndex *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::UpdateMaskRunLengthIndex( void )
+  {
+    InputImageConstPointer inputImage = this->GetInput();
+    const MaskType * mask = this->GetMask();
+    const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+
+    /** Check if the index is still up to date. */
+    const unsigned long updateTime = this->m_MaskRunLengthIndexUpdateTime.GetMTime();
+    if ( !this->m_MaskRunStartOffsets.empty()
+      && mask == this->m_MaskRunLengthIndexMask
+      && region == this->m_MaskRunLengthIndexRegion
+      && mask->GetMTime() < updateTime
+      && inputImage->GetMTime() < updateTime )
+    {
+      return;
+    }
+
+    /** Walk over the region in memory order, and store the runs of voxels
+     * whose centre is inside the mask.
+     */
+    this->m_MaskRunStartOffsets.clear();
+    this->m_MaskRunCumulativeLengths.clear();
+    typedef ImageRegionConstIteratorWithIndex< InputImageType > IteratorType;
+    IteratorType it( inputImage, region );
+    InputImagePointType point;
+    unsigned long offset = 0;
+    unsigned long numberOfInsideVoxels = 0;
+    bool previousInside = false;
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++offset )
+    {
+      inputImage->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+      const bool inside = mask->IsInside( point );
+
+      /** Start a new run at the start of every line, since a run may
+       * not wrap around. */
+      const bool newLine = ( it.GetIndex()[ 0 ] == region.GetIndex()[ 0 ] );
+      if ( inside )
+      {
+        ++numberOfInsideVoxels;
+        if ( !previousInside || newLine )
+        {
+          this->m_MaskRunStartOffsets.push_back( offset );
+          this->m_MaskRunCumulativeLengths.push_back( numberOfInsideVoxels );
+        }
+        else
+        {
+          this->m_MaskRunCumulativeLengths.back() = numberOfInsideVoxels;
+        }
+      }
+      previousInside = inside;
+    }
+
+    if ( numberOfInsideVoxels == 0 )
+    {
+      itkExceptionMacro( << "Could not find any image samples. "
+        << "The mask does not overlap with the input image region." );
+    }
+
+    this->m_MaskRunLengthIndexMask = mask;
+    this->m_MaskRunLengthIndexRegion = region;
+    this->m_MaskRunLengthIndexUpdateTime.Modified();
+
+  } // end UpdateMaskRunLengthIndex()
+
+
+  /**
+   * ******************* ComputeContinuousIndexInMask *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::ComputeContinuousIndexInMask( double u,
+      const InputImageContinuousIndexVectorType & offset,
+      InputImageContinuousIndexType & contIndex ) const
+  {
+    /** Select the voxel and find the run it belongs to. */
+    const unsigned long numberOfInsideVoxels = this->m_MaskRunCumulativeLengths.back();
+    const unsigned long voxel = vnl_math_min( numberOfInsideVoxels - 1,
+      static_cast<unsigned long>( u * static_cast<double>( numberOfInsideVoxels ) ) );
+    const std::vector< unsigned long >::const_iterator runIt = std::upper_bound(
+      this->m_MaskRunCumulativeLengths.begin(),
+      this->m_MaskRunCumulativeLengths.end(), voxel );
+    const unsigned long run = runIt - this->m_MaskRunCumulativeLengths.begin();
+    const unsigned long runBegin
+      = ( run == 0 ) ? 0 : this->m_MaskRunCumulativeLengths[ run - 1 ];
+    unsigned long voxelOffset
+      = this->m_MaskRunStartOffsets[ run ] + ( voxel - runBegin );
+
+    /** Convert the offset in the region to a continuous index. */
+    const InputImageRegionType & region = this->m_MaskRunLengthIndexRegion;
+    for ( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      const unsigned long size = region.GetSize()[ i ];
+      const double smallest = static_cast<double>( region.GetIndex()[ i ] );
+      const double largest = smallest + static_cast<double>( size - 1 );
+      const double position = smallest
+        + static_cast<double>( voxelOffset % size ) + offset[ i ];
+      contIndex[ i ] = static_cast<InputImagePointValueType>(
+        vnl_math_min( largest, vnl_math_max( smallest, position ) ) );
+      voxelOffset /= size;
+    }
+
+  } // end ComputeContinuousIndexInMask()
+
+
+  /**
+   * ******************* GenerateRandomCoordinateInMask *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::GenerateRandomCoordinateInMask(
+      InputImageContinuousIndexType & randomContIndex )
+  {
+    const double u = this->m_RandomGenerator->GetVariateWithOpenUpperRange();
+    InputImageContinuousIndexVectorType offset;
+    for ( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      offset[ i ] = this->m_RandomGenerator->GetVariateWithOpenUpperRange() - 0.5;
+    }
+    this->ComputeContinuousIndexInMask( u, offset, randomContIndex );
+
+  } // end GenerateRandomCoordinateInMask()
+
+
+  /**
+   * ******************* GenerateRandomCoordinateInMask *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::GenerateRandomCoordinateInMask(
+      InputImageContinuousIndexType & randomContIndex,
+      ThreadRandomGeneratorType & randomGenerator ) const
+  {
+    const double u = randomGenerator.drand64();
+    InputImageContinuousIndexVectorType offset;
+    for ( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      offset[ i ] = randomGenerator.drand64() - 0.5;
+    }
+    this->ComputeContinuousIndexInMask( u, offset, randomContIndex );
+
+  } // end GenerateRandomCoordinateInMask()
+
+
   /**
    * ******************* GenerateRandomCoordinate *******************
    */
@@ -185,6 +389,27 @@ namespace itk
   } // end GenerateRandomCoordinate()
 
 
+  /**
+   * ******************* GenerateRandomCoordinate *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >::
+    GenerateRandomCoordinate(
+      const InputImageContinuousIndexType & smallestContIndex,
+      const InputImageContinuousIndexType & largestContIndex,
+      InputImageContinuousIndexType &       randomContIndex,
+      ThreadRandomGeneratorType &           randomGenerator ) const
+  {
+    for ( unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      randomContIndex[ i ] = static_cast<InputImagePointValueType>(
+        randomGenerator.drand64( smallestContIndex[ i ], largestContIndex[ i ] ) );
+    }
+  } // end GenerateRandomCoordinate()
+
+
   /**
    * ******************* GenerateSampleRegion *******************
    */
@@ -204,12 +429,33 @@ namespace itk
       largestContIndex = largestImageContIndex;
       return;
     }
+    InputImageContinuousIndexVectorType sampleRegionSize;
+    InputImageContinuousIndexType maxSmallestContIndex;
+    this->ComputeSampleRegionBounds( smallestImageContIndex, largestImageContIndex,
+      sampleRegionSize, maxSmallestContIndex );
+    this->GenerateRandomCoordinate( smallestImageContIndex, maxSmallestContIndex, smallestContIndex );
+    largestContIndex = smallestContIndex;
+    largestContIndex += sampleRegionSize;
+
+  } // end GenerateSampleRegion()
+
+
+  /**
+   * ******************* ComputeSampleRegionBounds *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >::
+    ComputeSampleRegionBounds(
+      const InputImageContinuousIndexType & smallestImageContIndex,
+      const InputImageContinuousIndexType & largestImageContIndex,
+      InputImageContinuousIndexVectorType & sampleRegionSize,
+      InputImageContinuousIndexType & maxSmallestContIndex ) const
+  {
     /** Convert sampleRegionSize to continuous index space and
      * compute the maximum allowed value for the smallestContIndex,
      * such that a sampleregion of size SampleRegionSize still fits. */
-    typedef typename InputImageContinuousIndexType::VectorType   CIndexVectorType;
-    CIndexVectorType sampleRegionSize;
-    InputImageContinuousIndexType maxSmallestContIndex;
     for (unsigned int i = 0; i < InputImageDimension; ++i)
     {
       sampleRegionSize[i] = this->GetSampleRegionSize()[i] /
@@ -218,11 +464,103 @@ namespace itk
       /** make sure it is larger than the lower bound */
       maxSmallestContIndex[i] = vnl_math_max( maxSmallestContIndex[i], smallestImageContIndex[i] );
     }
-    this->GenerateRandomCoordinate( smallestImageContIndex, maxSmallestContIndex, smallestContIndex );
-    largestContIndex = smallestContIndex;
-    largestContIndex += sampleRegionSize;
 
-  } // end GenerateSampleRegion()
+  } // end ComputeSampleRegionBounds()
+
+
+  /**
+   * ******************* BeforeThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::BeforeThreadedGenerateData( void )
+  {
+    /** Initialize the per-thread random streams. */
+    this->Superclass::BeforeThreadedGenerateData();
+
+    /** Select the sample region. A random sample region is drawn from the
+     * stream of the first thread, to keep the result reproducible.
+     */
+    if ( !this->GetUseRandomSampleRegion() )
+    {
+      this->m_ThreaderSmallestContIndex = this->m_ThreaderSmallestImageContIndex;
+      this->m_ThreaderLargestContIndex = this->m_ThreaderLargestImageContIndex;
+      return;
+    }
+    InputImageContinuousIndexVectorType sampleRegionSize;
+    InputImageContinuousIndexType maxSmallestContIndex;
+    this->ComputeSampleRegionBounds(
+      this->m_ThreaderSmallestImageContIndex, this->m_ThreaderLargestImageContIndex,
+      sampleRegionSize, maxSmallestContIndex );
+    this->GenerateRandomCoordinate( this->m_ThreaderSmallestImageContIndex,
+      maxSmallestContIndex, this->m_ThreaderSmallestContIndex,
+      this->m_ThreadRandomGenerators[ 0 ] );
+    this->m_ThreaderLargestContIndex = this->m_ThreaderSmallestContIndex;
+    this->m_ThreaderLargestContIndex += sampleRegionSize;
+
+  } // end BeforeThreadedGenerateData()
+
+
+  /**
+   * ******************* ThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomCoordinateSampler< TInputImage >
+    ::ThreadedGenerateData( unsigned int threadID )
+  {
+    /** Get handles to the input image, output sample container and interpolator. */
+    const InputImageType * inputImage = this->GetInput();
+    ImageSampleContainerType * sampleContainer = this->GetOutput();
+    const InterpolatorType * interpolator = this->m_Interpolator.GetPointer();
+    ThreadRandomGeneratorType & randomGenerator
+      = this->m_ThreadRandomGenerators[ threadID ];
+
+    /** Get the range of samples of this thread. */
+    unsigned long pos_begin, pos_end;
+    this->GetThreadSampleRange( threadID, pos_begin, pos_end );
+    typename ImageSampleContainerType::Iterator iter = sampleContainer->Begin();
+    typename ImageSampleContainerType::Iterator end = sampleContainer->Begin();
+    iter += pos_begin;
+    end += pos_end;
+
+    /** Fill this part of the sample container. */
+    InputImageContinuousIndexType sampleContIndex;
+    for ( ; iter != end; ++iter )
+    {
+      /** Make a reference to the current sample in the container. */
+      InputImagePointType & samplePoint = (*iter).Value().m_ImageCoordinates;
+      ImageSampleValueType & sampleValue = (*iter).Value().m_ImageValue;
+
+      /** Draw a point inside the mask, or walk over the image until we
+       * find a valid point. */
+      if ( this->m_UseMaskRunLengthIndex )
+      {
+        this->GenerateRandomCoordinateInMask( sampleContIndex, randomGenerator );
+      }
+      else
+      {
+        do
+        {
+          /** Generate a point in the input image region. */
+          this->GenerateRandomCoordinate( this->m_ThreaderSmallestContIndex,
+            this->m_ThreaderLargestContIndex, sampleContIndex, randomGenerator );
+        } while ( !interpolator->IsInsideBuffer( sampleContIndex ) );
+      }
+
+      /** Convert to point */
+      inputImage->TransformContinuousIndexToPhysicalPoint( sampleContIndex, samplePoint );
+
+      /** Compute the value at the contindex. */
+      sampleValue = static_cast<ImageSampleValueType>(
+        interpolator->EvaluateAtContinuousIndex( sampleContIndex ) );
+
+    } // end for loop
+
+  } // end ThreadedGenerateData()
 
 
   /**
@@ -238,6 +576,8 @@ namespace itk
 
     os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
     os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+    os << indent << "UseRandomSampleRegion: " << this->m_UseRandomSampleRegion << std::endl;
+    os << indent << "UseDirectMaskSampling: " << this->m_UseDirectMaskSampling << std::endl;
 
   } // end PrintSelf()
 
@@ -30,6 +30,10 @@ namespace itk
    * If a mask is given, the sampler tries to find samples within the
    * mask. If the mask is very sparse, this may take some time. In this case,
    * consider using the ImageRandomSamplerSparseMask.
+   *
+   * When UseMultiThread is set and no mask is used, the samples are
+   * generated by multiple threads, each drawing from its own random number
+   * stream (see ImageRandomSamplerBase).
    *
 	 * \ingroup ImageSamplers
 	 * */
@@ -73,8 +77,16 @@ namespace itk
     typedef typename InputImageType::IndexType    InputImageIndexType;
     typedef typename InputImageType::PointType    InputImagePointType;
 
+    /** This sampler generates its samples with multiple threads, if enabled. */
+    virtual bool ThreadedGenerateDataSupported( void ) const
+    {
+      return true;
+    }
+
   protected:
 
+    typedef typename Superclass::ThreadRandomGeneratorType  ThreadRandomGeneratorType;
+
     /** The constructor. */
     ImageRandomSampler(){};
     /** The destructor. */
@@ -83,6 +95,9 @@ namespace itk
     /** Function that does the work. */
     virtual void GenerateData( void );
 
+    /** Generate the samples of one thread. */
+    virtual void ThreadedGenerateData( unsigned int threadID );
+
   private:
 
     /** The private constructor. */
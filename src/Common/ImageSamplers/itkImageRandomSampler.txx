@@ -18,6 +18,7 @@
 #include "itkImageRandomSampler.h"
 
 #include "itkImageRandomConstIteratorWithIndex.h"
+#include "vnl/vnl_math.h"
 
 namespace itk
 {
@@ -36,6 +37,15 @@ namespace itk
     typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
     typename MaskType::ConstPointer mask = this->GetMask();
 
+    /** Generate the samples using multiple threads, if requested. Masks are
+     * not thread-safe, so with a mask the single-threaded code is used.
+     */
+    if ( this->m_UseMultiThread && mask.IsNull() )
+    {
+      this->LaunchThreadedGenerateData( this->GetNumberOfSamples() );
+      return;
+    }
+
     /** Reserve memory for the output. */
     sampleContainer->Reserve( this->GetNumberOfSamples() );
 
@@ -120,6 +130,59 @@ namespace itk
   } // end GenerateData()
 
 
+  /**
+   * ******************* ThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSampler< TInputImage >
+    ::ThreadedGenerateData( unsigned int threadID )
+  {
+    /** Get handles to the input image and output sample container. */
+    const InputImageType * inputImage = this->GetInput();
+    ImageSampleContainerType * sampleContainer = this->GetOutput();
+    ThreadRandomGeneratorType & randomGenerator
+      = this->m_ThreadRandomGenerators[ threadID ];
+
+    /** Get the region from which the voxels are drawn. */
+    const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+    const double numberOfVoxels
+      = static_cast<double>( region.GetNumberOfPixels() );
+    const unsigned long lastVoxel = region.GetNumberOfPixels() - 1;
+
+    /** Get the range of samples of this thread. */
+    unsigned long pos_begin, pos_end;
+    this->GetThreadSampleRange( threadID, pos_begin, pos_end );
+    typename ImageSampleContainerType::Iterator iter = sampleContainer->Begin();
+    typename ImageSampleContainerType::Iterator end = sampleContainer->Begin();
+    iter += pos_begin;
+    end += pos_end;
+
+    /** Fill this part of the sample container. */
+    InputImageIndexType index;
+    for ( ; iter != end; ++iter )
+    {
+      /** Draw a random voxel and convert its offset in the region to an index. */
+      unsigned long offset = vnl_math_min( lastVoxel, static_cast<unsigned long>(
+        randomGenerator.drand64( 0.0, numberOfVoxels ) ) );
+      for ( unsigned int i = 0; i < InputImageDimension; ++i )
+      {
+        const unsigned long size = region.GetSize()[ i ];
+        index[ i ] = region.GetIndex()[ i ] + static_cast<long>( offset % size );
+        offset /= size;
+      }
+
+      /** Get the physical coordinates and the value and put them in the sample. */
+      inputImage->TransformIndexToPhysicalPoint( index,
+        (*iter).Value().m_ImageCoordinates );
+      (*iter).Value().m_ImageValue = inputImage->GetPixel( index );
+
+    } // end for loop
+
+  } // end ThreadedGenerateData()
+
+
 } // end namespace itk
 
 #endif // end #ifndef __ImageRandomSampler_txx
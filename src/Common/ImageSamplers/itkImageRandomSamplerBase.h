@@ -16,6 +16,8 @@
 #define __ImageRandomSamplerBase_h
 
 #include "itkImageSamplerBase.h"
+#include "vnl/vnl_random.h"
+#include <vector>
 
 namespace itk
 {
@@ -25,6 +27,12 @@ namespace itk
    * \brief This class is a base class for any image sampler that randomly picks samples.
    *
    * It adds the Set/GetNumberOfSamples function.
+   *
+   * For the multi-threaded GenerateData() every thread draws from its own
+   * random number stream. The streams are derived from a single seed, see
+   * SetSeed(), so that the selected samples can be reproduced for a given
+   * seed and number of threads. The single-threaded GenerateData() keeps
+   * using the global Mersenne Twister generator.
 	 *
 	 * \ingroup ImageSamplers
    */
@@ -70,26 +78,41 @@ namespace itk
     /** Get the number of samples. */
     itkGetConstMacro( NumberOfSamples, unsigned long );
 
+    /** Set the seed of the per-thread random number streams. Setting the seed
+     * restarts the streams, so the next sample sets are identical to those
+     * generated after a previous call with the same seed.
+     */
+    virtual void SetSeed( unsigned long seed );
+
+    /** Get the seed of the per-thread random number streams. */
+    itkGetConstMacro( Seed, unsigned long );
+
   protected:
 
+    /** Typedefs for the per-thread random number generators. */
+    typedef vnl_random                                  ThreadRandomGeneratorType;
+    typedef std::vector< ThreadRandomGeneratorType >    ThreadRandomGeneratorVectorType;
+
     /** The constructor. */
-    ImageRandomSamplerBase()
-    {
-      this->m_NumberOfSamples = 100;
-    };
+    ImageRandomSamplerBase();
 
     /** The destructor. */
     virtual ~ImageRandomSamplerBase() {};
 
     /** PrintSelf. */
-    void PrintSelf( std::ostream& os, Indent indent ) const
-    {
-      Superclass::PrintSelf( os, indent );
-      os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
-    };
+    void PrintSelf( std::ostream& os, Indent indent ) const;
+
+    /** (Re)initialize the per-thread random number streams when the seed or
+     * the number of threads has changed. Otherwise the streams simply continue,
+     * so that every update produces a new sample set.
+     */
+    virtual void BeforeThreadedGenerateData( void );
 
     unsigned long m_NumberOfSamples;
 
+    /** The per-thread random number generators. */
+    ThreadRandomGeneratorVectorType   m_ThreadRandomGenerators;
+
   private:
 
     /** The private constructor. */
@@ -97,10 +120,17 @@ namespace itk
     /** The private copy constructor. */
     void operator=( const Self& );            // purposely not implemented
 
+    unsigned long   m_Seed;
+    bool            m_ReseedThreadRandomGenerators;
+
   }; // end class ImageRandomSamplerBase
 
 
 } // end namespace itk
 
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageRandomSamplerBase.txx"
+#endif
+
 #endif // end #ifndef __ImageRandomSamplerBase_h
 
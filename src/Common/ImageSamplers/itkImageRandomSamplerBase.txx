@@ -0,0 +1,105 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __ImageRandomSamplerBase_txx
+#define __ImageRandomSamplerBase_txx
+
+#include "itkImageRandomSamplerBase.h"
+
+namespace itk
+{
+
+  /**
+   * ******************* Constructor *******************
+   */
+
+  template< class TInputImage >
+    ImageRandomSamplerBase< TInputImage >
+    ::ImageRandomSamplerBase()
+  {
+    this->m_NumberOfSamples = 100;
+    this->m_Seed = 121212;
+    this->m_ReseedThreadRandomGenerators = true;
+
+  } // end Constructor()
+
+
+  /**
+   * ******************* SetSeed *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::SetSeed( unsigned long seed )
+  {
+    /** Always restart the streams, even if the seed did not change. */
+    this->m_Seed = seed;
+    this->m_ReseedThreadRandomGenerators = true;
+    this->Modified();
+
+  } // end SetSeed()
+
+
+  /**
+   * ******************* BeforeThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::BeforeThreadedGenerateData( void )
+  {
+    const unsigned int numberOfThreads = this->m_ThreaderNumberOfThreads;
+    if ( !this->m_ReseedThreadRandomGenerators
+      && this->m_ThreadRandomGenerators.size() == numberOfThreads )
+    {
+      return;
+    }
+
+    /** Derive the seed of each stream from a master stream, such that the
+     * streams of neighbouring threads are not correlated.
+     */
+    ThreadRandomGeneratorType masterGenerator( this->m_Seed );
+    this->m_ThreadRandomGenerators.resize( numberOfThreads );
+    for ( unsigned int i = 0; i < numberOfThreads; ++i )
+    {
+      this->m_ThreadRandomGenerators[ i ].reseed( masterGenerator.lrand32() );
+    }
+    this->m_ReseedThreadRandomGenerators = false;
+
+  } // end BeforeThreadedGenerateData()
+
+
+  /**
+   * ******************* PrintSelf *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageRandomSamplerBase< TInputImage >
+    ::PrintSelf( std::ostream& os, Indent indent ) const
+  {
+    Superclass::PrintSelf( os, indent );
+
+    os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+    os << indent << "Seed: " << this->m_Seed << std::endl;
+
+  } // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __ImageRandomSamplerBase_txx
+
@@ -19,6 +19,7 @@
 #include "itkImageSample.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
+#include "itkMultiThreader.h"
 
 
 namespace itk
@@ -156,11 +157,37 @@ namespace itk
       return true;
     }
 
+    /** Returns whether the sampler implements ThreadedGenerateData(), i.e.
+     * whether it can generate its samples with multiple threads.
+     */
+    virtual bool ThreadedGenerateDataSupported( void ) const
+    {
+      return false;
+    }
+
     /** Get a handle to the cropped InputImageregion. */
     itkGetConstReferenceMacro( CroppedInputImageRegion, InputImageRegionType );
 
+    /** ******************** Multi-threading ******************** */
+
+    /** Set/Get whether GenerateData() may distribute the work over multiple
+     * threads. The number of threads is given by SetNumberOfThreads(), which
+     * by default follows the global itk::MultiThreader setting. Samplers that
+     * do not implement ThreadedGenerateData() ignore this flag.
+     * Default: false.
+     */
+    itkSetMacro( UseMultiThread, bool );
+    itkGetConstMacro( UseMultiThread, bool );
+    itkBooleanMacro( UseMultiThread );
+
+    /** Update the output. Overridden to time the sampler update. */
+    virtual void UpdateOutputData( DataObject * output );
+
   protected:
 
+    /** Typedefs for multi-threading. */
+    typedef MultiThreader::ThreadInfoStruct             ThreadInfoType;
+
     /** The constructor. */
     ImageSamplerBase();
 
@@ -187,6 +214,39 @@ namespace itk
     /** Compute the intersection of the InputImageRegion and the bounding box of the mask. */
     void CropInputImageRegion( void );
 
+    /** Distribute the generation of numberOfSamples samples over the threads.
+     * The output sample container is resized to numberOfSamples, after which
+     * every thread calls ThreadedGenerateData(). Each thread fills the part
+     * of the container given by GetThreadSampleRange().
+     */
+    virtual void LaunchThreadedGenerateData( unsigned long numberOfSamples );
+
+    /** Called by LaunchThreadedGenerateData() once the number of threads is
+     * known, just before the threads are started. Does nothing by default.
+     */
+    virtual void BeforeThreadedGenerateData( void ) {};
+
+    /** Fill the samples [begin, end) of the output, see GetThreadSampleRange().
+     * Subclasses that support multi-threading override this method, and
+     * ThreadedGenerateDataSupported(). It may only modify its part of the
+     * output container and per-thread state.
+     */
+    virtual void ThreadedGenerateData( unsigned int threadID );
+
+    /** Compute the range [begin, end) of samples that is generated by a thread. */
+    virtual void GetThreadSampleRange( unsigned int threadID,
+      unsigned long & begin, unsigned long & end ) const;
+
+    /** Callback passed to the threader. */
+    static ITK_THREAD_RETURN_TYPE GenerateDataThreaderCallback( void * arg );
+
+    /** The number of samples and threads used by LaunchThreadedGenerateData(). */
+    unsigned long                     m_ThreaderNumberOfSamples;
+    unsigned int                      m_ThreaderNumberOfThreads;
+
+    /** Whether GenerateData() may use multiple threads. */
+    bool                              m_UseMultiThread;
+
   private:
 
     /** The private constructor. */
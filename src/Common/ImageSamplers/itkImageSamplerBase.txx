@@ -16,6 +16,8 @@
 #define __ImageSamplerBase_txx
 
 #include "itkImageSamplerBase.h"
+#include "elxProfiler.h"
+#include "vnl/vnl_math.h"
 
 namespace itk
 {
@@ -32,6 +34,10 @@ namespace itk
     this->m_NumberOfMasks = 0;
     this->m_NumberOfInputImageRegions = 0;
 
+    this->m_UseMultiThread = false;
+    this->m_ThreaderNumberOfSamples = 0;
+    this->m_ThreaderNumberOfThreads = 1;
+
   } // end Constructor()
 
 
@@ -400,6 +406,114 @@ namespace itk
   } // end CropInputImageRegion()
 
 
+  /**
+   * ******************* UpdateOutputData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageSamplerBase< TInputImage >
+    ::UpdateOutputData( DataObject * output )
+  {
+    tmr::ProfilerScope profilerScope( tmr::Profiler::SamplerUpdate );
+
+    /** Generate the samples. */
+    this->Superclass::UpdateOutputData( output );
+
+  } // end UpdateOutputData()
+
+
+  /**
+   * ******************* LaunchThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageSamplerBase< TInputImage >
+    ::LaunchThreadedGenerateData( unsigned long numberOfSamples )
+  {
+    /** Check for support here, since throwing within a thread is not an option. */
+    if ( !this->ThreadedGenerateDataSupported() )
+    {
+      itkExceptionMacro( << "ERROR: this sampler does not support "
+        << "multi-threaded sample generation." );
+    }
+
+    /** Allocate the output, so that the threads can write to it directly. */
+    typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
+    sampleContainer->resize( numberOfSamples );
+    this->m_ThreaderNumberOfSamples = numberOfSamples;
+
+    /** The threader may clamp the requested number of threads. */
+    this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+    this->m_ThreaderNumberOfThreads = this->GetMultiThreader()->GetNumberOfThreads();
+
+    /** Run ThreadedGenerateData() in all threads. */
+    this->BeforeThreadedGenerateData();
+    this->GetMultiThreader()->SetSingleMethod(
+      this->GenerateDataThreaderCallback, this );
+    this->GetMultiThreader()->SingleMethodExecute();
+
+  } // end LaunchThreadedGenerateData()
+
+
+  /**
+   * ******************* GenerateDataThreaderCallback *******************
+   */
+
+  template< class TInputImage >
+    ITK_THREAD_RETURN_TYPE
+    ImageSamplerBase< TInputImage >
+    ::GenerateDataThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+    const unsigned int threadID = infoStruct->ThreadID;
+    Self * sampler = static_cast<Self *>( infoStruct->UserData );
+
+    sampler->ThreadedGenerateData( threadID );
+
+    return ITK_THREAD_RETURN_VALUE;
+
+  } // end GenerateDataThreaderCallback()
+
+
+  /**
+   * ******************* ThreadedGenerateData *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageSamplerBase< TInputImage >
+    ::ThreadedGenerateData( unsigned int itkNotUsed( threadID ) )
+  {
+    /** Overridden by samplers that support threading. Not called otherwise,
+     * see LaunchThreadedGenerateData().
+     */
+
+  } // end ThreadedGenerateData()
+
+
+  /**
+   * ******************* GetThreadSampleRange *******************
+   */
+
+  template< class TInputImage >
+    void
+    ImageSamplerBase< TInputImage >
+    ::GetThreadSampleRange( unsigned int threadID,
+      unsigned long & begin, unsigned long & end ) const
+  {
+    const unsigned long numberOfSamples = this->m_ThreaderNumberOfSamples;
+    const unsigned long numberOfThreads = this->m_ThreaderNumberOfThreads;
+    const unsigned long chunk
+      = ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads;
+
+    begin = vnl_math_min( numberOfSamples, threadID * chunk );
+    end = vnl_math_min( numberOfSamples, begin + chunk );
+
+  } // end GetThreadSampleRange()
+
+
   /**
    * ******************* PrintSelf *******************
    */
@@ -427,6 +541,7 @@ namespace itk
       os << indent.GetNextIndent() << this->m_InputImageRegionVector[ i ] << std::endl;
     }
     os << indent << "CroppedInputImageRegion" << this->m_CroppedInputImageRegion << std::endl;
+    os << indent << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
 
   } // end PrintSelf()
 
@@ -90,6 +90,7 @@ private:
   typedef typename VectorType::size_type          size_type;
   typedef typename VectorType::iterator           VectorIterator;
   typedef typename VectorType::const_iterator     VectorConstIterator;
+  typedef typename VectorType::difference_type    difference_type;
 
 protected:
   /** Provide pass-through constructors corresponding to all the STL
@@ -148,6 +149,8 @@ public:
     Iterator operator++ (int) { Iterator temp(*this); ++m_Pos; ++m_Iter; return temp; }
     Iterator& operator-- ()   { --m_Pos; --m_Iter; return *this; }
     Iterator operator-- (int) { Iterator temp(*this); --m_Pos; --m_Iter; return temp; }
+    Iterator& operator+= (difference_type n) { m_Pos += n; m_Iter += n; return *this; }
+    Iterator& operator-= (difference_type n) { m_Pos -= n; m_Iter -= n; return *this; }
 
     bool operator == (const Iterator& r) const { return m_Iter == r.m_Iter; }
     bool operator != (const Iterator& r) const { return m_Iter != r.m_Iter; }
@@ -181,6 +184,8 @@ public:
     ConstIterator operator++ (int) { ConstIterator temp(*this); ++m_Pos; ++m_Iter; return temp; }
     ConstIterator& operator-- ()   { --m_Pos; --m_Iter; return *this; }
     ConstIterator operator-- (int) { ConstIterator temp(*this); --m_Pos; --m_Iter; return temp; }
+    ConstIterator& operator+= (difference_type n) { m_Pos += n; m_Iter += n; return *this; }
+    ConstIterator& operator-= (difference_type n) { m_Pos -= n; m_Iter -= n; return *this; }
 
     ConstIterator& operator = (const Iterator& r) { m_Pos = r.m_Pos; m_Iter = r.m_Iter; return *this; }
 
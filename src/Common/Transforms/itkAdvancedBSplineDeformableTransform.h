@@ -118,6 +118,16 @@ namespace itk
  * The class is templated coordinate representation type (float or double),
  * the space dimension and the spline order.
  *
+ * Thread safety: once the grid and the parameters have been set, the methods
+ * TransformPoint( point ), TransformPoint( point, output, weights, indices, inside ),
+ * GetJacobian( point, weights, indices ), GetJacobian( point, jacobian, nzji ),
+ * GetSpatialJacobian(), GetSpatialHessian(), GetJacobianOfSpatialJacobian()
+ * and GetJacobianOfSpatialHessian() are const and reentrant: they do not
+ * modify the transform, and all scratch memory is either allocated on the
+ * stack or owned by the caller. They can therefore be called concurrently
+ * from multiple threads. The ITK-style GetJacobian( point ) returns a
+ * reference to the internal Jacobian and is NOT thread-safe.
+ *
  * \ingroup Transforms
  */
 template <
@@ -171,6 +181,9 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType                  JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType   InternalMatrixType;
+  typedef typename Superclass::GridRegionType       GridRegionType;
+  typedef typename Superclass
+    ::GridIndexToPointMatrixType                    GridIndexToPointMatrixType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename Superclass::PixelType        PixelType;
@@ -190,7 +203,10 @@ public:
   /** This method specifies the region over which the grid resides. */
   virtual void SetGridRegion( const RegionType& region );
 
-  /** Transform points by a B-spline deformable transformation. */
+  /** Transform points by a B-spline deformable transformation.
+   * This method does not need the interpolation weights themselves, and
+   * computes the displacement with ComputeDisplacement().
+   */
   OutputPointType TransformPoint( const InputPointType & point ) const;
 
   /** Interpolation weights function type. */
@@ -199,6 +215,7 @@ public:
     itkGetStaticConstMacro( SplineOrder ) >                 WeightsFunctionType;
   typedef typename WeightsFunctionType::WeightsType         WeightsType;
   typedef typename WeightsFunctionType::ContinuousIndexType ContinuousIndexType;
+  typedef typename WeightsFunctionType::OneDWeightsType     OneDWeightsType;
   typedef BSplineInterpolationDerivativeWeightFunction<
     ScalarType,
     itkGetStaticConstMacro( SpaceDimension ),
@@ -217,6 +234,8 @@ public:
    * in the support region used to compute the deformation.
    * Parameter indices for the i-th dimension can be obtained by adding
    * ( i * this->GetNumberOfParametersPerDimension() ) to the indices array.
+   * The weights and indices arrays are owned by the caller and should have
+   * size GetNumberOfWeights(). This method is reentrant.
    */
   virtual void TransformPoint(
     const InputPointType & inputPoint,
@@ -235,16 +254,28 @@ public:
 
   virtual unsigned long GetNumberOfNonZeroJacobianIndices( void ) const;
 
-  /** Compute the Jacobian matrix of the transformation at one point. */
+  /** Compute the Jacobian matrix of the transformation at one point.
+   * The full (dense) Jacobian is stored in a member variable, of which a
+   * reference is returned. This method is therefore NOT thread-safe; use
+   * the sparse GetJacobian( ipp, j, nzji ) instead.
+   */
   virtual const JacobianType & GetJacobian( const InputPointType & point ) const;
 
-  /** Compute the Jacobian of the transformation. */
+  /** Compute the Jacobian of the transformation, in the form of the
+   * interpolation weights and the parameter indices of the x (zeroth)
+   * dimension. The weights and indices arrays are owned by the caller and
+   * should have size GetNumberOfWeights(). This method is reentrant.
+   */
   virtual void GetJacobian(
     const InputPointType & ipp,
     WeightsType & weights,
     ParameterIndexArrayType & indices ) const;
 
-  /** Compute the Jacobian of the transformation. */
+  /** Compute the sparse Jacobian of the transformation. The jacobian and the
+   * nonzero Jacobian indices are owned by the caller; they are only resized
+   * when they do not have the correct size yet, so that callers can reuse
+   * them for many points. This method is reentrant.
+   */
   virtual void GetJacobian(
     const InputPointType & ipp,
     JacobianType & j,
@@ -255,6 +286,47 @@ public:
     const InputPointType & ipp,
     SpatialJacobianType & sj ) const;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and
+   * GetSpatialJacobian(). The weights buffer and the offsets of the
+   * support region within the coefficient images are set up once per
+   * block, after which the coefficients are read directly from the
+   * coefficient buffers instead of through image iterators.
+   * TransformPoints() uses the same kernel as TransformPoint(), see
+   * ComputeDisplacement().
+   */
+  virtual void TransformPoints(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    OutputPointType * opp ) const;
+
+  virtual void GetJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    JacobianType * j,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    SpatialJacobianType * sj ) const;
+
+  /** Evaluate the transformation and/or the spatial Jacobian on a regular
+   * grid. This is possible when the grid axes are parallel to those of the
+   * B-spline grid, so that the continuous grid index in each dimension only
+   * depends on the grid index in that same dimension. The 1D (derivative)
+   * weights are then tabulated once per dimension, and the coefficients are
+   * contracted one dimension at a time: the contraction over the last
+   * dimension is shared by all points of a slice, the one over the next
+   * dimension by all points of a row, and only the contraction over the
+   * first dimension is done per point. Returns false for other grids.
+   */
+  virtual bool EvaluateOnGrid(
+    const InputPointType & origin,
+    const GridIndexToPointMatrixType & indexToPoint,
+    const GridRegionType & region,
+    OutputPointType * opp,
+    SpatialJacobianType * sj ) const;
+
   /** Compute the spatial Hessian of the transformation. */
   virtual void GetSpatialHessian(
     const InputPointType & ipp,
@@ -309,6 +381,109 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const;
 
+  /** Compute the buffer offsets of all coefficients in a support region,
+   * relative to the first coefficient of that region, in the order of the
+   * interpolation weights. They are the same for all support regions.
+   * The offsets array should have size GetNumberOfWeights().
+   */
+  void ComputeSupportRegionOffsets( unsigned long * offsets ) const;
+
+  /** Compute the displacement at a continuous grid index that lies inside
+   * the valid region. Instead of multiplying all coefficients of the
+   * support region with the full tensor product weights, the coefficients
+   * are contracted with the 1D weights one dimension at a time, reading
+   * directly from the coefficient buffers. In 3D with cubic splines this
+   * takes 3 x 84 multiplications per point, instead of 128 for the full
+   * weights plus 3 x 64 for the contraction. The loops have compile-time
+   * bounds, with dedicated versions for 2D and 3D.
+   */
+  void ComputeDisplacementSeparable(
+    const ContinuousIndexType & cindex,
+    ScalarType * displacement ) const;
+
+  /** Compute the displacement at a continuous grid index that lies inside
+   * the valid region, like the TransformPoint() that returns the weights,
+   * by summing the products of the full weights and the coefficients in
+   * ScalarType precision.
+   */
+  void ComputeDisplacementFullWeights(
+    const ContinuousIndexType & cindex,
+    ScalarType * displacement ) const;
+
+  /** Compute the displacement at a continuous grid index that lies inside
+   * the valid region. The separable kernel sums in double precision and in
+   * another order than the full weights. For a double ScalarType this only
+   * changes the result at round-off level, but for a single precision
+   * ScalarType it changes the last bits of the output points. In that case
+   * the full weights are used, so that the results stay identical to those
+   * of the ITK B-spline transform.
+   */
+  void ComputeDisplacement(
+    const ContinuousIndexType & cindex,
+    ScalarType * displacement ) const
+  {
+    if ( sizeof( ScalarType ) < sizeof( double ) )
+    {
+      this->ComputeDisplacementFullWeights( cindex, displacement );
+    }
+    else
+    {
+      this->ComputeDisplacementSeparable( cindex, displacement );
+    }
+  }
+
+  /** The tables and intermediate results of EvaluateOnGrid(). Level d of
+   * st_Buffer holds, for each variant and output dimension, the
+   * coefficients contracted over the dimensions d and higher, for all grid
+   * positions in the dimensions lower than d. Variant 0 is contracted with
+   * the weights only; variant v > 0 with the derivative weights in
+   * dimension SpaceDimension - v.
+   */
+  struct GridEvaluationType
+  {
+    InputPointType              st_Origin;
+    GridIndexToPointMatrixType  st_IndexToPoint;
+    IndexType                   st_Index;
+    OutputPointType *           st_OutputPoints;
+    SpatialJacobianType *       st_SpatialJacobians;
+    unsigned int                st_NumberOfVariants[ NDimensions + 1 ];
+    unsigned long               st_BlockSize[ NDimensions + 1 ];
+    unsigned long               st_OutputStride[ NDimensions ];
+    std::vector<unsigned char>  st_Inside[ NDimensions ];
+    std::vector<long>           st_Start[ NDimensions ];
+    std::vector<double>         st_Weights[ NDimensions ];
+    std::vector<double>         st_DerivativeWeights[ NDimensions ];
+    std::vector<double>         st_Buffer[ NDimensions ];
+  };
+
+  /** Visit all grid indices of dimension d and lower, for the current
+   * indices of the higher dimensions, contracting the coefficients over
+   * dimension d. Called recursively by EvaluateOnGrid().
+   */
+  void EvaluateOnGridDimension( GridEvaluationType & evaluation,
+    const unsigned int d, const bool inside,
+    const unsigned long outputOffset ) const;
+
+  /** Contract one block of coefficients over a single dimension:
+   * output[ g ] = sum_s weights[ s ] * input[ ( start + s ) * blockSize + g ].
+   */
+  template <class TInput>
+  static void ContractDimension( const TInput * input,
+    const unsigned long blockSize, const long start,
+    const double * weights, double * output )
+  {
+    for ( unsigned long g = 0; g < blockSize; ++g ) output[ g ] = 0.0;
+    for ( unsigned int s = 0; s < SplineOrder + 1; ++s )
+    {
+      const TInput * in = input + ( start + s ) * blockSize;
+      const double w = weights[ s ];
+      for ( unsigned long g = 0; g < blockSize; ++g )
+      {
+        output[ g ] += w * in[ g ];
+      }
+    }
+  }
+
   typedef typename Superclass::JacobianImageType JacobianImageType;
   typedef typename Superclass::JacobianPixelType JacobianPixelType;
 
@@ -338,20 +338,177 @@ typename AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrd
 AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
 ::TransformPoint(const InputPointType &point) const
 {
-  /** Allocate memory on the stack: */
+  /** Check if the coefficient image has been set. */
+  if ( !this->m_CoefficientImage[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    return point;
+  }
+
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex( point, cindex );
+
+  // NOTE: if the support region does not lie totally within the grid
+  // we assume zero displacement and return the input point
+  if ( !this->InsideValidRegion( cindex ) )
+  {
+    return point;
+  }
+
+  /** The output point is the start point + displacement. */
+  ScalarType displacement[ SpaceDimension ];
+  this->ComputeDisplacement( cindex, displacement );
+
+  OutputPointType outputPoint;
+  for ( unsigned int j = 0; j < SpaceDimension; j++ )
+  {
+    outputPoint[ j ] = point[ j ] + displacement[ j ];
+  }
+
+  return outputPoint;
+}
+
+
+/**
+ * ********************* ComputeDisplacementSeparable ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
+::ComputeDisplacementSeparable(
+  const ContinuousIndexType & cindex,
+  ScalarType * displacement ) const
+{
+  /** Compute the 1D weights of each dimension. */
+  IndexType supportIndex;
+  OneDWeightsType weights1D;
+  this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  this->m_WeightsFunction->Evaluate1DWeights( cindex, supportIndex, weights1D );
+
+  /** All coefficient images share the same buffer layout. */
+  const ImageType * coefficientImage = this->m_CoefficientImage[ 0 ];
+  const typename ImageType::OffsetValueType * offsetTable
+    = coefficientImage->GetOffsetTable();
+  const unsigned long startOffset = coefficientImage->ComputeOffset( supportIndex );
+  const unsigned int supportSize = SplineOrder + 1;
+  const unsigned int lastDimension = SpaceDimension - 1;
+
+  for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    const PixelType * coefficients
+      = this->m_CoefficientImage[ dim ]->GetBufferPointer() + startOffset;
+    double sum = 0.0;
+
+    if ( SpaceDimension == 2 )
+    {
+      for ( unsigned int y = 0; y < supportSize; ++y )
+      {
+        const PixelType * line = coefficients + y * offsetTable[ lastDimension ];
+        double sumX = 0.0;
+        for ( unsigned int x = 0; x < supportSize; ++x )
+        {
+          sumX += line[ x ] * weights1D[ 0 ][ x ];
+        }
+        sum += sumX * weights1D[ lastDimension ][ y ];
+      }
+    }
+    else if ( SpaceDimension == 3 )
+    {
+      for ( unsigned int z = 0; z < supportSize; ++z )
+      {
+        const PixelType * slice = coefficients + z * offsetTable[ lastDimension ];
+        double sumY = 0.0;
+        for ( unsigned int y = 0; y < supportSize; ++y )
+        {
+          const PixelType * line = slice + y * offsetTable[ 1 ];
+          double sumX = 0.0;
+          for ( unsigned int x = 0; x < supportSize; ++x )
+          {
+            sumX += line[ x ] * weights1D[ 0 ][ x ];
+          }
+          sumY += sumX * weights1D[ 1 ][ y ];
+        }
+        sum += sumY * weights1D[ lastDimension ][ z ];
+      }
+    }
+    else
+    {
+      /** Any other dimension: loop over all lines along the first dimension,
+       * weighting each line sum with the product of the other 1D weights.
+       */
+      const unsigned long numberOfLines
+        = WeightsFunctionType::NumberOfWeights / supportSize;
+      for ( unsigned long l = 0; l < numberOfLines; ++l )
+      {
+        unsigned long remainder = l;
+        unsigned long lineOffset = 0;
+        double lineWeight = 1.0;
+        for ( unsigned int d = 1; d < SpaceDimension; ++d )
+        {
+          const unsigned int k = remainder % supportSize;
+          remainder /= supportSize;
+          lineOffset += k * offsetTable[ d ];
+          lineWeight *= weights1D[ d ][ k ];
+        }
+
+        const PixelType * line = coefficients + lineOffset;
+        double sumX = 0.0;
+        for ( unsigned int x = 0; x < supportSize; ++x )
+        {
+          sumX += line[ x ] * weights1D[ 0 ][ x ];
+        }
+        sum += sumX * lineWeight;
+      }
+    }
+
+    displacement[ dim ] = static_cast<ScalarType>( sum );
+  } // end for dim
+
+} // end ComputeDisplacementSeparable()
+
+
+/**
+ * ********************* ComputeDisplacementFullWeights ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
+::ComputeDisplacementFullWeights(
+  const ContinuousIndexType & cindex,
+  ScalarType * displacement ) const
+{
+  /** Allocate memory on the stack. */
   const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
   typename WeightsType::ValueType weightsArray[ numberOfWeights ];
-  typename ParameterIndexArrayType::ValueType indicesArray[ numberOfWeights ];
   WeightsType weights( weightsArray, numberOfWeights, false );
-  ParameterIndexArrayType indices( indicesArray, numberOfWeights, false );
+  unsigned long supportOffsets[ numberOfWeights ];
+  this->ComputeSupportRegionOffsets( supportOffsets );
 
-  OutputPointType outputPoint;
-  bool inside;
+  /** Compute the interpolation weights. */
+  IndexType supportIndex;
+  this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+  const unsigned long startOffset
+    = this->m_CoefficientImage[ 0 ]->ComputeOffset( supportIndex );
 
-  this->TransformPoint( point, outputPoint, weights, indices, inside );
+  /** Correlate the coefficients with the weights, in the same order as
+   * the image iterators of the TransformPoint() that returns the weights.
+   */
+  for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    const PixelType * coefficients
+      = this->m_CoefficientImage[ dim ]->GetBufferPointer() + startOffset;
+    displacement[ dim ] = NumericTraits<ScalarType>::Zero;
+    for ( unsigned long k = 0; k < numberOfWeights; ++k )
+    {
+      displacement[ dim ] += static_cast<ScalarType>(
+        weightsArray[ k ] * coefficients[ supportOffsets[ k ] ] );
+    }
+  }
 
-  return outputPoint;
-}
+} // end ComputeDisplacementFullWeights()
 
 
 // Compute the Jacobian in one position
@@ -369,6 +526,9 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
     itkExceptionMacro( <<"Cannot compute Jacobian: parameters not set" );
     }
 
+  // NOTE: this method writes into m_JacobianImage, which wraps m_Jacobian,
+  // and m_LastJacobianIndex, and is therefore not thread-safe.
+
   // Zero all components of Jacobian
   // NOTE: for efficiency, we only need to zero out the coefficients
   // that got fill last time this method was called.
@@ -491,7 +651,8 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
   supportRegion.SetIndex( supportIndex );
   unsigned long counter = 0;
 
-  typedef ImageRegionIterator<JacobianImageType> IteratorType;
+  // Only read from the coefficient image, which keeps this method reentrant
+  typedef ImageRegionConstIterator<ImageType> IteratorType;
 
   IteratorType iterator = IteratorType( this->m_CoefficientImage[0], supportRegion );
 
@@ -556,7 +717,9 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
   ContinuousIndexType cindex;
   this->TransformPointToContinuousGridIndex( ipp, cindex );
 
-  /** Initialize */
+  /** Initialize. The jacobian is owned by the caller, so it is only
+   * resized when needed.
+   */
   const unsigned int nnzji = this->GetNumberOfNonZeroJacobianIndices();
   if ( (jacobian.cols() != nnzji) || (jacobian.rows() != SpaceDimension) )
   {
@@ -698,6 +861,455 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 } // end GetSpatialJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::TransformPoints(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  OutputPointType * opp ) const
+{
+  /** Check if the coefficient image has been set. */
+  if ( !this->m_CoefficientImage[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    for ( unsigned long p = 0; p < numberOfPoints; ++p )
+    {
+      opp[ p ] = ipp[ p ];
+    }
+    return;
+  }
+
+  ContinuousIndexType cindex;
+  ScalarType displacement[ SpaceDimension ];
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    this->TransformPointToContinuousGridIndex( ipp[ p ], cindex );
+
+    // NOTE: if the support region does not lie totally within the grid
+    // we assume zero displacement and return the input point
+    if ( !this->InsideValidRegion( cindex ) )
+    {
+      opp[ p ] = ipp[ p ];
+      continue;
+    }
+
+    /** The output point is the start point + displacement. */
+    this->ComputeDisplacement( cindex, displacement );
+    for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+    {
+      opp[ p ][ dim ] = ipp[ p ][ dim ] + displacement[ dim ];
+    }
+  } // end for points
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  JacobianType * j,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  if ( this->m_InputParametersPointer == NULL )
+  {
+    itkExceptionMacro( << "Cannot compute Jacobian: parameters not set" );
+  }
+
+  /** Allocate memory on the stack, once for the whole block. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  unsigned long supportOffsets[ numberOfWeights ];
+  this->ComputeSupportRegionOffsets( supportOffsets );
+
+  const ImageType * coefficientImage = this->m_CoefficientImage[ 0 ];
+  const unsigned int nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  const unsigned long parametersPerDim
+    = this->GetNumberOfParametersPerDimension();
+
+  ContinuousIndexType cindex;
+  IndexType supportIndex;
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    JacobianType & jacobian = j[ p ];
+    NonZeroJacobianIndicesType & nzji = nonZeroJacobianIndices[ p ];
+
+    /** The jacobian is owned by the caller, so it is only resized when needed. */
+    if ( (jacobian.cols() != nnzji) || (jacobian.rows() != SpaceDimension) )
+    {
+      jacobian.SetSize( SpaceDimension, nnzji );
+    }
+    jacobian.Fill( 0.0 );
+    nzji.resize( nnzji );
+
+    this->TransformPointToContinuousGridIndex( ipp[ p ], cindex );
+
+    // NOTE: if the support region does not lie totally within the grid
+    // we assume zero displacement and zero Jacobian
+    if ( !this->InsideValidRegion( cindex ) )
+    {
+      /** Return some dummy */
+      for ( unsigned int i = 0; i < nnzji; ++i )
+      {
+        nzji[ i ] = i;
+      }
+      continue;
+    }
+
+    /** Compute the weights and put them at the right positions. */
+    this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+    this->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+    const unsigned long startOffset
+      = coefficientImage->ComputeOffset( supportIndex );
+
+    for ( unsigned long mu = 0; mu < numberOfWeights; ++mu )
+    {
+      const unsigned long parameterNumber = startOffset + supportOffsets[ mu ];
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        jacobian( dim, mu + dim * numberOfWeights ) = weightsArray[ mu ];
+        nzji[ mu + dim * numberOfWeights ]
+          = parameterNumber + dim * parametersPerDim;
+      }
+    }
+  } // end for points
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetSpatialJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  SpatialJacobianType * sj ) const
+{
+  /** Allocate memory on the stack, once for the whole block. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  unsigned long supportOffsets[ numberOfWeights ];
+  this->ComputeSupportRegionOffsets( supportOffsets );
+
+  const ImageType * coefficientImage = this->m_CoefficientImage[ 0 ];
+  const PixelType * coefficients[ SpaceDimension ];
+  for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+  {
+    coefficients[ dim ] = this->m_CoefficientImage[ dim ]->GetBufferPointer();
+  }
+
+  ContinuousIndexType cindex;
+  IndexType supportIndex;
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    SpatialJacobianType & spatialJacobian = sj[ p ];
+    this->TransformPointToContinuousGridIndex( ipp[ p ], cindex );
+
+    // NOTE: if the support region does not lie totally within the grid
+    // we assume zero displacement and identity spatial Jacobian
+    if ( !this->InsideValidRegion( cindex ) )
+    {
+      spatialJacobian.SetIdentity();
+      continue;
+    }
+
+    this->m_DerivativeWeightsFunctions[ 0 ]->ComputeStartIndex(
+      cindex, supportIndex );
+    const unsigned long startOffset
+      = coefficientImage->ComputeOffset( supportIndex );
+
+    /** Compute dT_{dim} / dx_i = \sum coefs_{dim} * weights. */
+    for ( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      this->m_DerivativeWeightsFunctions[ i ]->Evaluate( cindex, supportIndex, weights );
+
+      double sum[ SpaceDimension ];
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        sum[ dim ] = 0.0;
+      }
+      for ( unsigned long k = 0; k < numberOfWeights; ++k )
+      {
+        const unsigned long offset = startOffset + supportOffsets[ k ];
+        const double w = weightsArray[ k ];
+        for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+        {
+          sum[ dim ] += coefficients[ dim ][ offset ] * w;
+        }
+      }
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        spatialJacobian( dim, i ) = sum[ dim ];
+      }
+    } // end for i
+
+    /** Take into account grid spacing and direction cosines. */
+    spatialJacobian = spatialJacobian * this->m_PointToIndexMatrix2;
+
+    /** Add contribution of spatial derivative of x. */
+    for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+    {
+      spatialJacobian( dim, dim ) += 1.0;
+    }
+  } // end for points
+
+} // end GetSpatialJacobians()
+
+
+/**
+ * ********************* EvaluateOnGrid ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+bool
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::EvaluateOnGrid(
+  const InputPointType & origin,
+  const GridIndexToPointMatrixType & indexToPoint,
+  const GridRegionType & region,
+  OutputPointType * opp,
+  SpatialJacobianType * sj ) const
+{
+  if ( !this->m_CoefficientImage[ 0 ] ) return false;
+
+  /** The continuous grid index of grid point i is c0 + A * i. The weights
+   * can only be tabulated per dimension if A is diagonal.
+   */
+  const GridIndexToPointMatrixType A = this->m_PointToIndexMatrix * indexToPoint;
+  for ( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      if ( i != j && vcl_abs( A( i, j ) ) > 1e-9 ) return false;
+    }
+  }
+  double c0[ SpaceDimension ];
+  for ( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    c0[ i ] = 0.0;
+    for ( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      c0[ i ] += this->m_PointToIndexMatrix( i, j )
+        * ( origin[ j ] - this->m_GridOrigin[ j ] );
+    }
+  }
+
+  GridEvaluationType evaluation;
+  evaluation.st_Origin = origin;
+  evaluation.st_IndexToPoint = indexToPoint;
+  evaluation.st_OutputPoints = opp;
+  evaluation.st_SpatialJacobians = sj;
+
+  /** The sizes of the levels of the contraction. */
+  const ImageType * coefficientImage = this->m_CoefficientImage[ 0 ];
+  const typename ImageType::OffsetValueType * offsetTable
+    = coefficientImage->GetOffsetTable();
+  const IndexType bufferIndex = coefficientImage->GetBufferedRegion().GetIndex();
+  for ( unsigned int d = 0; d <= SpaceDimension; ++d )
+  {
+    evaluation.st_BlockSize[ d ] = offsetTable[ d ];
+    evaluation.st_NumberOfVariants[ d ] = sj ? 1 + SpaceDimension - d : 1;
+  }
+  evaluation.st_NumberOfVariants[ SpaceDimension ] = 1;
+
+  /** Tabulate the 1D weights and the support start of each dimension. */
+  const unsigned int supportSize = SplineOrder + 1;
+  ContinuousIndexType cindex;
+  IndexType supportIndex;
+  OneDWeightsType weights1D;
+  unsigned long outputStride = 1;
+  for ( unsigned int d = 0; d < SpaceDimension; ++d )
+  {
+    const unsigned long size = region.GetSize()[ d ];
+    evaluation.st_OutputStride[ d ] = outputStride;
+    outputStride *= size;
+    evaluation.st_Inside[ d ].resize( size );
+    evaluation.st_Start[ d ].resize( size );
+    evaluation.st_Weights[ d ].resize( size * supportSize );
+    if ( sj ) evaluation.st_DerivativeWeights[ d ].resize( size * supportSize );
+    evaluation.st_Buffer[ d ].resize( evaluation.st_NumberOfVariants[ d ]
+      * SpaceDimension * evaluation.st_BlockSize[ d ] );
+
+    for ( unsigned long k = 0; k < size; ++k )
+    {
+      /** Only dimension d of the continuous index is used. */
+      cindex.Fill( static_cast<typename ContinuousIndexType::ValueType>(
+        c0[ d ] + A( d, d ) * static_cast<double>( region.GetIndex()[ d ] + k ) ) );
+      evaluation.st_Inside[ d ][ k ] = cindex[ d ] >= this->m_ValidRegionBegin[ d ]
+        && cindex[ d ] < this->m_ValidRegionEnd[ d ];
+      if ( !evaluation.st_Inside[ d ][ k ] ) continue;
+
+      this->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+      evaluation.st_Start[ d ][ k ] = supportIndex[ d ] - bufferIndex[ d ];
+      this->m_WeightsFunction->Evaluate1DWeights( cindex, supportIndex, weights1D );
+      for ( unsigned int s = 0; s < supportSize; ++s )
+      {
+        evaluation.st_Weights[ d ][ k * supportSize + s ] = weights1D[ d ][ s ];
+      }
+      if ( sj )
+      {
+        this->m_DerivativeWeightsFunctions[ d ]->Evaluate1DWeights(
+          cindex, supportIndex, weights1D );
+        for ( unsigned int s = 0; s < supportSize; ++s )
+        {
+          evaluation.st_DerivativeWeights[ d ][ k * supportSize + s ] = weights1D[ d ][ s ];
+        }
+      }
+    }
+  }
+
+  /** Start with the last dimension. */
+  evaluation.st_Index = region.GetIndex();
+  this->EvaluateOnGridDimension( evaluation, SpaceDimension - 1, true, 0 );
+
+  return true;
+
+} // end EvaluateOnGrid()
+
+
+/**
+ * ********************* EvaluateOnGridDimension ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::EvaluateOnGridDimension(
+  GridEvaluationType & evaluation,
+  const unsigned int d,
+  const bool inside,
+  const unsigned long outputOffset ) const
+{
+  const unsigned int supportSize = SplineOrder + 1;
+  const unsigned long size = evaluation.st_Inside[ d ].size();
+  const unsigned long blockSize = evaluation.st_BlockSize[ d ];
+  const unsigned long inputBlockSize = evaluation.st_BlockSize[ d + 1 ];
+  const unsigned int inputVariants = evaluation.st_NumberOfVariants[ d + 1 ];
+  const bool computeSpatialJacobian = evaluation.st_SpatialJacobians != 0;
+  double * buffer = evaluation.st_Buffer[ d ].empty() ? 0 : &evaluation.st_Buffer[ d ][ 0 ];
+  const typename IndexType::IndexValueType startIndex = evaluation.st_Index[ d ];
+
+  for ( unsigned long k = 0; k < size; ++k )
+  {
+    evaluation.st_Index[ d ] = startIndex + k;
+    const bool insideK = inside && evaluation.st_Inside[ d ][ k ];
+
+    /** Contract over dimension d. The variants of the previous level are
+     * contracted with the weights; the value variant is also contracted
+     * with the derivative weights, which adds the variant of dimension d.
+     */
+    if ( insideK )
+    {
+      const long start = evaluation.st_Start[ d ][ k ];
+      const double * weights = &evaluation.st_Weights[ d ][ k * supportSize ];
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        for ( unsigned int v = 0; v < inputVariants; ++v )
+        {
+          double * output = buffer + ( v * SpaceDimension + dim ) * blockSize;
+          if ( d == SpaceDimension - 1 )
+          {
+            Self::ContractDimension( this->m_CoefficientImage[ dim ]->GetBufferPointer(),
+              blockSize, start, weights, output );
+          }
+          else
+          {
+            Self::ContractDimension( &evaluation.st_Buffer[ d + 1 ][
+              ( v * SpaceDimension + dim ) * inputBlockSize ],
+              blockSize, start, weights, output );
+          }
+        }
+        if ( computeSpatialJacobian )
+        {
+          const double * derivativeWeights
+            = &evaluation.st_DerivativeWeights[ d ][ k * supportSize ];
+          double * output = buffer + ( inputVariants * SpaceDimension + dim ) * blockSize;
+          if ( d == SpaceDimension - 1 )
+          {
+            Self::ContractDimension( this->m_CoefficientImage[ dim ]->GetBufferPointer(),
+              blockSize, start, derivativeWeights, output );
+          }
+          else
+          {
+            Self::ContractDimension( &evaluation.st_Buffer[ d + 1 ][ dim * inputBlockSize ],
+              blockSize, start, derivativeWeights, output );
+          }
+        }
+      }
+    }
+
+    const unsigned long offset = outputOffset + k * evaluation.st_OutputStride[ d ];
+    if ( d > 0 )
+    {
+      this->EvaluateOnGridDimension( evaluation, d - 1, insideK, offset );
+      continue;
+    }
+
+    /** All dimensions are contracted: store the results of this point. */
+    if ( evaluation.st_OutputPoints )
+    {
+      OutputPointType & outputPoint = evaluation.st_OutputPoints[ offset ];
+      for ( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        double x = evaluation.st_Origin[ i ];
+        for ( unsigned int j = 0; j < SpaceDimension; ++j )
+        {
+          x += evaluation.st_IndexToPoint( i, j ) * evaluation.st_Index[ j ];
+        }
+        if ( insideK ) x += buffer[ i ];
+        outputPoint[ i ] = static_cast<ScalarType>( x );
+      }
+    }
+    if ( computeSpatialJacobian )
+    {
+      SpatialJacobianType & spatialJacobian = evaluation.st_SpatialJacobians[ offset ];
+      if ( !insideK )
+      {
+        spatialJacobian.SetIdentity();
+        continue;
+      }
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        for ( unsigned int i = 0; i < SpaceDimension; ++i )
+        {
+          spatialJacobian( dim, i ) = static_cast<ScalarType>(
+            buffer[ ( SpaceDimension - i ) * SpaceDimension + dim ] );
+        }
+      }
+
+      /** Take into account grid spacing and direction cosines. */
+      spatialJacobian = spatialJacobian * this->m_PointToIndexMatrix2;
+
+      /** Add contribution of spatial derivative of x. */
+      for ( unsigned int dim = 0; dim < SpaceDimension; ++dim )
+      {
+        spatialJacobian( dim, dim ) += 1.0;
+      }
+    }
+  } // end for k
+
+  evaluation.st_Index[ d ] = startIndex;
+
+} // end EvaluateOnGridDimension()
+
+
 /**
  * ********************* GetSpatialHessian ****************************
  */
@@ -1369,6 +1981,37 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ********************* ComputeSupportRegionOffsets ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::ComputeSupportRegionOffsets( unsigned long * offsets ) const
+{
+  const typename ImageType::OffsetValueType * offsetTable
+    = this->m_CoefficientImage[ 0 ]->GetOffsetTable();
+
+  /** Walk through the support region with the first dimension running
+   * fastest, like the image iterators that are used elsewhere.
+   */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  for ( unsigned long k = 0; k < numberOfWeights; ++k )
+  {
+    unsigned long remainder = k;
+    unsigned long offset = 0;
+    for ( unsigned int d = 0; d < SpaceDimension; ++d )
+    {
+      offset += ( remainder % this->m_SupportSize[ d ] ) * offsetTable[ d ];
+      remainder /= this->m_SupportSize[ d ];
+    }
+    offsets[ k ] = offset;
+  }
+
+} // end ComputeSupportRegionOffsets()
+
+
 /**
  * ********************* ComputeNonZeroJacobianIndices ****************************
  */
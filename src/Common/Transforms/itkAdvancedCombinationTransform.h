@@ -89,6 +89,8 @@ public:
   typedef typename Superclass::SpatialHessianType             SpatialHessianType;
   typedef typename Superclass::JacobianOfSpatialHessianType   JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType             InternalMatrixType;
+  typedef typename Superclass::GridRegionType                 GridRegionType;
+  typedef typename Superclass::GridIndexToPointMatrixType     GridIndexToPointMatrixType;
 
   /** Typedefs for the InitialTransform. */
   typedef Superclass                                      InitialTransformType;
@@ -178,6 +180,46 @@ public:
     const InputPointType & ipp,
     SpatialJacobianType & sj ) const;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and
+   * GetSpatialJacobian(). The initial transform is evaluated for the
+   * whole block first, after which the block is passed on to the current
+   * transform, so that both transforms can use their own batched
+   * implementations.
+   */
+  virtual void TransformPoints(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    OutputPointType * opp ) const;
+
+  virtual void GetJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    JacobianType * j,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    SpatialJacobianType * sj ) const;
+
+  /** Grid evaluation is passed on to the current transform if there is no
+   * initial transform, or if a linear initial transform is composed with
+   * it: the grid is then mapped by the initial transform onto another
+   * regular grid. Returns false in the other cases.
+   */
+  virtual bool EvaluateOnGrid(
+    const InputPointType & origin,
+    const GridIndexToPointMatrixType & indexToPoint,
+    const GridRegionType & region,
+    OutputPointType * opp,
+    SpatialJacobianType * sj ) const;
+
+  /** Create a plain AdvancedCombinationTransform with a copy of the
+   * current transform, which shares the initial transform with this
+   * transform. Returns 0 if the current transform can not be copied.
+   */
+  virtual typename Superclass::Pointer CreateEvaluationCopy( void ) const;
+
   /** Compute the spatial Hessian of the transformation. */
   virtual void GetSpatialHessian(
     const InputPointType & ipp,
@@ -16,6 +16,7 @@
 #define __itkAdvancedCombinationTransform_hxx
 
 #include "itkAdvancedCombinationTransform.h"
+#include <vector>
 
 
 namespace itk
@@ -1527,6 +1528,246 @@ AdvancedCombinationTransform<TScalarType, NDimensions>
 } // end GetSpatialJacobian()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::TransformPoints(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  OutputPointType * opp ) const
+{
+  if ( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  if ( numberOfPoints == 0 ) return;
+
+  if ( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, ipp, opp );
+    return;
+  }
+
+  /** Evaluate the initial transform for the whole block. */
+  std::vector< OutputPointType > out0( numberOfPoints );
+  this->m_InitialTransform->TransformPoints( numberOfPoints, ipp, &out0[ 0 ] );
+
+  if ( this->m_UseAddition )
+  {
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, ipp, opp );
+    for ( unsigned long p = 0; p < numberOfPoints; ++p )
+    {
+      for ( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        opp[ p ][ i ] += ( out0[ p ][ i ] - ipp[ p ][ i ] );
+      }
+    }
+  }
+  else
+  {
+    this->m_CurrentTransform->TransformPoints( numberOfPoints, &out0[ 0 ], opp );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ****************** GetJacobians ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  JacobianType * j,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  if ( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  if ( numberOfPoints == 0 ) return;
+
+  /** Only the parameters of the current transform are optimized, so with
+   * addition the Jacobian is that of the current transform at the input
+   * points, and with composition at the initially transformed points.
+   */
+  if ( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    this->m_CurrentTransform->GetJacobians( numberOfPoints, ipp,
+      j, nonZeroJacobianIndices );
+    return;
+  }
+
+  std::vector< OutputPointType > out0( numberOfPoints );
+  this->m_InitialTransform->TransformPoints( numberOfPoints, ipp, &out0[ 0 ] );
+  this->m_CurrentTransform->GetJacobians( numberOfPoints, &out0[ 0 ],
+    j, nonZeroJacobianIndices );
+
+} // end GetJacobians()
+
+
+/**
+ * ****************** GetSpatialJacobians ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::GetSpatialJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  SpatialJacobianType * sj ) const
+{
+  if ( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  if ( numberOfPoints == 0 ) return;
+
+  if ( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->GetSpatialJacobians( numberOfPoints, ipp, sj );
+    return;
+  }
+
+  /** The spatial Jacobians of the initial transform. */
+  std::vector< SpatialJacobianType > sj0( numberOfPoints );
+  this->m_InitialTransform->GetSpatialJacobians( numberOfPoints, ipp, &sj0[ 0 ] );
+
+  if ( this->m_UseAddition )
+  {
+    SpatialJacobianType identity;
+    identity.SetIdentity();
+    this->m_CurrentTransform->GetSpatialJacobians( numberOfPoints, ipp, sj );
+    for ( unsigned long p = 0; p < numberOfPoints; ++p )
+    {
+      sj[ p ] = sj0[ p ] + sj[ p ] - identity;
+    }
+  }
+  else
+  {
+    std::vector< OutputPointType > out0( numberOfPoints );
+    this->m_InitialTransform->TransformPoints( numberOfPoints, ipp, &out0[ 0 ] );
+    this->m_CurrentTransform->GetSpatialJacobians( numberOfPoints, &out0[ 0 ], sj );
+    for ( unsigned long p = 0; p < numberOfPoints; ++p )
+    {
+      sj[ p ] = sj[ p ] * sj0[ p ];
+    }
+  }
+
+} // end GetSpatialJacobians()
+
+
+/**
+ * ****************** EvaluateOnGrid ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+bool
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::EvaluateOnGrid(
+  const InputPointType & origin,
+  const GridIndexToPointMatrixType & indexToPoint,
+  const GridRegionType & region,
+  OutputPointType * opp,
+  SpatialJacobianType * sj ) const
+{
+  if ( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+
+  if ( this->m_InitialTransform.IsNull() )
+  {
+    return this->m_CurrentTransform->EvaluateOnGrid(
+      origin, indexToPoint, region, opp, sj );
+  }
+
+  if ( this->m_UseAddition || !this->m_InitialTransform->IsLinear() )
+  {
+    return false;
+  }
+
+  /** A linear initial transform maps the grid onto a grid with
+   * origin T0(origin) and index-to-point matrix A0 * indexToPoint.
+   */
+  SpatialJacobianType sj0;
+  this->m_InitialTransform->GetSpatialJacobian( origin, sj0 );
+  const InputPointType origin0 = this->m_InitialTransform->TransformPoint( origin );
+  GridIndexToPointMatrixType indexToPoint0;
+  for ( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      indexToPoint0( i, j ) = 0.0;
+      for ( unsigned int k = 0; k < SpaceDimension; ++k )
+      {
+        indexToPoint0( i, j ) += sj0( i, k ) * indexToPoint( k, j );
+      }
+    }
+  }
+
+  if ( !this->m_CurrentTransform->EvaluateOnGrid(
+    origin0, indexToPoint0, region, opp, sj ) )
+  {
+    return false;
+  }
+
+  if ( sj )
+  {
+    const unsigned long numberOfPoints = region.GetNumberOfPixels();
+    for ( unsigned long p = 0; p < numberOfPoints; ++p )
+    {
+      sj[ p ] = sj[ p ] * sj0;
+    }
+  }
+
+  return true;
+
+} // end EvaluateOnGrid()
+
+
+/**
+ * ****************** CreateEvaluationCopy ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+typename AdvancedCombinationTransform<TScalarType, NDimensions>::Superclass::Pointer
+AdvancedCombinationTransform<TScalarType, NDimensions>
+::CreateEvaluationCopy( void ) const
+{
+  if ( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+
+  /** Subclasses, such as the elastix transform components, are not
+   * copied themselves: a plain combination transform suffices.
+   */
+  typename Superclass::Pointer currentCopy
+    = this->m_CurrentTransform->CreateEvaluationCopy();
+  if ( currentCopy.IsNull() )
+  {
+    return 0;
+  }
+
+  Pointer copy = Self::New();
+  copy->SetUseComposition( this->m_UseComposition );
+  copy->SetInitialTransform( this->m_InitialTransform );
+  copy->SetCurrentTransform( currentCopy );
+
+  return copy.GetPointer();
+
+} // end CreateEvaluationCopy()
+
+
 /**
  * ****************** GetSpatialHessian ****************************
  */
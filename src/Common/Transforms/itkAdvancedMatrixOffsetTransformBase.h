@@ -331,6 +331,15 @@ public:
   OutputCovariantVectorType TransformCovariantVector(
     const InputCovariantVectorType & vector ) const;
 
+  /** Transform a block of points. The matrix and offset are copied to
+   * local arrays once, after which the loop over the points does not
+   * involve any function calls, so that the compiler can vectorise it.
+   */
+  virtual void TransformPoints(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    OutputPointType * opp ) const;
+
   /** Create inverse of an affine transformation
     *
     * This populates the parameters an affine transform such that
@@ -379,6 +388,14 @@ public:
     const InputPointType &,
     SpatialJacobianType & ) const;
 
+  /** Compute the spatial Jacobian for a block of points. It equals the
+   * matrix of the transformation everywhere.
+   */
+  virtual void GetSpatialJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType *,
+    SpatialJacobianType * sj ) const;
+
   /** Compute the spatial Hessian of the transformation. */
   virtual void GetSpatialHessian(
     const InputPointType &,
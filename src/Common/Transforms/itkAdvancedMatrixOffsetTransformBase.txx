@@ -261,6 +261,50 @@ AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensio
 }
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template<class TScalarType, unsigned int NInputDimensions,
+                            unsigned int NOutputDimensions>
+void
+AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>
+::TransformPoints(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  OutputPointType * opp ) const
+{
+  /** Copy the matrix and offset to plain arrays. */
+  ScalarType matrix[ NOutputDimensions ][ NInputDimensions ];
+  ScalarType offset[ NOutputDimensions ];
+  for ( unsigned int i = 0; i < NOutputDimensions; ++i )
+  {
+    for ( unsigned int j = 0; j < NInputDimensions; ++j )
+    {
+      matrix[ i ][ j ] = this->m_Matrix( i, j );
+    }
+    offset[ i ] = this->m_Offset[ i ];
+  }
+
+  /** opp = matrix * ipp + offset, for all points. */
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    const InputPointType & point = ipp[ p ];
+    OutputPointType & result = opp[ p ];
+    for ( unsigned int i = 0; i < NOutputDimensions; ++i )
+    {
+      ScalarType sum = offset[ i ];
+      for ( unsigned int j = 0; j < NInputDimensions; ++j )
+      {
+        sum += matrix[ i ][ j ] * point[ j ];
+      }
+      result[ i ] = sum;
+    }
+  }
+
+} // end TransformPoints()
+
+
 // Transform a vector
 template<class TScalarType, unsigned int NInputDimensions,
                             unsigned int NOutputDimensions>
@@ -630,6 +674,28 @@ AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensio
 } // end GetSpatialJacobian()
 
 
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NInputDimensions,
+                            unsigned int NOutputDimensions>
+void
+AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>
+::GetSpatialJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType *,
+  SpatialJacobianType * sj ) const
+{
+  const MatrixType & matrix = this->GetMatrix();
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    sj[ p ] = matrix;
+  }
+
+} // end GetSpatialJacobians()
+
+
 /**
  * ********************* GetSpatialHessian ****************************
  */
@@ -34,6 +34,7 @@ PURPOSE. See the above copyright notices for more information.
 #include "itkTransform.h"
 #include "itkMatrix.h"
 #include "itkFixedArray.h"
+#include "itkImageRegion.h"
 
 namespace itk
 {
@@ -73,6 +74,13 @@ namespace itk
  * we additionally define GetJacobianOfSpatialJacobian() and
  * GetJacobianOfSpatialHessian().
  *
+ * Subclasses should implement the methods that take caller-owned output
+ * arguments, such as GetJacobian( ipp, j, nonZeroJacobianIndices ), in a
+ * const and reentrant way, i.e. without writing to member variables. This
+ * allows metrics to evaluate the transform from multiple threads. The
+ * GetJacobian( ipp ) from the superclass returns a reference to a member
+ * variable and is not thread-safe.
+ *
  * \ingroup Transforms
  *
  */
@@ -132,6 +140,11 @@ public:
   typedef std::vector< SpatialHessianType >         JacobianOfSpatialHessianType;
   typedef typename SpatialJacobianType::InternalMatrixType  InternalMatrixType;
 
+  /** Types for the evaluation on a regular grid. */
+  typedef ImageRegion< InputSpaceDimension >        GridRegionType;
+  typedef Matrix< double,
+    InputSpaceDimension, InputSpaceDimension >      GridIndexToPointMatrixType;
+
   /** Get the number of nonzero Jacobian indices. By default all. */
   virtual unsigned long GetNumberOfNonZeroJacobianIndices( void ) const;
 
@@ -206,6 +219,67 @@ public:
     const InputPointType & ipp,
     SpatialJacobianType & sj ) const;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and
+   * GetSpatialJacobian(), which evaluate the transformation at
+   * numberOfPoints input points at once. The output arrays are owned by
+   * the caller and should contain at least numberOfPoints elements.
+   * The Jacobians and nonzero Jacobian indices follow the same sizing
+   * rules as the single point GetJacobian(), so they can be reused over
+   * many calls.
+   *
+   * The default implementations simply loop over the single point
+   * methods. Subclasses may override them to share per-call setup over
+   * the block and to avoid a virtual call per point.
+   */
+  virtual void TransformPoints(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    OutputPointType * opp ) const;
+
+  virtual void GetJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    JacobianType * j,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    SpatialJacobianType * sj ) const;
+
+  /** Evaluate TransformPoint() and/or GetSpatialJacobian() at all points of
+   * a region of a regular grid, such as the voxels of an image. The grid
+   * point with index i is at origin + indexToPoint * i, like in
+   * Image::TransformIndexToPhysicalPoint(). The results are stored in opp
+   * and sj, either of which may be null, in the order of an image iterator
+   * over the region: the first dimension runs fastest.
+   *
+   * Subclasses can override this to reuse intermediate results between
+   * neighbouring grid points. The function returns false when no such
+   * implementation is available for this grid, in which case nothing is
+   * computed and the caller should use the point-wise functions. The
+   * default implementation returns false.
+   */
+  virtual bool EvaluateOnGrid(
+    const InputPointType & origin,
+    const GridIndexToPointMatrixType & indexToPoint,
+    const GridRegionType & region,
+    OutputPointType * opp,
+    SpatialJacobianType * sj ) const;
+
+  /** Create a transform that computes the same as this transform, but
+   * that owns its own copy of the parameters, so that it can be given
+   * other parameters without affecting this transform. Read-only data,
+   * such as an initial transform, may be shared with this transform.
+   * Copies can be evaluated in parallel, e.g. by the evaluators of a
+   * metric, see AdvancedImageToImageMetric::CreateEvaluator().
+   *
+   * The default implementation creates another instance of the same
+   * class and copies the fixed parameters and the parameters. It returns
+   * 0 if the transform can not be copied like that.
+   */
+  virtual Pointer CreateEvaluationCopy( void ) const;
+
   /** Compute the spatial Hessian of the transformation.
    *
    * The spatial Hessian is the vector of matrices of partial second order
@@ -130,6 +130,114 @@ AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
 } // end GetSpatialJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::TransformPoints(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  OutputPointType * opp ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    opp[ i ] = this->TransformPoint( ipp[ i ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::GetJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  JacobianType * j,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetJacobian( ipp[ i ], j[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::GetSpatialJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  SpatialJacobianType * sj ) const
+{
+  for ( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetSpatialJacobian( ipp[ i ], sj[ i ] );
+  }
+
+} // end GetSpatialJacobians()
+
+
+/**
+ * ********************* EvaluateOnGrid ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+bool
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::EvaluateOnGrid(
+  const InputPointType &,
+  const GridIndexToPointMatrixType &,
+  const GridRegionType &,
+  OutputPointType *,
+  SpatialJacobianType * ) const
+{
+  /** No dense implementation by default. */
+  return false;
+
+} // end EvaluateOnGrid()
+
+
+/**
+ * ********************* CreateEvaluationCopy ****************************
+ */
+
+template < class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+typename AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>::Pointer
+AdvancedTransform<TScalarType,NInputDimensions,NOutputDimensions>
+::CreateEvaluationCopy( void ) const
+{
+  /** Create another instance of the same class. */
+  Pointer copy = dynamic_cast< Self * >( this->CreateAnother().GetPointer() );
+  if ( copy.IsNull() )
+  {
+    return 0;
+  }
+
+  /** Copy the parameters by value, so that the copy does not refer to
+   * the parameters of this transform.
+   */
+  copy->SetFixedParameters( this->GetFixedParameters() );
+  copy->SetParametersByValue( this->GetParameters() );
+
+  return copy;
+
+} // end CreateEvaluationCopy()
+
+
 /**
  * ********************* GetSpatialHessian ****************************
  */
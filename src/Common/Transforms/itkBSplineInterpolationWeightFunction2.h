@@ -68,6 +68,7 @@ public:
   typedef typename Superclass::IndexType            IndexType;
   typedef typename Superclass::SizeType             SizeType;
   typedef typename Superclass::ContinuousIndexType  ContinuousIndexType;
+  typedef typename Superclass::OneDWeightsType      OneDWeightsType;
 
 protected:
   BSplineInterpolationWeightFunction2();
@@ -79,7 +80,6 @@ protected:
   typedef typename Superclass
     ::SecondOrderDerivativeKernelType               SecondOrderDerivativeKernelType;
   typedef typename Superclass::TableType            TableType;
-  typedef typename Superclass::OneDWeightsType      OneDWeightsType;
   typedef typename Superclass::WeightArrayType  WeightArrayType;
 
   /* Compute the 1D weights, which are:
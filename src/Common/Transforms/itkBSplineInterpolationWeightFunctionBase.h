@@ -117,6 +117,24 @@ public:
   void ComputeStartIndex( const ContinuousIndexType & index,
     IndexType & startIndex ) const;
 
+  /** Typedef for intermediary 1D weights.
+   * The Matrix is at least twice as fast as std::vector< vnl_vector< double > >,
+   * probably because of the fixed size at compile time.
+   */
+  typedef Matrix< double,
+    itkGetStaticConstMacro( SpaceDimension ),
+    itkGetStaticConstMacro( SplineOrder ) + 1 > OneDWeightsType;
+
+  /** Evaluate only the 1D weights of each dimension. The weights returned
+   * by Evaluate() are the tensor product of these, so callers that can
+   * exploit the separability do not need the full set of weights.
+   */
+  void Evaluate1DWeights( const ContinuousIndexType & cindex,
+    const IndexType & startIndex, OneDWeightsType & weights1D ) const
+  {
+    this->Compute1DWeights( cindex, startIndex, weights1D );
+  }
+
   /** Get support region size. */
   itkGetConstReferenceMacro( SupportSize, SizeType );
 
@@ -139,14 +157,6 @@ protected:
   /** Lookup table type. */
   typedef Array2D<unsigned long> TableType;
 
-  /** Typedef for intermediary 1D weights.
-   * The Matrix is at least twice as fast as std::vector< vnl_vector< double > >,
-   * probably because of the fixed size at compile time.
-   */
-  typedef Matrix< double,
-    itkGetStaticConstMacro( SpaceDimension ),
-    itkGetStaticConstMacro( SplineOrder ) + 1 > OneDWeightsType;
-
   /** Compute the 1D weights. */
   virtual void Compute1DWeights(
     const ContinuousIndexType & index,
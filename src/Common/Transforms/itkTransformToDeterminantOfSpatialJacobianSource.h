@@ -33,6 +33,7 @@ PURPOSE. See the above copyright notices for more information.
 
 #include "itkAdvancedTransform.h"
 #include "itkImageSource.h"
+#include "itkProgressReporter.h"
 
 namespace itk
 {
@@ -197,6 +198,14 @@ protected:
     const OutputImageRegionType& outputRegionForThread,
     int threadId );
 
+  /** Faster implementation for nonlinear transformations that support
+   * AdvancedTransform::EvaluateOnGrid(). Returns false, without computing
+   * anything, if the transform does not support it for the output grid.
+   */
+  bool GenerateSpatialJacobiansOnGrid(
+    const OutputImageRegionType& outputRegionForThread,
+    ProgressReporter & progress );
+
   /** Faster implementation for resampling that works for with linear
    *  transformation types. Unthreaded. */
   void LinearGenerateData( void );
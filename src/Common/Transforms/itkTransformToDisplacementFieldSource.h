@@ -0,0 +1,202 @@
+/*======================================================================
+
+This file is part of the elastix software.
+
+Copyright (c) University Medical Center Utrecht. All rights reserved.
+See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkTransformToDisplacementFieldSource_h
+#define __itkTransformToDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+#include "itkProgressReporter.h"
+
+namespace itk
+{
+
+/** \class TransformToDisplacementFieldSource
+ * \brief Generate the displacement field of a coordinate transform
+ *
+ * This class is the counterpart of the itkTransformToSpatialJacobianSource
+ * for the displacement T(x) - x, and replaces the ITK
+ * TransformToDeformationFieldSource for advanced transforms. The output
+ * image type should be an image of vectors of ImageDimension components.
+ *
+ * Instead of transforming the voxels one by one, the filter first lets
+ * the transform evaluate a whole slice at once, with
+ * AdvancedTransform::EvaluateOnGrid(), which for B-spline transforms
+ * reuses the interpolation of the coefficients between neighbouring
+ * voxels. If the transform does not support that for the output grid,
+ * the voxels are transformed in rows with AdvancedTransform::TransformPoints().
+ *
+ * Output information (spacing, size and direction) for the output
+ * image should be set. This information has the normal defaults of
+ * unit spacing, zero origin and identity direction.
+ *
+ * This filter is implemented as a multithreaded filter.  It provides a
+ * ThreadedGenerateData() method for its implementation.
+ *
+ * \ingroup GeometricTransforms
+ */
+template <class TOutputImage,
+class TTransformPrecisionType=double>
+class ITK_EXPORT TransformToDisplacementFieldSource:
+    public ImageSource<TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef TransformToDisplacementFieldSource      Self;
+  typedef ImageSource<TOutputImage>               Superclass;
+  typedef SmartPointer<Self>                      Pointer;
+  typedef SmartPointer<const Self>                ConstPointer;
+
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::Pointer       OutputImagePointer;
+  typedef typename OutputImageType::ConstPointer  OutputImageConstPointer;
+  typedef typename OutputImageType::RegionType    OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformToDisplacementFieldSource, ImageSource );
+
+  /** Number of dimensions. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform<TTransformPrecisionType,
+    itkGetStaticConstMacro( ImageDimension ),
+    itkGetStaticConstMacro( ImageDimension )>     TransformType;
+  typedef typename TransformType::ConstPointer    TransformPointerType;
+  typedef typename TransformType::InputPointType  InputPointType;
+  typedef typename TransformType::OutputPointType OutputPointType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase< itkGetStaticConstMacro( ImageDimension ) > ImageBaseType;
+
+  /** Set the coordinate transformation. Note that this is the
+   * output-to-input transform. By default the filter uses an Identity
+   * transform.
+   */
+  itkSetConstObjectMacro( Transform, TransformType );
+
+  /** Get a pointer to the coordinate transform. */
+  itkGetConstObjectMacro( Transform, TransformType );
+
+  /** Set the size of the output image. */
+  virtual void SetOutputSize( const SizeType & size );
+
+  /** Get the size of the output image. */
+  virtual const SizeType & GetOutputSize();
+
+  /** Set the start index of the output largest possible region.
+  * The default is an index of all zeros. */
+  virtual void SetOutputIndex( const IndexType & index );
+
+  /** Get the start index of the output largest possible region. */
+  virtual const IndexType & GetOutputIndex();
+
+  /** Set the region of the output image. */
+  itkSetMacro( OutputRegion, OutputImageRegionType );
+
+  /** Get the region of the output image. */
+  itkGetConstReferenceMacro( OutputRegion, OutputImageRegionType );
+
+  /** Set the output image spacing. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  virtual void SetOutputSpacing( const double* values );
+
+  /** Get the output image spacing. */
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Set the output image origin. */
+  itkSetMacro( OutputOrigin, OriginType );
+  virtual void SetOutputOrigin( const double* values);
+
+  /** Get the output image origin. */
+  itkGetConstReferenceMacro( OutputOrigin, OriginType );
+
+  /** Set the output direction cosine matrix. */
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+
+  /** Helper method to set the output parameters based on this image */
+  void SetOutputParametersFromImage( const ImageBaseType * image );
+
+  /** TransformToDisplacementFieldSource produces a vector image. */
+  virtual void GenerateOutputInformation( void );
+
+  /** Checking if transform is set. */
+  virtual void BeforeThreadedGenerateData( void );
+
+  /** Compute the Modified Time based on changes to the components. */
+  unsigned long GetMTime( void ) const;
+
+protected:
+  TransformToDisplacementFieldSource();
+  ~TransformToDisplacementFieldSource() {};
+
+  void PrintSelf( std::ostream& os, Indent indent ) const;
+
+  /** TransformToDisplacementFieldSource is implemented as a multithreaded
+   * filter.
+   */
+  void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread,
+    int threadId );
+
+  /** Implementation for transformations that support
+   * AdvancedTransform::EvaluateOnGrid(). Returns false, without computing
+   * anything, if the transform does not support it for the output grid.
+   */
+  bool GenerateDisplacementsOnGrid(
+    const OutputImageRegionType& outputRegionForThread,
+    ProgressReporter & progress );
+
+  /** Default implementation that works for any transformation type. */
+  void GenerateDisplacementsPerRow(
+    const OutputImageRegionType& outputRegionForThread,
+    ProgressReporter & progress );
+
+private:
+
+  TransformToDisplacementFieldSource( const Self& ); //purposely not implemented
+  void operator=( const Self& ); //purposely not implemented
+
+  /** Member variables. */
+  RegionType              m_OutputRegion;      // region of the output image
+  TransformPointerType    m_Transform;         // Coordinate transform to use
+  SpacingType             m_OutputSpacing;     // output image spacing
+  OriginType              m_OutputOrigin;      // output image origin
+  DirectionType           m_OutputDirection;   // output image direction cosines
+
+}; // end class TransformToDisplacementFieldSource
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkTransformToDisplacementFieldSource.txx"
+#endif
+
+#endif // end #ifndef __itkTransformToDisplacementFieldSource_h
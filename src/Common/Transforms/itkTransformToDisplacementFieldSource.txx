@@ -0,0 +1,392 @@
+/*======================================================================
+
+This file is part of the elastix software.
+
+Copyright (c) University Medical Center Utrecht. All rights reserved.
+See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __itkTransformToDisplacementFieldSource_txx
+#define __itkTransformToDisplacementFieldSource_txx
+
+#include "itkTransformToDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+#include "itkProgressReporter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageLinearIteratorWithIndex.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::TransformToDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill(1.0);
+  this->m_OutputOrigin.Fill(0.0);
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill( 0 );
+  this->m_OutputRegion.SetSize( size );
+
+  IndexType index;
+  index.Fill( 0 );
+  this->m_OutputRegion.SetIndex( index );
+
+  this->m_Transform = AdvancedIdentityTransform<TTransformPrecisionType, ImageDimension>::New();
+
+} // end Constructor
+
+
+/**
+ * Print out a description of self
+ *
+ * \todo Add details about this class
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * Set the output image size.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SetOutputSize( const SizeType & size )
+{
+  this->m_OutputRegion.SetSize( size );
+}
+
+
+/**
+ * Get the output image size.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+const typename TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SizeType &
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GetOutputSize()
+{
+  return this->m_OutputRegion.GetSize();
+}
+
+
+/**
+ * Set the output image index.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SetOutputIndex( const IndexType & index )
+{
+  this->m_OutputRegion.SetIndex( index );
+}
+
+
+/**
+ * Get the output image index.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+const typename TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::IndexType &
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GetOutputIndex()
+{
+  return this->m_OutputRegion.GetIndex();
+}
+
+
+/**
+ * Set the output image spacing.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SetOutputSpacing( const double* spacing )
+{
+  SpacingType s( spacing );
+  this->SetOutputSpacing( s );
+
+} // end SetOutputSpacing()
+
+
+/**
+ * Set the output image origin.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SetOutputOrigin( const double* origin )
+{
+  OriginType p( origin );
+  this->SetOutputOrigin( p );
+
+}
+
+/** Helper method to set the output parameters based on this image */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::SetOutputParametersFromImage ( const ImageBaseType * image )
+{
+  if( !image )
+    {
+    itkExceptionMacro(<< "Cannot use a null image reference");
+    }
+
+  this->SetOutputOrigin( image->GetOrigin() );
+  this->SetOutputSpacing( image->GetSpacing() );
+  this->SetOutputDirection( image->GetDirection() );
+  this->SetOutputRegion( image->GetLargestPossibleRegion() );
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * Set up state of filter before multi-threading.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::BeforeThreadedGenerateData( void )
+{
+  if( !this->m_Transform )
+    {
+    itkExceptionMacro(<< "Transform not set");
+    }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ThreadedGenerateData
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread,
+  int threadId )
+{
+  // Support for progress methods/callbacks
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+
+  // First try to let the transform evaluate the displacements on the
+  // voxel grid. Otherwise, transform the voxels row by row.
+  if ( !this->GenerateDisplacementsOnGrid( outputRegionForThread, progress ) )
+    {
+    this->GenerateDisplacementsPerRow( outputRegionForThread, progress );
+    }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * Evaluate the transform on the voxel grid, one slice at a time.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+bool
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GenerateDisplacementsOnGrid(
+  const OutputImageRegionType & outputRegionForThread,
+  ProgressReporter & progress )
+{
+  typedef typename TransformType::GridIndexToPointMatrixType GridIndexToPointMatrixType;
+  const unsigned int lastDimension = ImageDimension - 1;
+
+  // Get the output pointer
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // The voxel with index i is at origin + direction * spacing * i
+  InputPointType origin;
+  GridIndexToPointMatrixType indexToPoint;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    origin[ i ] = outputPtr->GetOrigin()[ i ];
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      indexToPoint( i, j ) = outputPtr->GetDirection()( i, j )
+        * outputPtr->GetSpacing()[ j ];
+      }
+    }
+
+  OutputImageRegionType sliceRegion = outputRegionForThread;
+  SizeType sliceSize = sliceRegion.GetSize();
+  sliceSize[ lastDimension ] = 1;
+  sliceRegion.SetSize( sliceSize );
+  std::vector< OutputPointType > transformedSlice( sliceRegion.GetNumberOfPixels() );
+  if ( transformedSlice.empty() )
+    {
+    return false;
+    }
+
+  PointType point;
+  PixelType displacement;
+  const unsigned long numberOfSlices = outputRegionForThread.GetSize()[ lastDimension ];
+  for ( unsigned long s = 0; s < numberOfSlices; ++s )
+    {
+    IndexType sliceIndex = outputRegionForThread.GetIndex();
+    sliceIndex[ lastDimension ] += s;
+    sliceRegion.SetIndex( sliceIndex );
+
+    // Only the first slice can fail, since the grid is the same for all
+    if ( !this->m_Transform->EvaluateOnGrid(
+      origin, indexToPoint, sliceRegion, &transformedSlice[ 0 ], 0 ) )
+      {
+      return false;
+      }
+
+    ImageRegionIteratorWithIndex<TOutputImage> sliceIt( outputPtr, sliceRegion );
+    for ( unsigned long p = 0; p < transformedSlice.size(); ++p )
+      {
+      outputPtr->TransformIndexToPhysicalPoint( sliceIt.GetIndex(), point );
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        displacement[ i ] = static_cast<PixelValueType>(
+          transformedSlice[ p ][ i ] - point[ i ] );
+        }
+      sliceIt.Set( displacement );
+      progress.CompletedPixel();
+      ++sliceIt;
+      }
+    }
+
+  return true;
+
+} // end GenerateDisplacementsOnGrid()
+
+
+/**
+ * Transform the voxels row by row, with the batched TransformPoints().
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GenerateDisplacementsPerRow(
+  const OutputImageRegionType & outputRegionForThread,
+  ProgressReporter & progress )
+{
+  // Get the output pointer
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // Create an iterator that will walk the output region for this thread.
+  typedef ImageLinearIteratorWithIndex<TOutputImage> OutputIteratorType;
+  OutputIteratorType it( outputPtr, outputRegionForThread );
+  it.SetDirection( 0 );
+
+  const unsigned long rowLength = outputRegionForThread.GetSize()[ 0 ];
+  std::vector< InputPointType > points( rowLength );
+  std::vector< OutputPointType > transformedPoints( rowLength );
+  PointType point;
+  PixelType displacement;
+
+  // Walk the output region
+  for ( it.GoToBegin(); !it.IsAtEnd(); it.NextLine() )
+    {
+    // Determine the coordinates of the voxels of this row
+    it.GoToBeginOfLine();
+    for ( unsigned long p = 0; p < rowLength; ++p, ++it )
+      {
+      outputPtr->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        points[ p ][ i ] = point[ i ];
+        }
+      }
+
+    this->m_Transform->TransformPoints( rowLength, &points[ 0 ], &transformedPoints[ 0 ] );
+
+    // Set the displacements
+    it.GoToBeginOfLine();
+    for ( unsigned long p = 0; p < rowLength; ++p, ++it )
+      {
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        displacement[ i ] = static_cast<PixelValueType>(
+          transformedPoints[ p ][ i ] - points[ p ][ i ] );
+        }
+      it.Set( displacement );
+      progress.CompletedPixel();
+      }
+    }
+
+} // end GenerateDisplacementsPerRow()
+
+
+/**
+ * Inform pipeline of required output region
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GenerateOutputInformation( void )
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+
+  // get pointer to the output
+  OutputImagePointer outputPtr = this->GetOutput();
+  if ( !outputPtr )
+    {
+    return;
+    }
+
+  outputPtr->SetLargestPossibleRegion( m_OutputRegion );
+  outputPtr->SetSpacing( m_OutputSpacing );
+  outputPtr->SetOrigin( m_OutputOrigin );
+  outputPtr->SetDirection( m_OutputDirection );
+  outputPtr->Allocate();
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * Verify if any of the components has been modified.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+unsigned long
+TransformToDisplacementFieldSource<TOutputImage,TTransformPrecisionType>
+::GetMTime( void ) const
+{
+  unsigned long latestTime = Object::GetMTime();
+
+  if( this->m_Transform )
+    {
+    if( latestTime < this->m_Transform->GetMTime() )
+      {
+      latestTime = this->m_Transform->GetMTime();
+      }
+    }
+
+  return latestTime;
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkTransformToDisplacementFieldSource_txx
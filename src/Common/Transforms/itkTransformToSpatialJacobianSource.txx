@@ -19,6 +19,7 @@ PURPOSE. See the above copyright notices for more information.
 #include "itkAdvancedIdentityTransform.h"
 #include "itkProgressReporter.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
 #include "vnl/vnl_copy.h"
 
 namespace itk
@@ -251,6 +252,14 @@ TransformToSpatialJacobianSource<TOutputImage,TTransformPrecisionType>
   PixelType sjOut;
   const unsigned int nrElements = sj.GetVnlMatrix().size();
 
+  // First try to let the transform evaluate the spatial Jacobians on the
+  // voxel grid, which may be much faster than point by point. This is
+  // done one slice at a time, to limit the memory use.
+  if ( this->GenerateSpatialJacobiansOnGrid( outputRegionForThread, progress ) )
+    {
+    return;
+    }
+
   // Walk the output region
   while ( !it.IsAtEnd() )
   {
@@ -274,6 +283,79 @@ TransformToSpatialJacobianSource<TOutputImage,TTransformPrecisionType>
 } // end NonlinearThreadedGenerateData()
 
 
+/**
+ * Evaluate the spatial Jacobians on the voxel grid, one slice at a time.
+ */
+template <class TOutputImage, class TTransformPrecisionType>
+bool
+TransformToSpatialJacobianSource<TOutputImage,TTransformPrecisionType>
+::GenerateSpatialJacobiansOnGrid(
+  const OutputImageRegionType & outputRegionForThread,
+  ProgressReporter & progress )
+{
+  typedef typename TransformType::InputPointType             InputPointType;
+  typedef typename TransformType::GridIndexToPointMatrixType GridIndexToPointMatrixType;
+  const unsigned int lastDimension = ImageDimension - 1;
+
+  // Get the output pointer
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // The voxel with index i is at origin + direction * spacing * i
+  InputPointType origin;
+  GridIndexToPointMatrixType indexToPoint;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    origin[ i ] = outputPtr->GetOrigin()[ i ];
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      indexToPoint( i, j ) = outputPtr->GetDirection()( i, j )
+        * outputPtr->GetSpacing()[ j ];
+      }
+    }
+
+  OutputImageRegionType sliceRegion = outputRegionForThread;
+  SizeType sliceSize = sliceRegion.GetSize();
+  sliceSize[ lastDimension ] = 1;
+  sliceRegion.SetSize( sliceSize );
+  std::vector< SpatialJacobianType > sjSlice( sliceRegion.GetNumberOfPixels() );
+  if ( sjSlice.empty() )
+    {
+    return false;
+    }
+
+  PixelType sjOut;
+  const unsigned int nrElements = sjSlice[ 0 ].GetVnlMatrix().size();
+
+  const unsigned long numberOfSlices = outputRegionForThread.GetSize()[ lastDimension ];
+  for ( unsigned long s = 0; s < numberOfSlices; ++s )
+    {
+    IndexType sliceIndex = outputRegionForThread.GetIndex();
+    sliceIndex[ lastDimension ] += s;
+    sliceRegion.SetIndex( sliceIndex );
+
+    // Only the first slice can fail, since the grid is the same for all
+    if ( !this->m_Transform->EvaluateOnGrid(
+      origin, indexToPoint, sliceRegion, 0, &sjSlice[ 0 ] ) )
+      {
+      return false;
+      }
+
+    ImageRegionIterator<TOutputImage> sliceIt( outputPtr, sliceRegion );
+    for ( unsigned long p = 0; p < sjSlice.size(); ++p )
+      {
+      vnl_copy( sjSlice[ p ].GetVnlMatrix().begin(), sjOut.GetVnlMatrix().begin(),
+        nrElements );
+      sliceIt.Set( sjOut );
+      progress.CompletedPixel();
+      ++sliceIt;
+      }
+    }
+
+  return true;
+
+} // end GenerateSpatialJacobiansOnGrid()
+
+
 template <class TOutputImage, class TTransformPrecisionType>
 void
 TransformToSpatialJacobianSource<TOutputImage,TTransformPrecisionType>
@@ -0,0 +1,278 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __elxProfiler_CXX_
+#define __elxProfiler_CXX_
+
+#include "elxProfiler.h"
+
+#include <fstream>
+#include <iomanip>
+
+/** Thread-local storage of plain data. */
+#if defined( _MSC_VER )
+#define ELX_THREAD_LOCAL __declspec( thread )
+#else
+#define ELX_THREAD_LOCAL __thread
+#endif
+
+
+namespace tmr
+{
+using namespace itk;
+
+/** The times of the calling thread that are not yet flushed. */
+static ELX_THREAD_LOCAL double        t_Seconds[ Profiler::NumberOfStages ];
+static ELX_THREAD_LOCAL unsigned long t_Calls[ Profiler::NumberOfStages ];
+static ELX_THREAD_LOCAL bool          t_HasTimes = false;
+
+/** The single instance. */
+static Profiler::Pointer              s_ProfilerInstance = 0;
+static SimpleFastMutexLock            s_ProfilerInstanceLock;
+
+bool Profiler::s_Enabled = false;
+
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+Profiler::Profiler()
+{
+  for ( unsigned int i = 0; i < NumberOfStages; ++i )
+  {
+    this->m_Seconds[ i ] = 0.0;
+    this->m_Calls[ i ] = 0;
+  }
+
+} // end Constructor
+
+
+/**
+ * ********************* GetInstance ****************************
+ */
+
+Profiler * Profiler::GetInstance( void )
+{
+  s_ProfilerInstanceLock.Lock();
+  if ( s_ProfilerInstance.IsNull() )
+  {
+    s_ProfilerInstance = new Self;
+    s_ProfilerInstance->UnRegister();
+  }
+  Self * instance = s_ProfilerInstance.GetPointer();
+  s_ProfilerInstanceLock.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ********************* AddTime ****************************
+ */
+
+void Profiler::AddTime( StageType stage, double seconds, unsigned long calls )
+{
+  t_Seconds[ stage ] += seconds;
+  t_Calls[ stage ] += calls;
+  t_HasTimes = true;
+
+} // end AddTime()
+
+
+/**
+ * ********************* FlushThread ****************************
+ */
+
+void Profiler::FlushThread( void )
+{
+  if ( !t_HasTimes ) return;
+
+  Self * profiler = Self::GetInstance();
+  profiler->m_Lock.Lock();
+  for ( unsigned int i = 0; i < NumberOfStages; ++i )
+  {
+    profiler->m_Seconds[ i ] += t_Seconds[ i ];
+    profiler->m_Calls[ i ] += t_Calls[ i ];
+    t_Seconds[ i ] = 0.0;
+    t_Calls[ i ] = 0;
+  }
+  profiler->m_Lock.Unlock();
+  t_HasTimes = false;
+
+} // end FlushThread()
+
+
+/**
+ * ********************* Reset ****************************
+ */
+
+void Profiler::Reset( void )
+{
+  Self::FlushThread();
+
+  this->m_Lock.Lock();
+  for ( unsigned int i = 0; i < NumberOfStages; ++i )
+  {
+    this->m_Seconds[ i ] = 0.0;
+    this->m_Calls[ i ] = 0;
+  }
+  this->m_Lock.Unlock();
+
+} // end Reset()
+
+
+/**
+ * ********************* GetTotals ****************************
+ */
+
+void Profiler::GetTotals( std::vector<double> & seconds,
+  std::vector<unsigned long> & calls )
+{
+  Self::FlushThread();
+
+  seconds.resize( NumberOfStages );
+  calls.resize( NumberOfStages );
+  this->m_Lock.Lock();
+  for ( unsigned int i = 0; i < NumberOfStages; ++i )
+  {
+    seconds[ i ] = this->m_Seconds[ i ];
+    calls[ i ] = this->m_Calls[ i ];
+  }
+  this->m_Lock.Unlock();
+
+} // end GetTotals()
+
+
+/**
+ * ********************* GetStageName ****************************
+ */
+
+const char * Profiler::GetStageName( unsigned int stage )
+{
+  switch ( stage )
+  {
+    case Iteration:           return "Iteration";
+    case CostFunction:        return "CostFunction";
+    case SamplerUpdate:       return "SamplerUpdate";
+    case TransformPoint:      return "TransformPoint";
+    case GetJacobian:         return "GetJacobian";
+    case Interpolation:       return "Interpolation";
+    case MetricAccumulation:  return "MetricAccumulation";
+    case XoutIO:              return "XoutIO";
+    default:                  return "OptimizerStep";
+  }
+
+} // end GetStageName()
+
+
+/**
+ * ********************* GetStageDepth ****************************
+ */
+
+unsigned int Profiler::GetStageDepth( unsigned int stage )
+{
+  switch ( stage )
+  {
+    case Iteration:           return 0;
+    case CostFunction:        return 1;
+    case XoutIO:              return 1;
+    case NumberOfStages:      return 1;
+    default:                  return 2;
+  }
+
+} // end GetStageDepth()
+
+
+/**
+ * ********************* PrintReport ****************************
+ */
+
+void Profiler::PrintReport( std::ostream & os )
+{
+  std::vector<double> seconds;
+  std::vector<unsigned long> calls;
+  this->GetTotals( seconds, calls );
+
+  /** The optimizer step is the part of the iteration that is not spent
+   * in the cost function or in writing the iteration information.
+   */
+  const double optimizerStep = seconds[ Iteration ]
+    - seconds[ CostFunction ] - seconds[ XoutIO ];
+
+  os << "Profile (stages marked with * are summed over threads):\n";
+  os << "  " << std::left << std::setw( 24 ) << "Stage"
+    << std::right << std::setw( 12 ) << "Calls"
+    << std::setw( 14 ) << "Time[ms]"
+    << std::setw( 16 ) << "Time/call[us]" << "\n";
+
+  /** Print the stages, and the optimizer step after the last one. */
+  for ( unsigned int i = 0; i <= NumberOfStages; ++i )
+  {
+    const double time = ( i < NumberOfStages ) ? seconds[ i ] : optimizerStep;
+    const unsigned long n = ( i < NumberOfStages ) ? calls[ i ] : calls[ Iteration ];
+    const bool perSample = i == TransformPoint || i == GetJacobian || i == Interpolation;
+
+    std::string name( 2 * Self::GetStageDepth( i ), ' ' );
+    name += Self::GetStageName( i );
+    if ( perSample ) name += " *";
+
+    os << "  " << std::left << std::setw( 24 ) << name
+      << std::right << std::setw( 12 ) << n
+      << std::setw( 14 ) << std::fixed << std::setprecision( 1 ) << time * 1000.0
+      << std::setw( 16 ) << std::setprecision( 3 )
+      << ( n > 0 ? time * 1.0e6 / static_cast<double>( n ) : 0.0 ) << "\n";
+  }
+  os.unsetf( std::ios::fixed );
+
+} // end PrintReport()
+
+
+/**
+ * ********************* WriteCSV ****************************
+ */
+
+bool Profiler::WriteCSV( const std::string & fileName, unsigned int level )
+{
+  std::ofstream file( fileName.c_str(),
+    level == 0 ? std::ios::out : std::ios::out | std::ios::app );
+  if ( !file.is_open() ) return false;
+
+  std::vector<double> seconds;
+  std::vector<unsigned long> calls;
+  this->GetTotals( seconds, calls );
+  const double optimizerStep = seconds[ Iteration ]
+    - seconds[ CostFunction ] - seconds[ XoutIO ];
+
+  if ( level == 0 )
+  {
+    file << "Resolution,Stage,Depth,Calls,Time[ms]\n";
+  }
+  file << std::setprecision( 6 );
+  for ( unsigned int i = 0; i <= NumberOfStages; ++i )
+  {
+    const double time = ( i < NumberOfStages ) ? seconds[ i ] : optimizerStep;
+    const unsigned long n = ( i < NumberOfStages ) ? calls[ i ] : calls[ Iteration ];
+    file << level << "," << Self::GetStageName( i ) << ","
+      << Self::GetStageDepth( i ) << "," << n << "," << time * 1000.0 << "\n";
+  }
+
+  return true;
+
+} // end WriteCSV()
+
+
+} // end namespace tmr
+
+#endif // end #ifndef __elxProfiler_CXX_
@@ -0,0 +1,188 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __elxProfiler_H_
+#define __elxProfiler_H_
+
+#include "elxTimer.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace tmr
+{
+using namespace itk;
+
+/**
+ * \class Profiler
+ * \brief Accumulates the time spent in the stages of a registration.
+ *
+ * The profiler measures, per stage, the total wall clock time and the
+ * number of calls. The stages form a hierarchy:
+ *
+ * \verbatim
+ * Iteration              time between iterations, measured by the optimizer
+ *   CostFunction         evaluation of the (scaled) cost function
+ *     SamplerUpdate      selection of the image samples
+ *     TransformPoint     mapping of the samples (*)
+ *     GetJacobian        transform Jacobians of the samples (*)
+ *     Interpolation      moving image values and gradients (*)
+ *     MetricAccumulation summation of the per-thread derivatives
+ *   XoutIO               writing the iteration information
+ *   OptimizerStep        the rest of the iteration (computed, not measured)
+ * \endverbatim
+ *
+ * The stages marked with (*) are called per sample, possibly by several
+ * threads at the same time; their times are summed over the threads.
+ *
+ * There is a single instance per process, see GetInstance(). If profiling
+ * is disabled, which is the default, a ProfilerScope costs a single test of
+ * a boolean. If enabled, each thread accumulates its times in thread-local
+ * storage, so without locking. The threads of the multi-threaded metrics
+ * add their times to the totals with FlushThread(), when they finish.
+ *
+ * \ingroup Timer
+ */
+
+class Profiler : public Object
+{
+public:
+  /** Standard ITK-stuff.*/
+  typedef Profiler                    Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer<Self>          Pointer;
+  typedef SmartPointer<const Self>    ConstPointer;
+
+  /** Run-time type information (and related methods).*/
+  itkTypeMacro( Profiler, Object );
+
+  /** The stages that are profiled. */
+  enum StageType
+  {
+    Iteration = 0,
+    CostFunction,
+    SamplerUpdate,
+    TransformPoint,
+    GetJacobian,
+    Interpolation,
+    MetricAccumulation,
+    XoutIO,
+    NumberOfStages
+  };
+
+  /** Get the single instance of this class. */
+  static Self * GetInstance( void );
+
+  /** Enable or disable profiling. Should not be called while other
+   * threads are profiling.
+   */
+  static void SetEnabled( bool enabled ) { s_Enabled = enabled; };
+  static bool GetEnabled( void ) { return s_Enabled; };
+
+  /** Add the time of a number of calls of a stage, in seconds. Thread-safe. */
+  static void AddTime( StageType stage, double seconds, unsigned long calls = 1 );
+
+  /** Add the times of the calling thread to the totals. Thread-safe. */
+  static void FlushThread( void );
+
+  /** Set all times to zero. Also flushes the calling thread. */
+  void Reset( void );
+
+  /** Get the total times in seconds and the numbers of calls of all stages.
+   * Also flushes the calling thread.
+   */
+  void GetTotals( std::vector<double> & seconds,
+    std::vector<unsigned long> & calls );
+
+  /** Get the name and the depth in the hierarchy of a stage. */
+  static const char * GetStageName( unsigned int stage );
+  static unsigned int GetStageDepth( unsigned int stage );
+
+  /** Print a table of all stages, and write it to a CSV file. The CSV file
+   * is truncated if level == 0, and appended to otherwise.
+   */
+  void PrintReport( std::ostream & os );
+  bool WriteCSV( const std::string & fileName, unsigned int level );
+
+protected:
+
+  Profiler();
+  virtual ~Profiler(){};
+
+  /** The totals of all flushed threads. */
+  double                      m_Seconds[ NumberOfStages ];
+  unsigned long               m_Calls[ NumberOfStages ];
+  SimpleFastMutexLock         m_Lock;
+
+private:
+
+  Profiler( const Self& );        // purposely not implemented
+  void operator=( const Self& );  // purposely not implemented
+
+  static bool                 s_Enabled;
+
+}; // end class Profiler
+
+
+/**
+ * \class ProfilerScope
+ * \brief Adds the time between its construction and destruction to a stage
+ * of the Profiler, if profiling is enabled.
+ *
+ * Usage:
+ * \code
+ * {
+ *   tmr::ProfilerScope profilerScope( tmr::Profiler::TransformPoint );
+ *   ...
+ * }
+ * \endcode
+ *
+ * \ingroup Timer
+ */
+
+class ProfilerScope
+{
+public:
+
+  ProfilerScope( Profiler::StageType stage )
+    : m_Stage( stage ), m_Enabled( Profiler::GetEnabled() ), m_StartTime( 0.0 )
+  {
+    if ( this->m_Enabled ) this->m_StartTime = Timer::GetWallClockTime();
+  }
+
+  ~ProfilerScope()
+  {
+    if ( this->m_Enabled )
+    {
+      Profiler::AddTime( this->m_Stage, Timer::GetWallClockTime() - this->m_StartTime );
+    }
+  }
+
+private:
+
+  ProfilerScope( const ProfilerScope & );     // purposely not implemented
+  void operator=( const ProfilerScope & );    // purposely not implemented
+
+  Profiler::StageType m_Stage;
+  bool                m_Enabled;
+  double              m_StartTime;
+
+}; // end class ProfilerScope
+
+
+} // end namespace tmr
+
+
+#endif // end #ifndef __elxProfiler_H_
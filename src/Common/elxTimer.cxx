@@ -16,6 +16,15 @@
 
 #include "elxTimer.h"
 
+/** GCC specific. We can use clock_gettime(). */
+#if defined( __GNUC__ ) && !defined( __APPLE__ )
+#define ELX_USE_CLOCK_GETTIME
+#elif defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
 
 namespace tmr
 {
@@ -34,10 +43,76 @@ Timer::Timer()
   this->m_StartClock = 0;
   this->m_StopTime = 0;
   this->m_StopClock = 0;
+  this->m_ElapsedTime = 0.0;
+  this->m_ElapsedClock = 0;
+  this->m_ElapsedTimeSec = 0;
+  this->m_ElapsedClockSec = 0.0;
+  this->m_StartWallClock = 0.0;
+  this->m_StopWallClock = 0.0;
+  this->m_StartCPUTime = 0.0;
+  this->m_StopCPUTime = 0.0;
+  this->m_ElapsedWallClockSec = 0.0;
+  this->m_ElapsedCPUTimeSec = 0.0;
 
 } // end Constructor
 
 
+/**
+ * ********************** GetWallClockTime ****************************
+ */
+
+double Timer::GetWallClockTime( void )
+{
+#if defined( ELX_USE_CLOCK_GETTIME )
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return static_cast<double>( now.tv_sec ) + static_cast<double>( now.tv_nsec ) / 1.0e9;
+#elif defined( _WIN32 )
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency( &frequency );
+  QueryPerformanceCounter( &now );
+  return static_cast<double>( now.QuadPart ) / static_cast<double>( frequency.QuadPart );
+#else
+  struct timeval now;
+  gettimeofday( &now, 0 );
+  return static_cast<double>( now.tv_sec ) + static_cast<double>( now.tv_usec ) / 1.0e6;
+#endif
+
+} // end GetWallClockTime()
+
+
+/**
+ * ********************** GetCPUTime ****************************
+ */
+
+double Timer::GetCPUTime( void )
+{
+#if defined( ELX_USE_CLOCK_GETTIME )
+  struct timespec now;
+  clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &now );
+  return static_cast<double>( now.tv_sec ) + static_cast<double>( now.tv_nsec ) / 1.0e9;
+#elif defined( _WIN32 )
+  /** The user and kernel times are in units of 100 ns. */
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if ( !GetProcessTimes( GetCurrentProcess(),
+    &creationTime, &exitTime, &kernelTime, &userTime ) )
+  {
+    return 0.0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  return static_cast<double>( kernel.QuadPart + user.QuadPart ) / 1.0e7;
+#else
+  return static_cast<double>( clock() ) / CLOCKS_PER_SEC;
+#endif
+
+} // end GetCPUTime()
+
+
 /**
  * ********************** StartTimer ****************************
  */
@@ -47,10 +122,8 @@ void Timer::StartTimer( void )
   /** Get the current time.*/
   this->m_StartTime = time( '\0' );
   this->m_StartClock = clock();
-
-#ifdef ELX_USE_CLOCK_GETTIME
-  clock_gettime( CLOCK_MONOTONIC, &this->m_StartClockMonotonic );
-#endif
+  this->m_StartWallClock = Self::GetWallClockTime();
+  this->m_StartCPUTime = Self::GetCPUTime();
 
 } // end StartTimer()
 
@@ -67,10 +140,8 @@ int Timer::StopTimer( void )
   /** Get the current time. */
   this->m_StopTime = time( '\0' );
   this->m_StopClock = clock();
-
-#ifdef ELX_USE_CLOCK_GETTIME
-  clock_gettime( CLOCK_MONOTONIC, &this->m_StopClockMonotonic );
-#endif
+  this->m_StopWallClock = Self::GetWallClockTime();
+  this->m_StopCPUTime = Self::GetCPUTime();
 
   /** Get the elapsed time. */
   this->ElapsedClockAndTime();
@@ -96,13 +167,10 @@ int Timer::ElapsedClockAndTime( void )
   /** Fill m_ElapsedTimeSec. */
   this->m_ElapsedTimeSec = static_cast<std::size_t>( this->m_ElapsedTime );
 
-  /** Fill m_ElapsedClockSec. */
-#ifndef ELX_USE_CLOCK_GETTIME
-  this->m_ElapsedClockSec = static_cast<double>( this->m_ElapsedClock ) / CLOCKS_PER_SEC;
-#else
-  this->m_ElapsedClockSec = ( this->m_StopClockMonotonic.tv_sec - this->m_StartClockMonotonic.tv_sec );
-  this->m_ElapsedClockSec += ( this->m_StopClockMonotonic.tv_nsec - this->m_StartClockMonotonic.tv_nsec ) / 1.0e9;
-#endif
+  /** Fill m_ElapsedWallClockSec, m_ElapsedCPUTimeSec and m_ElapsedClockSec. */
+  this->m_ElapsedWallClockSec = this->m_StopWallClock - this->m_StartWallClock;
+  this->m_ElapsedCPUTimeSec = this->m_StopCPUTime - this->m_StartCPUTime;
+  this->m_ElapsedClockSec = this->m_ElapsedWallClockSec;
 
   /** Fill m_TimeDHMS. */
   const std::size_t secondsPerMinute = 60;
@@ -52,12 +52,18 @@ using namespace itk;
  * This class is a wrap around ctime.h. It is used to time the registration,
  * to get the time per iteration, or whatever.
  *
- * For precise timings we use clock() or clock_gettime().
- * On Windows clock_gettime() does not exist. clock() seems to give accurate
- * timings, also on multi-threaded systems.
- * For GCC / linux we use clock_gettime(), since clock() reports erroneous
- * results on linux on multi-threaded systems: it reports the elapsed time
- * multiplied by the number of threads that have been used.
+ * For precise timings the timer measures two clocks:
+ * - the wall clock: a monotonic, high-resolution clock of the real elapsed
+ *   time. For GCC / linux we use clock_gettime( CLOCK_MONOTONIC ), on Windows
+ *   QueryPerformanceCounter(), and gettimeofday() otherwise.
+ * - the CPU clock: the processor time of the process, summed over all its
+ *   threads. For GCC / linux we use clock_gettime( CLOCK_PROCESS_CPUTIME_ID ),
+ *   on Windows GetProcessTimes(), and clock() otherwise.
+ * As soon as the work is done by several threads, the CPU time is larger
+ * than the wall clock time; their ratio is the parallel speed-up.
+ * The ElapsedClockSec equals the ElapsedWallClockSec. Note that clock() itself
+ * can not be used for this, since it reports the CPU time on linux, but the
+ * wall clock time on Windows.
  * Ugly #ifdefs are needed however, and elxCommon requires linking to the
  * library rt, but on linux only.
  *
@@ -105,6 +111,14 @@ public:
   itkGetConstMacro( ElapsedTimeSec, std::size_t );
   itkGetConstMacro( ElapsedClock, double );
   itkGetConstMacro( ElapsedClockSec, double );
+  itkGetConstMacro( ElapsedWallClockSec, double );
+  itkGetConstMacro( ElapsedCPUTimeSec, double );
+
+  /** Get the current time of the wall clock and the CPU clock, in seconds
+   * since an arbitrary, but fixed, moment.
+   */
+  static double GetWallClockTime( void );
+  static double GetCPUTime( void );
 
 protected:
 
@@ -122,12 +136,13 @@ protected:
   std::size_t   m_ElapsedTimeSec;
   double        m_ElapsedClockSec;
 
-  /** GCC specific. We can use clock_gettime(). */
-#if defined( __GNUC__ ) && !defined( __APPLE__ )
-#define ELX_USE_CLOCK_GETTIME
-  struct timespec m_StartClockMonotonic;
-  struct timespec m_StopClockMonotonic;
-#endif
+  /** The wall clock and the CPU clock, in seconds. */
+  double        m_StartWallClock;
+  double        m_StopWallClock;
+  double        m_StartCPUTime;
+  double        m_StopCPUTime;
+  double        m_ElapsedWallClockSec;
+  double        m_ElapsedCPUTimeSec;
 
   /** Strings that serve as output of the Formatted Output Functions */
   std::string m_StartTimeString;
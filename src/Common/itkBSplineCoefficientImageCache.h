@@ -0,0 +1,193 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBSplineCoefficientImageCache_h
+#define __itkBSplineCoefficientImageCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkByteSwapper.h"
+#include "vxl_config.h"
+
+#include <string>
+#include <list>
+
+namespace itk
+{
+
+/** \class BSplineCoefficientImageCache
+ *
+ * \brief A process-wide cache of B-spline coefficient images.
+ *
+ * The BSplineInterpolateImageFunction computes the B-spline coefficients of
+ * its input image with a recursive prefilter, every time SetInputImage() is
+ * called. In elastix this happens at every resolution, in every registration,
+ * and again in transformix, often for the same image. This class stores the
+ * coefficient images, so that the prefilter runs only once per image and
+ * spline order.
+ *
+ * The cache is keyed on the contents of the image: its geometry, a 64-bit
+ * checksum of its pixels, and the spline order. So different image objects
+ * with the same contents share the coefficients, for example the same image
+ * read by several ElastixMain instances in one process, or the same pyramid
+ * level in several registrations.
+ *
+ * There is one instance per coefficient image type, see GetInstance().
+ * The total size of the images kept in memory is bounded; the least recently
+ * used images are removed first. Optionally, the coefficient images are also
+ * written to a directory, from which they are read when they are not in
+ * memory, so that they are reused across processes as well.
+ *
+ * All methods are thread-safe.
+ *
+ * \ingroup ImageFunctions
+ */
+
+template < class TCoefficientImage >
+class BSplineCoefficientImageCache : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef BSplineCoefficientImageCache  Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer<Self>            Pointer;
+  typedef SmartPointer<const Self>      ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BSplineCoefficientImageCache, Object );
+
+  /** Typedefs. */
+  typedef TCoefficientImage                             CoefficientImageType;
+  typedef typename CoefficientImageType::Pointer        CoefficientImagePointer;
+  typedef typename CoefficientImageType::PixelType      CoefficientPixelType;
+
+  /** Get the single instance of this class. */
+  static Self * GetInstance( void );
+
+  /** Set/Get the maximum total size in bytes of the coefficient images
+   * kept in memory. Default: 1 GB.
+   */
+  void SetMaximumMemorySize( unsigned long size );
+  unsigned long GetMaximumMemorySize( void ) const;
+
+  /** Set/Get the directory in which the coefficient images are stored.
+   * If empty, the cache only exists in memory. Default: empty.
+   */
+  void SetCacheDirectory( const std::string & directory );
+  std::string GetCacheDirectory( void ) const;
+
+  /** Get the coefficients of an image for the given spline order. They are
+   * taken from the cache if possible, and otherwise computed with a
+   * BSplineDecompositionImageFilter and added to the cache.
+   * The returned image should not be modified.
+   */
+  template < class TInputImage >
+  CoefficientImagePointer GetCoefficients(
+    const TInputImage * image, unsigned int splineOrder );
+
+  /** Remove all images from memory. Files in the cache directory are kept. */
+  void Clear( void );
+
+protected:
+
+  /** The constructor. */
+  BSplineCoefficientImageCache();
+
+  /** The destructor. */
+  virtual ~BSplineCoefficientImageCache() {};
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream& os, Indent indent ) const;
+
+  /** An image in the cache. */
+  struct CacheEntryType
+  {
+    std::string               st_Key;
+    CoefficientImagePointer   st_Coefficients;
+    unsigned long             st_MemorySize;
+  };
+  typedef std::list< CacheEntryType >                   CacheListType;
+
+  /** Compute the key of an image and spline order. */
+  template < class TInputImage >
+  static std::string ComputeKey(
+    const TInputImage * image, unsigned int splineOrder );
+
+  /** Compute a 64-bit FNV-1a hash of a block of memory. */
+  static vxl_uint_64 ComputeHash( const void * data, unsigned long length,
+    vxl_uint_64 hash );
+
+  /** Look up an image in memory; moves it to the front of the list. */
+  CoefficientImagePointer FindInMemory( const std::string & key );
+
+  /** Add an image to memory, and remove the least recently used images
+   * if the maximum memory size is exceeded.
+   */
+  void AddToMemory( const std::string & key, CoefficientImageType * image );
+
+  /** Get the file name of an image in the cache directory. */
+  std::string GetFileName( const std::string & key ) const;
+
+  /** Read and write images in the cache directory. A file starts with a
+   * text header that holds the key, the byte order and the size of the
+   * coefficients, followed by the raw coefficients. The reader checks that
+   * the header matches the key and the input image.
+   */
+  template < class TInputImage >
+  CoefficientImagePointer ReadFromDisk( const std::string & key,
+    const TInputImage * image ) const;
+  void WriteToDisk( const std::string & key, CoefficientImageType * image ) const;
+
+  /** The first line and the byte order line of the header of a file. */
+  static std::string GetFileHeader( void )
+  {
+    return "ElastixBSplineCoefficientCache 1";
+  };
+  static std::string GetByteOrderLine( void )
+  {
+    return ByteSwapper<int>::SystemIsBigEndian()
+      ? "ByteOrder: MSB" : "ByteOrder: LSB";
+  };
+
+  /** Get the id of this process, for the names of temporary files. */
+  static unsigned long GetProcessId( void );
+
+private:
+
+  BSplineCoefficientImageCache( const Self& );  // purposely not implemented
+  void operator=( const Self& );                // purposely not implemented
+
+  /** The single instance, and the lock that guards its creation. */
+  static Pointer              s_Instance;
+  static SimpleFastMutexLock  s_InstanceLock;
+
+  /** Member variables. */
+  mutable SimpleFastMutexLock m_Lock;
+  CacheListType               m_Cache;
+  unsigned long               m_MemorySize;
+  unsigned long               m_MaximumMemorySize;
+  std::string                 m_CacheDirectory;
+  mutable unsigned long       m_NumberOfWrittenFiles;
+
+}; // end class BSplineCoefficientImageCache
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBSplineCoefficientImageCache.txx"
+#endif
+
+#endif // end #ifndef __itkBSplineCoefficientImageCache_h
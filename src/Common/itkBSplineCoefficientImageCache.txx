@@ -0,0 +1,554 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBSplineCoefficientImageCache_txx
+#define __itkBSplineCoefficientImageCache_txx
+
+#include "itkBSplineCoefficientImageCache.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "itksys/SystemTools.hxx"
+
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  #include <process.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace itk
+{
+
+/**
+ * ********************* Static members ****************************
+ */
+
+template < class TCoefficientImage >
+typename BSplineCoefficientImageCache<TCoefficientImage>::Pointer
+BSplineCoefficientImageCache<TCoefficientImage>::s_Instance = 0;
+
+template < class TCoefficientImage >
+SimpleFastMutexLock
+BSplineCoefficientImageCache<TCoefficientImage>::s_InstanceLock;
+
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template < class TCoefficientImage >
+BSplineCoefficientImageCache<TCoefficientImage>
+::BSplineCoefficientImageCache()
+{
+  this->m_MemorySize = 0;
+  this->m_MaximumMemorySize = 1024ul * 1024ul * 1024ul;
+  this->m_NumberOfWrittenFiles = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* GetInstance ****************************
+ */
+
+template < class TCoefficientImage >
+BSplineCoefficientImageCache<TCoefficientImage> *
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetInstance( void )
+{
+  s_InstanceLock.Lock();
+  if ( s_Instance.IsNull() )
+  {
+    /** No object factory, so that the instance can not be overridden. */
+    s_Instance = new Self;
+    s_Instance->UnRegister();
+  }
+  Self * instance = s_Instance.GetPointer();
+  s_InstanceLock.Unlock();
+
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::PrintSelf( std::ostream& os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  this->m_Lock.Lock();
+  os << indent << "NumberOfImages: " << this->m_Cache.size() << std::endl;
+  os << indent << "MemorySize: " << this->m_MemorySize << std::endl;
+  os << indent << "MaximumMemorySize: " << this->m_MaximumMemorySize << std::endl;
+  os << indent << "CacheDirectory: " << this->m_CacheDirectory << std::endl;
+  this->m_Lock.Unlock();
+
+} // end PrintSelf()
+
+
+/**
+ * ********************* SetMaximumMemorySize ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::SetMaximumMemorySize( unsigned long size )
+{
+  this->m_Lock.Lock();
+  this->m_MaximumMemorySize = size;
+
+  /** Remove the least recently used images that do not fit anymore. */
+  while ( this->m_MemorySize > this->m_MaximumMemorySize && !this->m_Cache.empty() )
+  {
+    this->m_MemorySize -= this->m_Cache.back().st_MemorySize;
+    this->m_Cache.pop_back();
+  }
+  this->m_Lock.Unlock();
+
+} // end SetMaximumMemorySize()
+
+
+/**
+ * ********************* GetMaximumMemorySize ****************************
+ */
+
+template < class TCoefficientImage >
+unsigned long
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetMaximumMemorySize( void ) const
+{
+  this->m_Lock.Lock();
+  const unsigned long size = this->m_MaximumMemorySize;
+  this->m_Lock.Unlock();
+
+  return size;
+
+} // end GetMaximumMemorySize()
+
+
+/**
+ * ********************* SetCacheDirectory ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::SetCacheDirectory( const std::string & directory )
+{
+  this->m_Lock.Lock();
+  this->m_CacheDirectory = directory;
+  this->m_Lock.Unlock();
+
+} // end SetCacheDirectory()
+
+
+/**
+ * ********************* GetCacheDirectory ****************************
+ */
+
+template < class TCoefficientImage >
+std::string
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetCacheDirectory( void ) const
+{
+  this->m_Lock.Lock();
+  const std::string directory = this->m_CacheDirectory;
+  this->m_Lock.Unlock();
+
+  return directory;
+
+} // end GetCacheDirectory()
+
+
+/**
+ * ********************* Clear ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::Clear( void )
+{
+  this->m_Lock.Lock();
+  this->m_Cache.clear();
+  this->m_MemorySize = 0;
+  this->m_Lock.Unlock();
+
+} // end Clear()
+
+
+/**
+ * ********************* GetCoefficients ****************************
+ */
+
+template < class TCoefficientImage >
+template < class TInputImage >
+typename BSplineCoefficientImageCache<TCoefficientImage>::CoefficientImagePointer
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetCoefficients( const TInputImage * image, unsigned int splineOrder )
+{
+  if ( image == 0 ) return 0;
+
+  /** Look in memory. */
+  const std::string key = Self::ComputeKey( image, splineOrder );
+  CoefficientImagePointer coefficients = this->FindInMemory( key );
+  if ( coefficients.IsNotNull() ) return coefficients;
+
+  /** Look in the cache directory. */
+  coefficients = this->ReadFromDisk( key, image );
+  if ( coefficients.IsNotNull() )
+  {
+    this->AddToMemory( key, coefficients );
+    return coefficients;
+  }
+
+  /** Compute the coefficients. This is done without holding the lock, so
+   * that other images can be processed at the same time. If two threads
+   * compute the same image, the last one simply replaces the first.
+   */
+  typedef BSplineDecompositionImageFilter<
+    TInputImage, CoefficientImageType >                 DecompositionFilterType;
+  typename DecompositionFilterType::Pointer decompositionFilter
+    = DecompositionFilterType::New();
+  decompositionFilter->SetSplineOrder( splineOrder );
+  decompositionFilter->SetInput( image );
+  decompositionFilter->Update();
+  coefficients = decompositionFilter->GetOutput();
+  coefficients->DisconnectPipeline();
+
+  this->WriteToDisk( key, coefficients );
+  this->AddToMemory( key, coefficients );
+
+  return coefficients;
+
+} // end GetCoefficients()
+
+
+/**
+ * ********************* ComputeKey ****************************
+ */
+
+template < class TCoefficientImage >
+template < class TInputImage >
+std::string
+BSplineCoefficientImageCache<TCoefficientImage>
+::ComputeKey( const TInputImage * image, unsigned int splineOrder )
+{
+  typedef typename TInputImage::PixelType   InputPixelType;
+
+  /** The spline order, the coefficient type and the geometry. */
+  std::ostringstream key;
+  key << std::setprecision( 17 );
+  key << "order:" << splineOrder
+    << " coefficient:" << sizeof( CoefficientPixelType )
+    << " pixel:" << sizeof( InputPixelType )
+    << " region:" << image->GetBufferedRegion().GetIndex()
+    << image->GetBufferedRegion().GetSize()
+    << " spacing:" << image->GetSpacing()
+    << " origin:" << image->GetOrigin()
+    << " direction:";
+  for ( unsigned int i = 0; i < TInputImage::ImageDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < TInputImage::ImageDimension; ++j )
+    {
+      key << image->GetDirection()[ i ][ j ] << " ";
+    }
+  }
+
+  /** A checksum of the pixel values. */
+  const unsigned long numberOfBytes
+    = image->GetBufferedRegion().GetNumberOfPixels() * sizeof( InputPixelType );
+  const vxl_uint_64 hash = Self::ComputeHash(
+    image->GetBufferPointer(), numberOfBytes, 14695981039346656037ULL );
+  key << " pixels:" << std::hex << hash;
+
+  return key.str();
+
+} // end ComputeKey()
+
+
+/**
+ * ********************* ComputeHash ****************************
+ */
+
+template < class TCoefficientImage >
+vxl_uint_64
+BSplineCoefficientImageCache<TCoefficientImage>
+::ComputeHash( const void * data, unsigned long length, vxl_uint_64 hash )
+{
+  const unsigned char * bytes = static_cast<const unsigned char *>( data );
+  for ( unsigned long i = 0; i < length; ++i )
+  {
+    hash ^= static_cast<vxl_uint_64>( bytes[ i ] );
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+
+} // end ComputeHash()
+
+
+/**
+ * ********************* FindInMemory ****************************
+ */
+
+template < class TCoefficientImage >
+typename BSplineCoefficientImageCache<TCoefficientImage>::CoefficientImagePointer
+BSplineCoefficientImageCache<TCoefficientImage>
+::FindInMemory( const std::string & key )
+{
+  CoefficientImagePointer coefficients = 0;
+
+  this->m_Lock.Lock();
+  typename CacheListType::iterator it = this->m_Cache.begin();
+  for ( ; it != this->m_Cache.end(); ++it )
+  {
+    if ( it->st_Key == key )
+    {
+      coefficients = it->st_Coefficients;
+      this->m_Cache.splice( this->m_Cache.begin(), this->m_Cache, it );
+      break;
+    }
+  }
+  this->m_Lock.Unlock();
+
+  return coefficients;
+
+} // end FindInMemory()
+
+
+/**
+ * ********************* AddToMemory ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::AddToMemory( const std::string & key, CoefficientImageType * image )
+{
+  CacheEntryType entry;
+  entry.st_Key = key;
+  entry.st_Coefficients = image;
+  entry.st_MemorySize = image->GetBufferedRegion().GetNumberOfPixels()
+    * sizeof( CoefficientPixelType );
+
+  this->m_Lock.Lock();
+
+  /** Images that are larger than the cache are not stored. */
+  if ( entry.st_MemorySize > this->m_MaximumMemorySize )
+  {
+    this->m_Lock.Unlock();
+    return;
+  }
+
+  /** Replace an existing entry with the same key. */
+  typename CacheListType::iterator it = this->m_Cache.begin();
+  for ( ; it != this->m_Cache.end(); ++it )
+  {
+    if ( it->st_Key == key )
+    {
+      this->m_MemorySize -= it->st_MemorySize;
+      this->m_Cache.erase( it );
+      break;
+    }
+  }
+
+  /** Remove the least recently used images. */
+  while ( this->m_MemorySize + entry.st_MemorySize > this->m_MaximumMemorySize
+    && !this->m_Cache.empty() )
+  {
+    this->m_MemorySize -= this->m_Cache.back().st_MemorySize;
+    this->m_Cache.pop_back();
+  }
+
+  this->m_Cache.push_front( entry );
+  this->m_MemorySize += entry.st_MemorySize;
+
+  this->m_Lock.Unlock();
+
+} // end AddToMemory()
+
+
+/**
+ * ********************* GetFileName ****************************
+ */
+
+template < class TCoefficientImage >
+std::string
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetFileName( const std::string & key ) const
+{
+  const std::string directory = this->GetCacheDirectory();
+  if ( directory.empty() ) return "";
+
+  /** The file name is a hash of the key. */
+  const vxl_uint_64 hash = Self::ComputeHash(
+    key.c_str(), key.size(), 14695981039346656037ULL );
+  std::ostringstream fileName;
+  fileName << directory << "/BSplineCoefficients_"
+    << std::hex << std::setw( 16 ) << std::setfill( '0' ) << hash << ".bin";
+
+  return fileName.str();
+
+} // end GetFileName()
+
+
+/**
+ * ********************* GetProcessId ****************************
+ */
+
+template < class TCoefficientImage >
+unsigned long
+BSplineCoefficientImageCache<TCoefficientImage>
+::GetProcessId( void )
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  return static_cast<unsigned long>( _getpid() );
+#else
+  return static_cast<unsigned long>( getpid() );
+#endif
+
+} // end GetProcessId()
+
+
+/**
+ * ********************* ReadFromDisk ****************************
+ */
+
+template < class TCoefficientImage >
+template < class TInputImage >
+typename BSplineCoefficientImageCache<TCoefficientImage>::CoefficientImagePointer
+BSplineCoefficientImageCache<TCoefficientImage>
+::ReadFromDisk( const std::string & key, const TInputImage * image ) const
+{
+  const std::string fileName = this->GetFileName( key );
+  if ( fileName.empty() || !itksys::SystemTools::FileExists( fileName.c_str() ) )
+  {
+    return 0;
+  }
+
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if ( !file.is_open() ) return 0;
+
+  /** Check the header. Different keys may have the same file name, so
+   * the full key is compared, not only the geometry.
+   */
+  const unsigned long numberOfBytes
+    = image->GetBufferedRegion().GetNumberOfPixels() * sizeof( CoefficientPixelType );
+  std::string line;
+  std::getline( file, line );
+  if ( line != Self::GetFileHeader() ) return 0;
+  std::getline( file, line );
+  if ( line != "Key: " + key ) return 0;
+  std::getline( file, line );
+  if ( line != Self::GetByteOrderLine() ) return 0;
+  std::getline( file, line );
+  std::ostringstream sizeLine;
+  sizeLine << "NumberOfBytes: " << numberOfBytes;
+  if ( !file || line != sizeLine.str() ) return 0;
+
+  /** The geometry is part of the key, so it is taken from the input image. */
+  CoefficientImagePointer coefficients = CoefficientImageType::New();
+  coefficients->SetRegions( image->GetBufferedRegion() );
+  coefficients->SetSpacing( image->GetSpacing() );
+  coefficients->SetOrigin( image->GetOrigin() );
+  coefficients->SetDirection( image->GetDirection() );
+  coefficients->Allocate();
+  file.read( reinterpret_cast<char *>( coefficients->GetBufferPointer() ),
+    numberOfBytes );
+  if ( !file || static_cast<unsigned long>( file.gcount() ) != numberOfBytes )
+  {
+    itkWarningMacro( << "Could not read " << fileName );
+    return 0;
+  }
+
+  return coefficients;
+
+} // end ReadFromDisk()
+
+
+/**
+ * ********************* WriteToDisk ****************************
+ */
+
+template < class TCoefficientImage >
+void
+BSplineCoefficientImageCache<TCoefficientImage>
+::WriteToDisk( const std::string & key, CoefficientImageType * image ) const
+{
+  const std::string fileName = this->GetFileName( key );
+  if ( fileName.empty() ) return;
+
+  /** Write to a temporary file first, which is renamed when it is complete,
+   * so that other processes never read a partially written file. The name
+   * of the temporary file is unique for this process and this call.
+   */
+  this->m_Lock.Lock();
+  const unsigned long fileNumber = this->m_NumberOfWrittenFiles++;
+  this->m_Lock.Unlock();
+  std::ostringstream temporaryFileNameStream;
+  temporaryFileNameStream << fileName << "." << Self::GetProcessId()
+    << "." << fileNumber << ".tmp";
+  const std::string temporaryFileName = temporaryFileNameStream.str();
+
+  const unsigned long numberOfBytes
+    = image->GetBufferedRegion().GetNumberOfPixels() * sizeof( CoefficientPixelType );
+  std::ofstream file( temporaryFileName.c_str(),
+    std::ios::out | std::ios::binary | std::ios::trunc );
+  if ( file.is_open() )
+  {
+    file << Self::GetFileHeader() << "\n"
+      << "Key: " << key << "\n"
+      << Self::GetByteOrderLine() << "\n"
+      << "NumberOfBytes: " << numberOfBytes << "\n";
+    file.write( reinterpret_cast<const char *>( image->GetBufferPointer() ),
+      numberOfBytes );
+    file.close();
+  }
+  if ( !file )
+  {
+    itkWarningMacro( << "Could not write " << temporaryFileName );
+    itksys::SystemTools::RemoveFile( temporaryFileName.c_str() );
+    return;
+  }
+
+  /** Move the file into place. This is atomic on POSIX systems. On Windows
+   * the rename fails if the file exists, which means that another process
+   * already wrote it with the same key; that file is kept.
+   */
+  if ( std::rename( temporaryFileName.c_str(), fileName.c_str() ) != 0 )
+  {
+    itksys::SystemTools::RemoveFile( temporaryFileName.c_str() );
+    if ( !itksys::SystemTools::FileExists( fileName.c_str() ) )
+    {
+      itkWarningMacro( << "Could not write " << fileName );
+    }
+  }
+
+} // end WriteToDisk()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineCoefficientImageCache_txx
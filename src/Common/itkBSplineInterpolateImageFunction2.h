@@ -0,0 +1,80 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+
+#ifndef __itkBSplineInterpolateImageFunction2_h
+#define __itkBSplineInterpolateImageFunction2_h
+
+#include "itkBSplineInterpolateImageFunction.h"
+
+namespace itk
+{
+
+/** \class BSplineInterpolateImageFunction2
+ * \brief A BSplineInterpolateImageFunction that gives access to its
+ * B-spline coefficients.
+ *
+ * The ITK interpolator keeps its coefficients in a protected member,
+ * without a Get method. This class adds GetCoefficients(), so that the
+ * AdvancedImageToImageMetric can evaluate the spline with the
+ * BSplineValueAndDerivativeKernel. The elastix B-spline interpolators
+ * inherit from this class.
+ *
+ * \ingroup ImageFunctions
+ */
+
+template < class TImageType, class TCoordRep = double, class TCoefficientType = double >
+class BSplineInterpolateImageFunction2
+  : public BSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BSplineInterpolateImageFunction2          Self;
+  typedef BSplineInterpolateImageFunction<
+    TImageType, TCoordRep, TCoefficientType >       Superclass;
+  typedef SmartPointer< Self >                      Pointer;
+  typedef SmartPointer< const Self >                ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BSplineInterpolateImageFunction2, BSplineInterpolateImageFunction );
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass::CoefficientImageType CoefficientImageType;
+
+  /** Get the B-spline coefficients of the input image. These are 0 as long
+   * as no input image is set.
+   */
+  const CoefficientImageType * GetCoefficients( void ) const
+  {
+    return this->m_Coefficients.GetPointer();
+  };
+
+protected:
+
+  BSplineInterpolateImageFunction2() {};
+  virtual ~BSplineInterpolateImageFunction2() {};
+
+private:
+
+  BSplineInterpolateImageFunction2( const Self& ); // purposely not implemented
+  void operator=( const Self& );                   // purposely not implemented
+
+}; // end class BSplineInterpolateImageFunction2
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineInterpolateImageFunction2_h
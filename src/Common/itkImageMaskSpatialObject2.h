@@ -90,6 +90,21 @@ public:
    *  check the name of the class and the current depth */
   virtual bool IsInside( const PointType & point) const;
 
+  /** Compute the transform from world coordinates to image coordinates, as
+   * used by IsInside(), into worldToIndex. Unlike IsInside(), this does not
+   * modify the internal state of this object. Returns false if the
+   * index-to-world transform is not invertible.
+   */
+  bool ComputeWorldToIndexTransform( TransformType * worldToIndex ) const;
+
+  /** Test whether a point is inside, using a world-to-index transform that
+   * was computed by ComputeWorldToIndexTransform(). This method does not
+   * modify this object, so several threads may call it at the same time,
+   * which is not the case for IsInside().
+   */
+  bool IsInsideUsingWorldToIndexTransform( const PointType & point,
+    const TransformType * worldToIndex ) const;
+
   /** Compute axis aligned bounding box from the image mask. The bounding box
    * is returned as an image region. Each call to this function will recompute
    * the region. This function is useful in cases, where you may have a mask image
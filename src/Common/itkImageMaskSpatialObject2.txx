@@ -102,6 +102,52 @@ ImageMaskSpatialObject2< TDimension >
 }
 
 
+/** Compute the world-to-index transform without modifying this object. */
+template< unsigned int TDimension >
+bool
+ImageMaskSpatialObject2< TDimension >
+::ComputeWorldToIndexTransform( TransformType * worldToIndex ) const
+{
+  if ( !worldToIndex )
+  {
+    return false;
+  }
+  return this->GetIndexToWorldTransform()->GetInverse( worldToIndex );
+}
+
+
+/** Test whether a point is inside, without modifying this object. */
+template< unsigned int TDimension >
+bool
+ImageMaskSpatialObject2< TDimension >
+::IsInsideUsingWorldToIndexTransform( const PointType & point,
+  const TransformType * worldToIndex ) const
+{
+  if( !this->GetBounds()->IsInside(point) )
+  {
+    return false;
+  }
+
+  PointType p = worldToIndex->TransformPoint(point);
+
+  IndexType index;
+  for(unsigned int i=0; i<TDimension; i++)
+  {
+    index[i] = static_cast<int>( vnl_math_rnd( p[i] ) );
+  }
+
+  const bool insideBuffer =
+    this->GetImage()->GetBufferedRegion().IsInside( index );
+
+  if( !insideBuffer )
+  {
+    return false;
+  }
+
+  return this->GetImage()->GetPixel(index) != NumericTraits<PixelType>::Zero;
+}
+
+
 /** Return true if the given point is inside the image */
 template< unsigned int TDimension>
 bool
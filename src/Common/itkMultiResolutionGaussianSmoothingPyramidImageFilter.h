@@ -165,6 +165,23 @@ public:
    */
   void SetSchedule( const ScheduleType& schedule );
 
+  /** Set/Get the resolution level that is computed when
+   * ComputeOnlyForCurrentLevel is true. Default: 0.
+   */
+  itkSetMacro( CurrentLevel, unsigned int );
+  itkGetConstMacro( CurrentLevel, unsigned int );
+
+  /** Set/Get whether only the output of the current level is computed.
+   * The outputs of the other levels are left empty, which reduces the memory
+   * consumption when the levels are processed one at a time. If the schedule
+   * of the next level equals the schedule of the current level, the output
+   * is kept, so that it can be reused for the next level without smoothing
+   * again. Default: false.
+   */
+  itkSetMacro( ComputeOnlyForCurrentLevel, bool );
+  itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
+  itkBooleanMacro( ComputeOnlyForCurrentLevel );
+
   /** Set spacing etc. */
   virtual void GenerateOutputInformation();
 
@@ -194,11 +211,27 @@ protected:
    * because it uses internally a filter that does this. */
   virtual void EnlargeOutputRequestedRegion(DataObject *output);
 
+  /** Graft the output that was kept by KeepOutputForNextLevel() onto the
+   * output of the current level. Returns false if no valid output was kept.
+   */
+  virtual bool GraftKeptOutput( void );
+
+  /** Keep the output of the current level, if the next level has the same
+   * schedule.
+   */
+  virtual void KeepOutputForNextLevel( void );
+
 
 private:
   MultiResolutionGaussianSmoothingPyramidImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
+  unsigned int        m_CurrentLevel;
+  bool                m_ComputeOnlyForCurrentLevel;
+  OutputImagePointer  m_KeptOutput;
+  unsigned int        m_KeptLevel;
+  unsigned long       m_KeptInputMTime;
+
 };
 
 
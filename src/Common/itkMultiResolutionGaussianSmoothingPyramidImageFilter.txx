@@ -51,6 +51,11 @@ template <class TInputImage, class TOutputImage>
 MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
 ::MultiResolutionGaussianSmoothingPyramidImageFilter()
 {
+  this->m_CurrentLevel = 0;
+  this->m_ComputeOnlyForCurrentLevel = false;
+  this->m_KeptOutput = 0;
+  this->m_KeptLevel = 0;
+  this->m_KeptInputMTime = 0;
 }
 
 
@@ -96,6 +101,32 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
   // Get the input and output pointers
   InputImageConstPointer  inputPtr = this->GetInput();
 
+  /** Determine the levels to compute: all, or only the current level. */
+  unsigned int firstLevel = 0;
+  unsigned int endLevel = this->m_NumberOfLevels;
+  if ( this->m_ComputeOnlyForCurrentLevel )
+  {
+    if ( this->m_CurrentLevel >= this->m_NumberOfLevels )
+    {
+      itkExceptionMacro( << "CurrentLevel (" << this->m_CurrentLevel
+        << ") should be smaller than NumberOfLevels ("
+        << this->m_NumberOfLevels << ")" );
+    }
+    firstLevel = this->m_CurrentLevel;
+    endLevel = this->m_CurrentLevel + 1;
+
+    /** Reuse the output of the previous level, if it has the same schedule. */
+    if ( this->GraftKeptOutput() )
+    {
+      this->KeepOutputForNextLevel();
+      return;
+    }
+  }
+  else
+  {
+    this->m_KeptOutput = 0;
+  }
+
   // Create caster and smoother  filters
   typedef CastImageFilter<InputImageType, OutputImageType> CasterType;
   typedef RecursiveGaussianImageFilter<OutputImageType, OutputImageType> SmootherType;
@@ -136,11 +167,11 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
   double       stdev[ImageDimension];
   SpacingType spacing = inputPtr->GetSpacing();
 
-  for( ilevel = 0; ilevel < this->m_NumberOfLevels; ilevel++ )
+  for( ilevel = firstLevel; ilevel < endLevel; ilevel++ )
   {
 
-    this->UpdateProgress( static_cast<float>( ilevel ) /
-                          static_cast<float>( this->m_NumberOfLevels ) );
+    this->UpdateProgress( static_cast<float>( ilevel - firstLevel ) /
+                          static_cast<float>( endLevel - firstLevel ) );
 
     // Allocate memory for each output
     OutputImagePointer outputPtr = this->GetOutput( ilevel );
@@ -203,6 +234,69 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
 
   } // for ilevel...
 
+  if ( this->m_ComputeOnlyForCurrentLevel )
+  {
+    this->KeepOutputForNextLevel();
+  }
+
+}
+
+
+/*
+ * Graft the kept output of the previous level
+ */
+template <class TInputImage, class TOutputImage>
+bool
+MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
+::GraftKeptOutput( void )
+{
+  /** The kept output is only valid for the level directly following the
+   * level it was computed for, and only if the input has not changed.
+   */
+  if ( this->m_KeptOutput.IsNull()
+    || this->m_KeptLevel + 1 != this->m_CurrentLevel
+    || this->m_KeptInputMTime != this->GetInput()->GetMTime() )
+  {
+    this->m_KeptOutput = 0;
+    return false;
+  }
+
+  this->GraftNthOutput( this->m_CurrentLevel, this->m_KeptOutput );
+  this->m_KeptOutput = 0;
+  return true;
+}
+
+
+/*
+ * Keep the output of the current level for the next level
+ */
+template <class TInputImage, class TOutputImage>
+void
+MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
+::KeepOutputForNextLevel( void )
+{
+  this->m_KeptOutput = 0;
+
+  const unsigned int level = this->m_CurrentLevel;
+  if ( level + 1 >= this->m_NumberOfLevels )
+  {
+    return;
+  }
+  for ( unsigned int idim = 0; idim < ImageDimension; idim++ )
+  {
+    if ( this->m_Schedule[ level + 1 ][ idim ] != this->m_Schedule[ level ][ idim ] )
+    {
+      return;
+    }
+  }
+
+  /** Share the buffer of the output, so that it survives a ReleaseData()
+   * of the output at the end of the current level.
+   */
+  this->m_KeptOutput = OutputImageType::New();
+  this->m_KeptOutput->Graft( this->GetOutput( level ) );
+  this->m_KeptLevel = level;
+  this->m_KeptInputMTime = this->GetInput()->GetMTime();
 }
 
 
@@ -215,6 +309,9 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
+  os << indent << "ComputeOnlyForCurrentLevel: "
+    << this->m_ComputeOnlyForCurrentLevel << std::endl;
 }
 
 
@@ -110,12 +110,14 @@ public:
 
   /**  Type of the Fixed image. */
   typedef          TFixedImage                        FixedImageType;
+  typedef typename FixedImageType::Pointer            FixedImagePointer;
   typedef typename FixedImageType::ConstPointer       FixedImageConstPointer;
   typedef typename FixedImageType::RegionType         FixedImageRegionType;
   typedef std::vector<FixedImageRegionType>           FixedImageRegionPyramidType;
 
   /**  Type of the Moving image. */
   typedef          TMovingImage                       MovingImageType;
+  typedef typename MovingImageType::Pointer           MovingImagePointer;
   typedef typename MovingImageType::ConstPointer      MovingImageConstPointer;
 
   /**  Type of the metric. */
@@ -209,6 +211,18 @@ public:
   /** Get the current resolution level being processed. */
   itkGetMacro( CurrentLevel, unsigned long );
 
+  /** Set/Get whether the pyramid images are computed per resolution level,
+   * just before the level is optimised, instead of all levels at once before
+   * the first level. The images of a level are released when the level
+   * finishes, so at most about two levels are in memory at the same time.
+   * This is supported by the MultiResolutionGaussianSmoothingPyramidImageFilter
+   * and the MultiResolutionShrinkPyramidImageFilter; other pyramids still
+   * compute all levels at once. Default: false.
+   */
+  itkSetMacro( ComputePyramidImagesPerResolution, bool );
+  itkGetConstMacro( ComputePyramidImagesPerResolution, bool );
+  itkBooleanMacro( ComputePyramidImagesPerResolution );
+
   /** Set/Get the initial transformation parameters. */
   itkSetMacro( InitialTransformParameters, ParametersType );
   itkGetConstReferenceMacro( InitialTransformParameters, ParametersType );
@@ -263,6 +277,23 @@ protected:
   /** Compute the size of the fixed region for each level of the pyramid. */
   virtual void PreparePyramids( void );
 
+  /** Compute the pyramid images of the current level, when
+   * ComputePyramidImagesPerResolution is true. The images are disconnected
+   * from the pyramids, so that updating them in the metric or the image
+   * sampler does not trigger a recomputation of the pyramids.
+   */
+  virtual void UpdatePyramidsForCurrentLevel( void );
+
+  /** Release the pyramid images of the current level. */
+  virtual void ReleasePyramidsOfCurrentLevel( void );
+
+  /** Let a pyramid compute only the given level, if it supports this.
+   * Returns false if the pyramid always computes all levels.
+   */
+  template < class TPyramid >
+  static bool SetPyramidComputeOnlyForCurrentLevel( TPyramid * pyramid,
+    const bool computeOnlyForCurrentLevel, const unsigned long level );
+
   /** Set the current level to be processed. */
   itkSetMacro( CurrentLevel, unsigned long );
 
@@ -297,6 +328,10 @@ private:
   unsigned long                    m_NumberOfLevels;
   unsigned long                    m_CurrentLevel;
 
+  bool                             m_ComputePyramidImagesPerResolution;
+  FixedImagePointer                m_FixedImageAtCurrentLevel;
+  MovingImagePointer               m_MovingImageAtCurrentLevel;
+
 }; // end class MultiResolutionImageRegistrationMethod2
 
 
@@ -37,6 +37,8 @@
 
 #include "itkMultiResolutionImageRegistrationMethod2.h"
 #include "itkRecursiveMultiResolutionPyramidImageFilter.h"
+#include "itkMultiResolutionGaussianSmoothingPyramidImageFilter.h"
+#include "itkMultiResolutionShrinkPyramidImageFilter.h"
 #include "itkContinuousIndex.h"
 #include "vnl/vnl_math.h"
 
@@ -69,6 +71,10 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
 
   this->m_Stop = false;
 
+  this->m_ComputePyramidImagesPerResolution = false;
+  this->m_FixedImageAtCurrentLevel = 0;
+  this->m_MovingImageAtCurrentLevel = 0;
+
   this->m_InitialTransformParameters = ParametersType(0);
   this->m_InitialTransformParametersOfNextLevel = ParametersType(0);
   this->m_LastTransformParameters = ParametersType(0);
@@ -118,8 +124,16 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
     }
 
   // Setup the metric
-  this->m_Metric->SetMovingImage( this->m_MovingImagePyramid->GetOutput(this->m_CurrentLevel) );
-  this->m_Metric->SetFixedImage( this->m_FixedImagePyramid->GetOutput(this->m_CurrentLevel) );
+  if ( this->m_ComputePyramidImagesPerResolution )
+    {
+    this->m_Metric->SetMovingImage( this->m_MovingImageAtCurrentLevel );
+    this->m_Metric->SetFixedImage( this->m_FixedImageAtCurrentLevel );
+    }
+  else
+    {
+    this->m_Metric->SetMovingImage( this->m_MovingImagePyramid->GetOutput(this->m_CurrentLevel) );
+    this->m_Metric->SetFixedImage( this->m_FixedImagePyramid->GetOutput(this->m_CurrentLevel) );
+    }
   this->m_Metric->SetTransform( this->m_Transform );
   this->m_Metric->SetInterpolator( this->m_Interpolator );
   this->m_Metric->SetFixedImageRegion( this->m_FixedImageRegionPyramid[ this->m_CurrentLevel ] );
@@ -196,15 +210,32 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
     itkExceptionMacro(<<"Moving image pyramid is not present");
     }
 
-  // Setup the fixed image pyramid
+  // Setup the fixed image pyramid. When the pyramid images are computed
+  // per resolution, only the output information is needed here.
   this->m_FixedImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
   this->m_FixedImagePyramid->SetInput( this->m_FixedImage );
-  this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  if ( SetPyramidComputeOnlyForCurrentLevel( this->m_FixedImagePyramid.GetPointer(),
+    this->m_ComputePyramidImagesPerResolution, 0 ) )
+  {
+    this->m_FixedImagePyramid->UpdateOutputInformation();
+  }
+  else
+  {
+    this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
+  }
 
   // Setup the moving image pyramid
   this->m_MovingImagePyramid->SetNumberOfLevels( this->m_NumberOfLevels );
   this->m_MovingImagePyramid->SetInput( this->m_MovingImage );
-  this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
+  if ( SetPyramidComputeOnlyForCurrentLevel( this->m_MovingImagePyramid.GetPointer(),
+    this->m_ComputePyramidImagesPerResolution, 0 ) )
+  {
+    this->m_MovingImagePyramid->UpdateOutputInformation();
+  }
+  else
+  {
+    this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
+  }
 
   typedef typename FixedImageRegionType::SizeType         SizeType;
   typedef typename FixedImageRegionType::IndexType        IndexType;
@@ -270,6 +301,93 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
 } // end PreparePyramids()
 
 
+/*
+ * Let a pyramid compute only the given level
+ */
+template < typename TFixedImage, typename TMovingImage >
+template < class TPyramid >
+bool
+MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
+::SetPyramidComputeOnlyForCurrentLevel( TPyramid * pyramid,
+  const bool computeOnlyForCurrentLevel, const unsigned long level )
+{
+  typedef typename TPyramid::InputImageType     InputImageType;
+  typedef typename TPyramid::OutputImageType    OutputImageType;
+  typedef MultiResolutionGaussianSmoothingPyramidImageFilter<
+    InputImageType, OutputImageType >           SmoothingPyramidType;
+  typedef MultiResolutionShrinkPyramidImageFilter<
+    InputImageType, OutputImageType >           ShrinkPyramidType;
+
+  SmoothingPyramidType * smoothingPyramid
+    = dynamic_cast<SmoothingPyramidType *>( pyramid );
+  if ( smoothingPyramid )
+  {
+    smoothingPyramid->SetComputeOnlyForCurrentLevel( computeOnlyForCurrentLevel );
+    smoothingPyramid->SetCurrentLevel( level );
+    return computeOnlyForCurrentLevel;
+  }
+
+  ShrinkPyramidType * shrinkPyramid
+    = dynamic_cast<ShrinkPyramidType *>( pyramid );
+  if ( shrinkPyramid )
+  {
+    shrinkPyramid->SetComputeOnlyForCurrentLevel( computeOnlyForCurrentLevel );
+    shrinkPyramid->SetCurrentLevel( level );
+    return computeOnlyForCurrentLevel;
+  }
+
+  return false;
+
+} // end SetPyramidComputeOnlyForCurrentLevel()
+
+
+/*
+ * Compute the pyramid images of the current level
+ */
+template < typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
+::UpdatePyramidsForCurrentLevel( void )
+{
+  const unsigned long level = this->m_CurrentLevel;
+
+  // Pyramids that do not support this already computed all levels
+  // in PreparePyramids(), so then the update does nothing.
+  SetPyramidComputeOnlyForCurrentLevel(
+    this->m_FixedImagePyramid.GetPointer(), true, level );
+  SetPyramidComputeOnlyForCurrentLevel(
+    this->m_MovingImagePyramid.GetPointer(), true, level );
+  this->m_FixedImagePyramid->GetOutput( level )->UpdateLargestPossibleRegion();
+  this->m_MovingImagePyramid->GetOutput( level )->UpdateLargestPossibleRegion();
+
+  // Share the buffers in images without a source.
+  this->m_FixedImageAtCurrentLevel = FixedImageType::New();
+  this->m_FixedImageAtCurrentLevel->Graft(
+    this->m_FixedImagePyramid->GetOutput( level ) );
+  this->m_MovingImageAtCurrentLevel = MovingImageType::New();
+  this->m_MovingImageAtCurrentLevel->Graft(
+    this->m_MovingImagePyramid->GetOutput( level ) );
+
+} // end UpdatePyramidsForCurrentLevel()
+
+
+/*
+ * Release the pyramid images of the current level
+ */
+template < typename TFixedImage, typename TMovingImage >
+void
+MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
+::ReleasePyramidsOfCurrentLevel( void )
+{
+  this->m_FixedImageAtCurrentLevel = 0;
+  this->m_MovingImageAtCurrentLevel = 0;
+
+  this->m_FixedImagePyramid->GetOutput( this->m_CurrentLevel )->ReleaseData();
+  this->m_MovingImagePyramid->GetOutput( this->m_CurrentLevel )->ReleaseData();
+
+} // end ReleasePyramidsOfCurrentLevel()
+
+
 /*
  * Starts the Registration Process
  */
@@ -304,6 +422,13 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
           this->m_CurrentLevel++ )
       {
 
+      // Compute the pyramid images of this level, if they are
+      // computed per resolution.
+      if ( this->m_ComputePyramidImagesPerResolution )
+        {
+        this->UpdatePyramidsForCurrentLevel();
+        }
+
       // Invoke an iteration event.
       // This allows a UI to reset any of the components between
       // resolution level.
@@ -356,10 +481,7 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
         }
 
       // Remove pyramid output of current level to release memory
-      this->m_FixedImagePyramid->GetOutput( this->m_CurrentLevel )
-        ->ReleaseData();
-      this->m_MovingImagePyramid->GetOutput( this->m_CurrentLevel )
-        ->ReleaseData();
+      this->ReleasePyramidsOfCurrentLevel();
       }
     }
 
@@ -388,6 +510,8 @@ MultiResolutionImageRegistrationMethod2<TFixedImage,TMovingImage>
 
   os << indent << "NumberOfLevels: " << this->m_NumberOfLevels << std::endl;
   os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
+  os << indent << "ComputePyramidImagesPerResolution: "
+    << this->m_ComputePyramidImagesPerResolution << std::endl;
 
   os << indent << "InitialTransformParameters: "
     << this->m_InitialTransformParameters << std::endl;
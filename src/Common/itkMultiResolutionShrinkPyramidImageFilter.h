@@ -70,6 +70,21 @@ public:
   /** Overwrite the Superclass implementation: no padding required. */
   virtual void GenerateInputRequestedRegion( void );
 
+  /** Set/Get the resolution level that is computed when
+   * ComputeOnlyForCurrentLevel is true. Default: 0.
+   */
+  itkSetMacro( CurrentLevel, unsigned int );
+  itkGetConstMacro( CurrentLevel, unsigned int );
+
+  /** Set/Get whether only the output of the current level is computed.
+   * The outputs of the other levels are left empty. If the schedule of the
+   * next level equals the schedule of the current level, the output is kept
+   * and reused for the next level. Default: false.
+   */
+  itkSetMacro( ComputeOnlyForCurrentLevel, bool );
+  itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
+  itkBooleanMacro( ComputeOnlyForCurrentLevel );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(SameDimensionCheck,
@@ -80,16 +95,32 @@ public:
 #endif
 
 protected:
-  MultiResolutionShrinkPyramidImageFilter() {};
+  MultiResolutionShrinkPyramidImageFilter();
   ~MultiResolutionShrinkPyramidImageFilter() {};
 
   /** Generate the output data. */
   virtual void GenerateData( void );
 
+  /** Graft the output that was kept by KeepOutputForNextLevel() onto the
+   * output of the current level. Returns false if no valid output was kept.
+   */
+  virtual bool GraftKeptOutput( void );
+
+  /** Keep the output of the current level, if the next level has the same
+   * schedule.
+   */
+  virtual void KeepOutputForNextLevel( void );
+
 private:
   MultiResolutionShrinkPyramidImageFilter(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
+  unsigned int        m_CurrentLevel;
+  bool                m_ComputeOnlyForCurrentLevel;
+  OutputImagePointer  m_KeptOutput;
+  unsigned int        m_KeptLevel;
+  unsigned long       m_KeptInputMTime;
+
 };
 
 
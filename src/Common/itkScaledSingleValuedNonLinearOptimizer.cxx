@@ -29,6 +29,7 @@ ScaledSingleValuedNonLinearOptimizer
 {
   this->m_Maximize = false;
   this->m_ScaledCostFunction = ScaledCostFunctionType::New();
+  this->m_ParallelCostFunctionEvaluator = ParallelCostFunctionEvaluatorType::New();
 
 } // end Constructor
 
@@ -104,6 +105,40 @@ ScaledSingleValuedNonLinearOptimizer
 } // end GetScaledValue()
 
 
+/**
+ * ********************* GetScaledValues *****************************
+ */
+
+void
+ScaledSingleValuedNonLinearOptimizer
+::GetScaledValues(
+  const ParallelCostFunctionEvaluatorType::ParametersContainerType & parameters,
+  ParallelCostFunctionEvaluatorType::MeasureContainerType & values,
+  ParallelCostFunctionEvaluatorType::ExceptionContainerType & exceptions ) const
+{
+  /** The evaluators are not scaled, so unscale the positions: x = y/s. */
+  ParallelCostFunctionEvaluatorType::ParametersContainerType unscaledParameters( parameters );
+  for ( unsigned int k = 0; k < unscaledParameters.size(); ++k )
+  {
+    this->m_ScaledCostFunction->ConvertScaledToUnscaledParameters(
+      unscaledParameters[ k ] );
+  }
+
+  this->m_ParallelCostFunctionEvaluator->GetValues(
+    unscaledParameters, values, exceptions );
+
+  /** Negate the values, like the scaled cost function does. */
+  if ( this->m_ScaledCostFunction->GetNegateCostFunction() )
+  {
+    for ( unsigned int k = 0; k < values.size(); ++k )
+    {
+      values[ k ] = -values[ k ];
+    }
+  }
+
+} // end GetScaledValues()
+
+
 /**
  * ********************* GetScaledDerivative *****************************
  */
@@ -17,6 +17,7 @@
 
 #include "itkSingleValuedNonLinearOptimizer.h"
 #include "itkScaledSingleValuedCostFunction.h"
+#include "itkParallelCostFunctionEvaluator.h"
 
 namespace itk
 {
@@ -54,6 +55,11 @@ namespace itk
    * So, if you want a scaling s, you must call SetScales(\f$s.*s\f$) (where .*
    * symbolises the element-wise product of \f$s\f$ with \f$s\f$)
    *
+   * Optimizers that evaluate the cost function at several independent
+   * positions at once, may use GetScaledValues(), which evaluates them
+   * concurrently if the ParallelCostFunctionEvaluator has been given
+   * evaluators; see GetUseConcurrentEvaluation().
+   *
    */
 
   class ScaledSingleValuedNonLinearOptimizer :
@@ -84,6 +90,8 @@ namespace itk
     typedef ScaledSingleValuedCostFunction        ScaledCostFunctionType;
     typedef ScaledCostFunctionType::Pointer       ScaledCostFunctionPointer;
 
+    typedef ParallelCostFunctionEvaluator         ParallelCostFunctionEvaluatorType;
+
     /** Configure the scaled cost function. This function
      * sets the current scales in the ScaledCostFunction.
      * NB: it assumes that the scales entered by the user
@@ -121,6 +129,18 @@ namespace itk
     virtual void SetMaximize( bool _arg );
     itkGetConstMacro( Maximize, bool );
 
+    /** Get the object that evaluates the cost function concurrently.
+     * Set its evaluators to enable the concurrent evaluation; they should
+     * be independent copies of the unscaled cost function.
+     */
+    itkGetObjectMacro( ParallelCostFunctionEvaluator, ParallelCostFunctionEvaluatorType );
+
+    /** Whether GetScaledValues() evaluates the positions concurrently. */
+    virtual bool GetUseConcurrentEvaluation( void ) const
+    {
+      return this->m_ParallelCostFunctionEvaluator->GetUseConcurrentEvaluation();
+    }
+
   protected:
 
     /** The constructor. */
@@ -134,6 +154,7 @@ namespace itk
     /** Member variables. */
     ParametersType                  m_ScaledCurrentPosition;
     ScaledCostFunctionPointer       m_ScaledCostFunction;
+    ParallelCostFunctionEvaluatorType::Pointer  m_ParallelCostFunctionEvaluator;
 
     /** Set m_ScaledCurrentPosition. */
     virtual void SetScaledCurrentPosition( const ParametersType & parameters );
@@ -171,6 +192,16 @@ namespace itk
       MeasureType & value,
       DerivativeType & derivative ) const;
 
+    /** Compute the values at several (scaled) positions, concurrently, by
+     * the evaluators of the ParallelCostFunctionEvaluator. An exception thrown
+     * for one position is stored in exceptions; see
+     * ParallelCostFunctionEvaluator::GetValues().
+     */
+    virtual void GetScaledValues(
+      const ParallelCostFunctionEvaluatorType::ParametersContainerType & parameters,
+      ParallelCostFunctionEvaluatorType::MeasureContainerType & values,
+      ParallelCostFunctionEvaluatorType::ExceptionContainerType & exceptions ) const;
+
   private:
 
     /** The private constructor. */
@@ -28,8 +28,8 @@ using namespace itk;
    * \brief An interpolator based on the itk::ImageRandomCoordinateSampler.
    *
    * This image sampler randomly samples 'NumberOfSamples' coordinates in
-   * the InputImageRegion. If a mask is given, the sampler tries to find
-   * samples within the mask. If the mask is very sparse, this may take some time.
+   * the InputImageRegion. If a mask is given, the samples are by default drawn
+   * directly from the voxels inside the mask, see UseDirectMaskSampling.
    * The RandomCoordinate sampler samples not only positions that correspond
    * to voxels, but also positions between voxels. An interpolator for the fixed image is thus
    * required. A B-spline interpolator is used, the order of which can be specified
@@ -64,6 +64,13 @@ using namespace itk;
    *    and in the second resolution 30mm.\n
    *    Default: sampleRegionSize[i] = min ( fixedImageSize[i], max_i ( fixedImageSize[i]/3 ) ),
    *    with fixedImageSize in mm. So, approximately 1/3 of the fixed image size.
+   * \parameter UseDirectMaskSampling: Defines whether, in case of a fixed image mask,
+   *    samples are drawn directly from the voxels inside the mask. If set to "false",
+   *    random coordinates in the bounding box of the mask are tried until one is found
+   *    inside the mask, which may take some time for sparse masks. Direct sampling
+   *    is not used in combination with UseRandomSampleRegion.\n
+   *    example: <tt>(UseDirectMaskSampling "false")</tt>\n
+   *    Default: true. The parameter can be specified for each resolution.
    * \parameter FixedImageBSplineInterpolationOrder: When using a RandomCoordinate sampler,
    *    the fixed image needs to be interpolated. This is done using a B-spline interpolator.
    *    With this option you can specify the order of interpolation.\n
@@ -54,6 +54,12 @@ namespace elastix
       "UseRandomSampleRegion", this->GetComponentLabel(), level, 0);
     this->SetUseRandomSampleRegion( useRandomSampleRegion );
 
+    /** Set the UseDirectMaskSampling bool. */
+    bool useDirectMaskSampling = true;
+    this->GetConfiguration()->ReadParameter( useDirectMaskSampling,
+      "UseDirectMaskSampling", this->GetComponentLabel(), level, 0 );
+    this->SetUseDirectMaskSampling( useDirectMaskSampling );
+
     /** Set the SampleRegionSize. */
     if ( useRandomSampleRegion )
     {
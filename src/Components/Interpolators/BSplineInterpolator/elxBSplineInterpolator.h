@@ -15,7 +15,8 @@
 #ifndef __elxBSplineInterpolator_h
 #define __elxBSplineInterpolator_h
 
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction2.h"
+#include "itkBSplineCoefficientImageCache.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -41,6 +42,16 @@ using namespace itk;
    *    example: <tt>(BSplineInterpolationOrder 3 2 3)</tt> \n
    *    The default order is 1. The parameter can be specified for each resolution.\n
    *    If only given for one resolution, that value is used for the other resolutions as well.
+   * \parameter UseBSplineCoefficientCache: whether the B-spline coefficients of the moving
+   *    image are taken from a cache that is shared by all registrations in this process. \n
+   *    The coefficients are then computed only once per image, pyramid level and spline order,
+   *    at the cost of keeping them in memory (at most 1 GB in total). \n
+   *    example: <tt>(UseBSplineCoefficientCache "true")</tt> \n
+   *    The default is "false".
+   * \parameter BSplineCoefficientCacheDirectory: a directory in which the cached coefficients
+   *    are stored, so that they are reused by later elastix and transformix runs. \n
+   *    example: <tt>(BSplineCoefficientCacheDirectory "/tmp/coefficients")</tt> \n
+   *    Only used when UseBSplineCoefficientCache is "true". By default the cache is only kept in memory.
    *
    * \ingroup Interpolators
    */
@@ -48,7 +59,7 @@ using namespace itk;
   template < class TElastix >
     class BSplineInterpolator :
     public
-      BSplineInterpolateImageFunction<
+      BSplineInterpolateImageFunction2<
         ITK_TYPENAME InterpolatorBase<TElastix>::InputImageType,
         ITK_TYPENAME InterpolatorBase<TElastix>::CoordRepType,
         double > , //CoefficientType
@@ -59,7 +70,7 @@ using namespace itk;
 
     /** Standard ITK-stuff. */
     typedef BSplineInterpolator                 Self;
-    typedef BSplineInterpolateImageFunction<
+    typedef BSplineInterpolateImageFunction2<
       typename InterpolatorBase<TElastix>::InputImageType,
       typename InterpolatorBase<TElastix>::CoordRepType,
       double >                                  Superclass1;
@@ -95,6 +106,10 @@ using namespace itk;
     typedef typename Superclass1::CoefficientFilterPointer  CoefficientFilterPointer;
     typedef typename Superclass1::CovariantVectorType       CovariantVectorType;
 
+    /** Typedef for the coefficient cache. */
+    typedef BSplineCoefficientImageCache<
+      CoefficientImageType >                                CoefficientImageCacheType;
+
     /** Typedefs inherited from Elastix. */
     typedef typename Superclass2::ElastixType               ElastixType;
     typedef typename Superclass2::ElastixPointer            ElastixPointer;
@@ -109,10 +124,15 @@ using namespace itk;
      */
     virtual void BeforeEachResolution( void );
 
+    /** Set the input image. If the coefficient cache is used, the
+     * coefficients are taken from the cache instead of being recomputed.
+     */
+    virtual void SetInputImage( const InputImageType * inputData );
+
   protected:
 
     /** The constructor. */
-    BSplineInterpolator() {}
+    BSplineInterpolator();
     /** The destructor. */
     virtual ~BSplineInterpolator() {}
 
@@ -123,6 +143,9 @@ using namespace itk;
     /** The private copy constructor. */
     void operator=( const Self& );      // purposely not implemented
 
+    /** Whether to use the coefficient cache. */
+    bool m_UseCoefficientCache;
+
   }; // end class BSplineInterpolator
 
 
@@ -22,6 +22,19 @@ namespace elastix
 using namespace itk;
 
 
+/**
+ * ***************** Constructor ***********************
+ */
+
+template <class TElastix>
+BSplineInterpolator<TElastix>
+::BSplineInterpolator()
+{
+  this->m_UseCoefficientCache = false;
+
+} // end Constructor
+
+
 /**
  * ***************** BeforeEachResolution ***********************
  */
@@ -51,9 +64,47 @@ void BSplineInterpolator<TElastix>
   /** Set the splineOrder. */
   this->SetSplineOrder( splineOrder );
 
+  /** Check if the coefficient cache should be used. */
+  this->m_UseCoefficientCache = false;
+  this->GetConfiguration()->ReadParameter( this->m_UseCoefficientCache,
+    "UseBSplineCoefficientCache", this->GetComponentLabel(), 0, 0 );
+  if ( this->m_UseCoefficientCache )
+  {
+    std::string cacheDirectory = "";
+    this->GetConfiguration()->ReadParameter( cacheDirectory,
+      "BSplineCoefficientCacheDirectory", this->GetComponentLabel(), 0, 0 );
+    if ( !cacheDirectory.empty() )
+    {
+      CoefficientImageCacheType::GetInstance()->SetCacheDirectory( cacheDirectory );
+    }
+  }
+
 } // end BeforeEachResolution()
 
 
+/**
+ * ***************** SetInputImage ***********************
+ */
+
+template <class TElastix>
+void BSplineInterpolator<TElastix>
+::SetInputImage( const InputImageType * inputData )
+{
+  if ( !this->m_UseCoefficientCache || inputData == 0 )
+  {
+    this->Superclass1::SetInputImage( inputData );
+    return;
+  }
+
+  /** Do what the superclass does, but take the coefficients from the cache. */
+  this->m_Coefficients = CoefficientImageCacheType::GetInstance()
+    ->GetCoefficients( inputData, this->GetSplineOrder() );
+  this->Superclass1::Superclass::SetInputImage( inputData );
+  this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+} // end SetInputImage()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxBSplineInterpolator_hxx
@@ -15,7 +15,7 @@
 #ifndef __elxBSplineInterpolatorFloat_h
 #define __elxBSplineInterpolatorFloat_h
 
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction2.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -48,7 +48,7 @@ using namespace itk;
   template < class TElastix >
     class BSplineInterpolatorFloat :
     public
-      BSplineInterpolateImageFunction<
+      BSplineInterpolateImageFunction2<
         ITK_TYPENAME InterpolatorBase<TElastix>::InputImageType,
         ITK_TYPENAME InterpolatorBase<TElastix>::CoordRepType,
         float > , //CoefficientType
@@ -59,7 +59,7 @@ using namespace itk;
 
     /** Standard ITK-stuff. */
     typedef BSplineInterpolatorFloat            Self;
-    typedef BSplineInterpolateImageFunction<
+    typedef BSplineInterpolateImageFunction2<
       typename InterpolatorBase<TElastix>::InputImageType,
       typename InterpolatorBase<TElastix>::CoordRepType,
       float >                                   Superclass1;
@@ -175,15 +175,23 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType  CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+  typedef typename Superclass::EvaluationContextStruct            EvaluationContextStruct;
 
-  /** Computes the inner product of transform Jacobian with moving image gradient.
-   * The results are stored in the imageJacobian, which is supposed
-   * to have the right size (same length as Jacobian's number of columns).
+  /** The areas and sums that each thread accumulates, next to its
+   * evaluation context.
    */
-  void EvaluateMovingImageAndTransformJacobianInnerProduct(
-    const TransformJacobianType & jacobian,
-    const MovingImageDerivativeType & movingImageDerivative,
-    DerivativeType & innerProduct ) const;
+  struct KappaPerThreadStruct
+  {
+    std::size_t     st_FixedForegroundArea;
+    std::size_t     st_MovingForegroundArea;
+    std::size_t     st_Intersection;
+    DerivativeType  st_Sum1;
+    DerivativeType  st_Sum2;
+  };
+  typedef std::vector< KappaPerThreadStruct >                     KappaPerThreadType;
+
+  /** The per-thread areas and sums. */
+  mutable KappaPerThreadType  m_KappaPerThreadVariables;
 
   /** Compute a pixel's contribution to the measure and derivatives;
    * Called by GetValueAndDerivative().
@@ -199,6 +207,34 @@ protected:
     DerivativeType & sum1,
     DerivativeType & sum2 ) const;
 
+  /** Single-threaded versions of GetValue() and GetValueAndDerivative(). */
+  MeasureType GetValueSingleThreaded(
+    const TransformParametersType & parameters ) const;
+  void GetValueAndDerivativeSingleThreaded(
+    const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Make sure the per-thread variables have the right size, and zero the areas. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Zero the sums of a thread, and loop over its samples. */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Compute a sample's contribution to the areas and sums of a thread. */
+  virtual void ThreadedUpdateValueAndDerivativeTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+  virtual void ThreadedUpdateValueTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+
+  /** Combine the areas and sums of all threads into the value and derivative. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+  virtual void AfterThreadedGetValue( MeasureType & value ) const;
+
 private:
   AdvancedKappaStatisticImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -59,44 +59,36 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
 
 
 /**
- * *************** EvaluateMovingImageAndTransformJacobianInnerProduct ****************
+ * ******************* GetValue *******************
  */
 
-template < class TFixedImage, class TMovingImage >
-void
+template <class TFixedImage, class TMovingImage>
+typename AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
 AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
-::EvaluateMovingImageAndTransformJacobianInnerProduct(
-  const TransformJacobianType & jacobian,
-  const MovingImageDerivativeType & movingImageDerivative,
-  DerivativeType & innerProduct ) const
+::GetValue( const TransformParametersType & parameters ) const
 {
-  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-  typedef typename DerivativeType::iterator              DerivativeIteratorType;
-  JacobianIteratorType jac = jacobian.begin();
-  innerProduct.Fill( 0.0 );
-  const unsigned int sizeInnerProduct = innerProduct.GetSize();
-  for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
   {
-    const double imDeriv = movingImageDerivative[ dim ];
-    DerivativeIteratorType it = innerProduct.begin();
-    for ( unsigned int mu = 0; mu < sizeInnerProduct; mu++ )
-    {
-      (*it) += (*jac) * imDeriv;
-      ++it; ++jac;
-    }
+    return this->GetValueSingleThreaded( parameters );
   }
 
-} // end EvaluateMovingImageAndTransformJacobianInnerProduct()
+  itkDebugMacro( "GetValue( " << parameters << " ) " );
+
+  /** Distribute the samples over the threads. */
+  return this->GetValueMultiThreaded( parameters );
+
+} // end GetValue()
 
 
 /**
- * ******************* GetValue *******************
+ * ******************* GetValueSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 typename AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
 AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
-::GetValue( const TransformParametersType & parameters ) const
+::GetValueSingleThreaded( const TransformParametersType & parameters ) const
 {
   itkDebugMacro( "GetValue( " << parameters << " ) " );
 
@@ -108,7 +100,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -130,7 +122,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
     const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside moving mask. */
     if ( sampleOk )
@@ -187,7 +179,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
   /** Return the mean squares measure value. */
   return measure;
 
-} // end GetValue()
+} // end GetValueSingleThreaded()
 
 
 /**
@@ -220,6 +212,31 @@ void
 AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
+  {
+    return this->GetValueAndDerivativeSingleThreaded(
+      parameters, value, derivative );
+  }
+
+  itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
+
+  /** Distribute the samples over the threads. */
+  this->GetValueAndDerivativeMultiThreaded( parameters, value, derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeSingleThreaded( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
 {
   itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
 
@@ -237,7 +254,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Some variables. */
@@ -264,7 +281,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
     const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside moving mask. */
     if ( sampleOk )
@@ -292,17 +309,20 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
         = static_cast<RealType>( (*fiter).Value().m_ImageValue );
 
       /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      const TransformJacobianType * sampleJacobian = 0;
+      const NonZeroJacobianIndicesType * sampleNzji = 0;
+      this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+        jacobian, nzji, sampleJacobian, sampleNzji );
 
       /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateMovingImageAndTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+      this->EvaluateTransformJacobianInnerProduct(
+        *sampleJacobian, movingImageDerivative, imageJacobian );
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(
         fixedImageValue, movingImageValue,
         fixedForegroundArea, movingForegroundArea, intersection,
-        imageJacobian, nzji,
+        imageJacobian, *sampleNzji,
         vecSum1, vecSum2 );
 
     } // end if sampleOk
@@ -336,7 +356,219 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
     derivative = tmp1 * vecSum1 - tmp2 * vecSum2;
   }
 
-} // end GetValueAndDerivative()
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  /** Call the superclass implementation, which prepares the contexts. */
+  this->Superclass::InitializeThreadingParameters();
+
+  /** Make sure every thread has its own areas and sums. The sums are only
+   * reallocated when the number of threads or parameters changed, and are
+   * zeroed by the threads themselves, in ThreadedGetValueAndDerivative().
+   */
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if ( this->m_KappaPerThreadVariables.size() != numberOfThreads )
+  {
+    this->m_KappaPerThreadVariables.resize( numberOfThreads );
+  }
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    KappaPerThreadStruct & perThread = this->m_KappaPerThreadVariables[ i ];
+    perThread.st_FixedForegroundArea = 0;
+    perThread.st_MovingForegroundArea = 0;
+    perThread.st_Intersection = 0;
+    if ( perThread.st_Sum1.GetSize() != numberOfParameters )
+    {
+      perThread.st_Sum1.SetSize( numberOfParameters );
+      perThread.st_Sum2.SetSize( numberOfParameters );
+    }
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  /** Zero the sums of this thread, in the thread itself. */
+  KappaPerThreadStruct & perThread = this->m_KappaPerThreadVariables[ threadID ];
+  perThread.st_Sum1.Fill( NumericTraits< DerivativeValueType >::Zero );
+  perThread.st_Sum2.Fill( NumericTraits< DerivativeValueType >::Zero );
+
+  /** Loop over the samples of this thread. */
+  this->Superclass::ThreadedGetValueAndDerivative( threadID );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedUpdateValueTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  KappaPerThreadStruct & perThread
+    = this->m_KappaPerThreadVariables[ context.st_ThreadID ];
+
+  /** Update the intermediate values. */
+  const RealType diffFixed = vnl_math_abs( fixedImageValue - this->m_ForegroundValue );
+  const RealType diffMoving = vnl_math_abs( movingImageValue - this->m_ForegroundValue );
+  if ( diffFixed < this->m_Epsilon ){ perThread.st_FixedForegroundArea++; }
+  if ( diffMoving < this->m_Epsilon ){ perThread.st_MovingForegroundArea++; }
+  if ( diffFixed < this->m_Epsilon
+    && diffMoving < this->m_Epsilon ){ perThread.st_Intersection++; }
+
+} // end ThreadedUpdateValueTerms()
+
+
+/**
+ * ******************* ThreadedUpdateValueAndDerivativeTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueAndDerivativeTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  KappaPerThreadStruct & perThread
+    = this->m_KappaPerThreadVariables[ context.st_ThreadID ];
+
+  /** Compute this pixel's contribution to the areas and sums of this thread. */
+  this->UpdateValueAndDerivativeTerms(
+    fixedImageValue, movingImageValue,
+    perThread.st_FixedForegroundArea, perThread.st_MovingForegroundArea,
+    perThread.st_Intersection,
+    context.st_ImageJacobian, *context.st_ImageJacobianIndices,
+    perThread.st_Sum1, perThread.st_Sum2 );
+
+} // end ThreadedUpdateValueAndDerivativeTerms()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  /** Gather the number of valid samples, and check if enough were valid. */
+  MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+  this->GatherThreadedValues( dummyValue );
+
+  /** Sum the areas of all threads. */
+  std::size_t fixedForegroundArea  = 0;
+  std::size_t movingForegroundArea = 0;
+  std::size_t intersection         = 0;
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    const KappaPerThreadStruct & perThread = this->m_KappaPerThreadVariables[ i ];
+    fixedForegroundArea  += perThread.st_FixedForegroundArea;
+    movingForegroundArea += perThread.st_MovingForegroundArea;
+    intersection         += perThread.st_Intersection;
+  }
+
+  /** Compute the final metric value. */
+  std::size_t areaSum = fixedForegroundArea + movingForegroundArea;
+  if ( areaSum == 0 )
+  {
+    value = NumericTraits< MeasureType >::Zero;
+  }
+  else
+  {
+    value = 1.0 - 2.0 * static_cast<MeasureType>( intersection )
+      / static_cast<MeasureType>( areaSum );
+  }
+  if ( !this->m_Complement ) value = 1.0 - value;
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedKappaStatisticImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the number of valid samples, and check if enough were valid. */
+  MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+  this->GatherThreadedValues( dummyValue );
+
+  /** Sum the areas and sums of all threads. */
+  std::size_t fixedForegroundArea  = 0;
+  std::size_t movingForegroundArea = 0;
+  std::size_t intersection         = 0;
+  DerivativeType vecSum1( this->GetNumberOfParameters() );
+  DerivativeType vecSum2( this->GetNumberOfParameters() );
+  vecSum1.Fill( NumericTraits< DerivativeValueType >::Zero );
+  vecSum2.Fill( NumericTraits< DerivativeValueType >::Zero );
+  for ( unsigned int i = 0; i < this->GetNumberOfThreads(); ++i )
+  {
+    const KappaPerThreadStruct & perThread = this->m_KappaPerThreadVariables[ i ];
+    fixedForegroundArea  += perThread.st_FixedForegroundArea;
+    movingForegroundArea += perThread.st_MovingForegroundArea;
+    intersection         += perThread.st_Intersection;
+    vecSum1 += perThread.st_Sum1;
+    vecSum2 += perThread.st_Sum2;
+  }
+
+  /** Compute the final metric value. */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  std::size_t areaSum = fixedForegroundArea + movingForegroundArea;
+  const MeasureType intersectionFloat = static_cast<MeasureType>( intersection );
+  const MeasureType areaSumFloat = static_cast<MeasureType>( areaSum );
+  if ( areaSum > 0 )
+  {
+    measure = 1.0 - 2.0 * intersectionFloat / areaSumFloat;
+  }
+  if ( !this->m_Complement ){ measure = 1.0 - measure; }
+  value = measure;
+
+  /** Calculate the derivative. */
+  MeasureType direction = -1.0;
+  if ( !this->m_Complement ) direction = 1.0;
+  const MeasureType areaSumFloatSquare = direction * areaSumFloat * areaSumFloat;
+  const MeasureType tmp1 = areaSumFloat / areaSumFloatSquare;
+  const MeasureType tmp2 = 2.0 * intersectionFloat / areaSumFloatSquare;
+
+  derivative = DerivativeType( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  if ( areaSum > 0 )
+  {
+    derivative = tmp1 * vecSum1 - tmp2 * vecSum2;
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
 
 
 /**
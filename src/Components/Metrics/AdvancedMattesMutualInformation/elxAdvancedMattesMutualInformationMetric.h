@@ -89,8 +89,20 @@ using namespace itk;
    *    number of parameters. The second method does not use this huge matrix,
    *    and is therefore much more memory efficient for large images and fine
    *    B-spline grids.
+   *    With "auto", the first option is used when the 3D matrix is smaller
+   *    than MaximumPDFDerivativesMemory, and the second option otherwise.
+   *    With the second option, the image Jacobians of the samples are stored
+   *    and reused, if they fit in MaximumPDFDerivativesMemory; otherwise they
+   *    are recomputed.\n
    *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
-   *    The default is "true".
+   *    example: <tt>(UseFastAndLowMemoryVersion "auto")</tt> \n
+   *    The default is "true". Can be given for each resolution, or for all
+   *    resolutions at once.
+   * \parameter MaximumPDFDerivativesMemory: The maximum amount of memory, in
+   *    megabytes, used for storing derivatives of the joint histogram.\n
+   *    example: <tt>(MaximumPDFDerivativesMemory 256)</tt> \n
+   *    The default is 128. Can be given for each resolution, or for all
+   *    resolutions at once.
    *
    * \sa ParzenWindowMutualInformationImageToImageMetric
    * \ingroup Metrics
@@ -112,11 +112,20 @@ using namespace itk;
     this->SetFixedKernelBSplineOrder( fixedKernelBSplineOrder );
     this->SetMovingKernelBSplineOrder( movingKernelBSplineOrder );
 
-    /** Set whether a low memory consumption should be used. */
-    bool useFastAndLowMemoryVersion = true;
+    /** Set whether a low memory consumption should be used. With "auto"
+     * the choice is made automatically, based on MaximumPDFDerivativesMemory.
+     */
+    std::string useFastAndLowMemoryVersion = "true";
     this->GetConfiguration()->ReadParameter( useFastAndLowMemoryVersion,
       "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
-    this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
+    this->SetUseExplicitPDFDerivatives( useFastAndLowMemoryVersion == "false" );
+    this->SetUseAutomaticPDFDerivativesMode( useFastAndLowMemoryVersion == "auto" );
+
+    /** Set the maximum amount of memory for storing pdf derivatives. */
+    double maximumPDFDerivativesMemory = 128.0;
+    this->GetConfiguration()->ReadParameter( maximumPDFDerivativesMemory,
+      "MaximumPDFDerivativesMemory", this->GetComponentLabel(), level, 0 );
+    this->SetMaximumPDFDerivativesMemory( maximumPDFDerivativesMemory );
 
     /** Set whether to use Nick Tustison's preconditioning technique. */
     bool useJacobianPreconditioning = false;
@@ -47,6 +47,25 @@ namespace itk
    * or by nearest neighbor interpolation of a precomputed central difference image.
    * \li A minimum number of samples that should map within the moving image (mask) can be specified.
    *
+   * The derivative can be computed in three ways:
+   * \li Explicit: the derivatives of the joint histogram to all parameters
+   *   are stored in a dense 3D image (UseExplicitPDFDerivatives true). This is
+   *   fast for a small number of parameters, but the memory is proportional
+   *   to the number of parameters times the number of histogram bins.
+   * \li Sparse: the image Jacobians of the samples are stored while the joint
+   *   histogram is computed, and are reused to compute the derivative. The
+   *   memory is proportional to the number of samples times the number of
+   *   nonzero Jacobian indices.
+   * \li Low memory: a second pass over the samples recomputes the image
+   *   Jacobians, so nothing needs to be stored.
+   *
+   * If UseExplicitPDFDerivatives is false, the choice between the sparse and
+   * the low memory variant is made automatically in every iteration, using
+   * the MaximumPDFDerivativesMemory setting. If
+   * UseAutomaticPDFDerivativesMode is true, also the choice for the explicit
+   * variant is made automatically, in InitializeHistograms(): it is used when
+   * the dense derivatives fit in MaximumPDFDerivativesMemory.
+   *
    * Notes:\n
    * 1. This class returns the negative mutual information value.\n
    * 2. This class in not thread safe due the private data structures
@@ -135,6 +154,7 @@ namespace itk
       Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
     typedef typename
       Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+    typedef typename Superclass::AdvancedTransformType      AdvancedTransformType;
 
     /** The fixed image dimension. */
     itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -151,6 +171,17 @@ namespace itk
     itkGetConstMacro( UseJacobianPreconditioning, bool );
     itkSetMacro( UseJacobianPreconditioning, bool );
 
+    /** Set/get whether UseExplicitPDFDerivatives should be determined
+     * automatically when the histograms are initialized; default: false.
+     */
+    itkSetMacro( UseAutomaticPDFDerivativesMode, bool );
+    itkGetConstMacro( UseAutomaticPDFDerivativesMode, bool );
+    itkBooleanMacro( UseAutomaticPDFDerivativesMode );
+
+    /** Create an evaluator of this metric; see the superclass. */
+    virtual typename Superclass::Superclass::Pointer CreateEvaluator(
+      AdvancedTransformType * transform = 0 ) const;
+
   protected:
 
     /** The constructor. */
@@ -185,6 +216,11 @@ namespace itk
     typedef typename Superclass::ParzenValueContainerType           ParzenValueContainerType;
     typedef typename Superclass::KernelFunctionType                 KernelFunctionType;
     typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+    typedef typename Superclass::NonZeroJacobianIndexType           NonZeroJacobianIndexType;
+    typedef typename Superclass::EvaluationContextStruct
+      EvaluationContextStruct;
+    typedef typename Superclass::ParzenWindowHistogramPerThreadStruct
+      ParzenWindowHistogramPerThreadStruct;
 
     /**  Get the value and analytic derivatives for single valued optimizers.
      * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -217,6 +253,20 @@ namespace itk
     /** Some initialization functions, called by Initialize. */
     virtual void InitializeHistograms( void );
 
+    /** Threaded version of the second pass over the samples in
+     * GetValueAndAnalyticDerivativeLowMemory(). Each thread accumulates the
+     * derivative contributions of its part of the samples in its private
+     * derivative, which are summed by AccumulateDerivatives() afterwards.
+     */
+    virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+    /** Compute the derivative contributions of the samples that were stored
+     * in the per-thread variables of thread threadID by
+     * ComputePDFsAndStoreSamples(), and add them to derivative.
+     */
+    virtual void UpdateDerivativeLowMemoryFromStoredSamples(
+      unsigned int threadID, DerivativeType & derivative ) const;
+
   private:
 
     /** The private constructor. */
@@ -229,15 +279,22 @@ namespace itk
     typedef Array2D< PRatioType >       PRatioArrayType;
     mutable PRatioArrayType             m_PRatioArray;
 
-    /** Setting */
+    /** Settings */
     bool  m_UseJacobianPreconditioning;
+    bool  m_UseAutomaticPDFDerivativesMode;
 
-    /** Helper function to update the derivative in case of low memory consumption. */
+    /** Whether the current derivative computation uses the stored samples. */
+    mutable bool m_UseStoredSamples;
+
+    /** Helper function to update the derivative in case of low memory
+     * consumption. nzji points to the imageJacobian.GetSize() nonzero
+     * Jacobian indices.
+     */
     void UpdateDerivativeLowMemory(
       const RealType & fixedImageValue,
       const RealType & movingImageValue,
       const DerivativeType & imageJacobian,
-      const NonZeroJacobianIndicesType & nzji,
+      const NonZeroJacobianIndexType * nzji,
       DerivativeType & derivative ) const;
 
     /** Helper function to compute m_PRatioArray in case of low memory consumption. */
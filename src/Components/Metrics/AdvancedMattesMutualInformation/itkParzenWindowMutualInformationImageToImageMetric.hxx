@@ -35,6 +35,8 @@ namespace itk
     ::ParzenWindowMutualInformationImageToImageMetric()
   {
     this->m_UseJacobianPreconditioning = false;
+    this->m_UseAutomaticPDFDerivativesMode = false;
+    this->m_UseStoredSamples = false;
   } // end constructor
 
 
@@ -47,6 +49,21 @@ namespace itk
     ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
     ::InitializeHistograms( void )
   {
+    /** Choose between explicit (dense) pdf derivatives and the other variants.
+     * The dense derivatives are fast when they are small, since they are
+     * cleared and summed over in every iteration.
+     */
+    if ( this->GetUseAutomaticPDFDerivativesMode() )
+    {
+      const double denseMegaBytes =
+        static_cast<double>( this->GetNumberOfParameters() )
+        * static_cast<double>( this->GetNumberOfFixedHistogramBins() )
+        * static_cast<double>( this->GetNumberOfMovingHistogramBins() )
+        * sizeof( PDFValueType ) / 1048576.0;
+      this->SetUseExplicitPDFDerivatives(
+        denseMegaBytes <= this->GetMaximumPDFDerivativesMemory() );
+    }
+
     /** Call Superclass implementation. */
     this->Superclass::InitializeHistograms();
 
@@ -61,6 +78,32 @@ namespace itk
   } // end InitializeHistograms()
 
 
+  /**
+   * ********************* CreateEvaluator ******************************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    typename ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::Superclass::Pointer
+    ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::CreateEvaluator( AdvancedTransformType * transform ) const
+  {
+    Pointer evaluator = Self::New();
+
+    /** Copy the settings that InitializeHistograms() depends on. */
+    evaluator->m_UseJacobianPreconditioning = this->m_UseJacobianPreconditioning;
+    evaluator->m_UseAutomaticPDFDerivativesMode = this->m_UseAutomaticPDFDerivativesMode;
+
+    if ( !this->InitializeEvaluator( evaluator, transform ) )
+    {
+      return 0;
+    }
+
+    return evaluator.GetPointer();
+
+  } // end CreateEvaluator()
+
+
   /**
    * ************************** GetValue **************************
    * Get the match Measure.
@@ -251,10 +294,21 @@ namespace itk
     derivative = DerivativeType( this->GetNumberOfParameters() );
     derivative.Fill( NumericTraits<double>::Zero );
 
-    /** Construct the JointPDF and Alpha.
-     * This function contains a loop over the samples.
+    /** Set up the parameters in the transform and update the imageSampler. */
+    this->SetTransformParameters( parameters );
+    this->UpdateImageSampler();
+
+    /** Decide whether the image Jacobians of the samples are stored during
+     * the computation of the joint histogram (sparse), or recomputed in a
+     * second pass over the samples.
      */
-    this->ComputePDFs( parameters );
+    this->m_UseStoredSamples = !this->GetUseJacobianPreconditioning()
+      && this->StoredSamplesFitInMemory( this->GetImageSampler()->GetOutput()->Size() );
+
+    /** Construct the JointPDF and Alpha, using the samples of the sampler
+     * that was just updated. This function contains a loop over the samples.
+     */
+    this->ComputePDFsOfUpdatedSamples( this->m_UseStoredSamples );
 
     /** Normalize the joint histogram by alpha. */
     this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
@@ -282,6 +336,29 @@ namespace itk
 
     // NOW A SECOND PASS OVER THE SAMPLES to compute the derivative
 
+    /** In the sparse variant the stored samples are used instead. */
+    if ( this->m_UseStoredSamples && !this->GetUseMultiThread() )
+    {
+      const unsigned int numberOfThreads = this->GetNumberOfThreads();
+      for ( unsigned int i = 0; i < numberOfThreads; ++i )
+      {
+        this->UpdateDerivativeLowMemoryFromStoredSamples( i, derivative );
+      }
+      return;
+    }
+
+    /** The second pass, or the loop over the stored samples, is distributed
+     * over the threads, unless the Jacobian preconditioning is used, which
+     * needs an additional global sum.
+     * The per-thread variables were initialized by ComputePDFsOfUpdatedSamples().
+     */
+    if ( this->GetUseMultiThread() && !this->GetUseJacobianPreconditioning() )
+    {
+      this->LaunchGetValueAndDerivativeThreaderCallback();
+      this->AccumulateDerivatives( derivative, 1.0 );
+      return;
+    }
+
     /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
     NonZeroJacobianIndicesType nzji( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
     DerivativeType imageJacobian( nzji.size() );
@@ -310,7 +387,7 @@ namespace itk
       MovingImagePointType mappedPoint;
 
       /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
       /** Check if the point is inside the moving mask. */
       if ( sampleOk )
@@ -339,20 +416,23 @@ namespace itk
           ->Evaluate( movingImageValue, movingImageDerivative );
 
         /** Get the transform Jacobian dT/dmu. */
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        const TransformJacobianType * sampleJacobian = 0;
+        const NonZeroJacobianIndicesType * sampleNzji = 0;
+        this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+          jacobian, nzji, sampleJacobian, sampleNzji );
 
         /** Compute the inner product (dM/dx)^T (dT/dmu). */
         this->EvaluateTransformJacobianInnerProduct(
-          jacobian, movingImageDerivative, imageJacobian );
+          *sampleJacobian, movingImageDerivative, imageJacobian );
 
         /** If desired, apply the technique introduced by Tustison */
         if ( this->GetUseJacobianPreconditioning() )
         {
-          this->ComputeJacobianPreconditioner( jacobian, nzji,
+          this->ComputeJacobianPreconditioner( *sampleJacobian, *sampleNzji,
             jacobianPreconditioner, preconditioningDivisor );
           DerivativeValueType * imjacit = imageJacobian.begin();
           DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
-          for ( unsigned int i = 0; i < nzji.size(); ++i )
+          for ( unsigned int i = 0; i < sampleNzji->size(); ++i )
           while ( imjacit != imageJacobian.end() )
           {
             (*imjacit) *= (*jacprecit);
@@ -363,7 +443,7 @@ namespace itk
 
         /** Compute this sample's contribution to the joint distributions. */
         this->UpdateDerivativeLowMemory(
-          fixedImageValue, movingImageValue, imageJacobian, nzji, derivative );
+          fixedImageValue, movingImageValue, imageJacobian, &( *sampleNzji )[ 0 ], derivative );
 
       } // end sampleOk
     } // end loop over sample container
@@ -476,7 +556,7 @@ namespace itk
     const RealType & fixedImageValue,
     const RealType & movingImageValue,
     const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
+    const NonZeroJacobianIndexType * nzji,
     DerivativeType & derivative ) const
   {
     /** In this function we need to do (see eq. 24 of Thevenaz [3]):
@@ -540,7 +620,7 @@ namespace itk
     //typedef typename DerivativeType::iterator   DerivativeIteratorType;
     //DerivativeIteratorType itDerivative( derivative );
 
-    if ( nzji.size() == this->GetNumberOfParameters() )
+    if ( imageJacobian.GetSize() == this->GetNumberOfParameters() )
     {
       /** Loop over all Jacobians. */
       //typename DerivativeType::const_iterator imjac = imageJacobian.begin();
@@ -864,6 +944,140 @@ namespace itk
 
   } // end ComputeJacobianPreconditioner
 
+  /**
+   * ******************* ThreadedGetValueAndDerivative *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+  void
+    ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+  {
+    /** Get a handle to the evaluation context of the current thread, with its
+     * pre-allocated derivative. The initialization is performed here, so that
+     * it is done multi-threaded.
+     */
+    EvaluationContextStruct & context = this->m_EvaluationContexts[ threadID ];
+    DerivativeType & derivative = context.st_Derivative;
+    derivative.Fill( NumericTraits<DerivativeValueType>::Zero );
+
+    /** In the sparse variant, only the samples stored by this thread are used. */
+    if ( this->m_UseStoredSamples )
+    {
+      this->UpdateDerivativeLowMemoryFromStoredSamples( threadID, derivative );
+      return;
+    }
+
+    /** The scratch of this thread for dM(x)/dmu, and the sparse jacobian+indices. */
+    NonZeroJacobianIndicesType & nzji = context.st_NonZeroJacobianIndices;
+    DerivativeType & imageJacobian = context.st_ImageJacobian;
+    TransformJacobianType & jacobian = context.st_Jacobian;
+
+    /** Get a handle to the sample container. */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+    const unsigned long sampleContainerSize = sampleContainer->Size();
+
+    /** Get the samples for this thread. */
+    unsigned long posBegin = 0;
+    unsigned long posEnd = 0;
+    this->GetThreadSampleRange( threadID, sampleContainerSize, posBegin, posEnd );
+
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator fiter;
+    typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+    fbegin += posBegin;
+    fend += posEnd;
+
+    /** Loop over the samples of this thread. */
+    for ( fiter = fbegin; fiter != fend; ++fiter )
+    {
+      /** Read fixed coordinates and create some variables. */
+      const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImageDerivativeType movingImageDerivative;
+      MovingImagePointType mappedPoint;
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
+
+      /** Check if the point is inside the moving mask. */
+      if ( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
+
+      /** Compute the moving image value, its derivative, and check
+       * if the point is inside the moving image buffer.
+       */
+      if ( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative );
+      }
+
+      if ( sampleOk )
+      {
+        /** Get the fixed image value. */
+        RealType fixedImageValue = static_cast<RealType>( (*fiter).Value().m_ImageValue );
+
+        /** Make sure the values fall within the histogram range. */
+        fixedImageValue = this->GetFixedImageLimiter()
+          ->Evaluate( fixedImageValue );
+        movingImageValue = this->GetMovingImageLimiter()
+          ->Evaluate( movingImageValue, movingImageDerivative );
+
+        /** Get the transform Jacobian dT/dmu. */
+        const TransformJacobianType * sampleJacobian = 0;
+        const NonZeroJacobianIndicesType * sampleNzji = 0;
+        this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+          jacobian, nzji, sampleJacobian, sampleNzji );
+
+        /** Compute the inner product (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          *sampleJacobian, movingImageDerivative, imageJacobian );
+
+        /** Compute this sample's contribution to the derivative. */
+        this->UpdateDerivativeLowMemory(
+          fixedImageValue, movingImageValue, imageJacobian, &( *sampleNzji )[ 0 ], derivative );
+
+      } // end sampleOk
+    } // end loop over the samples of this thread
+
+  } // end ThreadedGetValueAndDerivative()
+
+
+  /**
+   * ******************* UpdateDerivativeLowMemoryFromStoredSamples *******************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+  void
+    ParzenWindowMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::UpdateDerivativeLowMemoryFromStoredSamples(
+    unsigned int threadID, DerivativeType & derivative ) const
+  {
+    /** The image Jacobians and indices of the samples are stored in flat
+     * buffers; those of sample n start at n * nnzji.
+     */
+    ParzenWindowHistogramPerThreadStruct & perThread
+      = this->m_ParzenWindowHistogramPerThreadVariables[ threadID ];
+    const unsigned long nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+    for ( unsigned long n = 0; n < perThread.st_NumberOfStoredSamples; ++n )
+    {
+      const DerivativeType imageJacobian(
+        perThread.st_ImageJacobians.data_block() + n * nnzji, nnzji, false );
+      this->UpdateDerivativeLowMemory(
+        perThread.st_FixedImageValues[ n ],
+        perThread.st_MovingImageValues[ n ],
+        imageJacobian,
+        &perThread.st_NonZeroJacobianIndices[ n * nnzji ],
+        derivative );
+    }
+
+  } // end UpdateDerivativeLowMemoryFromStoredSamples()
+
+
 } // end namespace itk
 
 
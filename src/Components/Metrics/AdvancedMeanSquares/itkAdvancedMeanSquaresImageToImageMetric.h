@@ -114,6 +114,7 @@ public:
     Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+  typedef typename Superclass::AdvancedTransformType      AdvancedTransformType;
 
   /** Some typedefs for computing the SelfHessian */
   typedef typename Superclass::HessianValueType           HessianValueType;
@@ -127,17 +128,32 @@ public:
   itkStaticConstMacro( MovingImageDimension, unsigned int,
     MovingImageType::ImageDimension );
 
-  /** Get the value for single valued optimizers. */
+  /** Get the value for single valued optimizers.
+   * Depending on GetUseMultiThread() this calls the single-threaded
+   * implementation, or distributes the samples over multiple threads.
+   */
   virtual MeasureType GetValue( const TransformParametersType & parameters ) const;
 
+  /** Get the value, single-threaded implementation. */
+  virtual MeasureType GetValueSingleThreaded(
+    const TransformParametersType & parameters ) const;
+
   /** Get the derivatives of the match measure. */
   virtual void GetDerivative( const TransformParametersType & parameters,
     DerivativeType & derivative ) const;
 
-  /** Get value and derivatives for multiple valued optimizers. */
+  /** Get value and derivatives for multiple valued optimizers.
+   * Depending on GetUseMultiThread() this calls the single-threaded
+   * implementation, or distributes the samples over multiple threads.
+   */
   virtual void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType& Value, DerivativeType& Derivative ) const;
 
+  /** Get value and derivatives, single-threaded implementation. */
+  virtual void GetValueAndDerivativeSingleThreaded(
+    const TransformParametersType & parameters,
+    MeasureType& Value, DerivativeType& Derivative ) const;
+
   /** Experimental feature: compute SelfHessian */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
@@ -159,6 +175,12 @@ public:
    * \li Estimate the normalization factor, if asked for.  */
   virtual void Initialize(void) throw ( ExceptionObject );
 
+  /** Create an evaluator, which has the same settings and the same
+   * normalization factor as this metric.
+   */
+  virtual typename Superclass::Pointer CreateEvaluator(
+    AdvancedTransformType * transform = 0 ) const;
+
   /** Set/Get whether to normalize the mean squares measure.
    * This divides the MeanSquares by a factor (range/10)^2,
    * where range represents the maximum gray value range of the
@@ -187,6 +209,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+  typedef typename Superclass::EvaluationContextStruct            EvaluationContextStruct;
 
   /** Protected typedefs for SelfHessian */
   typedef SmoothingRecursiveGaussianImageFilter<
@@ -200,14 +223,6 @@ protected:
 
   double m_NormalizationFactor;
 
-  /** Computes the innerproduct of transform Jacobian with moving image gradient.
-   * The results are stored in imageJacobian, which is supposed
-   * to have the right size (same length as Jacobian's number of columns). */
-  void EvaluateTransformJacobianInnerProduct(
-    const TransformJacobianType & jacobian,
-    const MovingImageDerivativeType & movingImageDerivative,
-    DerivativeType & imageJacobian) const;
-
   /** Compute a pixel's contribution to the measure and derivatives;
    * Called by GetValueAndDerivative(). */
   void UpdateValueAndDerivativeTerms(
@@ -218,6 +233,27 @@ protected:
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
+  /** Compute a sample's contribution to the value and derivative
+   * accumulators of the evaluation context of a thread. */
+  virtual void ThreadedUpdateValueAndDerivativeTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+
+  /** Gather the values and derivatives of all threads and normalize. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Compute a sample's contribution to the value accumulator of the
+   * evaluation context of a thread. */
+  virtual void ThreadedUpdateValueTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+
+  /** Gather the values of all threads and normalize. */
+  virtual void AfterThreadedGetValue( MeasureType & value ) const;
+
   /** Compute a pixel's contribution to the SelfHessian;
    * Called by GetSelfHessian(). */
   void UpdateSelfHessianTerms(
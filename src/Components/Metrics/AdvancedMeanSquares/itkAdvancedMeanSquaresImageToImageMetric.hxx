@@ -89,6 +89,32 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
 } // end Initialize()
 
 
+/**
+ * ********************* CreateEvaluator ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>::Superclass::Pointer
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::CreateEvaluator( AdvancedTransformType * transform ) const
+{
+  Pointer evaluator = Self::New();
+  if ( !this->InitializeEvaluator( evaluator, transform ) )
+  {
+    return 0;
+  }
+
+  evaluator->m_UseNormalization = this->m_UseNormalization;
+  evaluator->m_NormalizationFactor = this->m_NormalizationFactor;
+  evaluator->m_SelfHessianSmoothingSigma = this->m_SelfHessianSmoothingSigma;
+  evaluator->m_SelfHessianNoiseRange = this->m_SelfHessianNoiseRange;
+  evaluator->m_NumberOfSamplesForSelfHessian = this->m_NumberOfSamplesForSelfHessian;
+
+  return evaluator.GetPointer();
+
+} // end CreateEvaluator()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -111,46 +137,82 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
 
 
 /**
- * *************** EvaluateTransformJacobianInnerProduct ****************
+ * ******************* GetValue *******************
  */
 
-template < class TFixedImage, class TMovingImage >
-void
+template <class TFixedImage, class TMovingImage>
+typename AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
 AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
-::EvaluateTransformJacobianInnerProduct(
-  const TransformJacobianType & jacobian,
-  const MovingImageDerivativeType & movingImageDerivative,
-  DerivativeType & imageJacobian ) const
+::GetValue( const TransformParametersType & parameters ) const
 {
-  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-  typedef typename DerivativeType::iterator              DerivativeIteratorType;
-  JacobianIteratorType jac = jacobian.begin();
-  imageJacobian.Fill( 0.0 );
-  const unsigned int sizeImageJacobian = imageJacobian.GetSize();
-  for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
   {
-    const double imDeriv = movingImageDerivative[ dim ];
-    DerivativeIteratorType imjac = imageJacobian.begin();
+    return this->GetValueSingleThreaded( parameters );
+  }
 
-    for ( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
-    {
-      (*imjac) += (*jac) * imDeriv;
-      ++imjac;
-      ++jac;
-    }
+  itkDebugMacro( "GetValue( " << parameters << " ) " );
+
+  /** Distribute the samples over the threads. */
+  return this->GetValueMultiThreaded( parameters );
+
+} // end GetValue()
+
+
+/**
+ * ******************* ThreadedUpdateValueTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  /** The difference squared. */
+  const RealType diff = movingImageValue - fixedImageValue;
+  context.st_Value += diff * diff;
+
+} // end ThreadedUpdateValueTerms()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  /** Gather the number of valid samples and the value of all threads,
+   * and check if enough samples were valid.
+   */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  this->GatherThreadedValues( measure );
+
+  /** Update measure value. */
+  double normal_sum = 0.0;
+  if ( this->m_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor /
+      static_cast<double>( this->m_NumberOfPixelsCounted );
   }
+  value = measure * normal_sum;
 
-} // end EvaluateTransformJacobianInnerProduct()
+} // end AfterThreadedGetValue()
 
 
 /**
- * ******************* GetValue *******************
+ * ******************* GetValueSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 typename AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
 AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
-::GetValue( const TransformParametersType & parameters ) const
+::GetValueSingleThreaded( const TransformParametersType & parameters ) const
 {
   itkDebugMacro( "GetValue( " << parameters << " ) " );
 
@@ -162,7 +224,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -179,7 +241,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -227,7 +289,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   /** Return the mean squares measure value. */
   return measure;
 
-} // end GetValue()
+} // end GetValueSingleThreaded()
 
 
 /**
@@ -262,6 +324,86 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
 ::GetValueAndDerivative(
   const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
+  {
+    return this->GetValueAndDerivativeSingleThreaded(
+      parameters, value, derivative );
+  }
+
+  itkDebugMacro("GetValueAndDerivative( " << parameters << " ) ");
+
+  /** Distribute the samples over the threads. */
+  this->GetValueAndDerivativeMultiThreaded( parameters, value, derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedUpdateValueAndDerivativeTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueAndDerivativeTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  /** Accumulate in the value and derivative of this thread. */
+  this->UpdateValueAndDerivativeTerms(
+    fixedImageValue, movingImageValue,
+    context.st_ImageJacobian, *context.st_ImageJacobianIndices,
+    context.st_Value, context.st_Derivative );
+
+} // end ThreadedUpdateValueAndDerivativeTerms()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the number of valid samples and the value of all threads,
+   * and check if enough samples were valid.
+   */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  this->GatherThreadedValues( measure );
+
+  /** Compute the normalization factor. */
+  double normal_sum = 0.0;
+  if ( this->m_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor /
+      static_cast<double>( this->m_NumberOfPixelsCounted );
+  }
+
+  /** The return value. */
+  value = measure * normal_sum;
+
+  /** Sum and normalize the derivatives of all threads. */
+  this->AccumulateDerivatives( derivative, normal_sum );
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeSingleThreaded(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
 {
   itkDebugMacro("GetValueAndDerivative( " << parameters << " ) ");
 
@@ -284,7 +426,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -302,7 +444,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
     MovingImageDerivativeType movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -328,16 +470,19 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
         = static_cast<RealType>( (*fiter).Value().m_ImageValue );
 
       /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      const TransformJacobianType * sampleJacobian = 0;
+      const NonZeroJacobianIndicesType * sampleNzji = 0;
+      this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+        jacobian, nzji, sampleJacobian, sampleNzji );
 
       /** Compute the inner products (dM/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        *sampleJacobian, movingImageDerivative, imageJacobian );
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(
         fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
+        imageJacobian, *sampleNzji,
         measure, derivative );
 
     } // end if sampleOk
@@ -361,7 +506,7 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
   /** The return value. */
   value = measure;
 
-} // end GetValueAndDerivative()
+} // end GetValueAndDerivativeSingleThreaded()
 
 
 /**
@@ -143,6 +143,7 @@ public:
     Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+  typedef typename Superclass::AdvancedTransformType      AdvancedTransformType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -171,6 +172,10 @@ public:
   itkGetConstReferenceMacro( SubtractMean, bool );
   itkBooleanMacro( SubtractMean );
 
+  /** Create an evaluator, which has the same settings as this metric. */
+  virtual typename Superclass::Pointer CreateEvaluator(
+    AdvancedTransformType * transform = 0 ) const;
+
 protected:
   AdvancedNormalizedCorrelationImageToImageMetric();
   virtual ~AdvancedNormalizedCorrelationImageToImageMetric() {};
@@ -189,14 +194,25 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType          MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+  typedef typename Superclass::EvaluationContextStruct            EvaluationContextStruct;
+  typedef typename NumericTraits< MeasureType >::AccumulateType   AccumulateType;
+
+  /** The sums that each thread accumulates, next to its evaluation context. */
+  struct CorrelationPerThreadStruct
+  {
+    AccumulateType  st_Sff;
+    AccumulateType  st_Smm;
+    AccumulateType  st_Sfm;
+    AccumulateType  st_Sf;
+    AccumulateType  st_Sm;
+    DerivativeType  st_DerivativeF;
+    DerivativeType  st_DerivativeM;
+    DerivativeType  st_Differential;
+  };
+  typedef std::vector< CorrelationPerThreadStruct >               CorrelationPerThreadType;
 
-  /** Computes the innerproduct of transform Jacobian with moving image gradient.
-   * The results are stored in imageJacobian, which is supposed
-   * to have the right size (same length as Jacobian's number of columns). */
-  void EvaluateTransformJacobianInnerProduct(
-    const TransformJacobianType & jacobian,
-    const MovingImageDerivativeType & movingImageDerivative,
-    DerivativeType & imageJacobian) const;
+  /** The per-thread sums. */
+  mutable CorrelationPerThreadType  m_CorrelationPerThreadVariables;
 
   /** Compute a pixel's contribution to the derivative terms;
    * Called by GetValueAndDerivative(). */
@@ -209,6 +225,41 @@ protected:
     DerivativeType & derivativeM,
     DerivativeType & differential ) const;
 
+  /** Single-threaded versions of GetValue() and GetValueAndDerivative(). */
+  MeasureType GetValueSingleThreaded(
+    const TransformParametersType & parameters ) const;
+  void GetValueAndDerivativeSingleThreaded(
+    const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Make sure the per-thread sums have the right size, and zero them. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  /** Zero the derivative terms of a thread, and loop over its samples. */
+  virtual void ThreadedGetValueAndDerivative( unsigned int threadID ) const;
+
+  /** Compute a sample's contribution to the sums of a thread. */
+  virtual void ThreadedUpdateValueAndDerivativeTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+  virtual void ThreadedUpdateValueTerms(
+    const RealType fixedImageValue,
+    const RealType movingImageValue,
+    EvaluationContextStruct & context ) const;
+
+  /** Combine the sums of all threads into the value and derivative. */
+  virtual void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const;
+  virtual void AfterThreadedGetValue( MeasureType & value ) const;
+
+  /** Sum the per-thread sums and the numbers of pixels counted, and check
+   * if enough samples were valid. The derivative terms are only summed if
+   * withDerivatives is true.
+   */
+  void GatherCorrelationSums( CorrelationPerThreadStruct & sums,
+    bool withDerivatives ) const;
+
 private:
   AdvancedNormalizedCorrelationImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -54,36 +54,25 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 
 
 /**
- * *************** EvaluateTransformJacobianInnerProduct ****************
+ * ******************* CreateEvaluator *******************
  */
 
-template < class TFixedImage, class TMovingImage >
-void
+template <class TFixedImage, class TMovingImage>
+typename AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>::Superclass::Pointer
 AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
-::EvaluateTransformJacobianInnerProduct(
-  const TransformJacobianType & jacobian,
-  const MovingImageDerivativeType & movingImageDerivative,
-  DerivativeType & imageJacobian ) const
+::CreateEvaluator( AdvancedTransformType * transform ) const
 {
-  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-  typedef typename DerivativeType::iterator              DerivativeIteratorType;
-  JacobianIteratorType jac = jacobian.begin();
-  imageJacobian.Fill( 0.0 );
-
-  const unsigned int sizeImageJacobian = imageJacobian.GetSize();
-  for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
+  Pointer evaluator = Self::New();
+  if ( !this->InitializeEvaluator( evaluator, transform ) )
   {
-    const double imDeriv = movingImageDerivative[ dim ];
-    DerivativeIteratorType imjac = imageJacobian.begin();
-
-    for ( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
-    {
-      (*imjac) += (*jac) * imDeriv;
-      ++imjac;
-      ++jac;
-    }
+    return 0;
   }
-} // end EvaluateTransformJacobianInnerProduct()
+
+  evaluator->m_SubtractMean = this->m_SubtractMean;
+
+  return evaluator.GetPointer();
+
+} // end CreateEvaluator()
 
 
 /**
@@ -148,6 +137,29 @@ template <class TFixedImage, class TMovingImage>
 typename AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
 AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 ::GetValue( const TransformParametersType & parameters ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
+  {
+    return this->GetValueSingleThreaded( parameters );
+  }
+
+  itkDebugMacro( "GetValue( " << parameters << " ) " );
+
+  /** Distribute the samples over the threads. */
+  return this->GetValueMultiThreaded( parameters );
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetValueSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>::MeasureType
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueSingleThreaded( const TransformParametersType & parameters ) const
 {
   itkDebugMacro( "GetValue( " << parameters << " ) " );
 
@@ -159,7 +171,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -184,7 +196,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -250,7 +262,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   /** Return the NC measure value. */
   return measure;
 
-} // end GetValue()
+} // end GetValueSingleThreaded()
 
 
 /**
@@ -283,6 +295,31 @@ void
 AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Option for now to still use the single threaded code. */
+  if ( !this->GetUseMultiThread() )
+  {
+    return this->GetValueAndDerivativeSingleThreaded(
+      parameters, value, derivative );
+  }
+
+  itkDebugMacro( << "GetValueAndDerivative( " << parameters << " ) " );
+
+  /** Distribute the samples over the threads. */
+  this->GetValueAndDerivativeMultiThreaded( parameters, value, derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::GetValueAndDerivativeSingleThreaded( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
 {
   itkDebugMacro( << "GetValueAndDerivative( " << parameters << " ) " );
 
@@ -317,7 +354,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -335,7 +372,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     MovingImageDerivativeType movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -360,11 +397,14 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
       const RealType & fixedImageValue = static_cast<RealType>( (*fiter).Value().m_ImageValue );
 
       /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      const TransformJacobianType * sampleJacobian = 0;
+      const NonZeroJacobianIndicesType * sampleNzji = 0;
+      this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+        jacobian, nzji, sampleJacobian, sampleNzji );
 
       /** Compute the innerproducts (dM/dx)^T (dT/dmu) and (dMask/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        *sampleJacobian, movingImageDerivative, imageJacobian );
 
       /** Update some sums needed to calculate the value of NC. */
       sff += fixedImageValue  * fixedImageValue;
@@ -375,7 +415,7 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 
       /** Compute this pixel's contribution to the derivative terms. */
       this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
+        fixedImageValue, movingImageValue, imageJacobian, *sampleNzji,
         derivativeF, derivativeM, differential );
 
     } // end if sampleOk
@@ -422,7 +462,274 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
   }
 
-} // end GetValueAndDerivative()
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::InitializeThreadingParameters( void ) const
+{
+  /** Call the superclass implementation, which prepares the contexts. */
+  this->Superclass::InitializeThreadingParameters();
+
+  /** Make sure every thread has its own sums. The derivative terms are only
+   * reallocated when the number of threads or parameters changed, and are
+   * zeroed by the threads themselves, in ThreadedGetValueAndDerivative().
+   */
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if ( this->m_CorrelationPerThreadVariables.size() != numberOfThreads )
+  {
+    this->m_CorrelationPerThreadVariables.resize( numberOfThreads );
+  }
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    CorrelationPerThreadStruct & sums = this->m_CorrelationPerThreadVariables[ i ];
+    sums.st_Sff = NumericTraits< AccumulateType >::Zero;
+    sums.st_Smm = NumericTraits< AccumulateType >::Zero;
+    sums.st_Sfm = NumericTraits< AccumulateType >::Zero;
+    sums.st_Sf  = NumericTraits< AccumulateType >::Zero;
+    sums.st_Sm  = NumericTraits< AccumulateType >::Zero;
+    if ( sums.st_DerivativeF.GetSize() != numberOfParameters )
+    {
+      sums.st_DerivativeF.SetSize( numberOfParameters );
+      sums.st_DerivativeM.SetSize( numberOfParameters );
+      sums.st_Differential.SetSize( numberOfParameters );
+    }
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedGetValueAndDerivative( unsigned int threadID ) const
+{
+  typedef typename DerivativeType::ValueType        DerivativeValueType;
+
+  /** Zero the derivative terms of this thread, in the thread itself. */
+  CorrelationPerThreadStruct & sums = this->m_CorrelationPerThreadVariables[ threadID ];
+  sums.st_DerivativeF.Fill( NumericTraits< DerivativeValueType >::Zero );
+  sums.st_DerivativeM.Fill( NumericTraits< DerivativeValueType >::Zero );
+  sums.st_Differential.Fill( NumericTraits< DerivativeValueType >::Zero );
+
+  /** Loop over the samples of this thread. */
+  this->Superclass::ThreadedGetValueAndDerivative( threadID );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedUpdateValueTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  /** Update the sums needed to calculate the value of NC. */
+  CorrelationPerThreadStruct & sums
+    = this->m_CorrelationPerThreadVariables[ context.st_ThreadID ];
+  sums.st_Sff += fixedImageValue  * fixedImageValue;
+  sums.st_Smm += movingImageValue * movingImageValue;
+  sums.st_Sfm += fixedImageValue  * movingImageValue;
+  sums.st_Sf  += fixedImageValue;
+  sums.st_Sm  += movingImageValue;
+
+} // end ThreadedUpdateValueTerms()
+
+
+/**
+ * ******************* ThreadedUpdateValueAndDerivativeTerms *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::ThreadedUpdateValueAndDerivativeTerms(
+  const RealType fixedImageValue,
+  const RealType movingImageValue,
+  EvaluationContextStruct & context ) const
+{
+  /** Update the sums needed to calculate the value of NC. */
+  this->ThreadedUpdateValueTerms( fixedImageValue, movingImageValue, context );
+
+  /** Compute this sample's contribution to the derivative terms. */
+  CorrelationPerThreadStruct & sums
+    = this->m_CorrelationPerThreadVariables[ context.st_ThreadID ];
+  this->UpdateDerivativeTerms(
+    fixedImageValue, movingImageValue,
+    context.st_ImageJacobian, *context.st_ImageJacobianIndices,
+    sums.st_DerivativeF, sums.st_DerivativeM, sums.st_Differential );
+
+} // end ThreadedUpdateValueAndDerivativeTerms()
+
+
+/**
+ * ******************* GatherCorrelationSums *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::GatherCorrelationSums( CorrelationPerThreadStruct & sums,
+  bool withDerivatives ) const
+{
+  typedef typename DerivativeType::ValueType        DerivativeValueType;
+
+  /** Gather the number of valid samples, and check if enough were valid. */
+  MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+  this->GatherThreadedValues( dummyValue );
+
+  /** Sum the sums of all threads. */
+  const unsigned int numberOfThreads = this->GetNumberOfThreads();
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  sums.st_Sff = sums.st_Smm = sums.st_Sfm = NumericTraits< AccumulateType >::Zero;
+  sums.st_Sf = sums.st_Sm = NumericTraits< AccumulateType >::Zero;
+  if ( withDerivatives )
+  {
+    sums.st_DerivativeF.SetSize( numberOfParameters );
+    sums.st_DerivativeM.SetSize( numberOfParameters );
+    sums.st_Differential.SetSize( numberOfParameters );
+    sums.st_DerivativeF.Fill( NumericTraits< DerivativeValueType >::Zero );
+    sums.st_DerivativeM.Fill( NumericTraits< DerivativeValueType >::Zero );
+    sums.st_Differential.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    const CorrelationPerThreadStruct & perThread
+      = this->m_CorrelationPerThreadVariables[ i ];
+    sums.st_Sff += perThread.st_Sff;
+    sums.st_Smm += perThread.st_Smm;
+    sums.st_Sfm += perThread.st_Sfm;
+    sums.st_Sf  += perThread.st_Sf;
+    sums.st_Sm  += perThread.st_Sm;
+    if ( withDerivatives )
+    {
+      sums.st_DerivativeF += perThread.st_DerivativeF;
+      sums.st_DerivativeM += perThread.st_DerivativeM;
+      sums.st_Differential += perThread.st_Differential;
+    }
+  }
+
+} // end GatherCorrelationSums()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  /** Gather the sums of all threads. */
+  CorrelationPerThreadStruct sums;
+  this->GatherCorrelationSums( sums, false );
+  AccumulateType sff = sums.st_Sff;
+  AccumulateType smm = sums.st_Smm;
+  AccumulateType sfm = sums.st_Sfm;
+
+  /** If SubtractMean, then subtract things from sff, smm and sfm. */
+  const RealType N = static_cast<RealType>( this->m_NumberOfPixelsCounted );
+  if ( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
+  {
+    sff -= ( sums.st_Sf * sums.st_Sf / N );
+    smm -= ( sums.st_Sm * sums.st_Sm / N );
+    sfm -= ( sums.st_Sf * sums.st_Sm / N );
+  }
+
+  /** The denominator of the NC. */
+  const RealType denom = -1.0 * vcl_sqrt( sff * smm );
+
+  /** Calculate the measure value. */
+  if ( this->m_NumberOfPixelsCounted > 0 && denom < -1e-14 )
+  {
+    value = sfm / denom;
+  }
+  else
+  {
+    value = NumericTraits< MeasureType >::Zero;
+  }
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  typedef typename DerivativeType::ValueType        DerivativeValueType;
+
+  /** Gather the sums of all threads. */
+  CorrelationPerThreadStruct sums;
+  this->GatherCorrelationSums( sums, true );
+  AccumulateType sff = sums.st_Sff;
+  AccumulateType smm = sums.st_Smm;
+  AccumulateType sfm = sums.st_Sfm;
+  DerivativeType & derivativeF = sums.st_DerivativeF;
+  DerivativeType & derivativeM = sums.st_DerivativeM;
+  const DerivativeType & differential = sums.st_Differential;
+
+  /** If SubtractMean, then subtract things from sff, smm, sfm,
+   * derivativeF and derivativeM.
+   */
+  const RealType N = static_cast<RealType>( this->m_NumberOfPixelsCounted );
+  if ( this->m_SubtractMean && this->m_NumberOfPixelsCounted > 0 )
+  {
+    sff -= ( sums.st_Sf * sums.st_Sf / N );
+    smm -= ( sums.st_Sm * sums.st_Sm / N );
+    sfm -= ( sums.st_Sf * sums.st_Sm / N );
+
+    for ( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
+    {
+      derivativeF[ i ] -= sums.st_Sf * differential[ i ] / N;
+      derivativeM[ i ] -= sums.st_Sm * differential[ i ] / N;
+    }
+  }
+
+  /** The denominator of the value and the derivative. */
+  const RealType denom = -1.0 * vcl_sqrt( sff * smm );
+
+  /** Calculate the value and the derivative. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  if ( this->m_NumberOfPixelsCounted > 0 && denom < -1e-14 )
+  {
+    value = sfm / denom;
+    for ( unsigned int i = 0; i < this->GetNumberOfParameters(); i++ )
+    {
+      derivative[ i ] = ( derivativeF[ i ] - ( sfm / smm ) * derivativeM[ i ] )
+        / denom;
+    }
+  }
+  else
+  {
+    value = NumericTraits< MeasureType >::Zero;
+    derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
 
 
 } // end namespace itk
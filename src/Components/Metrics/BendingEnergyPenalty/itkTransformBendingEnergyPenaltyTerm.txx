@@ -62,7 +62,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -78,7 +78,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -180,7 +180,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   bool transformIsBSpline = this->CheckForBSplineTransform( dummy );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -201,7 +201,7 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
      */
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
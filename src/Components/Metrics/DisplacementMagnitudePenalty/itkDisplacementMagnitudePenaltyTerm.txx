@@ -70,7 +70,7 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -86,7 +86,7 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -170,7 +170,7 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
   this->SetTransformParameters( parameters );
 
   /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
+  this->UpdateImageSampler();
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create iterator over the sample container. */
@@ -186,7 +186,7 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
     MovingImagePointType mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = this->TransformPoint( fixedPoint, fiter.Index(), mappedPoint );
 
     /** Check if point is inside mask. */
     if ( sampleOk )
@@ -199,7 +199,10 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
       this->m_NumberOfPixelsCounted++;
 
       /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      const TransformJacobianType * sampleJacobian = 0;
+      const NonZeroJacobianIndicesType * sampleNzji = 0;
+      this->EvaluateTransformJacobian( fixedPoint, fiter.Index(),
+        jacobian, nzji, sampleJacobian, sampleNzji );
 
       /** Compute displacement */
       VectorType vec = mappedPoint - fixedPoint;
@@ -214,8 +217,8 @@ DisplacementMagnitudePenaltyTerm< TFixedImage, TScalarType >
         const double vecd = vec[d];
         for (unsigned int i = 0; i < nrNonZeroJacobianIndices; ++i )
         {
-          const unsigned int mu = nzji[i];
-          derivative[mu] += vecd * jacobian(d,i);
+          const unsigned int mu = ( *sampleNzji )[i];
+          derivative[mu] += vecd * ( *sampleJacobian )(d,i);
         }
       }
     } // end if sampleOk
@@ -130,6 +130,7 @@ namespace itk
       Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
     typedef typename
       Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+    typedef typename Superclass::AdvancedTransformType      AdvancedTransformType;
 
     /** The fixed image dimension. */
     itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -146,6 +147,10 @@ namespace itk
     void GetValueAndDerivative( const ParametersType& parameters,
       MeasureType& Value, DerivativeType& Derivative ) const;
 
+    /** Create an evaluator of this metric; see the superclass. */
+    virtual typename Superclass::Superclass::Pointer CreateEvaluator(
+      AdvancedTransformType * transform = 0 ) const;
+
   protected:
 
     /** The constructor. */
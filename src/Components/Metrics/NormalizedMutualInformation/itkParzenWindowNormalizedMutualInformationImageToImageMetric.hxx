@@ -42,6 +42,28 @@ namespace itk
   } // end PrintSelf
 
 
+  /**
+   * ********************* CreateEvaluator ******************************
+   */
+
+  template < class TFixedImage, class TMovingImage >
+    typename ParzenWindowHistogramImageToImageMetric<TFixedImage,TMovingImage>
+    ::Superclass::Pointer
+    ParzenWindowNormalizedMutualInformationImageToImageMetric<TFixedImage,TMovingImage>
+    ::CreateEvaluator( AdvancedTransformType * transform ) const
+  {
+    Pointer evaluator = Self::New();
+
+    if ( !this->InitializeEvaluator( evaluator, transform ) )
+    {
+      return 0;
+    }
+
+    return evaluator.GetPointer();
+
+  } // end CreateEvaluator()
+
+
    /**
     * ********************** ComputeLogMarginalPDF***********************
     */
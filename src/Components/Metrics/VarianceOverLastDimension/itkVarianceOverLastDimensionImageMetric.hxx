@@ -145,38 +145,6 @@ namespace itk
     }
   } // end SampleRandom
 
-  /**
-   * *************** EvaluateTransformJacobianInnerProduct ****************
-   */
-
-  template < class TFixedImage, class TMovingImage >
-    void
-    VarianceOverLastDimensionImageMetric<TFixedImage,TMovingImage>
-    ::EvaluateTransformJacobianInnerProduct(
-    const TransformJacobianType & jacobian,
-    const MovingImageDerivativeType & movingImageDerivative,
-    DerivativeType & imageJacobian ) const
-  {
-    typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-    typedef typename DerivativeType::iterator              DerivativeIteratorType;
-    JacobianIteratorType jac = jacobian.begin();
-    imageJacobian.Fill( 0.0 );
-    const unsigned int sizeImageJacobian = imageJacobian.GetSize();
-    for ( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
-    {
-      const double imDeriv = movingImageDerivative[ dim ];
-      DerivativeIteratorType imjac = imageJacobian.begin();
-
-      for ( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
-      {
-        (*imjac) += (*jac) * imDeriv;
-        ++imjac;
-        ++jac;
-      }
-    }
-  } // end EvaluateTransformJacobianInnerProduct
-
-
   /**
    * ******************* GetValue *******************
    */
@@ -196,7 +164,7 @@ namespace itk
     this->SetTransformParameters( parameters );
 
     /** Update the imageSampler and get a handle to the sample container. */
-    this->GetImageSampler()->Update();
+    this->UpdateImageSampler();
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
     /** Create iterator over the sample container. */
@@ -349,7 +317,7 @@ namespace itk
     this->SetTransformParameters( parameters );
 
     /** Update the imageSampler and get a handle to the sample container. */
-    this->GetImageSampler()->Update();
+    this->UpdateImageSampler();
     ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
     /** Create iterator over the sample container. */
@@ -22,6 +22,12 @@
 #include "elxProgressCommand.h"
 #include "itkAdvancedTransform.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkMultiThreader.h"
+#include "itkSimpleFastMutexLock.h"
+#include "vnl/vnl_diag_matrix.h"
+#include "vnl/vnl_sparse_matrix.h"
+#include <vector>
+#include <string>
 
 namespace elastix
 {
@@ -158,6 +164,26 @@ namespace elastix
   *   Default/recommended: 100000. This works in general. If the image is smaller, the number
   *   of samples is automatically reduced. In principle, the more the better, but the slower.
   *   The parameter has only influence when AutomaticParameterEstimation is used.
+  * \parameter UseMultiThreadingForAutomaticParameterEstimation: Whether the computation of
+  *   the Jacobian terms, needed for the automatic parameter estimation, is distributed over
+  *   multiple threads. The number of threads is bounded by the MaximumNumberOfThreads command
+  *   line option. The gradients that are sampled afterwards are computed by the metric,
+  *   which follows its own UseMultiThreadingForMetrics setting.
+  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+  *   example: <tt>(UseMultiThreadingForAutomaticParameterEstimation "false")</tt>\n
+  *   Default value: "true".
+  *   The parameter has only influence when AutomaticParameterEstimation is used.
+  * \parameter ReuseAutomaticParameterEstimation: When set to "true", the settings found by the
+  *   automatic parameter estimation are remembered, and reused when the estimation is requested
+  *   again for the same transform (including its B-spline grid and current parameters), the same
+  *   images, samplers and masks, and the same estimation settings. This typically happens when
+  *   the same registration is run repeatedly within one process. The settings are kept in
+  *   the memory of that process only, so they are not shared between separate elastix runs. To reuse them over
+  *   runs, copy the SP_a, SigmoidMin etc. printed to the elastix.log to the parameter file.
+  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+  *   example: <tt>(ReuseAutomaticParameterEstimation "true")</tt>\n
+  *   Default value: "false".
+  *   The parameter has only influence when AutomaticParameterEstimation is used.
   *
   * \todo: this class contains a lot of functional code, which actually does not belong here.
   *
@@ -254,6 +280,20 @@ public:
   /** Get the MaximumNumberOfSamplingAttempts. */
   itkGetConstReferenceMacro( MaximumNumberOfSamplingAttempts, unsigned long );
 
+  /** Set/Get whether the computation of the Jacobian terms is distributed
+   * over multiple threads. Default: true.
+   */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Set/Get whether the automatically estimated settings may be reused,
+   * when the estimation is repeated under the same circumstances. Default: false.
+   */
+  itkSetMacro( ReuseAutomaticParameterEstimation, bool );
+  itkGetConstMacro( ReuseAutomaticParameterEstimation, bool );
+  itkBooleanMacro( ReuseAutomaticParameterEstimation );
+
 protected:
 
   /** Protected typedefs */
@@ -302,6 +342,68 @@ protected:
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for the covariance matrix of the Jacobian terms. */
+  typedef double                                      CovarianceValueType;
+  typedef Array2D<CovarianceValueType>                CovarianceMatrixType;
+  typedef vnl_sparse_matrix<CovarianceValueType>      SparseCovarianceMatrixType;
+  typedef vnl_diag_matrix<CovarianceValueType>        DiagCovarianceMatrixType;
+  typedef std::vector<unsigned int>                   BandCovarianceMapType;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::MultiThreader                          ThreaderType;
+  typedef ThreaderType::ThreadInfoStruct              ThreadInfoType;
+
+  /** Containers for the Jacobians of a block of samples, see
+   * ComputeJacobianTerms.
+   */
+  typedef std::vector<JacobianType>                   JacobianContainerType;
+  typedef std::vector<NonZeroJacobianIndicesType>     NonZeroJacobianIndicesContainerType;
+
+  /** The maxima that each thread computes in ComputeJacobianTerms. */
+  struct JacobianTermsPerThreadStruct
+  {
+    double  st_MaxJJ;
+    double  st_MaxJCJ;
+  };
+  typedef std::vector<JacobianTermsPerThreadStruct>   JacobianTermsPerThreadType;
+
+  /** The parameters that are passed to the threader callbacks of
+   * ComputeJacobianTerms.
+   */
+  struct JacobianTermsThreaderParameterType
+  {
+    Self *                              st_Optimizer;
+    const ImageSampleContainerType *    st_SampleContainer;
+    SparseCovarianceMatrixType *        st_Covariance;
+    CovarianceMatrixType *              st_BandCovariance;
+    const BandCovarianceMapType *       st_BandCovarianceMap;
+    const DiagCovarianceMatrixType *    st_DiagonalCovariance;
+    JacobianTermsPerThreadType *        st_PerThreadVariables;
+    ProgressCommandType *               st_ProgressObserver;
+    JacobianContainerType *             st_Jacobians;
+    NonZeroJacobianIndicesContainerType * st_JacobianIndices;
+    unsigned long                       st_BlockBegin;
+    unsigned long                       st_BlockEnd;
+  };
+
+  /** The quantities that determine the outcome of the automatic parameter
+   * estimation. Used to decide whether earlier estimated settings may be reused.
+   */
+  struct EstimationKeyType
+  {
+    std::string          st_Description;
+    std::vector<double>  st_Values;
+  };
+
+  /** An entry of the cache of estimated settings. */
+  struct EstimationCacheEntryType
+  {
+    EstimationKeyType  st_Key;
+    SettingsType       st_Settings;
+    bool               st_UseAdaptiveStepSizes;
+  };
+  typedef std::vector<EstimationCacheEntryType>       EstimationCacheType;
+
   AdaptiveStochasticGradientDescent();
   virtual ~AdaptiveStochasticGradientDescent() {};
 
@@ -355,10 +457,55 @@ protected:
     ImageSampleContainerPointer & sampleContainer );
 
   /** Functions to compute the Jacobian terms needed for the automatic
-   * parameter estimation.
+   * parameter estimation, using the samples in the sample container.
+   */
+  virtual void ComputeJacobianTerms(
+    const ImageSampleContainerType * sampleContainer,
+    double & TrC, double & TrCC, double & maxJJ, double & maxJCJ );
+
+  /** Compute the Jacobians of the part of the current block of samples
+   * that belongs to this thread, and store them in st_Jacobians.
+   * Used by ComputeJacobianTerms.
+   */
+  virtual void ThreadedComputeJacobians(
+    const JacobianTermsThreaderParameterType & parameters,
+    unsigned int threadID, unsigned int numberOfThreads );
+
+  /** Accumulate the upper triangular part of the sum of J_j^T J_j over the
+   * current block of samples, in the rows of the covariance matrix that
+   * belong to this thread. The Jacobians are read from st_Jacobians.
+   * Used by ComputeJacobianTerms.
+   */
+  virtual void ThreadedComputeCovariance(
+    const JacobianTermsThreaderParameterType & parameters,
+    unsigned int threadID, unsigned int numberOfThreads );
+
+  /** Compute maxJJ and maxJCJ for the part of the samples that belongs to
+   * this thread. Used by ComputeJacobianTerms.
    */
-  virtual void ComputeJacobianTerms( double & TrC, double & TrCC,
-    double & maxJJ, double & maxJCJ );
+  virtual void ThreadedComputeMaxJJAndMaxJCJ(
+    const JacobianTermsThreaderParameterType & parameters,
+    unsigned int threadID, unsigned int numberOfThreads );
+
+  /** The threader callbacks, which call the three functions above. */
+  static ITK_THREAD_RETURN_TYPE ComputeJacobiansThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE ComputeCovarianceThreaderCallback( void * arg );
+  static ITK_THREAD_RETURN_TYPE ComputeMaxJJAndMaxJCJThreaderCallback( void * arg );
+
+  /** Collect everything the outcome of the automatic parameter estimation
+   * depends on: the estimation settings, the transform and its current
+   * parameters, the samplers and the images.
+   */
+  virtual void ComputeEstimationKey(
+    const ImageSampleContainerType * sampleContainer,
+    EstimationKeyType & key );
+
+  /** Append the geometry and a checksum of the pixel values of an image
+   * to the estimation key.
+   */
+  template <class TImage>
+  static void AppendImageToEstimationKey(
+    const TImage * image, EstimationKeyType & key );
 
   /** Helper function, which calls GetScaledValueAndDerivative and does
    * some exception handling. Used by SampleGradients.
@@ -389,6 +536,19 @@ private:
   unsigned long m_MaxBandCovSize;
   unsigned long m_NumberOfBandStructureSamples;
 
+  /** Private variables for multi-threading. */
+  bool                    m_UseMultiThread;
+  ThreaderType::Pointer   m_Threader;
+
+  /** Private variables for the reuse of estimated settings. The cache is
+   * shared by all instances, since every registration creates a new optimizer.
+   * Being a static member, it only lives as long as the process: it is never
+   * written to disk, and separate elastix processes do not share it.
+   */
+  bool                        m_ReuseAutomaticParameterEstimation;
+  static EstimationCacheType  s_EstimationCache;
+  static SimpleFastMutexLock  s_EstimationCacheLock;
+
 }; // end class AdaptiveStochasticGradientDescent
 
 
@@ -28,12 +28,26 @@
 #include "vnl/vnl_sparse_matrix.h"
 #include "vnl/vnl_matlab_filewrite.h"
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkImageRegionConstIterator.h"
 #include "elxTimer.h"
 
 namespace elastix
 {
   using namespace itk;
 
+/**
+ * ********************** Static variables ***********************
+ */
+
+template <class TElastix>
+typename AdaptiveStochasticGradientDescent<TElastix>::EstimationCacheType
+AdaptiveStochasticGradientDescent<TElastix>::s_EstimationCache;
+
+template <class TElastix>
+SimpleFastMutexLock
+AdaptiveStochasticGradientDescent<TElastix>::s_EstimationCacheLock;
+
+
 /**
  * ********************** Constructor ***********************
  */
@@ -58,6 +72,10 @@ AdaptiveStochasticGradientDescent<TElastix>
   this->m_RandomGenerator = RandomGeneratorType::New();
   this->m_AdvancedTransform = 0;
 
+  this->m_UseMultiThread = true;
+  this->m_Threader = ThreaderType::New();
+  this->m_ReuseAutomaticParameterEstimation = false;
+
 } // Constructor
 
 
@@ -213,6 +231,19 @@ void AdaptiveStochasticGradientDescent<TElastix>
         "SigmoidScaleFactor", this->GetComponentLabel(), level, 0 );
       this->m_SigmoidScaleFactor = sigmoidScaleFactor;
 
+    /** Set whether the Jacobian terms are computed multi-threaded. */
+    bool useMultiThreading = true;
+    this->GetConfiguration()->ReadParameter( useMultiThreading,
+      "UseMultiThreadingForAutomaticParameterEstimation",
+      this->GetComponentLabel(), level, 0 );
+    this->SetUseMultiThread( useMultiThreading );
+
+    /** Set whether earlier estimated settings may be reused. */
+    bool reuseAutomaticParameterEstimation = false;
+    this->GetConfiguration()->ReadParameter( reuseAutomaticParameterEstimation,
+      "ReuseAutomaticParameterEstimation", this->GetComponentLabel(), level, 0 );
+    this->SetReuseAutomaticParameterEstimation( reuseAutomaticParameterEstimation );
+
   } // end if automatic parameter estimation
   else
   {
@@ -480,13 +511,57 @@ AdaptiveStochasticGradientDescent<TElastix>
   /** Get the user input. */
   const double delta = this->GetMaximumStepLength();
 
+  /** Get the samples for the computation of the Jacobian terms. */
+  ImageSampleContainerPointer sampleContainer = 0;
+  this->SampleFixedImageForJacobianTerms( sampleContainer );
+
+  /** Check if the settings were estimated before under the same circumstances. */
+  EstimationKeyType key;
+  if ( this->GetReuseAutomaticParameterEstimation() )
+  {
+    this->ComputeEstimationKey( sampleContainer, key );
+
+    bool found = false;
+    EstimationCacheEntryType entry;
+    s_EstimationCacheLock.Lock();
+    for ( unsigned int i = 0; i < s_EstimationCache.size(); ++i )
+    {
+      const EstimationKeyType & cachedKey = s_EstimationCache[ i ].st_Key;
+      if ( cachedKey.st_Description == key.st_Description
+        && cachedKey.st_Values == key.st_Values )
+      {
+        entry = s_EstimationCache[ i ];
+        found = true;
+        break;
+      }
+    }
+    s_EstimationCacheLock.Unlock();
+
+    if ( found )
+    {
+      this->SetParam_a( entry.st_Settings.a );
+      this->SetParam_alpha( entry.st_Settings.alpha );
+      this->SetSigmoidMax( entry.st_Settings.fmax );
+      this->SetSigmoidMin( entry.st_Settings.fmin );
+      this->SetSigmoidScale( entry.st_Settings.omega );
+      this->SetUseAdaptiveStepSizes( entry.st_UseAdaptiveStepSizes );
+
+      timer1->StopTimer();
+      elxout << "  Reused the settings of an earlier estimation." << std::endl;
+      elxout << "Automatic parameter estimation took "
+        << timer1->PrintElapsedTimeDHMS()
+        << std::endl;
+      return;
+    }
+  }
+
   /** Compute the Jacobian terms. */
   double TrC = 0.0;
   double TrCC = 0.0;
   double maxJJ = 0.0;
   double maxJCJ = 0.0;
   timer2->StartTimer();
-  this->ComputeJacobianTerms( TrC, TrCC, maxJJ, maxJCJ );
+  this->ComputeJacobianTerms( sampleContainer, TrC, TrCC, maxJJ, maxJCJ );
   timer2->StopTimer();
   elxout << "  Computing the Jacobian terms took "
     << timer2->PrintElapsedTimeDHMS()
@@ -575,6 +650,30 @@ AdaptiveStochasticGradientDescent<TElastix>
   this->SetSigmoidMin( fmin );
   this->SetSigmoidScale( omega );
 
+  /** Remember the settings, for reuse. Only a limited number of entries
+   * is stored, since the keys contain all transform parameters.
+   */
+  if ( this->GetReuseAutomaticParameterEstimation() )
+  {
+    EstimationCacheEntryType entry;
+    entry.st_Key = key;
+    entry.st_Settings.a = a;
+    entry.st_Settings.A = A;
+    entry.st_Settings.alpha = alpha;
+    entry.st_Settings.fmax = fmax;
+    entry.st_Settings.fmin = fmin;
+    entry.st_Settings.omega = omega;
+    entry.st_UseAdaptiveStepSizes = this->GetUseAdaptiveStepSizes();
+
+    s_EstimationCacheLock.Lock();
+    if ( s_EstimationCache.size() >= 16 )
+    {
+      s_EstimationCache.erase( s_EstimationCache.begin() );
+    }
+    s_EstimationCache.push_back( entry );
+    s_EstimationCacheLock.Unlock();
+  }
+
   /** Print the elapsed time. */
   timer1->StopTimer();
   elxout << "Automatic parameter estimation took "
@@ -774,8 +873,8 @@ AdaptiveStochasticGradientDescent<TElastix>
 template <class TElastix>
 void
 AdaptiveStochasticGradientDescent<TElastix>
-::ComputeJacobianTerms( double & TrC, double & TrCC,
-  double & maxJJ, double & maxJCJ )
+::ComputeJacobianTerms( const ImageSampleContainerType * sampleContainer,
+  double & TrC, double & TrCC, double & maxJJ, double & maxJCJ )
 {
   /** This function computes four terms needed for the automatic parameter
    * estimation. The equation number refers to the IJCV paper.
@@ -793,25 +892,13 @@ AdaptiveStochasticGradientDescent<TElastix>
    * Term 4: maxJCJ, see (54)
    */
 
-  typedef double                                      CovarianceValueType;
-  typedef Array2D<CovarianceValueType>                CovarianceMatrixType;
-  typedef vnl_sparse_matrix<CovarianceValueType>      SparseCovarianceMatrixType;
-  typedef typename SparseCovarianceMatrixType::row    SparseRowType;
-  typedef typename SparseCovarianceMatrixType::pair_t SparseCovarianceElementType;
-  typedef Array<unsigned int>           NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix<CovarianceValueType>        DiagCovarianceMatrixType;
-  typedef vnl_vector<CovarianceValueType>             JacobianColumnType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
   this->CheckForAdvancedTransform();
 
-  /** Get samples. */
-  ImageSampleContainerPointer sampleContainer = 0;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
+  /** Get the number of samples. */
   const unsigned int nrofsamples = sampleContainer->Size();
-  const double n = static_cast<double>( nrofsamples );
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast<unsigned int>(
@@ -826,12 +913,6 @@ AdaptiveStochasticGradientDescent<TElastix>
   /** Get scales vector */
   const ScalesType & scales = this->m_ScaledCostFunction->GetScales();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
-  unsigned int samplenr = 0;
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
   const unsigned int sizejacind
     = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
@@ -840,17 +921,12 @@ AdaptiveStochasticGradientDescent<TElastix>
   NonZeroJacobianIndicesType jacind( sizejacind );
   jacind[ 0 ] = 0;
   if ( sizejacind > 1 ) jacind[ 1 ] = 0;
-  NonZeroJacobianIndicesType prevjacind = jacind;
 
   /** Initialize covariance matrix. Sparse, diagonal, and band form. */
   SparseCovarianceMatrixType cov( P, P );
   DiagCovarianceMatrixType diagcov( P, 0.0 );
   CovarianceMatrixType bandcov;
 
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac( sizejacind, sizejacind );
-  jactjac.Fill( 0.0 );
-
   /** Prepare for progress printing. */
   ProgressCommandPointer progressObserver = ProgressCommandType::New();
   progressObserver->SetUpdateFrequency( nrofsamples * 2, 100 );
@@ -938,9 +1014,9 @@ AdaptiveStochasticGradientDescent<TElastix>
     static_cast<unsigned int>(difHist2.size()) );
   elxout << "  Used band size covariance matrix: " << bandcovsize << std::endl;
   /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
-  std::vector<unsigned int> bandcovMap( P, bandcovsize );
+  BandCovarianceMapType bandcovMap( P, bandcovsize );
   /** Maps colnr in bandcov to parameterNrDifference (q-p). */
-  std::vector<unsigned int> bandcovMap2( bandcovsize, P );
+  BandCovarianceMapType bandcovMap2( bandcovsize, P );
 
   /** Sort the difHist2 based on the frequencies. */
   std::sort( difHist2.begin(), difHist2.end() );
@@ -958,6 +1034,37 @@ AdaptiveStochasticGradientDescent<TElastix>
   bandcov = CovarianceMatrixType( P, bandcovsize );
   bandcov.Fill( 0.0 );
 
+  /** Setup the threader. */
+  this->m_Threader->SetNumberOfThreads( this->m_UseMultiThread
+    ? ThreaderType::GetGlobalDefaultNumberOfThreads() : 1 );
+  const unsigned int numberOfThreads = this->m_Threader->GetNumberOfThreads();
+  JacobianTermsPerThreadType perThreadVariables( numberOfThreads );
+
+  /** The samples are processed in blocks. The Jacobians of a block are
+   * computed once, divided over the threads, and stored. The threads then
+   * read them to accumulate their own rows of the covariance matrix. The
+   * block size limits the memory for the stored Jacobians to about 32 MB.
+   */
+  const unsigned long jacobianSize = static_cast<unsigned long>( outdim ) * sizejacind;
+  const unsigned long blockSize = vnl_math_max( 1ul, vnl_math_min(
+    static_cast<unsigned long>( nrofsamples ), ( 1ul << 22 ) / jacobianSize ) );
+  JacobianContainerType jacobians( blockSize, jacj );
+  NonZeroJacobianIndicesContainerType jacobianIndices( blockSize, jacind );
+
+  JacobianTermsThreaderParameterType threaderParameters;
+  threaderParameters.st_Optimizer = this;
+  threaderParameters.st_SampleContainer = sampleContainer;
+  threaderParameters.st_Covariance = &cov;
+  threaderParameters.st_BandCovariance = &bandcov;
+  threaderParameters.st_BandCovarianceMap = &bandcovMap;
+  threaderParameters.st_DiagonalCovariance = &diagcov;
+  threaderParameters.st_PerThreadVariables = &perThreadVariables;
+  threaderParameters.st_ProgressObserver = progressObserver.GetPointer();
+  threaderParameters.st_Jacobians = &jacobians;
+  threaderParameters.st_JacobianIndices = &jacobianIndices;
+  threaderParameters.st_BlockBegin = 0;
+  threaderParameters.st_BlockEnd = 0;
+
   /**
    *    TERM 1
    *
@@ -965,102 +1072,27 @@ AdaptiveStochasticGradientDescent<TElastix>
    * Compute C = 1/n \sum_i J_i^T J_i
    * Possibly apply scaling afterwards.
    */
-  jacind[ 0 ] = 0;
-  if ( sizejacind > 1 ) jacind[ 1 ] = 0;
-  for ( iter = begin; iter != end; ++iter )
+  for ( unsigned long blockBegin = 0; blockBegin < nrofsamples; blockBegin += blockSize )
   {
-    /** Print progress 0-50%. */
-    progressObserver->UpdateAndPrintProgress( samplenr );
-    ++samplenr;
-
-    /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
-    this->m_AdvancedTransform->GetJacobian( point, jacj, jacind  );
+    threaderParameters.st_BlockBegin = blockBegin;
+    threaderParameters.st_BlockEnd = vnl_math_min(
+      static_cast<unsigned long>( nrofsamples ), blockBegin + blockSize );
 
-    /** Skip invalid Jacobians in the beginning, if any. */
-    if ( sizejacind > 1 )
-    {
-      if ( jacind[ 0 ] == jacind[ 1 ] )
-      {
-        continue;
-      }
-    }
+    this->m_Threader->SetSingleMethod( this->ComputeJacobiansThreaderCallback,
+      &threaderParameters );
+    this->m_Threader->SingleMethodExecute();
 
-    if ( jacind == prevjacind )
-    {
-      /** Update sum of J_j^T J_j. */
-      vnl_fastops::inc_X_by_AtA( jactjac, jacj );
-    }
-    else
-    {
-      /** The following should only be done after the first sample. */
-      if ( iter != begin )
-      {
-        /** Update covariance matrix. */
-        for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-        {
-          const unsigned int p = prevjacind[ pi ];
+    this->m_Threader->SetSingleMethod( this->ComputeCovarianceThreaderCallback,
+      &threaderParameters );
+    this->m_Threader->SingleMethodExecute();
 
-          for ( unsigned int qi = 0; qi < sizejacind; ++qi )
-          {
-            const unsigned int q = prevjacind[ qi ];
-            /** Exploit symmetry: only fill upper triangular part. */
-            if ( q >= p )
-            {
-              const double tempval = jactjac( pi, qi ) / n;
-              if ( vcl_abs( tempval ) > 1e-14 )
-              {
-                const unsigned int bandindex = bandcovMap[ q - p ];
-                if ( bandindex < bandcovsize )
-                {
-                  bandcov( p, bandindex ) +=tempval;
-                }
-                else
-                {
-                  cov( p, q ) += tempval;
-                }
-              }
-            }
-          } // qi
-        } // pi
-      } // end if
-
-      /** Initialize jactjac by J_j^T J_j. */
-      vnl_fastops::AtA( jactjac, jacj );
-
-      /** Remember nonzerojacobian indices. */
-      prevjacind = jacind;
-    } // end else
-
-  } // end iter loop: end computation of covariance matrix
+    /** Print progress 0-50%. */
+    progressObserver->UpdateAndPrintProgress( threaderParameters.st_BlockEnd );
+  }
 
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for ( unsigned int pi = 0; pi < sizejacind; ++pi )
-  {
-    const unsigned int p = prevjacind[ pi ];
-    for ( unsigned int qi = 0; qi < sizejacind; ++qi )
-    {
-      const unsigned int q = prevjacind[ qi ];
-      if ( q >= p )
-      {
-        const double tempval = jactjac( pi, qi ) / n;
-        if ( vcl_abs( tempval ) > 1e-14 )
-        {
-           const unsigned int bandindex  = bandcovMap[ q - p ];
-           if ( bandindex < bandcovsize )
-           {
-             bandcov( p, bandindex ) +=tempval;
-           }
-           else
-           {
-             cov( p, q ) += tempval;
-           }
-        }
-      }
-    } // qi
-  } // pi
+  /** Release the memory of the stored Jacobians. */
+  JacobianContainerType().swap( jacobians );
+  NonZeroJacobianIndicesContainerType().swap( jacobianIndices );
 
   /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
    * \todo: perhaps work further with this bandmatrix instead.
@@ -1132,9 +1164,308 @@ AdaptiveStochasticGradientDescent<TElastix>
    * Compute maxJJ and maxJCJ
    * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
    * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
+   * Each thread handles a part of the samples; the maxima are combined here.
    */
-  maxJJ = 0.0;
-  maxJCJ = 0.0;
+  this->m_Threader->SetSingleMethod( this->ComputeMaxJJAndMaxJCJThreaderCallback,
+    &threaderParameters );
+  this->m_Threader->SingleMethodExecute();
+
+  for ( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    maxJJ = vnl_math_max( maxJJ, perThreadVariables[ i ].st_MaxJJ );
+    maxJCJ = vnl_math_max( maxJCJ, perThreadVariables[ i ].st_MaxJCJ );
+  }
+
+  /** Finalize progress information. */
+  progressObserver->PrintProgress( 1.0 );
+
+} // end ComputeJacobianTerms()
+
+
+/**
+ * ******************** ComputeJacobiansThreaderCallback **********************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeJacobiansThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+
+  JacobianTermsThreaderParameterType * temp
+    = static_cast<JacobianTermsThreaderParameterType *>( infoStruct->UserData );
+
+  temp->st_Optimizer->ThreadedComputeJacobians( *temp, threadID, numberOfThreads );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeJacobiansThreaderCallback()
+
+
+/**
+ * ******************** ThreadedComputeJacobians **********************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::ThreadedComputeJacobians(
+  const JacobianTermsThreaderParameterType & parameters,
+  unsigned int threadID, unsigned int numberOfThreads )
+{
+  /** Each thread writes the Jacobians of its own range of samples only. */
+  const ImageSampleContainerType * sampleContainer = parameters.st_SampleContainer;
+  JacobianContainerType & jacobians = *( parameters.st_Jacobians );
+  NonZeroJacobianIndicesContainerType & jacobianIndices
+    = *( parameters.st_JacobianIndices );
+
+  /** Get the range of samples of this thread, within the current block. */
+  const unsigned long blockBegin = parameters.st_BlockBegin;
+  const unsigned long blockLength = parameters.st_BlockEnd - blockBegin;
+  const unsigned long chunk
+    = ( blockLength + numberOfThreads - 1 ) / numberOfThreads;
+  const unsigned long begin = vnl_math_min( blockLength, threadID * chunk );
+  const unsigned long end = vnl_math_min( blockLength, begin + chunk );
+
+  for ( unsigned long i = begin; i < end; ++i )
+  {
+    const FixedImagePointType point
+      = sampleContainer->GetElement( blockBegin + i ).m_ImageCoordinates;
+    this->m_AdvancedTransform->GetJacobian( point,
+      jacobians[ i ], jacobianIndices[ i ] );
+  }
+
+} // end ThreadedComputeJacobians()
+
+
+/**
+ * ******************** ComputeCovarianceThreaderCallback **********************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeCovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+
+  JacobianTermsThreaderParameterType * temp
+    = static_cast<JacobianTermsThreaderParameterType *>( infoStruct->UserData );
+
+  temp->st_Optimizer->ThreadedComputeCovariance( *temp, threadID, numberOfThreads );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeCovarianceThreaderCallback()
+
+
+/**
+ * ******************** ThreadedComputeCovariance **********************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::ThreadedComputeCovariance(
+  const JacobianTermsThreaderParameterType & parameters,
+  unsigned int threadID, unsigned int numberOfThreads )
+{
+  /** Each thread owns a contiguous range of rows of the covariance matrix,
+   * and only updates the elements in these rows. Different threads thus
+   * never write to the same row of cov and bandcov, so no locking is needed.
+   * The Jacobians of the current block were computed beforehand, by
+   * ThreadedComputeJacobians(), and are only read here.
+   */
+  const JacobianContainerType & jacobians = *( parameters.st_Jacobians );
+  const NonZeroJacobianIndicesContainerType & jacobianIndices
+    = *( parameters.st_JacobianIndices );
+  SparseCovarianceMatrixType & cov = *( parameters.st_Covariance );
+  CovarianceMatrixType & bandcov = *( parameters.st_BandCovariance );
+  const BandCovarianceMapType & bandcovMap = *( parameters.st_BandCovarianceMap );
+  const unsigned int bandcovsize = bandcov.cols();
+  const unsigned long P = cov.rows();
+  const unsigned int pmin = static_cast<unsigned int>( threadID * P / numberOfThreads );
+  const unsigned int pmax = static_cast<unsigned int>( ( threadID + 1 ) * P / numberOfThreads );
+  const unsigned long blockLength = parameters.st_BlockEnd - parameters.st_BlockBegin;
+  const double n = static_cast<double>(
+    parameters.st_SampleContainer->Size() );
+
+  /** Variables for nonzerojacobian indices. */
+  const unsigned int outdim = this->m_AdvancedTransform->GetOutputSpaceDimension();
+  const unsigned int sizejacind
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType prevjacind( sizejacind );
+  bool havePrevious = false;
+
+  /** For temporary storage of the rows of J'J that belong to this thread.
+   * ownedIndices contains the positions pi in jacind with p in [pmin,pmax).
+   */
+  CovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.Fill( 0.0 );
+  std::vector<unsigned int> ownedIndices;
+  ownedIndices.reserve( sizejacind );
+
+  for ( unsigned long i = 0; i <= blockLength; ++i )
+  {
+    /** Get the stored Jacobian J_j. */
+    const bool lastSample = ( i == blockLength );
+    const JacobianType & jacj = jacobians[ lastSample ? 0 : i ];
+    const NonZeroJacobianIndicesType & jacind = jacobianIndices[ lastSample ? 0 : i ];
+    if ( !lastSample )
+    {
+      /** Skip invalid Jacobians in the beginning, if any. */
+      if ( sizejacind > 1 )
+      {
+        if ( jacind[ 0 ] == jacind[ 1 ] )
+        {
+          continue;
+        }
+      }
+    }
+
+    /** When the nonzero Jacobian indices change, and after the last sample
+     * of the block, add the accumulated J'J to the covariance matrix.
+     */
+    if ( lastSample || !havePrevious || jacind != prevjacind )
+    {
+      if ( havePrevious )
+      {
+        for ( unsigned int k = 0; k < ownedIndices.size(); ++k )
+        {
+          const unsigned int pi = ownedIndices[ k ];
+          const unsigned int p = prevjacind[ pi ];
+          for ( unsigned int qi = 0; qi < sizejacind; ++qi )
+          {
+            const unsigned int q = prevjacind[ qi ];
+            /** Exploit symmetry: only fill upper triangular part. */
+            if ( q >= p )
+            {
+              const double tempval = jactjac( pi, qi ) / n;
+              if ( vcl_abs( tempval ) > 1e-14 )
+              {
+                const unsigned int bandindex = bandcovMap[ q - p ];
+                if ( bandindex < bandcovsize )
+                {
+                  bandcov( p, bandindex ) += tempval;
+                }
+                else
+                {
+                  cov( p, q ) += tempval;
+                }
+              }
+            }
+          } // qi
+          jactjac.set_row( pi, 0.0 );
+        } // pi
+      }
+      if ( lastSample )
+      {
+        break;
+      }
+
+      /** Remember nonzerojacobian indices, and find the ones of this thread. */
+      prevjacind = jacind;
+      havePrevious = true;
+      ownedIndices.clear();
+      for ( unsigned int pi = 0; pi < sizejacind; ++pi )
+      {
+        if ( jacind[ pi ] >= pmin && jacind[ pi ] < pmax )
+        {
+          ownedIndices.push_back( pi );
+        }
+      }
+    } // end if new nonzero Jacobian indices
+
+    /** Update the rows of this thread of the sum of J_j^T J_j. */
+    for ( unsigned int k = 0; k < ownedIndices.size(); ++k )
+    {
+      const unsigned int pi = ownedIndices[ k ];
+      const unsigned int p = jacind[ pi ];
+      for ( unsigned int qi = 0; qi < sizejacind; ++qi )
+      {
+        if ( jacind[ qi ] >= p )
+        {
+          double sum = 0.0;
+          for ( unsigned int d = 0; d < outdim; ++d )
+          {
+            sum += jacj[ d ][ pi ] * jacj[ d ][ qi ];
+          }
+          jactjac( pi, qi ) += sum;
+        }
+      } // qi
+    } // pi
+
+  } // end loop over the samples of the block
+
+} // end ThreadedComputeCovariance()
+
+
+/**
+ * ******************** ComputeMaxJJAndMaxJCJThreaderCallback **********************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeMaxJJAndMaxJCJThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+
+  JacobianTermsThreaderParameterType * temp
+    = static_cast<JacobianTermsThreaderParameterType *>( infoStruct->UserData );
+
+  temp->st_Optimizer->ThreadedComputeMaxJJAndMaxJCJ( *temp, threadID, numberOfThreads );
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ComputeMaxJJAndMaxJCJThreaderCallback()
+
+
+/**
+ * ******************** ThreadedComputeMaxJJAndMaxJCJ **********************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::ThreadedComputeMaxJJAndMaxJCJ(
+  const JacobianTermsThreaderParameterType & parameters,
+  unsigned int threadID, unsigned int numberOfThreads )
+{
+  typedef typename SparseCovarianceMatrixType::row    SparseRowType;
+  typedef Array<unsigned int>           NonZeroJacobianIndicesExpandedType;
+
+  /** The covariance matrix is only read here, so the threads can share it. */
+  const ImageSampleContainerType * sampleContainer = parameters.st_SampleContainer;
+  SparseCovarianceMatrixType & cov = *( parameters.st_Covariance );
+  const DiagCovarianceMatrixType & diagcov = *( parameters.st_DiagonalCovariance );
+  const unsigned int P = cov.rows();
+  const ScalesType & scales = this->m_ScaledCostFunction->GetScales();
+  const bool useScales = this->GetUseScales();
+
+  /** Get the range of samples of this thread. */
+  const unsigned long nrofsamples = sampleContainer->Size();
+  const unsigned long chunk
+    = ( nrofsamples + numberOfThreads - 1 ) / numberOfThreads;
+  const unsigned long begin = vnl_math_min( nrofsamples, threadID * chunk );
+  const unsigned long end = vnl_math_min( nrofsamples, begin + chunk );
+
+  /** Thread-local variables. */
+  const unsigned int outdim = this->m_AdvancedTransform->GetOutputSpaceDimension();
+  const unsigned int sizejacind
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  double maxJJ = 0.0;
+  double maxJCJ = 0.0;
   const double sqrt2 = vcl_sqrt( static_cast<double>( 2.0 ) );
   JacobianType jacjjacj( outdim, outdim );
   JacobianType jacjcov( outdim, sizejacind );
@@ -1144,15 +1475,15 @@ AdaptiveStochasticGradientDescent<TElastix>
   JacobianType jacjcovjacj( outdim, outdim );
   NonZeroJacobianIndicesExpandedType jacindExpanded( P );
 
-  samplenr = 0;
-  for ( iter = begin; iter != end; ++iter )
+  for ( unsigned long samplenr = begin; samplenr < end; ++samplenr )
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
+    const FixedImagePointType point
+      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
     this->m_AdvancedTransform->GetJacobian( point, jacj, jacind  );
 
     /** Apply scales, if necessary. */
-    if ( this->GetUseScales() )
+    if ( useScales )
     {
       for ( unsigned int pi = 0; pi < sizejacind; ++pi )
       {
@@ -1198,8 +1529,8 @@ AdaptiveStochasticGradientDescent<TElastix>
       const unsigned int p = jacind[ pi ];
       if ( !cov.empty_row( p ) )
       {
-        SparseRowType & covrowp = cov.get_row( p );
-        typename SparseRowType::iterator covrowpit;
+        const SparseRowType & covrowp = cov.get_row( p );
+        typename SparseRowType::const_iterator covrowpit;
 
         /** Loop over row p of the sparse cov matrix. */
         for ( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
@@ -1244,16 +1575,19 @@ AdaptiveStochasticGradientDescent<TElastix>
     /** Max_j [JCJ_j]. */
     maxJCJ = vnl_math_max( maxJCJ, JCJ_j );
 
-    /** Show progress 50-100%. */
-    progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
+    /** Show progress 50-100%, estimated from the first thread. */
+    if ( threadID == 0 )
+    {
+      parameters.st_ProgressObserver->UpdateAndPrintProgress(
+        nrofsamples + ( samplenr - begin ) * numberOfThreads );
+    }
 
-  } // end loop over sample container
+  } // end loop over the samples of this thread
 
-  /** Finalize progress information. */
-  progressObserver->PrintProgress( 1.0 );
+  ( *parameters.st_PerThreadVariables )[ threadID ].st_MaxJJ = maxJJ;
+  ( *parameters.st_PerThreadVariables )[ threadID ].st_MaxJCJ = maxJCJ;
 
-} // end ComputeJacobianTerms()
+} // end ThreadedComputeMaxJJAndMaxJCJ()
 
 
 /**
@@ -1304,6 +1638,169 @@ AdaptiveStochasticGradientDescent<TElastix>
 } // end SampleFixedImageForJacobianTerms()
 
 
+/**
+ * **************** ComputeEstimationKey *******************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::ComputeEstimationKey( const ImageSampleContainerType * sampleContainer,
+  EstimationKeyType & key )
+{
+  typedef typename ElastixType::MetricBaseType::AdvancedMetricType MetricType;
+  std::ostringstream description;
+  std::vector<double> & values = key.st_Values;
+  values.clear();
+
+  /** The settings of the estimation. */
+  values.push_back( this->GetMaximumStepLength() );
+  values.push_back( this->GetParam_A() );
+  values.push_back( this->m_NumberOfGradientMeasurements );
+  values.push_back( this->m_NumberOfJacobianMeasurements );
+  values.push_back( this->m_NumberOfSamplesForExactGradient );
+  values.push_back( this->m_SigmoidScaleFactor );
+  values.push_back( this->m_MaxBandCovSize );
+  values.push_back( this->m_NumberOfBandStructureSamples );
+  values.push_back( this->GetUseAdaptiveStepSizes() );
+  values.push_back( this->GetNewSamplesEveryIteration() );
+
+  /** The scales. */
+  values.push_back( this->GetUseScales() );
+  if ( this->GetUseScales() )
+  {
+    const ScalesType & scales = this->GetScales();
+    values.insert( values.end(), scales.begin(), scales.end() );
+  }
+
+  /** The transform: its type, its grid (the fixed parameters),
+   * and the current position, at which the gradients are sampled.
+   */
+  typename TransformType::Pointer transform = this->GetRegistration()
+    ->GetAsITKBaseType()->GetTransform();
+  transform->SetParameters( this->GetCurrentPosition() );
+  description << transform->GetNameOfClass() << " ";
+  const ParametersType & fixedParameters = transform->GetFixedParameters();
+  values.push_back( fixedParameters.GetSize() );
+  values.insert( values.end(), fixedParameters.begin(), fixedParameters.end() );
+  const ParametersType & mu0 = this->GetScaledCurrentPosition();
+  values.push_back( mu0.GetSize() );
+  values.insert( values.end(), mu0.begin(), mu0.end() );
+
+  /** The samples for the Jacobian terms reflect the fixed image region and
+   * mask. Mapping them also covers an initial transform, if any.
+   */
+  const unsigned long nrofsamples = sampleContainer->Size();
+  values.push_back( nrofsamples );
+  for ( unsigned long i = 0; i < nrofsamples; ++i )
+  {
+    const FixedImagePointType & point
+      = sampleContainer->GetElement( i ).m_ImageCoordinates;
+    const typename TransformType::OutputPointType mappedPoint
+      = transform->TransformPoint( point );
+    for ( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      values.push_back( point[ d ] );
+    }
+    for ( unsigned int d = 0; d < MovingImageDimension; ++d )
+    {
+      values.push_back( mappedPoint[ d ] );
+    }
+  }
+
+  /** The metrics, their samplers and their images. */
+  const unsigned int M = this->GetElastix()->GetNumberOfMetrics();
+  for ( unsigned int m = 0; m < M; ++m )
+  {
+    description << this->GetElastix()->GetElxMetricBase( m )->elxGetClassName() << " ";
+
+    ImageSamplerBasePointer sampler =
+      this->GetElastix()->GetElxMetricBase( m )->GetAdvancedMetricImageSampler();
+    if ( sampler.IsNotNull() )
+    {
+      description << sampler->GetNameOfClass() << " ";
+      ImageRandomSamplerBaseType * randomSampler
+        = dynamic_cast< ImageRandomSamplerBaseType * >( sampler.GetPointer() );
+      if ( randomSampler )
+      {
+        values.push_back( randomSampler->GetNumberOfSamples() );
+      }
+      ImageRandomCoordinateSamplerType * randomCoordinateSampler
+        = dynamic_cast< ImageRandomCoordinateSamplerType * >( sampler.GetPointer() );
+      if ( randomCoordinateSampler )
+      {
+        values.push_back( randomCoordinateSampler->GetUseRandomSampleRegion() );
+      }
+    }
+
+    MetricType * metric = dynamic_cast<MetricType *>(
+      this->GetElastix()->GetElxMetricBase( m )->GetAsITKBaseType() );
+    if ( metric )
+    {
+      AppendImageToEstimationKey( metric->GetFixedImage(), key );
+      AppendImageToEstimationKey( metric->GetMovingImage(), key );
+    }
+  }
+
+  key.st_Description = description.str();
+
+} // end ComputeEstimationKey()
+
+
+/**
+ * **************** AppendImageToEstimationKey *******************
+ */
+
+template <class TElastix>
+template <class TImage>
+void
+AdaptiveStochasticGradientDescent<TElastix>
+::AppendImageToEstimationKey( const TImage * image, EstimationKeyType & key )
+{
+  std::vector<double> & values = key.st_Values;
+  if ( !image )
+  {
+    values.push_back( 0.0 );
+    return;
+  }
+
+  /** The geometry. */
+  const unsigned int dimension = TImage::ImageDimension;
+  const typename TImage::RegionType region = image->GetBufferedRegion();
+  for ( unsigned int d = 0; d < dimension; ++d )
+  {
+    values.push_back( region.GetIndex()[ d ] );
+    values.push_back( region.GetSize()[ d ] );
+    values.push_back( image->GetSpacing()[ d ] );
+    values.push_back( image->GetOrigin()[ d ] );
+    for ( unsigned int e = 0; e < dimension; ++e )
+    {
+      values.push_back( image->GetDirection()[ d ][ e ] );
+    }
+  }
+
+  /** A checksum of the pixel values: the sum, the sum of squares,
+   * and a position weighted sum, to detect a rearrangement of the pixels.
+   */
+  double sum = 0.0;
+  double sumsq = 0.0;
+  double weightedsum = 0.0;
+  unsigned long position = 0;
+  ImageRegionConstIterator<TImage> it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++position )
+  {
+    const double value = static_cast<double>( it.Get() );
+    sum += value;
+    sumsq += value * value;
+    weightedsum += value * static_cast<double>( position % 1009 );
+  }
+  values.push_back( sum );
+  values.push_back( sumsq );
+  values.push_back( weightedsum );
+
+} // end AppendImageToEstimationKey()
+
+
 /**
  * **************** PrintSettingsVector **********************
  */
@@ -157,6 +157,7 @@ using namespace itk;
 
 
     /** Check if any scales are set, and set the UseScales flag on or off;
+     * set up the concurrent evaluation of the cost function, if asked for;
      * after that call the superclass' implementation */
     virtual void StartOptimization(void);
 
@@ -49,6 +49,10 @@ using namespace itk;
     }
 
     /** Call the superclass */
+    /** Set up the concurrent evaluation of the cost function, if asked for */
+    this->ConfigureParallelCostFunctionEvaluator(
+      this->GetParallelCostFunctionEvaluator() );
+
     this->Superclass1::StartOptimization();
 
   } //end StartOptimization
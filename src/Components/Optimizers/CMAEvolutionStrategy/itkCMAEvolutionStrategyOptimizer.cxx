@@ -509,12 +509,14 @@ namespace itk
   {
     itkDebugMacro("GenerateOffspring");
 
-    /** Get the number of parameters from the cost function */
-    const unsigned int numberOfParameters =
-      this->GetScaledCostFunction()->GetNumberOfParameters();
+    /** Evaluate the offspring concurrently, if possible */
+    if ( this->GetUseConcurrentEvaluation() )
+    {
+      this->GenerateOffspringConcurrently();
+      return;
+    }
 
     /** Some casts/aliases: */
-    const unsigned int N = numberOfParameters;
     const unsigned int lambda = this->m_PopulationSize;
 
     /** Clear the old values */
@@ -525,23 +527,8 @@ namespace itk
     unsigned int nrOfFails = 0;
     while ( lam < lambda )
     {
-      /** draw from distribution N(0,I) */
-      for (unsigned int par = 0; par < N; ++par )
-      {
-        this->m_NormalizedSearchDirs[lam][par] =
-          this->m_RandomGenerator->GetNormalVariate();
-      }
-      /** Make like it was drawn from N(0,C) */
-      if ( this->GetUseCovarianceMatrixAdaptation() )
-      {
-        this->m_SearchDirs[lam] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[lam] );
-      }
-      else
-      {
-        this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
-      }
-      /** Make like it was drawn from N( 0, sigma^2 C ) */
-      this->m_SearchDirs[lam] *= this->m_CurrentSigma;
+      /** Draw from distribution N( 0, sigma^2 C ) */
+      this->DrawSearchDirection( lam );
 
       /** Compute the cost function */
       MeasureType costFunctionValue = 0.0;
@@ -581,6 +568,116 @@ namespace itk
   } // end GenerateOffspring
 
 
+  /**
+   * ****************** GenerateOffspringConcurrently *********************
+   */
+
+  void
+    CMAEvolutionStrategyOptimizer::
+    GenerateOffspringConcurrently(void)
+  {
+    itkDebugMacro("GenerateOffspringConcurrently");
+
+    typedef ParallelCostFunctionEvaluatorType::ParametersContainerType  PositionsType;
+    typedef ParallelCostFunctionEvaluatorType::MeasureContainerType     ValuesType;
+    typedef ParallelCostFunctionEvaluatorType::ExceptionContainerType   ExceptionsType;
+
+    /** Some casts/aliases: */
+    const unsigned int lambda = this->m_PopulationSize;
+
+    /** Clear the old values */
+    this->m_CostFunctionValues.clear();
+
+    /** Draw all offspring members, serially, since they share the
+     * random generator. */
+    std::vector<unsigned int> members( lambda );
+    std::vector<unsigned int> nrOfFails( lambda, 0 );
+    for ( unsigned int lam = 0; lam < lambda; ++lam )
+    {
+      members[ lam ] = lam;
+      this->DrawSearchDirection( lam );
+    }
+
+    /** Evaluate the members concurrently, and draw the members for which
+     * the evaluation failed again, until all members have a value. */
+    PositionsType positions;
+    ValuesType values;
+    ExceptionsType exceptions;
+    while ( !members.empty() )
+    {
+      /** x_lam = m + d_lam */
+      positions.resize( members.size() );
+      for ( unsigned int k = 0; k < members.size(); ++k )
+      {
+        positions[ k ] = this->GetScaledCurrentPosition();
+        positions[ k ] += this->m_SearchDirs[ members[ k ] ];
+      }
+
+      /** Compute the cost function */
+      this->GetScaledValues( positions, values, exceptions );
+
+      std::vector<unsigned int> failedMembers;
+      for ( unsigned int k = 0; k < members.size(); ++k )
+      {
+        const unsigned int lam = members[ k ];
+        if ( !exceptions[ k ].st_Caught )
+        {
+          /** Successfull cost function evaluation */
+          this->m_CostFunctionValues.push_back(
+            MeasureIndexPairType( values[ k ], lam ) );
+          continue;
+        }
+
+        /** try another parameter vector if we haven't tried that for 10 times already */
+        ++nrOfFails[ lam ];
+        if ( nrOfFails[ lam ] > 10 )
+        {
+          this->m_StopCondition = MetricError;
+          this->StopOptimization();
+          throw exceptions[ k ].st_Exception;
+        }
+        this->DrawSearchDirection( lam );
+        failedMembers.push_back( lam );
+      }
+      members.swap( failedMembers );
+    }
+
+  } // end GenerateOffspringConcurrently
+
+
+  /**
+   * ****************** DrawSearchDirection *********************
+   */
+
+  void
+    CMAEvolutionStrategyOptimizer::
+    DrawSearchDirection( unsigned int lam )
+  {
+    /** Get the number of parameters from the cost function */
+    const unsigned int N =
+      this->GetScaledCostFunction()->GetNumberOfParameters();
+
+    /** draw from distribution N(0,I) */
+    for (unsigned int par = 0; par < N; ++par )
+    {
+      this->m_NormalizedSearchDirs[lam][par] =
+        this->m_RandomGenerator->GetNormalVariate();
+    }
+    /** Make like it was drawn from N(0,C) */
+    if ( this->GetUseCovarianceMatrixAdaptation() )
+    {
+      this->m_SearchDirs[lam] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[lam] );
+    }
+    else
+    {
+      this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
+    }
+    /** Make like it was drawn from N( 0, sigma^2 C ) */
+    this->m_SearchDirs[lam] *= this->m_CurrentSigma;
+
+  } // end DrawSearchDirection
+
+
   /**
    * ****************** SortCostFunctionValues *********************
    */
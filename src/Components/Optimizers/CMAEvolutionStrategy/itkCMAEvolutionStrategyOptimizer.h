@@ -353,6 +353,15 @@ namespace itk
      * and m_CostFunctionValues */
     virtual void GenerateOffspring(void);
 
+    /** Like GenerateOffspring, but evaluates the cost function for all
+     * offspring members concurrently, using GetScaledValues(). Members
+     * for which the evaluation fails are drawn again. Called by
+     * GenerateOffspring if GetUseConcurrentEvaluation() returns true. */
+    virtual void GenerateOffspringConcurrently(void);
+
+    /** Draw m_NormalizedSearchDirs[lam] and m_SearchDirs[lam] */
+    virtual void DrawSearchDirection( unsigned int lam );
+
     /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
     virtual void SortCostFunctionValues(void);
 
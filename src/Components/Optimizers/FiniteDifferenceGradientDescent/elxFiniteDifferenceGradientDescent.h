@@ -127,6 +127,7 @@ using namespace itk;
     virtual void AfterRegistration(void);
 
     /** Check if any scales are set, and set the UseScales flag on or off;
+     * set up the concurrent evaluation of the cost function, if asked for;
      * after that call the superclass' implementation */
     virtual void StartOptimization(void);
 
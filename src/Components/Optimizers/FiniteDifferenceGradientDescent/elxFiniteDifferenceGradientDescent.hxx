@@ -238,6 +238,10 @@ using namespace itk;
       }
     }
 
+    /** Set up the concurrent evaluation of the cost function, if asked for */
+    this->ConfigureParallelCostFunctionEvaluator(
+      this->GetParallelCostFunctionEvaluator() );
+
     this->Superclass1::StartOptimization();
 
   } //end StartOptimization
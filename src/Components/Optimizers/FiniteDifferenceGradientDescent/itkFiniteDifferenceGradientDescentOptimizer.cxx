@@ -166,20 +166,27 @@ namespace itk
       /** Calculate the derivative; this may take a while... */
       try
       {
-        for ( unsigned int j = 0; j < spaceDimension; j++ )
+        if ( this->GetUseConcurrentEvaluation() )
         {
-          param[j] += ck;
-          valueplus = this->GetScaledValue( param );
-          param[j] -= 2.0*ck;
-          valuemin = this->GetScaledValue( param );
-          param[j] += ck;
+          sumOfSquaredGradients = this->ComputeGradientConcurrently( param, ck );
+        }
+        else
+        {
+          for ( unsigned int j = 0; j < spaceDimension; j++ )
+          {
+            param[j] += ck;
+            valueplus = this->GetScaledValue( param );
+            param[j] -= 2.0*ck;
+            valuemin = this->GetScaledValue( param );
+            param[j] += ck;
 
-          const double gradient = (valueplus - valuemin) / (2.0 * ck);
-          this->m_Gradient[j] = gradient;
+            const double gradient = (valueplus - valuemin) / (2.0 * ck);
+            this->m_Gradient[j] = gradient;
 
-          sumOfSquaredGradients += ( gradient * gradient );
+            sumOfSquaredGradients += ( gradient * gradient );
 
-        } // for j = 0 .. spaceDimension
+          } // for j = 0 .. spaceDimension
+        }
       }
       catch( ExceptionObject& err )
       {
@@ -218,6 +225,65 @@ namespace itk
   } // end ResumeOptimization
 
 
+  /**
+   * ********************* ComputeGradientConcurrently ************************
+   */
+
+  double FiniteDifferenceGradientDescentOptimizer
+    ::ComputeGradientConcurrently( const ParametersType & param, double ck )
+  {
+    typedef ParallelCostFunctionEvaluatorType::ParametersContainerType  PositionsType;
+    typedef ParallelCostFunctionEvaluatorType::MeasureContainerType     ValuesType;
+    typedef ParallelCostFunctionEvaluatorType::ExceptionContainerType   ExceptionsType;
+
+    const unsigned int spaceDimension = param.GetSize();
+
+    /** Perturb a few parameters at a time, to limit the memory use. */
+    const unsigned int parametersPerBatch = 4 *
+      this->GetParallelCostFunctionEvaluator()->GetNumberOfEvaluators();
+
+    PositionsType positions;
+    ValuesType values;
+    ExceptionsType exceptions;
+    double sumOfSquaredGradients = 0.0;
+    for ( unsigned int first = 0; first < spaceDimension; first += parametersPerBatch )
+    {
+      const unsigned int last = vnl_math_min( first + parametersPerBatch, spaceDimension );
+
+      /** The positions param + ck e_j and param - ck e_j */
+      positions.assign( 2 * ( last - first ), param );
+      for ( unsigned int j = first; j < last; j++ )
+      {
+        positions[ 2 * ( j - first ) ][ j ] += ck;
+        positions[ 2 * ( j - first ) + 1 ][ j ] -= ck;
+      }
+
+      this->GetScaledValues( positions, values, exceptions );
+
+      for ( unsigned int j = first; j < last; j++ )
+      {
+        for ( unsigned int k = 2 * ( j - first ); k < 2 * ( j - first + 1 ); ++k )
+        {
+          if ( exceptions[ k ].st_Caught )
+          {
+            throw exceptions[ k ].st_Exception;
+          }
+        }
+        const double valueplus = values[ 2 * ( j - first ) ];
+        const double valuemin = values[ 2 * ( j - first ) + 1 ];
+
+        const double gradient = (valueplus - valuemin) / (2.0 * ck);
+        this->m_Gradient[j] = gradient;
+
+        sumOfSquaredGradients += ( gradient * gradient );
+      }
+    }
+
+    return sumOfSquaredGradients;
+
+  } // end ComputeGradientConcurrently
+
+
   /**
    * ********************** StopOptimization **********************
    */
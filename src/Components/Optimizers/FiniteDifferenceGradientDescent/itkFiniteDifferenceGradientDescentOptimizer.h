@@ -154,6 +154,11 @@ namespace itk
     virtual double Compute_a( unsigned long k ) const;
     virtual double Compute_c( unsigned long k ) const;
 
+    /** Compute m_Gradient by evaluating the perturbed positions concurrently,
+     * with GetScaledValues(). Returns the sum of the squared gradients. */
+    virtual double ComputeGradientConcurrently(
+      const ParametersType & param, double ck );
+
   private:
 
     FiniteDifferenceGradientDescentOptimizer( const Self& );  // purposely not implemented
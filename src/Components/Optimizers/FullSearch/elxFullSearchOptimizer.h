@@ -121,6 +121,10 @@ using namespace itk;
     virtual void AfterRegistration(void);
     /** \todo BeforeAll, checking parameters. */
 
+    /** Set up the concurrent evaluation of the cost function, if asked for;
+     * after that call the superclass' implementation */
+    virtual void StartOptimization(void);
+
     /** Get a pointer to the image containing the optimization surface. */
     itkGetObjectMacro(OptimizationSurface, NDImageType);
 
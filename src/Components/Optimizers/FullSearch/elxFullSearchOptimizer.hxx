@@ -57,6 +57,25 @@ FullSearch<TElastix>
 } // end BeforeRegistration
 
 
+/**
+ * ***************** StartOptimization ***********************
+ */
+
+template <class TElastix>
+void
+FullSearch<TElastix>
+::StartOptimization( void )
+{
+  /** Set up the concurrent evaluation of the cost function, if asked for. */
+  this->ConfigureParallelCostFunctionEvaluator(
+    this->GetParallelCostFunctionEvaluator() );
+
+  /** Call the superclass. */
+  this->Superclass1::StartOptimization();
+
+} // end StartOptimization
+
+
 /**
  * ***************** BeforeEachResolution ***********************
  */
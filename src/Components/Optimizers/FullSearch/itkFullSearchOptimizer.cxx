@@ -20,6 +20,7 @@
 #include "itkEventObject.h"
 #include "itkExceptionObject.h"
 #include "itkNumericTraits.h"
+#include "vnl/vnl_math.h"
 
 namespace itk
 {
@@ -41,6 +42,8 @@ namespace itk
     m_NumberOfSearchSpaceDimensions = 0;
     m_SearchSpace = 0;
     m_LastSearchSpaceChanges = 0;
+    m_ParallelCostFunctionEvaluator = ParallelCostFunctionEvaluatorType::New();
+    m_BatchFirstIteration = 0;
 
   } //end constructor
 
@@ -56,6 +59,8 @@ namespace itk
     itkDebugMacro("StartOptimization");
 
     m_CurrentIteration   = 0;
+    m_BatchValues.clear();
+    m_BatchExceptions.clear();
 
     this->ProcessSearchSpaceChanges();
 
@@ -101,7 +106,14 @@ namespace itk
 
       try
       {
-        m_Value = m_CostFunction->GetValue( this->GetCurrentPosition() );
+        if ( m_ParallelCostFunctionEvaluator->GetUseConcurrentEvaluation() )
+        {
+          m_Value = this->GetConcurrentlyComputedValue();
+        }
+        else
+        {
+          m_Value = m_CostFunction->GetValue( this->GetCurrentPosition() );
+        }
       }
       catch( ExceptionObject& err )
       {
@@ -148,6 +160,70 @@ namespace itk
   } //end function ResumeOptimization
 
 
+  /**
+   * ***************** GetConcurrentlyComputedValue *****************
+   */
+  FullSearchOptimizer::MeasureType
+    FullSearchOptimizer
+    ::GetConcurrentlyComputedValue( void )
+  {
+    /** Compute the values of the next batch of points, if needed. */
+    if ( m_CurrentIteration < m_BatchFirstIteration
+      || m_CurrentIteration >= m_BatchFirstIteration + m_BatchValues.size() )
+    {
+      const unsigned long batchSize = vnl_math_min(
+        static_cast<unsigned long>(
+          8 * m_ParallelCostFunctionEvaluator->GetNumberOfEvaluators() ),
+        this->GetNumberOfIterations() - m_CurrentIteration );
+
+      ParallelCostFunctionEvaluatorType::ParametersContainerType positions( batchSize );
+      for ( unsigned long k = 0; k < batchSize; ++k )
+      {
+        positions[ k ] = this->IndexToPosition(
+          this->IterationToIndex( m_CurrentIteration + k ) );
+      }
+
+      m_BatchFirstIteration = m_CurrentIteration;
+      m_BatchValues.clear();
+      m_ParallelCostFunctionEvaluator->GetValues(
+        positions, m_BatchValues, m_BatchExceptions );
+    }
+
+    const unsigned long k = m_CurrentIteration - m_BatchFirstIteration;
+    if ( m_BatchExceptions[ k ].st_Caught )
+    {
+      throw m_BatchExceptions[ k ].st_Exception;
+    }
+    return m_BatchValues[ k ];
+
+  } // end GetConcurrentlyComputedValue
+
+
+  /**
+   * ********************** IterationToIndex ***********************
+   *
+   * The inverse of the sequence of UpdateCurrentPosition: the first
+   * dimension of the search space changes fastest.
+   */
+  FullSearchOptimizer::SearchSpaceIndexType
+    FullSearchOptimizer
+    ::IterationToIndex( unsigned long iteration )
+  {
+    const unsigned int searchSpaceDimension = this->GetNumberOfSearchSpaceDimensions();
+    const SearchSpaceSizeType & searchSpaceSize = this->GetSearchSpaceSize();
+
+    SearchSpaceIndexType index( searchSpaceDimension );
+    for (unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++)
+    {
+      index[ssdim] = static_cast<long>( iteration % searchSpaceSize[ssdim] );
+      iteration /= searchSpaceSize[ssdim];
+    }
+
+    return index;
+
+  } // end IterationToIndex
+
+
   /**
    * ************************** Stop optimization ******************
    */
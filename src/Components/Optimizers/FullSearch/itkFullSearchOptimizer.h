@@ -20,6 +20,7 @@
 #include "itkImage.h"
 #include "itkArray.h"
 #include "itkFixedArray.h"
+#include "itkParallelCostFunctionEvaluator.h"
 
 
 namespace itk
@@ -85,6 +86,9 @@ namespace itk
     /** The size of each dimension to be searched ((max-min)/step)) */
     typedef Array<unsigned long>                      SearchSpaceSizeType;
 
+    /** Typedef for the concurrent evaluation of the search space points. */
+    typedef ParallelCostFunctionEvaluator             ParallelCostFunctionEvaluatorType;
+
 
     /** NB: The methods SetScales has no influence! */
 
@@ -186,6 +190,19 @@ namespace itk
     /** Get Stop condition. */
     itkGetConstMacro( StopCondition, StopConditionType );
 
+    /** Get the object that evaluates the cost function concurrently.
+     * If it is given at least two evaluators, independent copies of the
+     * cost function, the values of a number of consecutive search space
+     * points are computed concurrently. The iterations are still reported
+     * one by one.
+     */
+    itkGetObjectMacro( ParallelCostFunctionEvaluator, ParallelCostFunctionEvaluatorType );
+
+    /** Convert an iteration number to the index of the point in search
+     * space that is evaluated in that iteration.
+     */
+    virtual SearchSpaceIndexType IterationToIndex( unsigned long iteration );
+
 
   protected:
     FullSearchOptimizer();
@@ -210,6 +227,18 @@ namespace itk
     unsigned long                 m_LastSearchSpaceChanges;
     virtual void ProcessSearchSpaceChanges(void);
 
+    /** Return the value at the current position, taken from the values that
+     * were computed concurrently; computes the next batch of values first, if
+     * needed. Throws the exception that occurred at the current position, if any.
+     */
+    virtual MeasureType GetConcurrentlyComputedValue(void);
+
+    /** Variables for the concurrent evaluation. */
+    ParallelCostFunctionEvaluatorType::Pointer                m_ParallelCostFunctionEvaluator;
+    ParallelCostFunctionEvaluatorType::MeasureContainerType   m_BatchValues;
+    ParallelCostFunctionEvaluatorType::ExceptionContainerType m_BatchExceptions;
+    unsigned long                                             m_BatchFirstIteration;
+
   private:
     FullSearchOptimizer(const Self&); //purposely not implemented
     void operator=(const Self&); //purposely not implemented
@@ -87,6 +87,22 @@ using namespace itk;
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter EvaluateMetricsConcurrently: Whether the metrics are evaluated
+ *    concurrently, in each resolution. Metrics that share an image sampler,
+ *    a fixed image, a mask or an interpolator, for example because fewer
+ *    samplers or masks than metrics are given, are evaluated one after the
+ *    other in the same thread. The threads of the metrics are divided over
+ *    the concurrent groups. \n
+ *    example: <tt>(EvaluateMetricsConcurrently "true" "false")</tt> \n
+ *    The default is "false".
+ * \parameter UseTransformEvaluationCache: Whether the transformed sample
+ *    points and the transform Jacobians are computed only once, for all
+ *    metrics that use the same transform and sample exactly the same fixed
+ *    image points, in each resolution. This only pays off when several
+ *    metrics share their samples, and costs memory for the Jacobians of
+ *    up to 20000 samples. \n
+ *    example: <tt>(UseTransformEvaluationCache "true" "false")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Registrations
  */
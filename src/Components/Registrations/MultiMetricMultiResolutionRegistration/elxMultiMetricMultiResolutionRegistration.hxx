@@ -216,6 +216,20 @@ MultiMetricMultiResolutionRegistration<TElastix>
     this->GetCombinationMetric()->SetUseMetric( use, metricnr );
   }
 
+  /** Set whether the metrics are evaluated concurrently. */
+  bool evaluateMetricsConcurrently = false;
+  this->GetConfiguration()->ReadParameter( evaluateMetricsConcurrently,
+    "EvaluateMetricsConcurrently", "", level, 0 );
+  this->GetCombinationMetric()->SetEvaluateMetricsConcurrently(
+    evaluateMetricsConcurrently );
+
+  /** Set whether the transform is evaluated once for metrics that share their samples. */
+  bool useTransformEvaluationCache = false;
+  this->GetConfiguration()->ReadParameter( useTransformEvaluationCache,
+    "UseTransformEvaluationCache", "", level, 0 );
+  this->GetCombinationMetric()->SetUseTransformEvaluationCache(
+    useTransformEvaluationCache );
+
   /** Check if the exact metric value, computed on all pixels, should be shown.
    * If at least one of the metrics has it enabled, show also the weighted sum of all
    * exact metric values. */
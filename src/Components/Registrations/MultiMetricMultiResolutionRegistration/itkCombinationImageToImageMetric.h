@@ -192,6 +192,31 @@ public:
   itkSetMacro( UseRelativeWeights, bool );
   itkGetMacro( UseRelativeWeights, bool );
 
+  /** Set and Get whether the sub metrics are evaluated concurrently in
+   * GetValueAndDerivative(). Only metrics that are an AdvancedImageToImageMetric
+   * or a SingleValuedPointSetToPointSetMetric are evaluated concurrently;
+   * other cost functions are evaluated one by one afterwards. Metrics that
+   * share an image sampler, the input image of their image samplers, a mask
+   * or an interpolator are not independent,
+   * so they are put in one group, of which the metrics are evaluated one
+   * after the other. Each group gets its own thread, and the threads of the
+   * metrics themselves are divided over the groups. The transform parameters
+   * are set only once beforehand. Default: false.
+   */
+  itkSetMacro( EvaluateMetricsConcurrently, bool );
+  itkGetConstMacro( EvaluateMetricsConcurrently, bool );
+  itkBooleanMacro( EvaluateMetricsConcurrently );
+
+  /** Set and Get whether the transform is evaluated only once per sample
+   * for all image metrics that use the same transform and sample exactly
+   * the same fixed image points. The mapped points and Jacobians are then
+   * computed once per iteration, and read by all these metrics.
+   * Default: false.
+   */
+  itkSetMacro( UseTransformEvaluationCache, bool );
+  itkGetConstMacro( UseTransformEvaluationCache, bool );
+  itkBooleanMacro( UseTransformEvaluationCache );
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -380,6 +405,15 @@ public:
     const TransformParametersType & parameters,
     HessianType & H ) const;
 
+  /** Create an evaluator that combines evaluators of all sub metrics,
+   * which share a single copy of the transform. Returns 0 if one of the
+   * sub metrics does not support evaluators, or is not an image metric,
+   * or if the sub metrics use different transforms. The evaluator
+   * does not evaluate its sub metrics concurrently.
+   */
+  virtual typename Superclass::Pointer CreateEvaluator(
+    AdvancedTransformType * transform = 0 ) const;
+
   /** Method to return the latest modified time of this object or any of its
    * cached ivars.
    */
@@ -406,6 +440,96 @@ protected:
   FixedImageRegionType        m_NullFixedImageRegion;
   DerivativeType              m_NullDerivative;
 
+  /** Typedefs for the concurrent evaluation of the sub metrics. */
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
+
+  /** Groups of sub metrics; the metrics of a group are evaluated one after
+   * the other, and different groups concurrently.
+   */
+  typedef std::vector< unsigned int >                     MetricIndicesType;
+  typedef std::vector< MetricIndicesType >                MetricGroupsType;
+
+  /** The parameters that are passed to the threader callback. */
+  struct ConcurrentMetricsThreaderParameterType
+  {
+    const Self *                  st_Metric;
+    const ParametersType *        st_Parameters;
+    const MetricGroupsType *      st_MetricGroups;
+  };
+
+  /** An exception thrown by a sub metric in one of the threads, which
+   * is passed on after all threads have finished.
+   */
+  struct MetricExceptionStruct
+  {
+    bool            st_Caught;
+    ExceptionObject st_Exception;
+  };
+
+  /** Compute the value and derivative of sub metric pos, and store them,
+   * together with the derivative magnitude and the computation time.
+   */
+  void ComputeMetricValueAndDerivative( unsigned int pos,
+    const ParametersType & parameters ) const;
+
+  /** Get the objects of sub metric pos that are not safe to use by two
+   * metrics at the same time: the image sampler and its input image, the
+   * masks and the interpolator.
+   */
+  void GetSharedMetricObjects( unsigned int pos,
+    std::vector< const Object * > & sharedObjects ) const;
+
+  /** Divide the given sub metrics into groups, such that metrics that share
+   * an object returned by GetSharedMetricObjects() are in the same group.
+   */
+  void GroupIndependentMetrics( const MetricIndicesType & metricIndices,
+    MetricGroupsType & metricGroups ) const;
+
+  /** Compute the values and derivatives of the sub metrics of the given
+   * groups, one thread per group, using ComputeMetricValueAndDerivative().
+   */
+  void ComputeMetricValuesAndDerivativesConcurrently(
+    const MetricGroupsType & metricGroups,
+    const ParametersType & parameters ) const;
+
+  /** The threader callback for the concurrent evaluation. */
+  static ITK_THREAD_RETURN_TYPE ConcurrentMetricsThreaderCallback( void * arg );
+
+  /** Set the TransformParametersAreSetExternally flag of sub metric pos.
+   * Returns false if the sub metric does not support it.
+   */
+  bool SetMetricTransformParametersAreSetExternally(
+    unsigned int pos, bool setExternally ) const;
+
+  /** Typedefs for the transform evaluation cache. */
+  typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass::TransformEvaluationCacheType TransformEvaluationCacheType;
+  typedef typename TransformEvaluationCacheType::Pointer    TransformEvaluationCachePointer;
+
+  /** Group the image metrics that use the same transform and the same
+   * samples, evaluate the transform once per group at the given parameters,
+   * and pass the cache of each group to its metrics. Only groups of at least
+   * two metrics get a cache. The Jacobians are only cached when requested.
+   */
+  void PrepareTransformEvaluationCaches( const ParametersType & parameters,
+    bool computeJacobians ) const;
+
+  /** Remove the transform evaluation caches from the metrics. Should be
+   * called after every PrepareTransformEvaluationCaches(), since the caches
+   * are only valid for the current parameters.
+   */
+  void ReleaseTransformEvaluationCaches( void ) const;
+
+  /** Variables for the transform evaluation cache. */
+  bool                                                  m_UseTransformEvaluationCache;
+  mutable std::vector< TransformEvaluationCachePointer > m_TransformEvaluationCaches;
+
+  /** Variables for the concurrent evaluation. */
+  bool                                              m_EvaluateMetricsConcurrently;
+  typename ThreaderType::Pointer                    m_ConcurrentMetricsThreader;
+  mutable std::vector< MetricExceptionStruct >      m_MetricExceptions;
+
 private:
   CombinationImageToImageMetric(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
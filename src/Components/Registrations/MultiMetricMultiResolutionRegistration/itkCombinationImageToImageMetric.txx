@@ -18,6 +18,7 @@
 #include "itkCombinationImageToImageMetric.h"
 #include "elxTimer.h"
 #include "itkMath.h"
+#include "vnl/vnl_math.h"
 
 
 /** Macros to reduce some copy-paste work.
@@ -162,6 +163,9 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 {
   this->m_NumberOfMetrics = 0;
   this->m_UseRelativeWeights = false;
+  this->m_EvaluateMetricsConcurrently = false;
+  this->m_UseTransformEvaluationCache = false;
+  this->m_ConcurrentMetricsThreader = ThreaderType::New();
   this->ComputeGradientOff();
 
 } // end Constructor
@@ -182,6 +186,10 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   /** Add debugging information. */
   os << "NumberOfMetrics: "
     << this->m_NumberOfMetrics << std::endl;
+  os << "EvaluateMetricsConcurrently: "
+    << ( this->m_EvaluateMetricsConcurrently ? "true" : "false" ) << std::endl;
+  os << "UseTransformEvaluationCache: "
+    << ( this->m_UseTransformEvaluationCache ? "true" : "false" ) << std::endl;
   for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
     os << "Metric " << i << ":\n";
@@ -654,48 +662,60 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   /** Initialise. */
   MeasureType measure = NumericTraits< MeasureType >::Zero;
 
-  /** Compute, store and combine all metric values. */
-  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  /** Evaluate the transform only once for metrics that share their samples. */
+  this->PrepareTransformEvaluationCaches( parameters, false );
+
+  try
   {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
+    /** Compute, store and combine all metric values. */
+    for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      /** Time the computation per metric. */
+      typename tmr::Timer::Pointer timer = tmr::Timer::New();
+      timer->StartTimer();
 
-    /** Compute ... */
-    MeasureType tmpValue = this->m_Metrics[ i ]->GetValue( parameters );
-    timer->StopTimer();
+      /** Compute ... */
+      MeasureType tmpValue = this->m_Metrics[ i ]->GetValue( parameters );
+      timer->StopTimer();
 
-    /** store ... */
-    this->m_MetricValues[ i ] = tmpValue;
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
+      /** store ... */
+      this->m_MetricValues[ i ] = tmpValue;
+      this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
+        Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
 
-    /** and combine. */
-    if ( this->m_UseMetric[ i ] )
-    {
-      if ( !this->m_UseRelativeWeights )
+      /** and combine. */
+      if ( this->m_UseMetric[ i ] )
       {
-        measure += this->m_MetricWeights[ i ] * this->m_MetricValues[ i ];
-      }
-      else
-      {
-        /** The relative weight of metric i is such that the
-         * value of metric i is rescaled
-         * to be a fraction of that of metric 0; the fraction is
-         * defined by the fraction of the two relative weights.
-         * Note that this weight is different in each iteration.
-         */
-        double weight = 1.0;
-        if ( this->m_MetricValues[ i ] > 1e-10 )
+        if ( !this->m_UseRelativeWeights )
         {
-          weight = this->m_MetricRelativeWeights[ i ]
-            * this->m_MetricValues[ 0 ]
-            / this->m_MetricValues[ i ];
-          measure += weight * this->m_MetricValues[ i ];
+          measure += this->m_MetricWeights[ i ] * this->m_MetricValues[ i ];
+        }
+        else
+        {
+          /** The relative weight of metric i is such that the
+           * value of metric i is rescaled
+           * to be a fraction of that of metric 0; the fraction is
+           * defined by the fraction of the two relative weights.
+           * Note that this weight is different in each iteration.
+           */
+          double weight = 1.0;
+          if ( this->m_MetricValues[ i ] > 1e-10 )
+          {
+            weight = this->m_MetricRelativeWeights[ i ]
+              * this->m_MetricValues[ 0 ]
+              / this->m_MetricValues[ i ];
+            measure += weight * this->m_MetricValues[ i ];
+          }
         }
       }
     }
   }
+  catch ( ... )
+  {
+    this->ReleaseTransformEvaluationCaches();
+    throw;
+  }
+  this->ReleaseTransformEvaluationCaches();
 
   /** Return a value. */
   return measure;
@@ -718,50 +738,62 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< MeasureType >::Zero );
 
-  /** Compute, store and combine all metric derivatives. */
-  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
-  {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-
-    /** Compute ... */
-    tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
-    this->m_Metrics[ i ]->GetDerivative( parameters, tmpDerivative );
-    timer->StopTimer();
-
-    /** store ... */
-    this->m_MetricDerivatives[ i ] = tmpDerivative;
-    this->m_MetricDerivativesMagnitude[ i ] = tmpDerivative.magnitude();
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
+  /** Evaluate the transform only once for metrics that share their samples. */
+  this->PrepareTransformEvaluationCaches( parameters, true );
 
-    /** and combine. */
-    if ( this->m_UseMetric[ i ] )
+  try
+  {
+    /** Compute, store and combine all metric derivatives. */
+    for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
     {
-      if ( !this->m_UseRelativeWeights )
-      {
-        derivative += this->m_MetricWeights[ i ] * this->m_MetricDerivatives[ i ];
-      }
-      else
+      /** Time the computation per metric. */
+      typename tmr::Timer::Pointer timer = tmr::Timer::New();
+      timer->StartTimer();
+
+      /** Compute ... */
+      tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
+      this->m_Metrics[ i ]->GetDerivative( parameters, tmpDerivative );
+      timer->StopTimer();
+
+      /** store ... */
+      this->m_MetricDerivatives[ i ] = tmpDerivative;
+      this->m_MetricDerivativesMagnitude[ i ] = tmpDerivative.magnitude();
+      this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
+        Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
+
+      /** and combine. */
+      if ( this->m_UseMetric[ i ] )
       {
-        /** The relative weight of metric i is such that the
-         * magnitude of the derivative of metric i is rescaled
-         * to be a fraction of that of metric 0; the fraction is
-         * defined by the fraction of the two relative weights.
-         * Note that this weight is different in each iteration.
-         */
-        double weight = 1.0;
-        if ( this->m_MetricDerivativesMagnitude[ i ] > 1e-10 )
+        if ( !this->m_UseRelativeWeights )
         {
-          weight = this->m_MetricRelativeWeights[ i ]
-            * this->m_MetricDerivativesMagnitude[ 0 ]
-            / this->m_MetricDerivativesMagnitude[ i ];
-          derivative += weight * this->m_MetricDerivatives[ i ];
+          derivative += this->m_MetricWeights[ i ] * this->m_MetricDerivatives[ i ];
+        }
+        else
+        {
+          /** The relative weight of metric i is such that the
+           * magnitude of the derivative of metric i is rescaled
+           * to be a fraction of that of metric 0; the fraction is
+           * defined by the fraction of the two relative weights.
+           * Note that this weight is different in each iteration.
+           */
+          double weight = 1.0;
+          if ( this->m_MetricDerivativesMagnitude[ i ] > 1e-10 )
+          {
+            weight = this->m_MetricRelativeWeights[ i ]
+              * this->m_MetricDerivativesMagnitude[ 0 ]
+              / this->m_MetricDerivativesMagnitude[ i ];
+            derivative += weight * this->m_MetricDerivatives[ i ];
+          }
         }
       }
     }
   }
+  catch ( ... )
+  {
+    this->ReleaseTransformEvaluationCaches();
+    throw;
+  }
+  this->ReleaseTransformEvaluationCaches();
 
 } // end GetDerivative()
 
@@ -779,34 +811,62 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
   DerivativeType & derivative ) const
 {
   /** Initialise. */
-  MeasureType tmpValue = NumericTraits< MeasureType >::Zero;
   value = NumericTraits< MeasureType >::Zero;
-
-  DerivativeType tmpDerivative = DerivativeType( this->GetNumberOfParameters() );
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< MeasureType >::Zero );
 
-  /** Compute, store and combine all metric values and derivatives. */
+  /** Evaluate the transform only once for metrics that share their samples. */
+  this->PrepareTransformEvaluationCaches( parameters, true );
+
+  try
+  {
+    /** Select the metrics that can be evaluated concurrently, and group
+     * the metrics that are not independent.
+     */
+    MetricIndicesType concurrentMetrics;
+    MetricGroupsType metricGroups;
+    if ( this->m_EvaluateMetricsConcurrently )
+    {
+      for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+      {
+        if ( dynamic_cast<ImageMetricType *>( this->GetMetric( i ) )
+          || dynamic_cast<PointSetMetricType *>( this->GetMetric( i ) ) )
+        {
+          concurrentMetrics.push_back( i );
+        }
+      }
+      this->GroupIndependentMetrics( concurrentMetrics, metricGroups );
+      if ( metricGroups.size() < 2 )
+      {
+        concurrentMetrics.clear();
+        metricGroups.clear();
+      }
+    }
+
+    /** Compute and store all metric values and derivatives. */
+    this->ComputeMetricValuesAndDerivativesConcurrently(
+      metricGroups, parameters );
+    std::vector< unsigned int >::const_iterator concurrentIt = concurrentMetrics.begin();
+    for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      if ( concurrentIt != concurrentMetrics.end() && *concurrentIt == i )
+      {
+        ++concurrentIt;
+        continue;
+      }
+      this->ComputeMetricValueAndDerivative( i, parameters );
+    }
+  }
+  catch ( ... )
+  {
+    this->ReleaseTransformEvaluationCaches();
+    throw;
+  }
+  this->ReleaseTransformEvaluationCaches();
+
+  /** Combine all metric values and derivatives. */
   for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
-    /** Time the computation per metric. */
-    typename tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-
-    /** Compute ... */
-    tmpValue = NumericTraits< MeasureType >::Zero;
-    tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
-    this->m_Metrics[ i ]->GetValueAndDerivative( parameters, tmpValue, tmpDerivative );
-    timer->StopTimer();
-
-    /** store ... */
-    this->m_MetricValues[ i ] = tmpValue;
-    this->m_MetricDerivatives[ i ] = tmpDerivative;
-    this->m_MetricDerivativesMagnitude[ i ] = tmpDerivative.magnitude();
-    this->m_MetricComputationTime[ i ] = static_cast<std::size_t>(
-      Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
-  
-    /** and combine. */
     if ( this->m_UseMetric[ i ] )
     {
       if ( !this->m_UseRelativeWeights )
@@ -838,6 +898,428 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetValueAndDerivative()
 
 
+/**
+ * ****************** PrepareTransformEvaluationCaches *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::PrepareTransformEvaluationCaches( const ParametersType & parameters,
+  bool computeJacobians ) const
+{
+  if ( !this->m_UseTransformEvaluationCache || this->m_NumberOfMetrics < 2 )
+  {
+    return;
+  }
+
+  /** Group the image metrics by transform and by sample coordinates. */
+  std::vector< int > metricToCache( this->m_NumberOfMetrics, -1 );
+  unsigned int numberOfCaches = 0;
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * imageMetric
+      = dynamic_cast<ImageMetricType *>( this->GetMetric( i ) );
+    const TransformType * transform = this->GetTransform( i );
+    if ( !imageMetric || !transform || !imageMetric->GetUseImageSampler()
+      || !imageMetric->GetImageSampler() )
+    {
+      continue;
+    }
+
+    /** Make sure the transform and the samples are up to date. */
+    imageMetric->SetTransformParameters( parameters );
+    imageMetric->GetImageSampler()->Update();
+    const ImageSampleContainerType * samples
+      = imageMetric->GetImageSampler()->GetOutput();
+
+    /** Find a group with the same transform and samples. */
+    for ( unsigned int c = 0; c < numberOfCaches; ++c )
+    {
+      if ( this->m_TransformEvaluationCaches[ c ]->GetTransform() == transform
+        && this->m_TransformEvaluationCaches[ c ]->AddSampleContainer( samples ) )
+      {
+        metricToCache[ i ] = c;
+        break;
+      }
+    }
+
+    /** Otherwise start a new group. The caches are reused, to keep their buffers. */
+    if ( metricToCache[ i ] < 0 )
+    {
+      if ( numberOfCaches == this->m_TransformEvaluationCaches.size() )
+      {
+        this->m_TransformEvaluationCaches.push_back( TransformEvaluationCacheType::New() );
+      }
+      TransformEvaluationCacheType * cache
+        = this->m_TransformEvaluationCaches[ numberOfCaches ];
+      cache->Initialize();
+      cache->SetTransform( transform );
+      cache->AddSampleContainer( samples );
+      metricToCache[ i ] = numberOfCaches;
+      ++numberOfCaches;
+    }
+  }
+
+  /** Evaluate the transform for the groups that are shared by several metrics. */
+  for ( unsigned int c = 0; c < numberOfCaches; ++c )
+  {
+    if ( this->m_TransformEvaluationCaches[ c ]->GetNumberOfSampleContainers() > 1 )
+    {
+      this->m_TransformEvaluationCaches[ c ]->Compute( computeJacobians );
+    }
+  }
+
+  /** Pass the caches to the metrics. */
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if ( metricToCache[ i ] < 0 ) continue;
+    TransformEvaluationCacheType * cache
+      = this->m_TransformEvaluationCaches[ metricToCache[ i ] ];
+    if ( cache->GetNumberOfSampleContainers() > 1 )
+    {
+      dynamic_cast<ImageMetricType *>( this->GetMetric( i ) )
+        ->SetTransformEvaluationCache( cache );
+    }
+  }
+
+} // end PrepareTransformEvaluationCaches()
+
+
+/**
+ * ****************** ReleaseTransformEvaluationCaches *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ReleaseTransformEvaluationCaches( void ) const
+{
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * imageMetric
+      = dynamic_cast<ImageMetricType *>( this->GetMetric( i ) );
+    if ( imageMetric && imageMetric->GetTransformEvaluationCache() )
+    {
+      imageMetric->SetTransformEvaluationCache( 0 );
+    }
+  }
+
+} // end ReleaseTransformEvaluationCaches()
+
+
+/**
+ * ********************* ComputeMetricValueAndDerivative ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMetricValueAndDerivative( unsigned int pos,
+  const ParametersType & parameters ) const
+{
+  /** Time the computation per metric. */
+  typename tmr::Timer::Pointer timer = tmr::Timer::New();
+  timer->StartTimer();
+
+  /** Compute, directly into the derivative buffer of this metric. */
+  MeasureType tmpValue = NumericTraits< MeasureType >::Zero;
+  DerivativeType & tmpDerivative = this->m_MetricDerivatives[ pos ];
+  tmpDerivative.SetSize( this->GetNumberOfParameters() );
+  tmpDerivative.Fill( NumericTraits< MeasureType >::Zero );
+  this->m_Metrics[ pos ]->GetValueAndDerivative( parameters, tmpValue, tmpDerivative );
+  timer->StopTimer();
+
+  /** Store. */
+  this->m_MetricValues[ pos ] = tmpValue;
+  this->m_MetricDerivativesMagnitude[ pos ] = tmpDerivative.magnitude();
+  this->m_MetricComputationTime[ pos ] = static_cast<std::size_t>(
+    Math::Round( timer->GetElapsedClockSec() * 1000.0 ) );
+
+} // end ComputeMetricValueAndDerivative()
+
+
+/**
+ * ******************* GetSharedMetricObjects *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::GetSharedMetricObjects( unsigned int pos,
+  std::vector< const Object * > & sharedObjects ) const
+{
+  sharedObjects.clear();
+
+  /** The image sampler is updated by the metric, which also updates the
+   * pipeline of its input image. The masks may be modified by IsInside(),
+   * and not all interpolators are thread-safe.
+   */
+  const ImageMetricType * imageMetric
+    = dynamic_cast<const ImageMetricType *>( this->GetMetric( pos ) );
+  const PointSetMetricType * pointSetMetric
+    = dynamic_cast<const PointSetMetricType *>( this->GetMetric( pos ) );
+  if ( imageMetric )
+  {
+    if ( imageMetric->GetUseImageSampler() )
+    {
+      sharedObjects.push_back( imageMetric->GetImageSampler() );
+      sharedObjects.push_back( imageMetric->GetImageSampler()->GetInput() );
+    }
+    sharedObjects.push_back( imageMetric->GetFixedImageMask() );
+    sharedObjects.push_back( imageMetric->GetMovingImageMask() );
+    sharedObjects.push_back( imageMetric->GetInterpolator() );
+  }
+  else if ( pointSetMetric )
+  {
+    sharedObjects.push_back( pointSetMetric->GetFixedImageMask() );
+    sharedObjects.push_back( pointSetMetric->GetMovingImageMask() );
+  }
+
+} // end GetSharedMetricObjects()
+
+
+/**
+ * ******************* GroupIndependentMetrics *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::GroupIndependentMetrics( const MetricIndicesType & metricIndices,
+  MetricGroupsType & metricGroups ) const
+{
+  const unsigned int numberOfMetrics = metricIndices.size();
+  std::vector< std::vector< const Object * > > sharedObjects( numberOfMetrics );
+  std::vector< unsigned int > groupOf( numberOfMetrics );
+  for ( unsigned int k = 0; k < numberOfMetrics; ++k )
+  {
+    this->GetSharedMetricObjects( metricIndices[ k ], sharedObjects[ k ] );
+    groupOf[ k ] = k;
+  }
+
+  /** Merge the groups of every two metrics that share an object. */
+  for ( unsigned int k = 0; k < numberOfMetrics; ++k )
+  {
+    for ( unsigned int l = k + 1; l < numberOfMetrics; ++l )
+    {
+      if ( groupOf[ k ] == groupOf[ l ] ) continue;
+
+      bool share = false;
+      for ( unsigned int a = 0; a < sharedObjects[ k ].size() && !share; ++a )
+      {
+        if ( !sharedObjects[ k ][ a ] ) continue;
+        for ( unsigned int b = 0; b < sharedObjects[ l ].size(); ++b )
+        {
+          if ( sharedObjects[ k ][ a ] == sharedObjects[ l ][ b ] )
+          {
+            share = true;
+            break;
+          }
+        }
+      }
+
+      if ( share )
+      {
+        const unsigned int oldGroup = groupOf[ l ];
+        for ( unsigned int m = 0; m < numberOfMetrics; ++m )
+        {
+          if ( groupOf[ m ] == oldGroup ) groupOf[ m ] = groupOf[ k ];
+        }
+      }
+    }
+  }
+
+  /** Collect the groups, in the order of their first metric. */
+  metricGroups.clear();
+  std::vector< int > groupPosition( numberOfMetrics, -1 );
+  for ( unsigned int k = 0; k < numberOfMetrics; ++k )
+  {
+    if ( groupPosition[ groupOf[ k ] ] < 0 )
+    {
+      groupPosition[ groupOf[ k ] ] = metricGroups.size();
+      metricGroups.push_back( MetricIndicesType() );
+    }
+    metricGroups[ groupPosition[ groupOf[ k ] ] ].push_back( metricIndices[ k ] );
+  }
+
+} // end GroupIndependentMetrics()
+
+
+/**
+ * ************** ComputeMetricValuesAndDerivativesConcurrently *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ComputeMetricValuesAndDerivativesConcurrently(
+  const MetricGroupsType & metricGroups,
+  const ParametersType & parameters ) const
+{
+  if ( metricGroups.empty() ) return;
+
+  /** Divide the threads over the groups, so that the threads of the image
+   * metrics do not oversubscribe the machine.
+   */
+  const unsigned int numberOfGroups = metricGroups.size();
+  const unsigned int threadsPerMetric = vnl_math_max( 1u,
+    this->GetNumberOfThreads() / numberOfGroups );
+
+  /** The metrics share the transform, so set its parameters only once,
+   * before starting the threads, and prevent the metrics from setting
+   * them again.
+   */
+  std::vector< unsigned int > numberOfThreads( this->m_NumberOfMetrics, 0 );
+  for ( unsigned int g = 0; g < numberOfGroups; ++g )
+  {
+    for ( unsigned int k = 0; k < metricGroups[ g ].size(); ++k )
+    {
+      const unsigned int pos = metricGroups[ g ][ k ];
+      ImageMetricType * imageMetric
+        = dynamic_cast<ImageMetricType *>( this->GetMetric( pos ) );
+      PointSetMetricType * pointSetMetric
+        = dynamic_cast<PointSetMetricType *>( this->GetMetric( pos ) );
+      if ( imageMetric )
+      {
+        imageMetric->SetTransformParameters( parameters );
+        numberOfThreads[ pos ] = imageMetric->GetNumberOfThreads();
+        imageMetric->SetNumberOfThreads(
+          vnl_math_min( numberOfThreads[ pos ], threadsPerMetric ) );
+      }
+      else if ( pointSetMetric )
+      {
+        pointSetMetric->SetTransformParameters( parameters );
+      }
+      this->SetMetricTransformParametersAreSetExternally( pos, true );
+    }
+  }
+
+  /** Reset the exceptions. */
+  this->m_MetricExceptions.resize( this->m_NumberOfMetrics );
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    this->m_MetricExceptions[ i ].st_Caught = false;
+  }
+
+  /** Launch one thread per group. */
+  ConcurrentMetricsThreaderParameterType userData;
+  userData.st_Metric = this;
+  userData.st_Parameters = &parameters;
+  userData.st_MetricGroups = &metricGroups;
+  this->m_ConcurrentMetricsThreader->SetNumberOfThreads( numberOfGroups );
+  this->m_ConcurrentMetricsThreader->SetSingleMethod(
+    ConcurrentMetricsThreaderCallback, &userData );
+  this->m_ConcurrentMetricsThreader->SingleMethodExecute();
+
+  /** Restore the metrics, and pass on the first exception that was thrown. */
+  const MetricExceptionStruct * firstException = 0;
+  for ( unsigned int g = 0; g < numberOfGroups; ++g )
+  {
+    for ( unsigned int k = 0; k < metricGroups[ g ].size(); ++k )
+    {
+      const unsigned int pos = metricGroups[ g ][ k ];
+      this->SetMetricTransformParametersAreSetExternally( pos, false );
+      ImageMetricType * imageMetric
+        = dynamic_cast<ImageMetricType *>( this->GetMetric( pos ) );
+      if ( imageMetric )
+      {
+        imageMetric->SetNumberOfThreads( numberOfThreads[ pos ] );
+      }
+      if ( !firstException && this->m_MetricExceptions[ pos ].st_Caught )
+      {
+        firstException = &this->m_MetricExceptions[ pos ];
+      }
+    }
+  }
+  if ( firstException )
+  {
+    throw firstException->st_Exception;
+  }
+
+} // end ComputeMetricValuesAndDerivativesConcurrently()
+
+
+/**
+ * ******************* ConcurrentMetricsThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_TYPE
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::ConcurrentMetricsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  const unsigned int numberOfThreads = infoStruct->NumberOfThreads;
+  ConcurrentMetricsThreaderParameterType * userData
+    = static_cast<ConcurrentMetricsThreaderParameterType *>( infoStruct->UserData );
+
+  /** Evaluate the metrics of the groups of this thread one by one. */
+  const MetricGroupsType & metricGroups = *userData->st_MetricGroups;
+  for ( unsigned int g = threadID; g < metricGroups.size(); g += numberOfThreads )
+  {
+    for ( unsigned int k = 0; k < metricGroups[ g ].size(); ++k )
+    {
+      const unsigned int pos = metricGroups[ g ][ k ];
+      MetricExceptionStruct & metricException
+        = userData->st_Metric->m_MetricExceptions[ pos ];
+      try
+      {
+        userData->st_Metric->ComputeMetricValueAndDerivative(
+          pos, *userData->st_Parameters );
+      }
+      catch ( ExceptionObject & err )
+      {
+        metricException.st_Caught = true;
+        metricException.st_Exception = err;
+      }
+      catch ( std::exception & err )
+      {
+        metricException.st_Caught = true;
+        metricException.st_Exception = ExceptionObject( __FILE__, __LINE__,
+          err.what(), "CombinationImageToImageMetric" );
+      }
+    }
+  }
+
+  /** Add the profiled times of this thread, before it ends. */
+  tmr::Profiler::FlushThread();
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ConcurrentMetricsThreaderCallback()
+
+
+/**
+ * ************** SetMetricTransformParametersAreSetExternally *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::SetMetricTransformParametersAreSetExternally(
+  unsigned int pos, bool setExternally ) const
+{
+  ImageMetricType * imageMetric
+    = dynamic_cast<ImageMetricType *>( this->GetMetric( pos ) );
+  if ( imageMetric )
+  {
+    imageMetric->SetTransformParametersAreSetExternally( setExternally );
+    return true;
+  }
+  PointSetMetricType * pointSetMetric
+    = dynamic_cast<PointSetMetricType *>( this->GetMetric( pos ) );
+  if ( pointSetMetric )
+  {
+    pointSetMetric->SetTransformParametersAreSetExternally( setExternally );
+    return true;
+  }
+  return false;
+
+} // end SetMetricTransformParametersAreSetExternally()
+
+
 /**
  * ********************* GetSelfHessian ****************************
  */
@@ -893,6 +1375,76 @@ CombinationImageToImageMetric<TFixedImage,TMovingImage>
 } // end GetSelfHessian()
 
 
+/**
+ * ********************* CreateEvaluator ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename CombinationImageToImageMetric<TFixedImage,TMovingImage>::Superclass::Pointer
+CombinationImageToImageMetric<TFixedImage,TMovingImage>
+::CreateEvaluator( AdvancedTransformType * transform ) const
+{
+  if ( this->m_NumberOfMetrics == 0 || this->m_AdvancedTransform.IsNull() )
+  {
+    return 0;
+  }
+
+  /** All sub metrics should use the same transform, of which the
+   * evaluators get a single copy.
+   */
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if ( this->GetTransform( i ) != this->m_AdvancedTransform.GetPointer() )
+    {
+      return 0;
+    }
+  }
+  typename AdvancedTransformType::Pointer transformCopy = transform;
+  if ( transformCopy.IsNull() )
+  {
+    transformCopy = this->m_AdvancedTransform->CreateEvaluationCopy();
+    if ( transformCopy.IsNull() )
+    {
+      return 0;
+    }
+  }
+
+  /** Create the evaluators of the sub metrics. */
+  Pointer evaluator = Self::New();
+  evaluator->SetNumberOfMetrics( this->m_NumberOfMetrics );
+  for ( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric
+      = dynamic_cast<const ImageMetricType *>( this->GetMetric( i ) );
+    if ( !metric )
+    {
+      return 0;
+    }
+    ImageMetricPointer subEvaluator = metric->CreateEvaluator( transformCopy );
+    if ( subEvaluator.IsNull() )
+    {
+      return 0;
+    }
+    evaluator->SetMetric( subEvaluator, i );
+  }
+
+  /** Copy the weights and the settings. */
+  evaluator->m_MetricWeights = this->m_MetricWeights;
+  evaluator->m_MetricRelativeWeights = this->m_MetricRelativeWeights;
+  evaluator->m_UseRelativeWeights = this->m_UseRelativeWeights;
+  evaluator->m_UseMetric = this->m_UseMetric;
+  evaluator->m_UseTransformEvaluationCache = this->m_UseTransformEvaluationCache;
+  evaluator->m_EvaluateMetricsConcurrently = false;
+  evaluator->SetUseMultiThread( false );
+
+  /** Set the transform in the evaluator itself. */
+  evaluator->Superclass::SetTransform( transformCopy );
+
+  return evaluator.GetPointer();
+
+} // end CreateEvaluator()
+
+
 /**
  * ********************* GetMTime ****************************
  */
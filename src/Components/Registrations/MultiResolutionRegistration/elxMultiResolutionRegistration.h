@@ -36,6 +36,13 @@ using namespace itk;
    * \parameter NumberOfResolutions: the number of resolutions used. \n
    *    example: <tt>(NumberOfResolutions 4)</tt> \n
    *    The default is 3.
+   * \parameter ComputePyramidImagesPerResolution: compute the pyramid images of a
+   *    resolution just before it is optimised, instead of all resolutions before the
+   *    first one, and release them when the resolution finishes. This reduces the
+   *    memory consumption for large images. Only the smoothing and shrinking pyramids
+   *    support this; the recursive pyramids still compute all resolutions at once. \n
+   *    example: <tt>(ComputePyramidImagesPerResolution "true")</tt> \n
+   *    The default is "false".
    *
    * \ingroup Registrations
    */
@@ -38,6 +38,12 @@ using namespace itk;
     this->m_Configuration->ReadParameter( numberOfResolutions, "NumberOfResolutions", 0 );
     this->SetNumberOfLevels( numberOfResolutions );
 
+    /** Set whether the pyramid images are computed per resolution. */
+    bool computePyramidImagesPerResolution = false;
+    this->m_Configuration->ReadParameter( computePyramidImagesPerResolution,
+      "ComputePyramidImagesPerResolution", 0, false );
+    this->SetComputePyramidImagesPerResolution( computePyramidImagesPerResolution );
+
     /** Set the FixedImageRegion. */
 
     /** Make sure the fixed image is up to date. */
@@ -16,6 +16,7 @@
 #define __elxBSplineResampleInterpolator_h
 
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineCoefficientImageCache.h"
 #include "elxIncludes.h"
 
 namespace elastix
@@ -33,12 +34,23 @@ namespace elastix
   *    the deformed moving image; possible values: (0-5) \n
   *    example: <tt>(FinalBSplineInterpolationOrder 3) </tt> \n
   *    Default: 3.
+  * \parameter UseBSplineCoefficientCache: whether the B-spline coefficients of the moving
+  *    image are taken from a cache that is shared by all registrations in this process,
+  *    and by the BSplineInterpolator. \n
+  *    example: <tt>(UseBSplineCoefficientCache "true")</tt> \n
+  *    Default: "false".
+  * \parameter BSplineCoefficientCacheDirectory: a directory in which the cached coefficients
+  *    are stored, so that they are reused by later elastix and transformix runs. \n
+  *    example: <tt>(BSplineCoefficientCacheDirectory "/tmp/coefficients")</tt> \n
+  *    Default: "", which means that the cache is only kept in memory.
   *
   * The transform parameters necessary for transformix, additionally defined by this class, are:
   * \transformparameter FinalBSplineInterpolationOrder: the order of the B-spline used to resample
   *    the deformed moving image; possible values: (0-5) \n
   *    example: <tt>(FinalBSplineInterpolationOrder 3) </tt> \n
   *    Default: 3.
+  * \transformparameter UseBSplineCoefficientCache: see above. Only written if "true".
+  * \transformparameter BSplineCoefficientCacheDirectory: see above. Only written if not empty.
   *
   * With very large images, memory problems may be avoided by using the BSplineResampleInterpolatorFloat.
   * The differences of the result are generally negligible.
@@ -98,6 +110,10 @@ namespace elastix
     typedef typename Superclass1::CoefficientFilterPointer  CoefficientFilterPointer;
     typedef typename Superclass1::CovariantVectorType       CovariantVectorType;
 
+    /** Typedef for the coefficient cache. */
+    typedef BSplineCoefficientImageCache<
+      CoefficientImageType >                                CoefficientImageCacheType;
+
     /** Typedef's from ResampleInterpolatorBase. */
     typedef typename Superclass2::ElastixType               ElastixType;
     typedef typename Superclass2::ElastixPointer            ElastixPointer;
@@ -118,10 +134,15 @@ namespace elastix
     /** Function to write transform-parameters to a file. */
     virtual void WriteToFile( void ) const;
 
+    /** Set the input image. If the coefficient cache is used, the
+     * coefficients are taken from the cache instead of being recomputed.
+     */
+    virtual void SetInputImage( const InputImageType * inputData );
+
   protected:
 
     /** The constructor. */
-    BSplineResampleInterpolator() {}
+    BSplineResampleInterpolator();
     /** The destructor. */
     virtual ~BSplineResampleInterpolator() {}
 
@@ -132,6 +153,13 @@ namespace elastix
     /** The private copy constructor. */
     void operator=( const Self& );              // purposely not implemented
 
+    /** Read the coefficient cache settings from the configuration. */
+    void ReadCoefficientCacheSettings( void );
+
+    /** The coefficient cache settings. */
+    bool        m_UseCoefficientCache;
+    std::string m_CoefficientCacheDirectory;
+
   }; // end class BSplineResampleInterpolator
 
 
@@ -21,6 +21,20 @@ namespace elastix
 {
   using namespace itk;
 
+/*
+ * ******************* Constructor ***********************
+ */
+
+template <class TElastix>
+BSplineResampleInterpolator<TElastix>
+::BSplineResampleInterpolator()
+{
+  this->m_UseCoefficientCache = false;
+  this->m_CoefficientCacheDirectory = "";
+
+} // end Constructor
+
+
 /*
  * ******************* BeforeRegistration ***********************
  */
@@ -42,6 +56,9 @@ BSplineResampleInterpolator<TElastix>
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Read the coefficient cache settings. */
+  this->ReadCoefficientCacheSettings();
+
 } // end BeforeRegistration()
 
 
@@ -69,6 +86,9 @@ BSplineResampleInterpolator<TElastix>
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Read the coefficient cache settings. */
+  this->ReadCoefficientCacheSettings();
+
 } // end ReadFromFile()
 
 
@@ -90,9 +110,70 @@ BSplineResampleInterpolator<TElastix>
   xout["transpar"] << "(FinalBSplineInterpolationOrder "
     << this->GetSplineOrder() << ")" << std::endl;
 
+  /** Write the coefficient cache settings, so that transformix uses them too. */
+  if ( this->m_UseCoefficientCache )
+  {
+    xout["transpar"] << "(UseBSplineCoefficientCache \"true\")" << std::endl;
+    if ( !this->m_CoefficientCacheDirectory.empty() )
+    {
+      xout["transpar"] << "(BSplineCoefficientCacheDirectory \""
+        << this->m_CoefficientCacheDirectory << "\")" << std::endl;
+    }
+  }
+
 } // end WriteToFile()
 
 
+/*
+ * ******************* ReadCoefficientCacheSettings ****************************
+ */
+
+template <class TElastix>
+void
+BSplineResampleInterpolator<TElastix>
+::ReadCoefficientCacheSettings( void )
+{
+  this->m_UseCoefficientCache = false;
+  this->m_Configuration->ReadParameter( this->m_UseCoefficientCache,
+    "UseBSplineCoefficientCache", 0 );
+
+  this->m_CoefficientCacheDirectory = "";
+  this->m_Configuration->ReadParameter( this->m_CoefficientCacheDirectory,
+    "BSplineCoefficientCacheDirectory", 0 );
+
+  if ( this->m_UseCoefficientCache && !this->m_CoefficientCacheDirectory.empty() )
+  {
+    CoefficientImageCacheType::GetInstance()
+      ->SetCacheDirectory( this->m_CoefficientCacheDirectory );
+  }
+
+} // end ReadCoefficientCacheSettings()
+
+
+/*
+ * ******************* SetInputImage ****************************
+ */
+
+template <class TElastix>
+void
+BSplineResampleInterpolator<TElastix>
+::SetInputImage( const InputImageType * inputData )
+{
+  if ( !this->m_UseCoefficientCache || inputData == 0 )
+  {
+    this->Superclass1::SetInputImage( inputData );
+    return;
+  }
+
+  /** Do what the superclass does, but take the coefficients from the cache. */
+  this->m_Coefficients = CoefficientImageCacheType::GetInstance()
+    ->GetCoefficients( inputData, this->GetSplineOrder() );
+  this->Superclass1::Superclass::SetInputImage( inputData );
+  this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+} // end SetInputImage()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxBSplineResampleInterpolator_hxx
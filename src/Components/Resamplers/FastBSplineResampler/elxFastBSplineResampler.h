@@ -0,0 +1,141 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __elxFastBSplineResampler_h
+#define __elxFastBSplineResampler_h
+
+
+#include "itkFastBSplineResampleImageFilter.h"
+#include "elxIncludes.h"
+
+namespace elastix
+{
+using namespace itk;
+
+/**
+ * \class FastBSplineResampler
+ * \brief A resampler based on the itk::FastBSplineResampleImageFilter.
+ *
+ * This resampler uses a specialised kernel when third order B-spline
+ * interpolation is used together with a transform that is composed of
+ * third order B-spline and affine transforms. Otherwise it behaves like
+ * the DefaultResampler.
+ *
+ * The parameters used in this class are:
+ * \parameter Resampler: Select this resampler as follows:\n
+ *    <tt>(Resampler "FastBSplineResampler")</tt>
+ * \parameter UseFastBSplineResampling: Whether to use the specialised
+ *    kernel. \n
+ *    example: <tt>(UseFastBSplineResampling "false")</tt> \n
+ *    The default is "true".
+ *
+ * \ingroup Resamplers
+ */
+
+template < class TElastix >
+class FastBSplineResampler :
+  public FastBSplineResampleImageFilter<
+  ITK_TYPENAME ResamplerBase<TElastix>::InputImageType,
+  ITK_TYPENAME ResamplerBase<TElastix>::OutputImageType,
+  ITK_TYPENAME ResamplerBase<TElastix>::CoordRepType >,
+  public ResamplerBase<TElastix>
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef FastBSplineResampler                            Self;
+  typedef FastBSplineResampleImageFilter<
+    typename ResamplerBase<TElastix>::InputImageType,
+    typename ResamplerBase<TElastix>::OutputImageType,
+    typename ResamplerBase<TElastix>::CoordRepType >      Superclass1;
+  typedef ResamplerBase<TElastix>                         Superclass2;
+  typedef SmartPointer<Self>                              Pointer;
+  typedef SmartPointer<const Self>                        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( FastBSplineResampler, FastBSplineResampleImageFilter );
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific resampler. \n
+   * example: <tt>(Resampler "FastBSplineResampler")</tt>\n
+   */
+  elxClassNameMacro( "FastBSplineResampler" );
+
+  /** Typedef's inherited from the superclass. */
+  typedef typename Superclass1::InputImageType            InputImageType;
+  typedef typename Superclass1::OutputImageType           OutputImageType;
+  typedef typename Superclass1::InputImagePointer         InputImagePointer;
+  typedef typename Superclass1::OutputImagePointer        OutputImagePointer;
+  typedef typename Superclass1::InputImageRegionType      InputImageRegionType;
+  typedef typename Superclass1::TransformType             TransformType;
+  typedef typename Superclass1::TransformPointerType      TransformPointerType;
+  typedef typename Superclass1::InterpolatorType          InterpolatorType;
+  typedef typename Superclass1::InterpolatorPointerType   InterpolatePointerType;
+  typedef typename Superclass1::SizeType                  SizeType;
+  typedef typename Superclass1::IndexType                 IndexType;
+  typedef typename Superclass1::PointType                 PointType;
+  typedef typename Superclass1::PixelType                 PixelType;
+  typedef typename Superclass1::OutputImageRegionType     OutputImageRegionType;
+  typedef typename Superclass1::SpacingType               SpacingType;
+  typedef typename Superclass1::OriginPointType           OriginPointType;
+
+  /** Typedef's from the ResamplerBase. */
+  typedef typename Superclass2::ElastixType           ElastixType;
+  typedef typename Superclass2::ElastixPointer        ElastixPointer;
+  typedef typename Superclass2::ConfigurationType     ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer  ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType      RegistrationType;
+  typedef typename Superclass2::RegistrationPointer   RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType           ITKBaseType;
+
+  /** Read the parameters before the registration. */
+  virtual void BeforeRegistration( void );
+
+  /** Function to read parameters from a file. */
+  virtual void ReadFromFile( void );
+
+  /** Function to write parameters to a file. */
+  virtual void WriteToFile( void ) const;
+
+protected:
+
+  /** The constructor. */
+  FastBSplineResampler() {}
+  /** The destructor. */
+  virtual ~FastBSplineResampler() {}
+
+  /** Overwrite from FastBSplineResampleImageFilter.
+   * We simply call the Superclass and print the warning messages to elxout.
+   */
+  virtual bool CheckForValidConfiguration( void );
+
+private:
+
+  /** The private constructor. */
+  FastBSplineResampler( const Self& );  // purposely not implemented
+  /** The private copy constructor. */
+  void operator=( const Self& );        // purposely not implemented
+
+}; // end class FastBSplineResampler
+
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "elxFastBSplineResampler.hxx"
+#endif
+
+#endif // end #ifndef __elxFastBSplineResampler_h
@@ -0,0 +1,111 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __elxFastBSplineResampler_hxx
+#define __elxFastBSplineResampler_hxx
+
+#include "elxFastBSplineResampler.h"
+
+
+namespace elastix
+{
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+FastBSplineResampler<TElastix>
+::BeforeRegistration( void )
+{
+  /** Are we using the specialised kernel? Default = true. */
+  bool useFastResampling = true;
+  this->m_Configuration->ReadParameter( useFastResampling,
+    "UseFastBSplineResampling", 0 );
+  this->SetUseFastResampling( useFastResampling );
+
+} // end BeforeRegistration()
+
+
+/*
+ * ******************* ReadFromFile  ****************************
+ */
+
+template <class TElastix>
+void
+FastBSplineResampler<TElastix>
+::ReadFromFile( void )
+{
+  /** Call ReadFromFile of the ResamplerBase. */
+  this->Superclass2::ReadFromFile();
+
+  /** FastBSplineResampler specific. */
+
+  /** Are we using the specialised kernel? Default = true. */
+  bool useFastResampling = true;
+  this->m_Configuration->ReadParameter( useFastResampling,
+    "UseFastBSplineResampling", 0 );
+  this->SetUseFastResampling( useFastResampling );
+
+} // end ReadFromFile()
+
+
+/**
+ * ************************* WriteToFile ************************
+ */
+
+template <class TElastix>
+void
+FastBSplineResampler<TElastix>
+::WriteToFile( void ) const
+{
+  /** Call the WriteToFile from the ResamplerBase. */
+  this->Superclass2::WriteToFile();
+
+  /** Add some FastBSplineResampler specific lines. */
+  xout["transpar"] << std::endl << "// FastBSplineResampler specific" << std::endl;
+
+  /** Is the specialised kernel used or not? */
+  std::string useFastResampling = "false";
+  if ( this->GetUseFastResampling() ) useFastResampling = "true";
+  xout["transpar"] << "(UseFastBSplineResampling \""
+    << useFastResampling << "\")" << std::endl;
+
+} // end WriteToFile()
+
+
+/**
+ * ************************* CheckForValidConfiguration ************************
+ */
+
+template <class TElastix>
+bool
+FastBSplineResampler<TElastix>
+::CheckForValidConfiguration( void )
+{
+  const bool valid = this->Superclass1::CheckForValidConfiguration();
+
+  if ( !valid )
+  {
+    elxout << this->Superclass1::GetWarningReport() << std::endl;
+  }
+
+  return valid;
+
+} // end CheckForValidConfiguration()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef __elxFastBSplineResampler_hxx
@@ -0,0 +1,264 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __itkFastBSplineResampleImageFilter_h
+#define __itkFastBSplineResampleImageFilter_h
+
+#include "itkResampleImageFilter.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedIdentityTransform.h"
+
+#include <vector>
+#include <string>
+
+namespace itk
+{
+
+/** \class FastBSplineResampleImageFilter
+ * \brief Resample an image with a specialised kernel for third order
+ * B-spline transforms and third order B-spline interpolation.
+ *
+ * This filter is the CPU counterpart of the itkCUDAResampleImageFilter. It
+ * handles the same case, a third order B-spline transform with third order
+ * B-spline interpolation, for 2D and 3D images, and additionally chains of
+ * transforms that are composed of affine (matrix-offset) transforms and
+ * third order B-spline transforms, such as an affine registration followed
+ * by a B-spline registration. Arbitrary direction cosines are supported.
+ *
+ * Before the threads are started, the transform is flattened into a list of
+ * stages: affine maps, which are merged where possible, and B-spline
+ * transforms, of which only the coefficient buffers and the grid geometry
+ * are kept. The B-spline coefficients of the input image are computed once,
+ * in the coefficient type of the interpolator, float or double.
+ * Per voxel the cubic weights of all dimensions are computed without
+ * branches, and the coefficients are gathered as rows of four neighbouring
+ * values, of which the weighted sums are computed in the innermost loop.
+ * The B-spline transform stages share the gathered offsets and weights
+ * between the components of the displacement.
+ *
+ * The work is distributed over the threads per slice, as in any ITK filter.
+ * If the configuration is not supported, the ResampleImageFilter
+ * implementation is used; the reason is given by GetWarningReport().
+ *
+ * \ingroup GeometricTransforms
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType = float>
+class ITK_EXPORT FastBSplineResampleImageFilter:
+  public ResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+{
+public:
+  /** Standard class typedefs. */
+  typedef FastBSplineResampleImageFilter                      Self;
+  typedef ResampleImageFilter<
+    TInputImage,TOutputImage,TInterpolatorPrecisionType>      Superclass;
+  typedef SmartPointer<Self>                                  Pointer;
+  typedef SmartPointer<const Self>                            ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( FastBSplineResampleImageFilter, ResampleImageFilter );
+
+  /** The dimension of the images. */
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TOutputImage::ImageDimension );
+
+  /** Typedefs from Superclass. */
+  typedef typename Superclass::InputImageType           InputImageType;
+  typedef typename Superclass::OutputImageType          OutputImageType;
+  typedef typename Superclass::InputImagePointer        InputImagePointer;
+  typedef typename Superclass::InputImageConstPointer   InputImageConstPointer;
+  typedef typename Superclass::OutputImagePointer       OutputImagePointer;
+  typedef typename Superclass::InputImageRegionType     InputImageRegionType;
+
+  typedef typename Superclass::TransformType            TransformType;
+  typedef typename Superclass::TransformPointerType     TransformPointerType;
+  typedef typename Superclass::InterpolatorType         InterpolatorType;
+  typedef typename Superclass::InterpolatorPointerType  InterpolatorPointerType;
+
+  typedef typename Superclass::SizeType                 SizeType;
+  typedef typename Superclass::IndexType                IndexType;
+  typedef typename Superclass::PointType                PointType;
+  typedef typename Superclass::PixelType                PixelType;
+  typedef typename Superclass::InputPixelType           InputPixelType;
+  typedef typename Superclass::OutputImageRegionType    OutputImageRegionType;
+  typedef typename Superclass::SpacingType              SpacingType;
+  typedef typename Superclass::OriginPointType          OriginPointType;
+  typedef typename Superclass::DirectionType            DirectionType;
+
+  /** Typedefs for the supported transforms. */
+  typedef AdvancedCombinationTransform<
+    TInterpolatorPrecisionType, ImageDimension >        InternalComboTransformType;
+  typedef AdvancedBSplineDeformableTransform<
+    TInterpolatorPrecisionType, ImageDimension, 3 >     InternalBSplineTransformType;
+  typedef AdvancedMatrixOffsetTransformBase<
+    TInterpolatorPrecisionType,
+    ImageDimension, ImageDimension >                    InternalMatrixOffsetTransformType;
+  typedef AdvancedIdentityTransform<
+    TInterpolatorPrecisionType, ImageDimension >        InternalIdentityTransformType;
+  typedef typename InternalBSplineTransformType::PixelType BSplineCoefficientType;
+
+  /** Typedefs for the B-spline coefficients of the input image, which have
+   * the coefficient type of the interpolator.
+   */
+  typedef Image< float, ImageDimension >                CoefficientImageFloatType;
+  typedef Image< double, ImageDimension >               CoefficientImageDoubleType;
+
+  /** Set whether to use the specialised kernel. Default: true. */
+  itkSetMacro( UseFastResampling, bool );
+  itkGetConstMacro( UseFastResampling, bool );
+  itkBooleanMacro( UseFastResampling );
+
+  /** Get why the specialised kernel was not used in the last update.
+   * Empty if it was used.
+   */
+  itkGetStringMacro( WarningReport );
+
+protected:
+  FastBSplineResampleImageFilter();
+  virtual ~FastBSplineResampleImageFilter() {};
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const;
+
+  /** Check the configuration, flatten the transform and compute the
+   * coefficients of the input image. If the configuration is not supported,
+   * prepare the ResampleImageFilter implementation instead.
+   */
+  virtual void BeforeThreadedGenerateData( void );
+
+  /** Resample the region of one thread. */
+  virtual void ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, int threadId );
+
+  /** Release the coefficients and the flattened transform. */
+  virtual void AfterThreadedGenerateData( void );
+
+  /** Check if the transform, interpolator and image dimension are supported
+   * by the specialised kernel, and flatten the transform. If not, the reason
+   * is stored in the warning report, and false is returned.
+   */
+  virtual bool CheckForValidConfiguration( void );
+
+  /** Typedefs for the flattened transform. */
+  typedef Matrix< double, ImageDimension, ImageDimension > MatrixType;
+  typedef Vector< double, ImageDimension >              VectorType;
+  typedef Point< double, ImageDimension >               InternalPointType;
+
+  /** A stage of the flattened transform: an affine map, or a third order
+   * B-spline transform, which adds a displacement to the point.
+   */
+  struct TransformStageType
+  {
+    bool                                st_IsBSpline;
+    /** The affine matrix, or the map from point to continuous grid index. */
+    MatrixType                          st_Matrix;
+    /** The affine offset, or minus the position of the first grid point. */
+    VectorType                          st_Offset;
+    /** The coefficient buffers of a B-spline transform. */
+    const BSplineCoefficientType *      st_Coefficients[ ImageDimension ];
+    long                                st_Stride[ ImageDimension ];
+    double                              st_ValidBegin[ ImageDimension ];
+    double                              st_ValidEnd[ ImageDimension ];
+  };
+  typedef std::vector< TransformStageType >             TransformStageContainerType;
+
+  /** Add the stages of a transform to m_TransformStages.
+   * Returns false if the transform is not supported.
+   */
+  bool AddTransformStages( const TransformType * transform );
+
+  /** Add an affine stage; merged with a preceding affine stage. */
+  void AddAffineStage( const MatrixType & matrix, const VectorType & offset );
+
+  /** Compute the four cubic B-spline weights for a fractional position. */
+  static void ComputeCubicWeights( const double t, double weights[ 4 ] )
+  {
+    const double t2 = t * t;
+    const double t3 = t2 * t;
+    const double s = 1.0 - t;
+    weights[ 0 ] = s * s * s / 6.0;
+    weights[ 1 ] = ( 3.0 * t3 - 6.0 * t2 + 4.0 ) / 6.0;
+    weights[ 2 ] = ( -3.0 * t3 + 3.0 * t2 + 3.0 * t + 1.0 ) / 6.0;
+    weights[ 3 ] = t3 / 6.0;
+  }
+
+  /** Transform a point by a B-spline stage. */
+  void TransformPointByBSplineStage( const TransformStageType & stage,
+    InternalPointType & point ) const;
+
+  /** Compute the B-spline coefficients of the input image. */
+  template < class TCoefficientImage >
+  typename TCoefficientImage::Pointer ComputeInputCoefficients( void ) const;
+
+  /** Interpolate the input image at a continuous index relative to the
+   * start of its buffer. The index should lie inside the buffer.
+   */
+  template < class TCoefficient >
+  double InterpolateInputImage( const TCoefficient * coefficients,
+    const double cindex[ ImageDimension ] ) const;
+
+  /** Resample the region of one thread, with the input coefficients of
+   * the coefficient type of the interpolator.
+   */
+  template < class TCoefficient >
+  void ThreadedResample( const TCoefficient * coefficients,
+    const OutputImageRegionType & outputRegionForThread, int threadId );
+
+private:
+
+  FastBSplineResampleImageFilter( const Self& ); // purposely not implemented
+  void operator=( const Self& );                 // purposely not implemented
+
+  /** Check if the interpolator is a third order B-spline interpolator,
+   * and store whether its coefficients are float.
+   */
+  bool CheckForValidInterpolator( void );
+
+  /** Settings and state. */
+  bool                        m_UseFastResampling;
+  bool                        m_FastResamplingActive;
+  std::string                 m_WarningReport;
+
+  /** The flattened transform. The first affine stage is merged with the
+   * map from output index to physical point, which is m_OutputIndexToPoint
+   * and m_OutputOrigin.
+   */
+  TransformStageContainerType m_TransformStages;
+  MatrixType                  m_OutputIndexToPoint;
+  VectorType                  m_OutputOrigin;
+
+  /** The coefficients of the input image, and the map from physical point
+   * to continuous index relative to the start of the buffer.
+   */
+  bool                        m_UseFloatCoefficients;
+  typename CoefficientImageFloatType::Pointer   m_InputCoefficientsFloat;
+  typename CoefficientImageDoubleType::Pointer  m_InputCoefficientsDouble;
+  MatrixType                  m_InputPointToIndex;
+  VectorType                  m_InputOffset;
+  long                        m_InputSize[ ImageDimension ];
+  long                        m_InputStride[ ImageDimension ];
+
+}; // end class FastBSplineResampleImageFilter
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkFastBSplineResampleImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkFastBSplineResampleImageFilter_h
@@ -0,0 +1,739 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#ifndef __itkFastBSplineResampleImageFilter_hxx
+#define __itkFastBSplineResampleImageFilter_hxx
+
+#include "itkFastBSplineResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "itkImageLinearIteratorWithIndex.h"
+#include "itkProgressReporter.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::FastBSplineResampleImageFilter()
+{
+  this->m_UseFastResampling = true;
+  this->m_FastResamplingActive = false;
+  this->m_WarningReport = "";
+  this->m_UseFloatCoefficients = false;
+
+  this->m_OutputIndexToPoint.SetIdentity();
+  this->m_OutputOrigin.Fill( 0.0 );
+  this->m_InputPointToIndex.SetIdentity();
+  this->m_InputOffset.Fill( 0.0 );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    this->m_InputSize[ i ] = 0;
+    this->m_InputStride[ i ] = 0;
+  }
+
+} // end Constructor
+
+
+/**
+ * ******************* CheckForValidInterpolator ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidInterpolator( void )
+{
+  /** The coefficients are computed by this filter, in the coefficient type
+   * of the interpolator.
+   */
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType, float >   ValidInterpolatorFloatType;
+  typedef BSplineInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType, double >  ValidInterpolatorDoubleType;
+
+  const ValidInterpolatorFloatType * testPtr1
+    = dynamic_cast<const ValidInterpolatorFloatType *>( this->GetInterpolator() );
+  const ValidInterpolatorDoubleType * testPtr2
+    = dynamic_cast<const ValidInterpolatorDoubleType *>( this->GetInterpolator() );
+
+  this->m_UseFloatCoefficients = ( testPtr1 != 0 );
+  if ( testPtr1 )
+  {
+    return testPtr1->GetSplineOrder() == 3;
+  }
+  else if ( testPtr2 )
+  {
+    return testPtr2->GetSplineOrder() == 3;
+  }
+  return false;
+
+} // end CheckForValidInterpolator()
+
+
+/**
+ * ******************* AddAffineStage ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::AddAffineStage( const MatrixType & matrix, const VectorType & offset )
+{
+  /** The first stage is merged with the map from output index to point. */
+  if ( this->m_TransformStages.empty() )
+  {
+    this->m_OutputIndexToPoint = matrix * this->m_OutputIndexToPoint;
+    this->m_OutputOrigin = matrix * this->m_OutputOrigin + offset;
+    return;
+  }
+
+  /** Merge with a preceding affine stage. */
+  TransformStageType & last = this->m_TransformStages.back();
+  if ( !last.st_IsBSpline )
+  {
+    last.st_Matrix = matrix * last.st_Matrix;
+    last.st_Offset = matrix * last.st_Offset + offset;
+    return;
+  }
+
+  /** Otherwise add a new stage. */
+  TransformStageType stage;
+  stage.st_IsBSpline = false;
+  stage.st_Matrix = matrix;
+  stage.st_Offset = offset;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    stage.st_Coefficients[ i ] = 0;
+    stage.st_Stride[ i ] = 0;
+    stage.st_ValidBegin[ i ] = 0.0;
+    stage.st_ValidEnd[ i ] = 0.0;
+  }
+  this->m_TransformStages.push_back( stage );
+
+} // end AddAffineStage()
+
+
+/**
+ * ******************* AddTransformStages ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::AddTransformStages( const TransformType * transform )
+{
+  if ( !transform ) return false;
+
+  /** A combination transform: the initial transform is applied first. */
+  const InternalComboTransformType * comboTransform
+    = dynamic_cast<const InternalComboTransformType *>( transform );
+  if ( comboTransform )
+  {
+    const TransformType * initialTransform = comboTransform->GetInitialTransform();
+    const TransformType * currentTransform
+      = const_cast<InternalComboTransformType *>( comboTransform )->GetCurrentTransform();
+    if ( !currentTransform ) return false;
+    if ( initialTransform )
+    {
+      /** Addition of the displacements is not supported. */
+      if ( !comboTransform->GetUseComposition() ) return false;
+      if ( !this->AddTransformStages( initialTransform ) ) return false;
+    }
+    return this->AddTransformStages( currentTransform );
+  }
+
+  /** The identity transform adds nothing. */
+  if ( dynamic_cast<const InternalIdentityTransformType *>( transform ) )
+  {
+    return true;
+  }
+
+  /** An affine transform: x -> Ax + b. */
+  const InternalMatrixOffsetTransformType * matrixOffsetTransform
+    = dynamic_cast<const InternalMatrixOffsetTransformType *>( transform );
+  if ( matrixOffsetTransform )
+  {
+    MatrixType matrix;
+    VectorType offset;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        matrix( i, j ) = matrixOffsetTransform->GetMatrix()( i, j );
+      }
+      offset[ i ] = matrixOffsetTransform->GetOffset()[ i ];
+    }
+    this->AddAffineStage( matrix, offset );
+    return true;
+  }
+
+  /** A third order B-spline transform. */
+  const InternalBSplineTransformType * bSplineTransform
+    = dynamic_cast<const InternalBSplineTransformType *>( transform );
+  if ( bSplineTransform )
+  {
+    const typename InternalBSplineTransformType::ImagePointer * coefficientImages
+      = bSplineTransform->GetCoefficientImage();
+    if ( coefficientImages[ 0 ].IsNull() ) return false;
+    const typename InternalBSplineTransformType::RegionType bufferedRegion
+      = coefficientImages[ 0 ]->GetBufferedRegion();
+
+    /** The map from a point to the continuous grid index, relative to the
+     * first grid point in the buffer.
+     */
+    MatrixType indexToPoint;
+    VectorType firstGridPoint;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        indexToPoint( i, j ) = bSplineTransform->GetGridDirection()( i, j )
+          * bSplineTransform->GetGridSpacing()[ j ];
+      }
+    }
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      firstGridPoint[ i ] = bSplineTransform->GetGridOrigin()[ i ];
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        firstGridPoint[ i ] += indexToPoint( i, j )
+          * static_cast<double>( bufferedRegion.GetIndex()[ j ] );
+      }
+    }
+
+    TransformStageType stage;
+    stage.st_IsBSpline = true;
+    stage.st_Matrix = MatrixType( indexToPoint.GetInverse() );
+    stage.st_Offset = -firstGridPoint;
+
+    /** The valid region of the transform: the support of the B-spline
+     * should lie inside the grid.
+     */
+    long stride = 1;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      stage.st_Coefficients[ i ] = coefficientImages[ i ]->GetBufferPointer();
+      stage.st_Stride[ i ] = stride;
+      stage.st_ValidBegin[ i ] = 1.0;
+      stage.st_ValidEnd[ i ] = static_cast<double>( bufferedRegion.GetSize()[ i ] ) - 2.0;
+      stride *= static_cast<long>( bufferedRegion.GetSize()[ i ] );
+    }
+    this->m_TransformStages.push_back( stage );
+    return true;
+  }
+
+  /** Other transforms are not supported. */
+  return false;
+
+} // end AddTransformStages()
+
+
+/**
+ * ******************* CheckForValidConfiguration ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+bool
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::CheckForValidConfiguration( void )
+{
+  this->m_WarningReport = "";
+  this->m_TransformStages.clear();
+
+  if ( !this->m_UseFastResampling )
+  {
+    this->m_WarningReport = "The fast B-spline resampling is switched off.";
+    return false;
+  }
+
+  /** Check for a valid interpolator: 3rd order B-spline. */
+  if ( !this->CheckForValidInterpolator() )
+  {
+    this->m_WarningReport = "WARNING: No valid interpolator set:\n"
+      "The interpolator should be 3rd order B-spline.\n"
+      "Falling back to the default implementation.";
+    return false;
+  }
+
+  /** Start with the map from output index to physical point. */
+  const DirectionType & direction = this->GetOutputDirection();
+  const SpacingType & spacing = this->GetOutputSpacing();
+  const OriginPointType & origin = this->GetOutputOrigin();
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      this->m_OutputIndexToPoint( i, j ) = direction( i, j ) * spacing[ j ];
+    }
+    this->m_OutputOrigin[ i ] = origin[ i ];
+  }
+
+  /** Check for a valid transform, and flatten it. */
+  if ( !this->AddTransformStages( this->GetTransform() ) )
+  {
+    this->m_TransformStages.clear();
+    this->m_WarningReport = "WARNING: No valid transform set:\n"
+      "The transform should be a composition of 3rd order B-spline and affine transforms.\n"
+      "Falling back to the default implementation.";
+    return false;
+  }
+
+  return true;
+
+} // end CheckForValidConfiguration()
+
+
+/**
+ * ******************* BeforeThreadedGenerateData ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::BeforeThreadedGenerateData( void )
+{
+  /** Fall back to the superclass if the configuration is not supported. */
+  this->m_FastResamplingActive = this->CheckForValidConfiguration();
+  if ( !this->m_FastResamplingActive )
+  {
+    this->Superclass::BeforeThreadedGenerateData();
+    return;
+  }
+
+  /** Compute the B-spline coefficients of the input image, in the
+   * coefficient type of the interpolator. The interpolator itself is not
+   * used, so its coefficients are not computed.
+   */
+  const ImageBase< ImageDimension > * coefficientImage = 0;
+  if ( this->m_UseFloatCoefficients )
+  {
+    this->m_InputCoefficientsFloat
+      = this->template ComputeInputCoefficients< CoefficientImageFloatType >();
+    coefficientImage = this->m_InputCoefficientsFloat.GetPointer();
+  }
+  else
+  {
+    this->m_InputCoefficientsDouble
+      = this->template ComputeInputCoefficients< CoefficientImageDoubleType >();
+    coefficientImage = this->m_InputCoefficientsDouble.GetPointer();
+  }
+
+  /** The map from a point to the continuous index relative to the start of
+   * the buffer, and the layout of the buffer.
+   */
+  const InputImageRegionType bufferedRegion
+    = coefficientImage->GetBufferedRegion();
+  MatrixType indexToPoint;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      indexToPoint( i, j ) = coefficientImage->GetDirection()( i, j )
+        * coefficientImage->GetSpacing()[ j ];
+    }
+  }
+  this->m_InputPointToIndex = MatrixType( indexToPoint.GetInverse() );
+
+  long stride = 1;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    this->m_InputOffset[ i ] = -coefficientImage->GetOrigin()[ i ];
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      this->m_InputOffset[ i ] -= indexToPoint( i, j )
+        * static_cast<double>( bufferedRegion.GetIndex()[ j ] );
+    }
+    this->m_InputSize[ i ] = static_cast<long>( bufferedRegion.GetSize()[ i ] );
+    this->m_InputStride[ i ] = stride;
+    stride *= this->m_InputSize[ i ];
+  }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ComputeInputCoefficients ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+template < class TCoefficientImage >
+typename TCoefficientImage::Pointer
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ComputeInputCoefficients( void ) const
+{
+  typedef BSplineDecompositionImageFilter<
+    InputImageType, TCoefficientImage >       DecompositionFilterType;
+  typename DecompositionFilterType::Pointer decompositionFilter
+    = DecompositionFilterType::New();
+  decompositionFilter->SetSplineOrder( 3 );
+  decompositionFilter->SetInput( this->GetInput() );
+  decompositionFilter->Update();
+
+  typename TCoefficientImage::Pointer coefficients = decompositionFilter->GetOutput();
+  coefficients->DisconnectPipeline();
+  return coefficients;
+
+} // end ComputeInputCoefficients()
+
+
+/**
+ * ******************* TransformPointByBSplineStage ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::TransformPointByBSplineStage( const TransformStageType & stage,
+  InternalPointType & point ) const
+{
+  /** Compute the continuous grid index. */
+  const VectorType shifted = point.GetVectorFromOrigin() + stage.st_Offset;
+  double cindex[ ImageDimension ];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    cindex[ i ] = 0.0;
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+    {
+      cindex[ i ] += stage.st_Matrix( i, j ) * shifted[ j ];
+    }
+  }
+
+  /** Outside the valid region the displacement is zero, as in the transform. */
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    if ( cindex[ i ] < stage.st_ValidBegin[ i ]
+      || cindex[ i ] >= stage.st_ValidEnd[ i ] )
+    {
+      return;
+    }
+  }
+
+  /** Compute the weights of all dimensions, and the offset of the first
+   * coefficient of the support.
+   */
+  double weights[ ImageDimension ][ 4 ];
+  long start = 0;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    const double floored = vcl_floor( cindex[ i ] );
+    ComputeCubicWeights( cindex[ i ] - floored, weights[ i ] );
+    start += ( static_cast<long>( floored ) - 1 ) * stage.st_Stride[ i ];
+  }
+
+  /** Sum the support as rows of four coefficients along the first dimension.
+   * All components of the displacement share the offsets and the weights.
+   */
+  const unsigned int numberOfRows = 1u << ( 2 * ( ImageDimension - 1 ) );
+  double displacement[ ImageDimension ];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    displacement[ i ] = 0.0;
+  }
+  for ( unsigned int r = 0; r < numberOfRows; ++r )
+  {
+    long offset = start;
+    double rowWeight = 1.0;
+    unsigned int rest = r;
+    for ( unsigned int i = 1; i < ImageDimension; ++i )
+    {
+      const unsigned int k = rest & 3;
+      rest >>= 2;
+      offset += static_cast<long>( k ) * stage.st_Stride[ i ];
+      rowWeight *= weights[ i ][ k ];
+    }
+
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      const BSplineCoefficientType * row = stage.st_Coefficients[ i ] + offset;
+      displacement[ i ] += rowWeight * (
+        weights[ 0 ][ 0 ] * row[ 0 ] + weights[ 0 ][ 1 ] * row[ 1 ]
+        + weights[ 0 ][ 2 ] * row[ 2 ] + weights[ 0 ][ 3 ] * row[ 3 ] );
+    }
+  }
+
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    point[ i ] += displacement[ i ];
+  }
+
+} // end TransformPointByBSplineStage()
+
+
+/**
+ * ******************* InterpolateInputImage ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+template < class TCoefficient >
+double
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::InterpolateInputImage( const TCoefficient * coefficients,
+  const double cindex[ ImageDimension ] ) const
+{
+  /** Compute the weights and the offsets of the support of all dimensions.
+   * Outside the buffer the mirror boundary conditions of the
+   * BSplineInterpolateImageFunction are applied.
+   */
+  double weights[ ImageDimension ][ 4 ];
+  long offsets[ ImageDimension ][ 4 ];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    const double floored = vcl_floor( cindex[ i ] );
+    ComputeCubicWeights( cindex[ i ] - floored, weights[ i ] );
+
+    const long first = static_cast<long>( floored ) - 1;
+    const long size = this->m_InputSize[ i ];
+    const long size2 = 2 * size - 2;
+    for ( unsigned int k = 0; k < 4; ++k )
+    {
+      long index = first + static_cast<long>( k );
+      if ( size == 1 )
+      {
+        index = 0;
+      }
+      else if ( index < 0 || index >= size )
+      {
+        if ( index < 0 )
+        {
+          index = -index - size2 * ( ( -index ) / size2 );
+        }
+        else
+        {
+          index = index - size2 * ( index / size2 );
+        }
+        if ( size <= index ) index = size2 - index;
+      }
+      offsets[ i ][ k ] = index * this->m_InputStride[ i ];
+    }
+  }
+
+  /** Sum the support as rows of four coefficients along the first dimension. */
+  const unsigned int numberOfRows = 1u << ( 2 * ( ImageDimension - 1 ) );
+  double value = 0.0;
+  for ( unsigned int r = 0; r < numberOfRows; ++r )
+  {
+    long offset = 0;
+    double rowWeight = 1.0;
+    unsigned int rest = r;
+    for ( unsigned int i = 1; i < ImageDimension; ++i )
+    {
+      const unsigned int k = rest & 3;
+      rest >>= 2;
+      offset += offsets[ i ][ k ];
+      rowWeight *= weights[ i ][ k ];
+    }
+
+    const TCoefficient * row = coefficients + offset;
+    value += rowWeight * (
+      weights[ 0 ][ 0 ] * row[ offsets[ 0 ][ 0 ] ]
+      + weights[ 0 ][ 1 ] * row[ offsets[ 0 ][ 1 ] ]
+      + weights[ 0 ][ 2 ] * row[ offsets[ 0 ][ 2 ] ]
+      + weights[ 0 ][ 3 ] * row[ offsets[ 0 ][ 3 ] ] );
+  }
+
+  return value;
+
+} // end InterpolateInputImage()
+
+
+/**
+ * ******************* ThreadedGenerateData ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread, int threadId )
+{
+  /** Use the superclass if the configuration is not supported. */
+  if ( !this->m_FastResamplingActive )
+  {
+    this->Superclass::ThreadedGenerateData( outputRegionForThread, threadId );
+    return;
+  }
+
+  if ( this->m_UseFloatCoefficients )
+  {
+    this->ThreadedResample( this->m_InputCoefficientsFloat->GetBufferPointer(),
+      outputRegionForThread, threadId );
+  }
+  else
+  {
+    this->ThreadedResample( this->m_InputCoefficientsDouble->GetBufferPointer(),
+      outputRegionForThread, threadId );
+  }
+
+} // end ThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedResample ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+template < class TCoefficient >
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::ThreadedResample( const TCoefficient * coefficients,
+  const OutputImageRegionType & outputRegionForThread, int threadId )
+{
+  /** Walk over the rows of the region of this thread. */
+  typedef ImageLinearIteratorWithIndex< OutputImageType > OutputIteratorType;
+  OutputIteratorType it( this->GetOutput(), outputRegionForThread );
+  it.SetDirection( 0 );
+
+  /** Report the progress per row. */
+  const unsigned long numberOfRows = outputRegionForThread.GetNumberOfPixels()
+    / outputRegionForThread.GetSize()[ 0 ];
+  ProgressReporter progress( this, threadId, numberOfRows );
+
+  /** The range of the output pixel type, and the default value. */
+  const double minValue
+    = static_cast<double>( NumericTraits< PixelType >::NonpositiveMin() );
+  const double maxValue
+    = static_cast<double>( NumericTraits< PixelType >::max() );
+  const PixelType defaultValue = this->GetDefaultPixelValue();
+
+  /** The step of the point along a row. */
+  VectorType step;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    step[ i ] = this->m_OutputIndexToPoint( i, 0 );
+  }
+
+  const unsigned int numberOfStages = this->m_TransformStages.size();
+  it.GoToBegin();
+  while ( !it.IsAtEnd() )
+  {
+    /** The point of the first voxel of the row, after the first affine stage. */
+    const IndexType & rowIndex = it.GetIndex();
+    InternalPointType rowStart;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      rowStart[ i ] = this->m_OutputOrigin[ i ];
+      for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+        rowStart[ i ] += this->m_OutputIndexToPoint( i, j )
+          * static_cast<double>( rowIndex[ j ] );
+      }
+    }
+
+    unsigned long k = 0;
+    while ( !it.IsAtEndOfLine() )
+    {
+      /** Apply the remaining stages of the transform. */
+      InternalPointType point = rowStart + step * static_cast<double>( k );
+      for ( unsigned int s = 0; s < numberOfStages; ++s )
+      {
+        const TransformStageType & stage = this->m_TransformStages[ s ];
+        if ( stage.st_IsBSpline )
+        {
+          this->TransformPointByBSplineStage( stage, point );
+        }
+        else
+        {
+          point = stage.st_Matrix * point + stage.st_Offset;
+        }
+      }
+
+      /** Compute the continuous index in the input buffer. */
+      const VectorType shifted = point.GetVectorFromOrigin() + this->m_InputOffset;
+      double cindex[ ImageDimension ];
+      bool inside = true;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+        cindex[ i ] = 0.0;
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+          cindex[ i ] += this->m_InputPointToIndex( i, j ) * shifted[ j ];
+        }
+        if ( cindex[ i ] < -0.5
+          || cindex[ i ] >= static_cast<double>( this->m_InputSize[ i ] ) - 0.5 )
+        {
+          inside = false;
+        }
+      }
+
+      /** Interpolate, and clamp to the range of the output pixel type. */
+      if ( inside )
+      {
+        double value = this->InterpolateInputImage( coefficients, cindex );
+        if ( value < minValue ) value = minValue;
+        else if ( value > maxValue ) value = maxValue;
+        it.Set( static_cast<PixelType>( value ) );
+      }
+      else
+      {
+        it.Set( defaultValue );
+      }
+
+      ++it;
+      ++k;
+    }
+
+    it.NextLine();
+    progress.CompletedPixel();
+  }
+
+} // end ThreadedResample()
+
+
+/**
+ * ******************* AfterThreadedGenerateData ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::AfterThreadedGenerateData( void )
+{
+  if ( !this->m_FastResamplingActive )
+  {
+    this->Superclass::AfterThreadedGenerateData();
+    return;
+  }
+
+  /** Release the coefficients and the flattened transform. */
+  this->m_InputCoefficientsFloat = 0;
+  this->m_InputCoefficientsDouble = 0;
+  this->m_TransformStages.clear();
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* PrintSelf ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+FastBSplineResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "UseFastResampling: " << this->m_UseFastResampling << std::endl;
+  os << indent << "WarningReport: " << this->m_WarningReport << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkFastBSplineResampleImageFilter_hxx
@@ -71,6 +71,9 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType                    JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType     InternalMatrixType;
+  typedef typename Superclass::GridRegionType         GridRegionType;
+  typedef typename Superclass
+    ::GridIndexToPointMatrixType                      GridIndexToPointMatrixType;
   typedef typename Superclass::ParametersType         ParametersType;
 
   /** Parameters as SpaceDimension number of images. */
@@ -109,6 +112,12 @@ public:
   /** This method specifies the region over which the grid resides. */
   virtual void SetGridRegion( const RegionType& region );
 
+  /** Transform points by a B-spline deformable transformation. The
+   * separable kernel of the superclass does not handle support regions
+   * that wrap around, so this calls the version below.
+   */
+  OutputPointType TransformPoint( const InputPointType & point ) const;
+
   /** Transform points by a B-spline deformable transformation.
    * On return, weights contains the interpolation weights used to compute the
    * deformation and indices of the x (zeroth) dimension coefficient parameters
@@ -137,6 +146,38 @@ public:
     const InputPointType & ipp,
     SpatialJacobianType & sj ) const;
 
+  /** The batched methods of the superclass do not handle support regions
+   * that wrap around the last dimension, so evaluate point by point.
+   */
+  virtual void TransformPoints(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    OutputPointType * opp ) const;
+
+  virtual void GetJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    JacobianType * j,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const;
+
+  virtual void GetSpatialJacobians(
+    const unsigned long numberOfPoints,
+    const InputPointType * ipp,
+    SpatialJacobianType * sj ) const;
+
+  /** The grid evaluation of the superclass does not handle wrapping
+   * either, so it is disabled: returns false.
+   */
+  virtual bool EvaluateOnGrid(
+    const InputPointType &,
+    const GridIndexToPointMatrixType &,
+    const GridRegionType &,
+    OutputPointType *,
+    SpatialJacobianType * ) const
+  {
+    return false;
+  }
+
 protected:
   CyclicBSplineDeformableTransform();
   virtual ~CyclicBSplineDeformableTransform();
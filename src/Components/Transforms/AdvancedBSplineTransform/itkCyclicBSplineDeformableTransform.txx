@@ -239,6 +239,28 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
   }
 }
 
+/** Transform a point. */
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+typename CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
+::OutputPointType
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>
+::TransformPoint( const InputPointType & point ) const
+{
+  /** Allocate memory on the stack: */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  typename ParameterIndexArrayType::ValueType indicesArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  ParameterIndexArrayType indices( indicesArray, numberOfWeights, false );
+
+  OutputPointType outputPoint;
+  bool inside;
+
+  this->TransformPoint( point, outputPoint, weights, indices, inside );
+
+  return outputPoint;
+}
+
 /** Compute the Jacobian in one position. */
 template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
 const
@@ -506,6 +528,76 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
 } // end GetSpatialJacobian()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::TransformPoints(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  OutputPointType * opp ) const
+{
+  /** Allocate memory on the stack, once for the whole block. */
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray[ numberOfWeights ];
+  typename ParameterIndexArrayType::ValueType indicesArray[ numberOfWeights ];
+  WeightsType weights( weightsArray, numberOfWeights, false );
+  ParameterIndexArrayType indices( indicesArray, numberOfWeights, false );
+  bool inside;
+
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    this->TransformPoint( ipp[ p ], opp[ p ], weights, indices, inside );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  JacobianType * j,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices ) const
+{
+  /** The sparse GetJacobian() is hidden by the overloads in this class. */
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    this->Superclass::GetJacobian( ipp[ p ], j[ p ], nonZeroJacobianIndices[ p ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* GetSpatialJacobians ****************************
+ */
+
+template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions,VSplineOrder>
+::GetSpatialJacobians(
+  const unsigned long numberOfPoints,
+  const InputPointType * ipp,
+  SpatialJacobianType * sj ) const
+{
+  for ( unsigned long p = 0; p < numberOfPoints; ++p )
+  {
+    this->GetSpatialJacobian( ipp[ p ], sj[ p ] );
+  }
+
+} // end GetSpatialJacobians()
+
+
 /**
  * ********************* ComputeNonZeroJacobianIndices ****************************
  */
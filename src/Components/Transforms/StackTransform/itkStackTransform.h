@@ -164,6 +164,26 @@ public:
   /** Get number of nonzero Jacobian indices. */
   virtual unsigned long GetNumberOfNonZeroJacobianIndices( void ) const;
 
+  /** Create a stack transform with copies of the sub transforms. */
+  virtual typename Superclass::Pointer CreateEvaluationCopy( void ) const
+  {
+    Pointer copy = Self::New();
+    copy->SetNumberOfSubTransforms( this->m_NumberOfSubTransforms );
+    copy->SetStackSpacing( this->m_StackSpacing );
+    copy->SetStackOrigin( this->m_StackOrigin );
+    for ( unsigned int t = 0; t < this->m_NumberOfSubTransforms; ++t )
+    {
+      SubTransformPointer subTransformCopy
+        = this->m_SubTransformContainer[ t ]->CreateEvaluationCopy();
+      if ( subTransformCopy.IsNull() )
+      {
+        return 0;
+      }
+      copy->SetSubTransform( t, subTransformCopy );
+    }
+    return copy.GetPointer();
+  }
+
 protected:
   StackTransform();
   virtual ~StackTransform() {};
@@ -21,6 +21,7 @@
 #include "elxBaseComponentSE.h"
 
 #include "itkImageSamplerBase.h"
+#include "itkImageRandomSamplerBase.h"
 
 
 namespace elastix
@@ -33,6 +34,22 @@ namespace elastix
    *
    * This class contains all the common functionality for ImageSamplers.
    *
+   * The parameters used in this class are:
+   * \parameter UseMultiThreadingForSamplers: Whether the sampler may distribute
+   *    the generation of the samples over multiple threads. The number of
+   *    threads is bounded by the MaximumNumberOfThreads command line option.
+   *    Only the Random, RandomCoordinate and Grid samplers implement this,
+   *    and only when no mask is used. Can be given for each resolution or
+   *    for all resolutions at once. \n
+   *    example: <tt>(UseMultiThreadingForSamplers "true")</tt> \n
+   *    The default is false.
+   * \parameter RandomSeed: The seed of the random number streams of the
+   *    multi-threaded random samplers. With a fixed seed and number of
+   *    threads the selected samples are reproducible. If given, the streams
+   *    are restarted at the start of each resolution. \n
+   *    example: <tt>(RandomSeed 121212)</tt> \n
+   *    By default the streams are seeded once and continue over the resolutions.
+   *
    * \ingroup ImageSamplers
    * \ingroup ComponentBaseClasses
    */
@@ -78,6 +95,7 @@ namespace elastix
     /** Execute stuff before each resolution:
      * \li Give a warning when NewSamplesEveryIteration is specified,
      * but the sampler is ignoring it.
+     * \li Set the multi-threading options and the random seed.
      */
     virtual void BeforeEachResolutionBase(void);
 
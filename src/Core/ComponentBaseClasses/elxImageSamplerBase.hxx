@@ -53,6 +53,36 @@ ImageSamplerBase<TElastix>
     }
   }
 
+  /** Should the sampler use multi-threading? */
+  bool useMultiThreading = false;
+  this->m_Configuration->ReadParameter( useMultiThreading,
+    "UseMultiThreadingForSamplers", this->GetComponentLabel(), level, 0 );
+  if ( useMultiThreading
+    && !this->GetAsITKBaseType()->ThreadedGenerateDataSupported() )
+  {
+    xl::xout["warning"]
+      << "WARNING: You want to use multi-threading for the sampler,\n"
+      << "but the selected ImageSampler does not support that."
+      << std::endl;
+    useMultiThreading = false;
+  }
+  this->GetAsITKBaseType()->SetUseMultiThread( useMultiThreading );
+
+  /** Set the seed of the per-thread random number streams, if given. */
+  typedef itk::ImageRandomSamplerBase< InputImageType > RandomSamplerType;
+  RandomSamplerType * randomSampler
+    = dynamic_cast<RandomSamplerType *>( this->GetAsITKBaseType() );
+  if ( randomSampler )
+  {
+    unsigned long seed = randomSampler->GetSeed();
+    bool found = this->m_Configuration->ReadParameter( seed,
+      "RandomSeed", this->GetComponentLabel(), level, 0 );
+    if ( found )
+    {
+      randomSampler->SetSeed( seed );
+    }
+  }
+
 } // end BeforeEachResolutionBase()
 
 } // end namespace elastix
@@ -21,6 +21,7 @@
 #include "elxBaseComponentSE.h"
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkImageGridSampler.h"
+#include "itkMultiThreader.h"
 #include "itkPointSet.h"
 
 #include "elxTimer.h"
@@ -54,6 +55,24 @@ using namespace itk;
    *    This example for a 2D registration of 2 resolutions sets the downsampling rate
    *    to 1 in the first resolution (so: use really all pixels), and to 2 in the 
    *    second resolution. Default: 1 in each resolution and each dimension. 
+   * \parameter ExactMetricEveryNIterations: Compute the exact metric value only
+   *    every N iterations, when ShowExactMetricValue is set to "true". In the
+   *    other iterations the most recently computed value is shown. The exact
+   *    value is computed with GetValue(), so no derivatives are computed, and
+   *    metrics that support it use multiple threads (see
+   *    UseMultiThreadingForMetrics). Can be given for each resolution. \n
+   *    example: <tt>(ExactMetricEveryNIterations 10)</tt> \n
+   *    Default: 1, so the exact value is computed in every iteration.
+   * \parameter ExactMetricAsynchronous: Whether the exact metric value is
+   *    computed in a background thread, while the optimization continues.
+   *    The value is computed on a copy of the metric, see
+   *    AdvancedImageToImageMetric::CreateEvaluator(), at a snapshot of the
+   *    parameters. It is shown when the next exact value is started, so
+   *    ExactMetricEveryNIterations iterations late. Metrics that do not
+   *    support evaluators compute the exact value synchronously. Can be
+   *    given for each resolution. \n
+   *    example: <tt>(ExactMetricAsynchronous "true")</tt> \n
+   *    Default: false.
    * \parameter CheckNumberOfSamples: Whether the metric checks if at least
    *    a certain fraction (default 1/4) of the samples map inside the moving
    *    image. Can be given for each resolution or for all resolutions at once. \n
@@ -64,6 +83,13 @@ using namespace itk;
    *    CheckNumberOfSamples. \n
    *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
    *    The default is 0.25.
+   * \parameter UseMultiThreadingForMetrics: Whether the metric may distribute
+   *    its computations over multiple threads. The number of threads is bounded
+   *    by the MaximumNumberOfThreads command line option. Only metrics that
+   *    implement a threaded computation make use of this. Can be given for
+   *    each resolution or for all resolutions at once. \n
+   *    example: <tt>(UseMultiThreadingForMetrics "false")</tt> \n
+   *    The default is true.
    *
    * \ingroup Metrics
    * \ingroup ComponentBaseClasses
@@ -153,6 +179,11 @@ public:
    */
   virtual void AfterEachIterationBase( void );
 
+  /** Execute stuff after each resolution:
+   * \li Wait for an asynchronous computation of the exact metric value.
+   */
+  virtual void AfterEachResolutionBase( void );
+
   /** Force the metric to base its computation on a new subset of image samples.
    * Not every metric may have implemented this.
    */
@@ -196,7 +227,7 @@ protected:
   /** The constructor. */
   MetricBase();
   /** The destructor. */
-  virtual ~MetricBase() {}
+  virtual ~MetricBase();
 
   /**  Get the exact value. Mutual information computed over all points.
    * It is meant in situations when you optimize using just a subset of pixels,
@@ -210,13 +241,40 @@ protected:
   virtual MeasureType GetExactValue( const ParametersType& parameters );
   /** \todo the method GetExactDerivative could as well be added here. */
 
+  /** Start the computation of the exact value at the given parameters in a
+   * background thread, on an evaluator of this metric. Returns false if the
+   * metric does not support evaluators.
+   */
+  virtual bool StartExactValueThread( const ParametersType & parameters );
+
+  /** Wait for the background computation of the exact value, if any, and
+   * store its result in m_CurrentExactMetricValue.
+   */
+  virtual void FinishExactValueThread( void );
+
   bool m_ShowExactMetricValue;
+  unsigned int m_ExactMetricEveryNIterations;
+  bool m_ExactMetricAsynchronous;
   typename ExactMetricImageSamplerType::Pointer m_ExactMetricSampler;
   MeasureType m_CurrentExactMetricValue;
   ExactMetricSampleGridSpacingType m_ExactMetricSampleGridSpacing;
 
 private:
 
+  /** The threader callback of StartExactValueThread(). */
+  static ITK_THREAD_RETURN_TYPE ExactValueThreaderCallback( void * arg );
+
+  /** The state of the background computation of the exact value. The
+   * evaluator and the parameter snapshot are only touched by the main
+   * thread while no computation is running.
+   */
+  typename AdvancedMetricType::Pointer  m_ExactMetricEvaluator;
+  ParametersType                        m_ExactMetricParameters;
+  MultiThreader::Pointer                m_ExactMetricThreader;
+  int                                   m_ExactMetricThreadID;
+  MeasureType                           m_ExactMetricThreadValue;
+  std::string                           m_ExactMetricThreadError;
+
   /** The private constructor. */
   MetricBase( const Self& );      // purposely not implemented
   /** The private copy constructor. */
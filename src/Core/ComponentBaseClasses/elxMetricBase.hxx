@@ -31,13 +31,34 @@ MetricBase<TElastix>
 {
   /** Initialize. */
   this->m_ShowExactMetricValue = false;
+  this->m_ExactMetricEveryNIterations = 1;
+  this->m_ExactMetricAsynchronous = false;
   this->m_ExactMetricSampler = 0;
   this->m_CurrentExactMetricValue = 0.0;
   this->m_ExactMetricSampleGridSpacing.Fill(1);
 
+  this->m_ExactMetricEvaluator = 0;
+  this->m_ExactMetricThreader = 0;
+  this->m_ExactMetricThreadID = -1;
+  this->m_ExactMetricThreadValue = 0.0;
+
 } // end Constructor
 
 
+/**
+ * ********************* Destructor ****************************
+ */
+
+template <class TElastix>
+MetricBase<TElastix>
+::~MetricBase()
+{
+  /** The background thread uses this object. */
+  this->FinishExactValueThread();
+
+} // end Destructor
+
+
 /**
  * ******************* BeforeEachResolutionBase ******************
  */
@@ -91,8 +112,27 @@ MetricBase<TElastix>
       this->m_ExactMetricSampleGridSpacing[dim] =
         static_cast<SampleGridSpacingValueType>( spacing_dim );
     }    
+
+    /** Read how often the "exact" metric should be computed. */
+    this->m_ExactMetricEveryNIterations = 1;
+    this->GetConfiguration()->ReadParameter(
+      this->m_ExactMetricEveryNIterations, "ExactMetricEveryNIterations",
+      this->GetComponentLabel(), level, 0 );
+    if ( this->m_ExactMetricEveryNIterations == 0 )
+    {
+      this->m_ExactMetricEveryNIterations = 1;
+    }
+
+    /** Read whether the "exact" metric is computed in the background. */
+    this->m_ExactMetricAsynchronous = false;
+    this->GetConfiguration()->ReadParameter(
+      this->m_ExactMetricAsynchronous, "ExactMetricAsynchronous",
+      this->GetComponentLabel(), level, 0 );
   }
 
+  /** The evaluator of the previous resolution is out of date. */
+  this->m_ExactMetricEvaluator = 0;
+
   /** Cast this to AdvancedMetricType. */
   AdvancedMetricType * thisAsAdvanced
     = dynamic_cast< AdvancedMetricType * >( this );
@@ -119,6 +159,13 @@ MetricBase<TElastix>
     {
       thisAsAdvanced->SetRequiredRatioOfValidSamples( ratio );
     }
+
+    /** Should the metric use multi-threading? */
+    bool useMultiThreading = true;
+    this->GetConfiguration()->ReadParameter( useMultiThreading,
+      "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseMultiThread( useMultiThreading );
+
   } // end Advanced metric
 
 } // end BeforeEachResolutionBase()
@@ -139,12 +186,45 @@ MetricBase<TElastix>
   std::string exactMetricColumn = "Exact";
   exactMetricColumn += this->GetComponentLabel();
 
-  this->m_CurrentExactMetricValue = 0.0;
-  if ( this->m_ShowExactMetricValue )
+  if ( !this->m_ShowExactMetricValue )
+  {
+    this->m_CurrentExactMetricValue = 0.0;
+  }
+  else
   {
-    this->m_CurrentExactMetricValue = this->GetExactValue( 
-      this->GetElastix()->GetElxOptimizerBase()
-      ->GetAsITKBaseType()->GetCurrentPosition()  );
+    /** Only compute it every ExactMetricEveryNIterations iterations;
+     * in between, the most recently computed value is shown.
+     */
+    const unsigned int iterationNumber
+      = this->GetElastix()->GetIterationCounter();
+    if ( iterationNumber % this->m_ExactMetricEveryNIterations == 0 )
+    {
+      const ParametersType & currentPosition = this->GetElastix()
+        ->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition();
+
+      /** Show the value that was started N iterations ago, and start the
+       * next one, or compute the value right away.
+       */
+      bool started = false;
+      if ( this->m_ExactMetricAsynchronous )
+      {
+        this->FinishExactValueThread();
+        started = this->StartExactValueThread( currentPosition );
+        if ( !started )
+        {
+          xl::xout["warning"]
+            << "WARNING: ExactMetricAsynchronous is not supported by "
+            << this->GetComponentLabel()
+            << ".\n  The exact metric value is computed synchronously."
+            << std::endl;
+          this->m_ExactMetricAsynchronous = false;
+        }
+      }
+      if ( !started )
+      {
+        this->m_CurrentExactMetricValue = this->GetExactValue( currentPosition );
+      }
+    }
 
     xl::xout["iteration"][ exactMetricColumn.c_str() ]
       << this->m_CurrentExactMetricValue;
@@ -153,6 +233,22 @@ MetricBase<TElastix>
 } // end AfterEachIterationBase()
 
 
+/**
+ * ******************* AfterEachResolutionBase ******************
+ */
+
+template <class TElastix>
+void
+MetricBase<TElastix>
+::AfterEachResolutionBase( void )
+{
+  /** Do not let the background computation run into the next resolution. */
+  this->FinishExactValueThread();
+  this->m_ExactMetricEvaluator = 0;
+
+} // end AfterEachResolutionBase()
+
+
 /**
  * ********************* SelectNewSamples ************************
  */
@@ -243,6 +339,137 @@ MetricBase<TElastix>
 } // end GetExactValue()
 
 
+/**
+ * ********************* StartExactValueThread ************************
+ */
+
+template <class TElastix>
+bool
+MetricBase<TElastix>
+::StartExactValueThread( const ParametersType & parameters )
+{
+  /** Create the evaluator, once per resolution, since this metric is
+   * initialized by then.
+   */
+  if ( this->m_ExactMetricEvaluator.IsNull() )
+  {
+    AdvancedMetricType * thisAsAdvanced
+      = dynamic_cast< AdvancedMetricType * >( this );
+    if ( thisAsAdvanced == 0 )
+    {
+      return false;
+    }
+    this->m_ExactMetricEvaluator = thisAsAdvanced->CreateEvaluator();
+    if ( this->m_ExactMetricEvaluator.IsNull() )
+    {
+      return false;
+    }
+
+    /** Give the evaluator its own full (or actually 'grid') sampler, since
+     * the sampler of this metric is updated during the optimization.
+     */
+    typename ImageSamplerBaseType::Pointer currentSampler
+      = this->GetAdvancedMetricImageSampler();
+    if ( currentSampler.IsNotNull() )
+    {
+      if ( this->m_ExactMetricSampler.IsNull() )
+      {
+        this->m_ExactMetricSampler = ExactMetricImageSamplerType::New();
+      }
+      this->m_ExactMetricSampler->SetInput( currentSampler->GetInput() );
+      this->m_ExactMetricSampler->SetMask( currentSampler->GetMask() );
+      this->m_ExactMetricSampler->SetInputImageRegion(
+        currentSampler->GetInputImageRegion() );
+      this->m_ExactMetricSampler->SetSampleGridSpacing(
+        this->m_ExactMetricSampleGridSpacing );
+      this->m_ExactMetricEvaluator->SetImageSampler( this->m_ExactMetricSampler );
+    }
+  }
+
+  /** The evaluator does not update its sampler, so do it here, before the
+   * thread starts.
+   */
+  if ( this->m_ExactMetricEvaluator->GetUseImageSampler() )
+  {
+    this->m_ExactMetricEvaluator->GetImageSampler()->Update();
+  }
+
+  /** Evaluate at a snapshot of the parameters, since the optimizer
+   * continues to change its current position.
+   */
+  this->m_ExactMetricParameters = parameters;
+  this->m_ExactMetricThreadError = "";
+  if ( this->m_ExactMetricThreader.IsNull() )
+  {
+    this->m_ExactMetricThreader = MultiThreader::New();
+  }
+  this->m_ExactMetricThreadID = this->m_ExactMetricThreader->SpawnThread(
+    this->ExactValueThreaderCallback, this );
+
+  return true;
+
+} // end StartExactValueThread()
+
+
+/**
+ * ********************* FinishExactValueThread ************************
+ */
+
+template <class TElastix>
+void
+MetricBase<TElastix>
+::FinishExactValueThread( void )
+{
+  if ( this->m_ExactMetricThreadID < 0 )
+  {
+    return;
+  }
+
+  /** Wait for the thread to finish. */
+  this->m_ExactMetricThreader->TerminateThread( this->m_ExactMetricThreadID );
+  this->m_ExactMetricThreadID = -1;
+
+  if ( !this->m_ExactMetricThreadError.empty() )
+  {
+    xl::xout["warning"]
+      << "WARNING: the exact metric value could not be computed:\n"
+      << this->m_ExactMetricThreadError << std::endl;
+  }
+  this->m_CurrentExactMetricValue = this->m_ExactMetricThreadValue;
+
+} // end FinishExactValueThread()
+
+
+/**
+ * ********************* ExactValueThreaderCallback ************************
+ */
+
+template <class TElastix>
+ITK_THREAD_RETURN_TYPE
+MetricBase<TElastix>
+::ExactValueThreaderCallback( void * arg )
+{
+  MultiThreader::ThreadInfoStruct * infoStruct
+    = static_cast<MultiThreader::ThreadInfoStruct *>( arg );
+  Self * metric = static_cast<Self *>( infoStruct->UserData );
+
+  /** Exceptions can not be thrown out of a thread; pass the message. */
+  try
+  {
+    metric->m_ExactMetricThreadValue = metric->m_ExactMetricEvaluator
+      ->GetValue( metric->m_ExactMetricParameters );
+  }
+  catch ( ExceptionObject & excp )
+  {
+    metric->m_ExactMetricThreadValue = itk::NumericTraits<MeasureType>::Zero;
+    metric->m_ExactMetricThreadError = excp.GetDescription();
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ExactValueThreaderCallback()
+
+
 /**
  * ******************* GetAdvancedMetricUseImageSampler ********************
  */
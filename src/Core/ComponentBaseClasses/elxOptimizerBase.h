@@ -20,6 +20,8 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkOptimizer.h"
+#include "itkParallelCostFunctionEvaluator.h"
+#include "elxProfiler.h"
 
 
 namespace elastix
@@ -42,6 +44,17 @@ using namespace itk;
    *    Choose one from {"true", "false"} for every resolution.\n
    *    example: <tt>(NewSamplesEveryIteration "true" "true" "true")</tt> \n
    *    Default is "false" for every resolution.\n
+   * \parameter NumberOfConcurrentEvaluations: optimizers that evaluate the cost
+   *    function at several positions at once, such as the CMAEvolutionStrategy,
+   *    the FiniteDifferenceGradientDescent and the FullSearch, can evaluate that
+   *    many positions concurrently, each with its own copy of the metric. Only
+   *    works for metrics that support this (AdvancedMeanSquares,
+   *    AdvancedNormalizedCorrelation, AdvancedMattesMutualInformation,
+   *    NormalizedMutualInformation, and combinations of these); otherwise the
+   *    positions are evaluated one by one. Note that every copy of the metric
+   *    has its own copy of the transform.\n
+   *    example: <tt>(NumberOfConcurrentEvaluations 4 4 8)</tt> \n
+   *    Default is 1 for every resolution, which means no concurrent evaluation.\n
    *
    * \ingroup Optimizers
    * \ingroup ComponentBaseClasses
@@ -93,6 +106,11 @@ using namespace itk;
      */
     virtual void BeforeEachResolutionBase();
 
+    /** Execute stuff after each iteration:
+     * \li Add the time of this iteration to the profiler, if enabled.
+     */
+    virtual void AfterEachIterationBase();
+
     /** Method that sets the scales defined by a sinus
      * scale[i] = amplitude^( sin(i/nrofparam*2pi*frequency) )
      */
@@ -114,6 +132,16 @@ using namespace itk;
     /** Check whether the user asked to select new samples every iteration. */
     virtual bool GetNewSamplesEveryIteration( void ) const;
 
+    /** Give the ParallelCostFunctionEvaluator of the optimizer as many
+     * evaluators of the metric as the user asked for with the parameter
+     * NumberOfConcurrentEvaluations, and the image samplers of the metrics
+     * as shared data. Clears it if no concurrent evaluation is asked for,
+     * or if the metric does not support it. Should be called after the
+     * metric has been initialized, so in StartOptimization().
+     */
+    virtual void ConfigureParallelCostFunctionEvaluator(
+      ParallelCostFunctionEvaluator * evaluator );
+
   private:
 
     /** The private constructor. */
@@ -126,6 +154,14 @@ using namespace itk;
      */
     bool m_NewSamplesEveryIteration;
 
+    /** The number of positions at which the cost function is evaluated
+     * concurrently, in the current resolution.
+     */
+    unsigned int m_NumberOfConcurrentEvaluations;
+
+    /** The wall clock time at the start of the current iteration. */
+    double m_ProfilerIterationStartTime;
+
   }; // end class OptimizerBase
 
 
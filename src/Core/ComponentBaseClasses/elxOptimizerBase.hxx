@@ -30,6 +30,8 @@ OptimizerBase<TElastix>
 ::OptimizerBase()
 {
   this->m_NewSamplesEveryIteration = false;
+  this->m_NumberOfConcurrentEvaluations = 1;
+  this->m_ProfilerIterationStartTime = 0.0;
 
 } // end Constructor
 
@@ -76,9 +78,40 @@ OptimizerBase<TElastix>
   this->GetConfiguration()->ReadParameter( this->m_NewSamplesEveryIteration,
     "NewSamplesEveryIteration", this->GetComponentLabel(), level, 0 );
 
+  /** Check at how many positions the cost function may be evaluated concurrently. */
+  this->m_NumberOfConcurrentEvaluations = 1;
+  this->GetConfiguration()->ReadParameter( this->m_NumberOfConcurrentEvaluations,
+    "NumberOfConcurrentEvaluations", this->GetComponentLabel(), level, 0 );
+
+  /** The first iteration starts now. */
+  this->m_ProfilerIterationStartTime = tmr::Timer::GetWallClockTime();
+
 } // end BeforeEachResolutionBase()
 
 
+/**
+ * ****************** AfterEachIterationBase **********************
+ */
+
+template <class TElastix>
+void
+OptimizerBase<TElastix>
+::AfterEachIterationBase( void )
+{
+  /** The iteration is the time since the previous call, so it includes
+   * the writing of the iteration information of the previous iteration.
+   */
+  if ( tmr::Profiler::GetEnabled() )
+  {
+    const double now = tmr::Timer::GetWallClockTime();
+    tmr::Profiler::AddTime( tmr::Profiler::Iteration,
+      now - this->m_ProfilerIterationStartTime );
+    this->m_ProfilerIterationStartTime = now;
+  }
+
+} // end AfterEachIterationBase()
+
+
 /**
  * ****************** SelectNewSamples ****************************
  */
@@ -114,6 +147,48 @@ OptimizerBase<TElastix>
 } // end GetNewSamplesEveryIteration()
 
 
+/**
+ * ************** ConfigureParallelCostFunctionEvaluator *****************
+ */
+
+template <class TElastix>
+void
+OptimizerBase<TElastix>
+::ConfigureParallelCostFunctionEvaluator( ParallelCostFunctionEvaluator * evaluator )
+{
+  typedef typename RegistrationType::ITKBaseType::MetricType  MetricType;
+  typedef ParallelCostFunctionEvaluator::EvaluatorContainerType EvaluatorContainerType;
+
+  evaluator->Clear();
+  if ( this->m_NumberOfConcurrentEvaluations < 2 ) return;
+
+  /** Create an evaluator of the metric for every concurrent evaluation. */
+  const MetricType * metric
+    = this->GetRegistration()->GetAsITKBaseType()->GetMetric();
+  EvaluatorContainerType evaluators;
+  for ( unsigned int i = 0; i < this->m_NumberOfConcurrentEvaluations; ++i )
+  {
+    typename MetricType::Pointer metricEvaluator = metric->CreateEvaluator();
+    if ( metricEvaluator.IsNull() )
+    {
+      xl::xout["warning"] << "WARNING: the metric does not support concurrent "
+        << "evaluations.\n  The NumberOfConcurrentEvaluations is ignored." << std::endl;
+      return;
+    }
+    evaluators.push_back( metricEvaluator.GetPointer() );
+  }
+  evaluator->SetEvaluators( evaluators );
+
+  /** The evaluators share the samples of the metrics. */
+  for ( unsigned int i = 0; i < this->GetElastix()->GetNumberOfMetrics(); ++i )
+  {
+    evaluator->AddSharedDataSource(
+      this->GetElastix()->GetElxMetricBase( i )->GetAdvancedMetricImageSampler() );
+  }
+
+} // end ConfigureParallelCostFunctionEvaluator()
+
+
 /**
  * ****************** SetSinusScales ********************
  */
@@ -58,6 +58,23 @@ namespace elastix
    *    of the written image is desired.\n
    *    example: <tt>(CompressResultImage "true")</tt> \n
    *    The default is "false".
+   * \parameter ResampleUsingDisplacementField: flag to first convert the
+   *    (composed) transform to a displacement field, and resample the image with
+   *    that field. Every voxel then costs one field lookup instead of an
+   *    evaluation of all transforms in the chain. The field is computed by
+   *    multiple threads; the number of threads is bounded by the
+   *    MaximumNumberOfThreads command line option.\n
+   *    example: <tt>(ResampleUsingDisplacementField "true")</tt> \n
+   *    The default is "false".
+   * \parameter DisplacementFieldSubsamplingFactor: the displacement field may
+   *    be computed on a grid that is a factor coarser than the result image,
+   *    and is then interpolated with cubic B-splines. With a factor of 1 the
+   *    field is computed for every voxel, which is exact, but takes memory for
+   *    a vector per voxel. Only used if ResampleUsingDisplacementField is true.\n
+   *    example: <tt>(DisplacementFieldSubsamplingFactor 4)</tt> \n
+   *    The default is 1, unless a full resolution field would take more memory
+   *    than the input image; then the default is 4. A factor of 1 for such a
+   *    large field gives a warning.
    *
    * \ingroup Resamplers
    * \ingroup ComponentBaseClasses
@@ -104,6 +121,8 @@ namespace elastix
     typedef typename ITKBaseType::OriginPointType     OriginPointType;
     typedef typename ITKBaseType::PixelType           OutputPixelType;
 
+    typedef typename TransformType::Pointer           TransformPointer;
+
     /** Typedef for the ProgressCommand. */
     typedef elx::ProgressCommand          ProgressCommandType;
 
@@ -165,6 +184,12 @@ namespace elastix
     /** Method that sets the transform, the interpolator and the inputImage. */
     virtual void SetComponents(void);
 
+    /** Compute the displacement field of the transform on the grid of the
+     * result image, or on a coarser version of it, and return a transform
+     * that interpolates it. Used if ResampleUsingDisplacementField is true.
+     */
+    virtual TransformPointer CreateDisplacementFieldTransform( void );
+
   private:
 
     /** The private constructor. */
@@ -18,6 +18,12 @@
 #include "elxResamplerBase.h"
 #include "itkImageFileCastWriter.h"
 #include "itkChangeInformationImageFilter.h"
+#include "itkTransformToDisplacementFieldSource.h"
+#include "itkDeformationFieldInterpolatingTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+#include "itkVectorIndexSelectionCastImageFilter.h"
+#include "itkBSplineDecompositionImageFilter.h"
 #include "elxTimer.h"
 
 namespace elastix
@@ -241,6 +247,20 @@ ResamplerBase<TElastix>
   /** Make sure the resampler is updated. */
   this->GetAsITKBaseType()->Modified();
 
+  /** Possibly resample with the displacement field of the transform.
+   * The original transform is restored after writing the image.
+   */
+  bool useDisplacementField = false;
+  this->m_Configuration->ReadParameter( useDisplacementField,
+    "ResampleUsingDisplacementField", 0, false );
+  typename TransformType::ConstPointer originalTransform
+    = this->GetAsITKBaseType()->GetTransform();
+  if ( useDisplacementField )
+  {
+    this->GetAsITKBaseType()->SetTransform(
+      this->CreateDisplacementFieldTransform() );
+  }
+
   /** Add a progress observer to the resampler. */
   typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
   progressObserver->ConnectObserver( this->GetAsITKBaseType() );
@@ -254,6 +274,9 @@ ResamplerBase<TElastix>
   }
   catch( itk::ExceptionObject & excp )
   {
+    /** Restore the transform. */
+    this->GetAsITKBaseType()->SetTransform( originalTransform );
+
     /** Add information to the exception. */
     excp.SetLocation( "ResamplerBase - WriteResultImage()" );
     std::string err_str = excp.GetDescription();
@@ -312,6 +335,9 @@ ResamplerBase<TElastix>
   }
   catch( itk::ExceptionObject & excp )
   {
+    /** Restore the transform. */
+    this->GetAsITKBaseType()->SetTransform( originalTransform );
+
     /** Add information to the exception. */
     excp.SetLocation( "ResamplerBase - AfterRegistrationBase()" );
     std::string err_str = excp.GetDescription();
@@ -325,9 +351,181 @@ ResamplerBase<TElastix>
   /** Disconnect from the resampler. */
   progressObserver->DisconnectObserver( this->GetAsITKBaseType() );
 
+  /** Restore the transform, which releases the displacement field. */
+  if ( useDisplacementField )
+  {
+    this->GetAsITKBaseType()->SetTransform( originalTransform );
+  }
+
 } // end WriteResultImage()
 
 
+/*
+ * ******************* CreateDisplacementFieldTransform ********************
+ */
+
+template<class TElastix>
+typename ResamplerBase<TElastix>::TransformPointer
+ResamplerBase<TElastix>
+::CreateDisplacementFieldTransform( void )
+{
+  /** Typedef's for the displacement field. */
+  typedef itk::Vector< float, ImageDimension >        DisplacementVectorType;
+  typedef itk::Image<
+    DisplacementVectorType, ImageDimension >          DisplacementFieldType;
+  typedef typename DisplacementFieldType::Pointer     DisplacementFieldPointer;
+  typedef itk::TransformToDisplacementFieldSource<
+    DisplacementFieldType, CoordRepType >             DisplacementFieldGeneratorType;
+
+  /** Typedef's for the transforms that interpolate the field. */
+  typedef itk::DeformationFieldInterpolatingTransform<
+    CoordRepType, ImageDimension, float >             DisplacementFieldTransformType;
+  typedef itk::VectorLinearInterpolateImageFunction<
+    DisplacementFieldType, CoordRepType >             DisplacementFieldInterpolatorType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    CoordRepType, ImageDimension, 3 >                 BSplineTransformType;
+  typedef typename BSplineTransformType::ImageType    CoefficientImageType;
+  typedef typename BSplineTransformType::ImagePointer CoefficientImagePointer;
+  typedef itk::VectorIndexSelectionCastImageFilter<
+    DisplacementFieldType, CoefficientImageType >     ComponentSelectorType;
+  typedef itk::BSplineDecompositionImageFilter<
+    CoefficientImageType, CoefficientImageType >      DecompositionFilterType;
+
+  /** Start with the grid of the result image. */
+  SizeType size = this->GetAsITKBaseType()->GetSize();
+  IndexType index = this->GetAsITKBaseType()->GetOutputStartIndex();
+  SpacingType spacing = this->GetAsITKBaseType()->GetOutputSpacing();
+  OriginPointType origin = this->GetAsITKBaseType()->GetOutputOrigin();
+  const DirectionType direction = this->GetAsITKBaseType()->GetOutputDirection();
+
+  /** Compare the memory of a full resolution field to that of the input image. */
+  double fieldMemory = ImageDimension * sizeof( float );
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    fieldMemory *= static_cast<double>( size[ i ] );
+  }
+  const double inputMemory = sizeof( typename InputImageType::PixelType )
+    * static_cast<double>( this->GetAsITKBaseType()->GetInput()
+    ->GetBufferedRegion().GetNumberOfPixels() );
+  const bool fieldIsLarge = fieldMemory > inputMemory;
+
+  /** Read how much coarser the field may be than the result image. If not
+   * specified, a coarse field is used when a full resolution field would
+   * take more memory than the input image.
+   */
+  unsigned int subsamplingFactor = fieldIsLarge ? 4 : 1;
+  const bool factorFound = this->m_Configuration->ReadParameter( subsamplingFactor,
+    "DisplacementFieldSubsamplingFactor", 0, false );
+  if ( subsamplingFactor < 1 ) subsamplingFactor = 1;
+  if ( subsamplingFactor == 1 && fieldIsLarge )
+  {
+    xl::xout["warning"] << "WARNING: the full resolution displacement field "
+      << "takes " << fieldMemory / 1048576.0 << " MB, more than the input image ("
+      << inputMemory / 1048576.0 << " MB).\n"
+      << "  Consider setting DisplacementFieldSubsamplingFactor." << std::endl;
+  }
+  else if ( !factorFound && subsamplingFactor > 1 )
+  {
+    elxout << "  The full resolution displacement field would take more memory "
+      << "than the input image.\n  A DisplacementFieldSubsamplingFactor of "
+      << subsamplingFactor << " is used." << std::endl;
+  }
+
+  /** A coarse grid starts at the first voxel of the result image, and is
+   * extended by two grid points at each side, so that the support of the
+   * cubic B-spline lies inside the grid for every voxel of the result image.
+   */
+  if ( subsamplingFactor > 1 )
+  {
+    const unsigned int border = 2;
+    typename OriginPointType::VectorType offset;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+      offset[ i ] = spacing[ i ] * ( static_cast<double>( index[ i ] )
+        - static_cast<double>( border * subsamplingFactor ) );
+      size[ i ] = ( size[ i ] + subsamplingFactor - 2 ) / subsamplingFactor
+        + 1 + 2 * border;
+      spacing[ i ] *= subsamplingFactor;
+      index[ i ] = 0;
+    }
+    origin += direction * offset;
+  }
+
+  /** Compute the displacement field with multiple threads. */
+  typename DisplacementFieldGeneratorType::Pointer generator
+    = DisplacementFieldGeneratorType::New();
+  generator->SetOutputSize( size );
+  generator->SetOutputIndex( index );
+  generator->SetOutputSpacing( spacing );
+  generator->SetOutputOrigin( origin );
+  generator->SetOutputDirection( direction );
+  generator->SetTransform( this->m_Elastix->GetElxTransformBase()->GetAsITKBaseType() );
+
+  typename ProgressCommandType::Pointer progressObserver = ProgressCommandType::New();
+  progressObserver->ConnectObserver( generator );
+  progressObserver->SetStartString( "  Progress: " );
+  progressObserver->SetEndString( "%" );
+
+  elxout << "  Computing the displacement field ..." << std::endl;
+  try
+  {
+    generator->Update();
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    /** Add information to the exception. */
+    excp.SetLocation( "ResamplerBase - CreateDisplacementFieldTransform()" );
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while computing the displacement field.\n";
+    excp.SetDescription( err_str );
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+  progressObserver->DisconnectObserver( generator );
+
+  DisplacementFieldPointer field = generator->GetOutput();
+  field->DisconnectPipeline();
+
+  /** The full resolution field is known at every voxel of the result image;
+   * linear interpolation just returns those vectors.
+   */
+  if ( subsamplingFactor == 1 )
+  {
+    typename DisplacementFieldTransformType::Pointer fieldTransform
+      = DisplacementFieldTransformType::New();
+    fieldTransform->SetDeformationFieldInterpolator(
+      DisplacementFieldInterpolatorType::New() );
+    fieldTransform->SetDeformationField( field );
+    return fieldTransform.GetPointer();
+  }
+
+  /** A coarse field is upsampled with cubic B-splines: the B-spline
+   * coefficients of each component interpolate the field at the grid points.
+   */
+  CoefficientImagePointer coefficientImages[ ImageDimension ];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+  {
+    typename ComponentSelectorType::Pointer selector = ComponentSelectorType::New();
+    typename DecompositionFilterType::Pointer decomposition
+      = DecompositionFilterType::New();
+    selector->SetInput( field );
+    selector->SetIndex( i );
+    decomposition->SetSplineOrder( 3 );
+    decomposition->SetInput( selector->GetOutput() );
+    decomposition->Update();
+    coefficientImages[ i ] = decomposition->GetOutput();
+    coefficientImages[ i ]->DisconnectPipeline();
+  }
+
+  typename BSplineTransformType::Pointer bsplineTransform
+    = BSplineTransformType::New();
+  bsplineTransform->SetCoefficientImage( coefficientImages );
+  return bsplineTransform.GetPointer();
+
+} // end CreateDisplacementFieldTransform()
+
+
 /*
  * ************************* ReadFromFile ***********************
  */
@@ -457,6 +655,26 @@ ResamplerBase<TElastix>
   xl::xout["transpar"] << "(CompressResultImage \""
     << doCompression << "\")" << std::endl;
 
+  /** Write the settings for resampling with a displacement field, only if
+   * that is used. A subsampling factor that was not specified is not
+   * written either, so that its default is determined again when the
+   * transform parameter file is used.
+   */
+  bool useDisplacementField = false;
+  this->m_Configuration->ReadParameter( useDisplacementField,
+    "ResampleUsingDisplacementField", 0, false );
+  if ( useDisplacementField )
+  {
+    xl::xout["transpar"] << "(ResampleUsingDisplacementField \"true\")" << std::endl;
+    unsigned int subsamplingFactor = 1;
+    if ( this->m_Configuration->ReadParameter( subsamplingFactor,
+      "DisplacementFieldSubsamplingFactor", 0, false ) )
+    {
+      xl::xout["transpar"] << "(DisplacementFieldSubsamplingFactor "
+        << subsamplingFactor << ")" << std::endl;
+    }
+  }
+
 } // end WriteToFile()
 
 
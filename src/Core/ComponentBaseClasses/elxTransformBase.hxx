@@ -23,7 +23,7 @@
 #include "vnl/vnl_math.h"
 #include <itksys/SystemTools.hxx>
 #include "itkVector.h"
-#include "itkTransformToDeformationFieldSource.h"
+#include "itkTransformToDisplacementFieldSource.h"
 #include "itkTransformToDeterminantOfSpatialJacobianSource.h"
 #include "itkTransformToSpatialJacobianSource.h"
 #include "itkImageFileWriter.h"
@@ -1170,7 +1170,7 @@ void TransformBase<TElastix>
   typedef itk::Image<
     VectorPixelType, FixedImageDimension >            DeformationFieldImageType;
   typedef typename DeformationFieldImageType::Pointer DeformationFieldImagePointer;
-  typedef itk::TransformToDeformationFieldSource<
+  typedef itk::TransformToDisplacementFieldSource<
     DeformationFieldImageType, CoordRepType >         DeformationFieldGeneratorType;
   typedef itk::ChangeInformationImageFilter<
     DeformationFieldImageType >                       ChangeInfoFilterType;
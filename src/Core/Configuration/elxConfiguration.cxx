@@ -106,7 +106,66 @@ Configuration
    * of the parameter text file. The second part is then to get and set the
    * parameter in this configuration.
    */
+  if ( this->SetCommandLineArguments( _arg ) != 0 )
+  {
+    return 1;
+  }
+
+  /** Read the ParameterFile. */
+  this->m_ParameterFileParser->SetParameterFileName( this->m_ParameterFileName );
+  try
+  {
+    xl::xout["standard"] << "Reading the elastix parameters from file ...\n" << std::endl;
+    this->m_ParameterFileParser->ReadParameterFile();
+  }
+  catch ( itk::ExceptionObject & excp )
+  {
+    xl::xout["error"] << "ERROR: when reading the parameter file:\n"
+      << excp << std::endl;
+    return 1;
+  }
+
+  /** Connect the parameter file reader to the interface. */
+  this->SetParameterMap( this->m_ParameterFileParser->GetParameterMap() );
+
+  /** Return a value.*/
+  return 0;
+
+} // end Initialize()
 
+
+/**
+ * ********************** Initialize ****************************
+ */
+
+int
+Configuration
+::Initialize( const CommandLineArgumentMapType & _arg,
+  const ParameterMapType & inputMap )
+{
+  if ( this->SetCommandLineArguments( _arg ) != 0 )
+  {
+    return 1;
+  }
+
+  /** The file is not parsed, but the parser needs its name for printing. */
+  this->m_ParameterFileParser->SetParameterFileName( this->m_ParameterFileName );
+  this->SetParameterMap( inputMap );
+
+  /** Return a value.*/
+  return 0;
+
+} // end Initialize()
+
+
+/**
+ * ****************** SetCommandLineArguments *******************
+ */
+
+int
+Configuration
+::SetCommandLineArguments( const CommandLineArgumentMapType & _arg )
+{
   /** Store the command line arguments. */
   this->m_CommandLineArgumentMap = _arg;
 
@@ -145,23 +204,21 @@ Configuration
     return 1;
   }
 
-  /** Read the ParameterFile. */
-  this->m_ParameterFileParser->SetParameterFileName( this->m_ParameterFileName );
-  try
-  {
-    xl::xout["standard"] << "Reading the elastix parameters from file ...\n" << std::endl;
-    this->m_ParameterFileParser->ReadParameterFile();
-  }
-  catch ( itk::ExceptionObject & excp )
-  {
-    xl::xout["error"] << "ERROR: when reading the parameter file:\n"
-      << excp << std::endl;
-    return 1;
-  }
+  return 0;
 
-  /** Connect the parameter file reader to the interface. */
-  this->m_ParameterMapInterface->SetParameterMap(
-    this->m_ParameterFileParser->GetParameterMap() );
+} // end SetCommandLineArguments()
+
+
+/**
+ * ********************** SetParameterMap ***********************
+ */
+
+void
+Configuration
+::SetParameterMap( const ParameterMapType & inputMap )
+{
+  /** Connect the parameter map to the interface. */
+  this->m_ParameterMapInterface->SetParameterMap( inputMap );
 
   /** Silently check in the parameter file if error messages should be printed. */
   this->m_ParameterMapInterface->SetPrintErrorMessages( false );
@@ -172,10 +229,20 @@ Configuration
   /** Set the initialized flag. */
   this->m_IsInitialized = true;
 
-  /** Return a value.*/
-  return 0;
+} // end SetParameterMap()
 
-} // end Initialize()
+
+/**
+ * ********************** GetParameterMap ***********************
+ */
+
+const Configuration::ParameterMapType &
+Configuration
+::GetParameterMap( void ) const
+{
+  return this->m_ParameterFileParser->GetParameterMap();
+
+} // end GetParameterMap()
 
 
 /**
@@ -69,6 +69,7 @@ public:
   /** Typedefs for the parameter file. */
   typedef itk::ParameterFileParser              ParameterFileParserType;
   typedef ParameterFileParserType::Pointer      ParameterFileParserPointer;
+  typedef ParameterFileParserType::ParameterMapType ParameterMapType;
   typedef itk::ParameterMapInterface            ParameterMapInterfaceType;
   typedef ParameterMapInterfaceType::Pointer    ParameterMapInterfacePointer;
 
@@ -89,6 +90,18 @@ public:
    */
   virtual int Initialize( const CommandLineArgumentMapType & _arg );
 
+  /** Pass the command line arguments and a parameter map that was read
+   * before, e.g. by another Configuration object. The parameter file
+   * given by -p is not parsed again, but its name is still used for printing.
+   */
+  virtual int Initialize( const CommandLineArgumentMapType & _arg,
+    const ParameterMapType & inputMap );
+
+  /** Get the parameter map that was read from the parameter file by the
+   * first Initialize() function. Empty if the second one was used.
+   */
+  virtual const ParameterMapType & GetParameterMap( void ) const;
+
   /** True, if Initialize was successfully called. */
   virtual bool IsInitialized( void ) const; //to elxconfigurationbase
 
@@ -235,6 +248,14 @@ public:
      */
     virtual void PrintParameterFile( void ) const;
 
+    /** Store the command line arguments and determine the parameter file name.
+     * Used by both Initialize() functions.
+     */
+    virtual int SetCommandLineArguments( const CommandLineArgumentMapType & _arg );
+
+    /** Pass the parameter map to the interface. Used by both Initialize() functions. */
+    virtual void SetParameterMap( const ParameterMapType & inputMap );
+
   private:
 
     Configuration( const Self& );   // purposely not implemented
@@ -109,6 +109,33 @@ int xoutSetup( const char * logfilename )
 } // end xoutSetup()
 
 
+/**
+ * ********************* xoutSetLogFile *************************
+ *
+ * NB: this function is a global function, not part of the ElastixMain
+ * class!!
+ */
+
+int xoutSetLogFile( const char * logfilename, bool append )
+{
+  /** The outputs of xout point to g_LogFileStream, so reopening
+   * it redirects all of them.
+   */
+  g_LogFileStream.close();
+  g_LogFileStream.clear();
+  g_LogFileStream.open( logfilename,
+    append ? std::ios::out | std::ios::app : std::ios::out );
+  if ( !g_LogFileStream.is_open() )
+  {
+    std::cerr << "ERROR: LogFile cannot be opened!" << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+} // end xoutSetLogFile()
+
+
 /**
  * ********************* Constructor ****************************
  */
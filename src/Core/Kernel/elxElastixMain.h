@@ -49,6 +49,16 @@ using namespace itk;
  */
 extern int xoutSetup( const char * logfilename );
 
+/**
+ * function xoutSetLogFile
+ * Redirect the log file output of the xl::xout variable to another file,
+ * after xoutSetup has been called. The file is truncated, unless append
+ * is true. Used by elastix in batch mode, to write a log per image pair.
+ *
+ * It returns 0 if everything went ok. 1 otherwise.
+ */
+extern int xoutSetLogFile( const char * logfilename, bool append );
+
 /**
  * \class ElastixMain
  * \brief A class with all functionality to configure elastix.
@@ -36,6 +36,7 @@
 #include "elxTransformBase.h"
 
 #include "elxTimer.h"
+#include "elxProfiler.h"
 
 #include <sstream>
 #include <fstream>
@@ -104,6 +105,15 @@ using namespace itk;
  * information from the image, which relates voxel coordinates to world coordinates.
  * Ignoring it may easily lead to left/right swaps for example, which could
  * skrew up a (medical) analysis.
+ * \parameter Profile: Controls whether to measure the time spent in the
+ *    stages of each iteration: the cost function, the sampler, the transform,
+ *    the interpolation, the accumulation of the metric derivative, the
+ *    optimizer step, and the writing of the iteration information. The table
+ *    is printed to the log after each resolution, and written to the file
+ *    ProfileInfo.<ElastixLevel>.csv, next to the IterationInfo files.\n
+ *    example: <tt>(Profile "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
  *
  * \ingroup Kernel
  */
@@ -506,11 +506,19 @@ void ElastixTemplate<TFixedImage, TMovingImage>
   CallInEachComponent( &BaseComponentType::BeforeRegistrationBase );
   CallInEachComponent( &BaseComponentType::BeforeRegistration );
 
+  /** Enable the profiler if the user asked for it. */
+  bool profile = false;
+  this->GetConfiguration()->ReadParameter( profile, "Profile", 0, false );
+  tmr::Profiler::SetEnabled( profile );
+
   /** Add a column to iteration with the iteration number. */
   xout["iteration"].AddTargetCell( "1:ItNr" );
 
-  /** Add a column to iteration with timing information. */
+  /** Add columns to iteration with timing information: the wall clock
+   * time and the CPU time summed over all threads.
+   */
   xout["iteration"].AddTargetCell( "Time[ms]" );
+  xout["iteration"].AddTargetCell( "CPUTime[ms]" );
 
   /** Print time for initializing. */
   this->m_Timer0->StopTimer();
@@ -555,6 +563,9 @@ void ElastixTemplate<TFixedImage, TMovingImage>
 
   this->OpenIterationInfoFile();
 
+  /** Start profiling this resolution. */
+  tmr::Profiler::GetInstance()->Reset();
+
   /** Call all the BeforeEachResolution() functions. */
   this->BeforeEachResolutionBase();
   CallInEachComponent( &BaseComponentType::BeforeEachResolutionBase );
@@ -595,10 +606,32 @@ void ElastixTemplate<TFixedImage, TMovingImage>
     << "Time spent in resolution "
     << ( level )
     << " (ITK initialisation and iterating): "
-    << this->m_ResolutionTimer->GetElapsedClockSec()
-    << " s.\n";
+    << this->m_ResolutionTimer->GetElapsedWallClockSec()
+    << " s (CPU time: "
+    << this->m_ResolutionTimer->GetElapsedCPUTimeSec()
+    << " s).\n";
   elxout << std::setprecision( this->GetDefaultOutputPrecision() );
 
+  /** Print the profile of this resolution, and add it to the ProfileInfo file. */
+  if ( tmr::Profiler::GetEnabled() )
+  {
+    std::ostringstream report("");
+    tmr::Profiler::GetInstance()->PrintReport( report );
+    elxout << report.str();
+
+    std::ostringstream makeFileName("");
+    makeFileName << this->m_Configuration->GetCommandLineArgument( "-out" )
+      << "ProfileInfo."
+      << this->m_Configuration->GetElastixLevel()
+      << ".csv";
+    std::string fileName = makeFileName.str();
+    if ( !tmr::Profiler::GetInstance()->WriteCSV( fileName, level ) )
+    {
+      xout["error"] << "ERROR: File \"" << fileName
+        << "\" could not be opened!" << std::endl;
+    }
+  }
+
   /** Call all the AfterEachResolution() functions. */
   this->AfterEachResolutionBase();
   CallInEachComponent( &BaseComponentType::AfterEachResolutionBase );
@@ -657,10 +690,15 @@ void ElastixTemplate<TFixedImage, TMovingImage>
   /** Time in this iteration. */
   this->m_IterationTimer->StopTimer();
   xout["iteration"]["Time[ms]"]
-    << static_cast<unsigned long>( this->m_IterationTimer->GetElapsedClockSec() *1000 );
+    << static_cast<unsigned long>( this->m_IterationTimer->GetElapsedWallClockSec() * 1000 );
+  xout["iteration"]["CPUTime[ms]"]
+    << static_cast<unsigned long>( this->m_IterationTimer->GetElapsedCPUTimeSec() * 1000 );
 
   /** Write the iteration info of this iteration. */
-  xout["iteration"].WriteBufferedData();
+  {
+    tmr::ProfilerScope profilerScope( tmr::Profiler::XoutIO );
+    xout["iteration"].WriteBufferedData();
+  }
 
   /** Create a TransformParameter-file for the current iteration. */
   bool writeTansformParametersThisIteration = false;
@@ -59,6 +59,8 @@ int main( int argc, char **argv )
 
   typedef ElastixMainType::ArgumentMapType            ArgumentMapType;
   typedef ArgumentMapType::value_type                 ArgumentMapEntryType;
+  typedef ElastixMainType::ConfigurationType          ConfigurationType;
+  typedef ConfigurationType::ParameterMapType         ParameterMapType;
 
   typedef std::pair< std::string, std::string >       ArgPairType;
   typedef std::queue< ArgPairType >                   ParameterFileListType;
@@ -80,6 +82,9 @@ int main( int argc, char **argv )
   bool outFolderPresent = false;
   std::string outFolder = "";
   std::string logFileName = "";
+  std::vector<std::string> movingImageList;
+  std::vector<std::string> movingMaskList;
+  std::vector<ParameterMapType> parameterMaps;
 
   /** Put command line parameters into parameterFileList. */
   for ( unsigned int i = 1; static_cast<long>(i) < ( argc - 1 ); i += 2 )
@@ -100,6 +105,24 @@ int main( int argc, char **argv )
       std::string tempPName = tempPname.str();
       argMap.insert( ArgumentMapEntryType( tempPName.c_str(), value.c_str() ) );
     }
+    else if ( key == "-m" || key == "-mMask" )
+    {
+      /** Several moving images (and masks) may be given, for batch mode.
+       * The first one is stored in the argMap, for a single registration.
+       */
+      if ( key == "-m" )
+      {
+        movingImageList.push_back( value );
+      }
+      else
+      {
+        movingMaskList.push_back( value );
+      }
+      if ( argMap.count( key.c_str() ) == 0 )
+      {
+        argMap.insert( ArgumentMapEntryType( key.c_str(), value.c_str() ) );
+      }
+    }
     else
     {
       if ( key == "-out" )
@@ -133,6 +156,73 @@ int main( int argc, char **argv )
 
   } // end for loop
 
+  /** Read the list of moving images for batch mode, if given. Each line
+   * contains a moving image, and optionally a moving mask. Empty lines
+   * and lines starting with "//" are skipped.
+   */
+  std::vector<std::string> batchMovingMasks;
+  std::string commonMovingMask = "";
+  bool batchMode = movingImageList.size() > 1;
+  if ( argMap.count( "-mlist" ) )
+  {
+    batchMode = true;
+    if ( !movingImageList.empty() )
+    {
+      std::cerr << "ERROR: The options \"-m\" and \"-mlist\" can not be combined." << std::endl;
+      returndummy |= -1;
+    }
+    std::ifstream listFile( argMap[ "-mlist" ].c_str() );
+    if ( !listFile.is_open() )
+    {
+      std::cerr << "ERROR: The file \"" << argMap[ "-mlist" ]
+        << "\" could not be opened." << std::endl;
+      returndummy |= -1;
+    }
+    std::string line;
+    while ( std::getline( listFile, line ) )
+    {
+      std::istringstream lineStream( line );
+      std::string movingImage = "";
+      std::string movingMask = "";
+      lineStream >> movingImage >> movingMask;
+      if ( movingImage.empty() || movingImage.find( "//" ) == 0 ) continue;
+      movingImageList.push_back( movingImage );
+      batchMovingMasks.push_back( movingMask );
+    }
+    if ( movingImageList.empty() )
+    {
+      std::cerr << "ERROR: The file \"" << argMap[ "-mlist" ]
+        << "\" does not contain any moving image." << std::endl;
+      returndummy |= -1;
+    }
+  }
+  else
+  {
+    batchMovingMasks.assign( movingImageList.size(), "" );
+    if ( batchMode && movingMaskList.size() == movingImageList.size() )
+    {
+      batchMovingMasks = movingMaskList;
+      movingMaskList.clear();
+    }
+  }
+
+  /** In batch mode a single "-mMask" is used for all moving images that
+   * have no mask of their own.
+   */
+  if ( batchMode )
+  {
+    if ( movingMaskList.size() == 1 )
+    {
+      commonMovingMask = movingMaskList[ 0 ];
+    }
+    else if ( movingMaskList.size() > 1 )
+    {
+      std::cerr << "ERROR: Give either one \"-mMask\" for all moving images, "
+        << "or one for each \"-m\"." << std::endl;
+      returndummy |= -1;
+    }
+  }
+
   /** The argv0 argument, required for finding the component.dll/so's. */
   argMap.insert( ArgumentMapEntryType( "-argv0", argv[ 0 ] )  );
 
@@ -206,83 +296,188 @@ int main( int argc, char **argv )
    * Do the (possibly multiple) registration(s).
    */
 
-  for ( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+  /** In batch mode, the moving images are registered one after another to
+   * the same fixed image. The fixed image and mask, the parsed parameter
+   * files, and the component database are kept in memory. Each image pair
+   * writes its results and its log to a subfolder of the output directory.
+   */
+  const unsigned int nrOfPairs = batchMode ? movingImageList.size() : 1;
+  unsigned int nrOfFailedPairs = 0;
+  elastices.resize( nrOfParameterFiles );
+
+  for ( unsigned int pair = 0; pair < nrOfPairs; pair++ )
   {
-    /** Create another instance of ElastixMain. */
-    elastices.push_back( ElastixMainType::New() );
-
-    /** Set stuff we get from a former registration. */
-    elastices[ i ]->SetInitialTransform( transform );
-    elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
-    elastices[ i ]->SetMovingImageContainer( movingImageContainer );
-    elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
-    elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
-    elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
-
-    /** Set the current elastix-level. */
-    elastices[ i ]->SetElastixLevel( i );
-    elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
-
-    /** Delete the previous ParameterFileName. */
-    if ( argMap.count( "-p" ) )
+    /** Set up the command line arguments of this image pair. */
+    tmr::Timer::Pointer pairTimer = tmr::Timer::New();
+    if ( batchMode )
     {
-      argMap.erase( "-p" );
+      pairTimer->StartTimer();
+
+      std::ostringstream makePairFolder("");
+      makePairFolder << outFolder << "Pair"
+        << std::setw( 4 ) << std::setfill( '0' ) << pair << "/";
+      const std::string pairOutFolder = makePairFolder.str();
+      itksys::SystemTools::MakeDirectory( pairOutFolder.c_str() );
+
+      argMap[ "-out" ] = pairOutFolder;
+      argMap[ "-m" ] = movingImageList[ pair ];
+      const std::string movingMask = batchMovingMasks[ pair ].empty()
+        ? commonMovingMask : batchMovingMasks[ pair ];
+      if ( movingMask.empty() )
+      {
+        argMap.erase( "-mMask" );
+      }
+      else
+      {
+        argMap[ "-mMask" ] = movingMask;
+      }
+
+      elxout << "=========================================================================" << "\n" << std::endl;
+      elxout << "Registering image pair " << pair << " of " << nrOfPairs
+        << ": moving image \"" << movingImageList[ pair ]
+        << "\", output in \"" << pairOutFolder << "\".\n" << std::endl;
+
+      /** The log of this pair is written to its own folder. */
+      const std::string pairLogFileName = pairOutFolder + "elastix.log";
+      elx::xoutSetLogFile( pairLogFileName.c_str(), false );
+
+      /** Only the fixed image and mask are reused. */
+      transform = 0;
+      movingImageContainer = 0;
+      movingMaskContainer = 0;
     }
 
-    /** Read the first parameterFileName in the queue. */
-    ArgPairType argPair = parameterFileList.front();
-    parameterFileList.pop();
+    ParameterFileListType pairParameterFileList = parameterFileList;
+    int pairReturnValue = 0;
+
+    for ( unsigned int i = 0; i < nrOfParameterFiles; i++ )
+    {
+      /** Create another instance of ElastixMain. */
+      elastices[ i ] = ElastixMainType::New();
+
+      /** Set stuff we get from a former registration. */
+      elastices[ i ]->SetInitialTransform( transform );
+      elastices[ i ]->SetFixedImageContainer( fixedImageContainer );
+      elastices[ i ]->SetMovingImageContainer( movingImageContainer );
+      elastices[ i ]->SetFixedMaskContainer( fixedMaskContainer );
+      elastices[ i ]->SetMovingMaskContainer( movingMaskContainer );
+      elastices[ i ]->SetOriginalFixedImageDirectionFlat( fixedImageOriginalDirection );
+
+      /** Set the current elastix-level. */
+      elastices[ i ]->SetElastixLevel( i );
+      elastices[ i ]->SetTotalNumberOfElastixLevels( nrOfParameterFiles );
+
+      /** Delete the previous ParameterFileName. */
+      if ( argMap.count( "-p" ) )
+      {
+        argMap.erase( "-p" );
+      }
 
-    /** Put it in the ArgumentMap. */
-    argMap.insert( ArgumentMapEntryType( argPair.first, argPair.second ) );
+      /** Read the first parameterFileName in the queue. */
+      ArgPairType argPair = pairParameterFileList.front();
+      pairParameterFileList.pop();
 
-    /** Print a start message. */
-    elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
-    elxout << "Running elastix with parameter file " << i
-      << ": \"" << argMap[ "-p" ] << "\".\n" << std::endl;
+      /** Put it in the ArgumentMap. */
+      argMap.insert( ArgumentMapEntryType( argPair.first, argPair.second ) );
 
-    /** Declare a timer, start it and print the start time. */
-    tmr::Timer::Pointer timer = tmr::Timer::New();
-    timer->StartTimer();
-    elxout << "Current time: " << timer->PrintStartTime() << "." << std::endl;
+      /** Print a start message. */
+      elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
+      elxout << "Running elastix with parameter file " << i
+        << ": \"" << argMap[ "-p" ] << "\".\n" << std::endl;
 
-    /** Start registration. */
-    returndummy = elastices[ i ]->Run( argMap );
+      /** Declare a timer, start it and print the start time. */
+      tmr::Timer::Pointer timer = tmr::Timer::New();
+      timer->StartTimer();
+      elxout << "Current time: " << timer->PrintStartTime() << "." << std::endl;
 
-    /** Check for errors. */
-    if ( returndummy != 0 )
+      /** Start registration. The parameter file is parsed only for the
+       * first image pair.
+       */
+      if ( i < parameterMaps.size() )
+      {
+        pairReturnValue = elastices[ i ]->GetConfiguration()->Initialize(
+          argMap, parameterMaps[ i ] );
+        if ( pairReturnValue == 0 )
+        {
+          pairReturnValue = elastices[ i ]->Run();
+        }
+      }
+      else
+      {
+        pairReturnValue = elastices[ i ]->Run( argMap );
+        if ( batchMode && pairReturnValue == 0 )
+        {
+          parameterMaps.push_back(
+            elastices[ i ]->GetConfiguration()->GetParameterMap() );
+        }
+      }
+
+      /** Check for errors. */
+      if ( pairReturnValue != 0 )
+      {
+        xl::xout["error"] << "Errors occurred!" << std::endl;
+        if ( !batchMode )
+        {
+          return pairReturnValue;
+        }
+        elastices[ i ] = 0;
+        break;
+      }
+
+      /** Get the transform, the fixedImage and the movingImage
+       * in order to put it in the (possibly) next registration.
+       */
+      transform            = elastices[ i ]->GetFinalTransform();
+      fixedImageContainer  = elastices[ i ]->GetFixedImageContainer();
+      movingImageContainer = elastices[ i ]->GetMovingImageContainer();
+      fixedMaskContainer   = elastices[ i ]->GetFixedMaskContainer();
+      movingMaskContainer  = elastices[ i ]->GetMovingMaskContainer();
+      fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
+
+      /** Print a finish message. */
+      elxout << "Running elastix with parameter file " << i
+        << ": \"" << argMap[ "-p" ] << "\", has finished.\n" << std::endl;
+
+      /** Stop timer and print it. */
+      timer->StopTimer();
+      elxout << "\nCurrent time: " << timer->PrintStopTime() << "." << std::endl;
+      elxout << "Time used for running elastix with this parameter file: "
+        << timer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
+
+      /** Try to release some memory. */
+      elastices[ i ] = 0;
+
+    } // end loop over registrations
+
+    /** Return to the main log and report the result of this pair. */
+    if ( batchMode )
     {
-      xl::xout["error"] << "Errors occurred!" << std::endl;
-      return returndummy;
+      elx::xoutSetLogFile( logFileName.c_str(), true );
+      pairTimer->StopTimer();
+      if ( pairReturnValue != 0 )
+      {
+        nrOfFailedPairs++;
+        returndummy = pairReturnValue;
+        xl::xout["error"] << "Registering image pair " << pair
+          << " failed, see \"" << argMap[ "-out" ] << "elastix.log\".\n" << std::endl;
+      }
+      else
+      {
+        elxout << "Registering image pair " << pair << " has finished in "
+          << pairTimer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
+      }
     }
 
-    /** Get the transform, the fixedImage and the movingImage
-     * in order to put it in the (possibly) next registration.
-     */
-    transform            = elastices[ i ]->GetFinalTransform();
-    fixedImageContainer  = elastices[ i ]->GetFixedImageContainer();
-    movingImageContainer = elastices[ i ]->GetMovingImageContainer();
-    fixedMaskContainer   = elastices[ i ]->GetFixedMaskContainer();
-    movingMaskContainer  = elastices[ i ]->GetMovingMaskContainer();
-    fixedImageOriginalDirection = elastices[ i ]->GetOriginalFixedImageDirectionFlat();
-
-    /** Print a finish message. */
-    elxout << "Running elastix with parameter file " << i
-      << ": \"" << argMap[ "-p" ] << "\", has finished.\n" << std::endl;
-
-    /** Stop timer and print it. */
-    timer->StopTimer();
-    elxout << "\nCurrent time: " << timer->PrintStopTime() << "." << std::endl;
-    elxout << "Time used for running elastix with this parameter file: "
-      << timer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
-
-    /** Try to release some memory. */
-    elastices[ i ] = 0;
-
-  } // end loop over registrations
+  } // end loop over image pairs
 
   elxout << "-------------------------------------------------------------------------" << "\n" << std::endl;
 
+  if ( batchMode )
+  {
+    elxout << "Registered " << nrOfPairs - nrOfFailedPairs << " of "
+      << nrOfPairs << " image pairs successfully.\n" << std::endl;
+  }
+
   /** Stop totaltimer and print it. */
   totaltimer->StopTimer();
   elxout << "Total time elapsed: " << totaltimer->PrintElapsedTimeDHMS() << ".\n" << std::endl;
@@ -347,6 +542,16 @@ void PrintHelp( void )
   std::cout << "-threads  set the maximum number of threads of elastix\n"
     << std::endl;
 
+  /** Batch mode.*/
+  std::cout << "Batch mode, registering many moving images to one fixed image:\n";
+  std::cout << "-m        may be given several times; -mMask may then be given\n"
+    "          once for all moving images, or once for each \"-m\"\n";
+  std::cout << "-mlist    a file with a moving image and optionally a moving mask\n"
+    "          on each line, instead of \"-m\"\n";
+  std::cout << "The fixed image, the fixed mask and the parameter files are read\n"
+    "only once. The results of pair i are written to <out>/Pair<i>/.\n"
+    << std::endl;
+
   /** The parameter file.*/
   std::cout << "The parameter-file must contain all the information "
     "necessary for elastix to run properly. That includes which metric to "
@@ -24,6 +24,9 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 #include "itkObject.h"
 #include "itkDataObject.h"
 #include <itksys/SystemTools.hxx>
@@ -0,0 +1,188 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+
+#include <ctime>
+#include <cmath>
+#include <vector>
+#include <iomanip>
+
+/** This microbenchmark times the B-spline TransformPoint() variants for
+ * spline orders 1 to 3 in 2D and 3D:
+ * - TransformPoint( ipp, opp, weights, indices, inside ), which computes the
+ *   full tensor product weights and the parameter indices,
+ * - TransformPoint( ipp ), which uses the separable kernel,
+ * - TransformPoints( N, ipp, opp ), the batched version.
+ * It also checks that the separable kernel gives the same result as the
+ * full weights, up to round-off.
+ */
+
+//-------------------------------------------------------------------------------------
+
+template< unsigned int Dimension, unsigned int SplineOrder >
+unsigned long TimeTransformPoint( const unsigned int N, const unsigned int R )
+{
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >                    TransformType;
+  typedef typename TransformType::InputPointType        InputPointType;
+  typedef typename TransformType::OutputPointType       OutputPointType;
+  typedef typename TransformType::ParametersType        ParametersType;
+  typedef typename TransformType::WeightsType           WeightsType;
+  typedef typename TransformType::ParameterIndexArrayType ParameterIndexArrayType;
+  typedef typename TransformType::ImageType             CoefficientImageType;
+
+  /** Setup a B-spline grid of 30 control points in each dimension. */
+  typename TransformType::Pointer transform = TransformType::New();
+  typename CoefficientImageType::SizeType gridSize;
+  gridSize.Fill( 30 );
+  typename CoefficientImageType::IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  typename CoefficientImageType::RegionType gridRegion( gridIndex, gridSize );
+  typename CoefficientImageType::SpacingType gridSpacing;
+  typename CoefficientImageType::PointType gridOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSpacing[ d ] = 10.0 + d;
+    gridOrigin[ d ] = -150.0 + 3.0 * d;
+  }
+  typename CoefficientImageType::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 5.0 * vcl_sin( 0.01 * static_cast<double>( i ) );
+  }
+  transform->SetParameters( parameters );
+
+  /** Deterministic test points inside the valid region. */
+  std::vector< InputPointType > inputPoints( N );
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double fraction = 0.5 + 0.4 * vcl_sin( 1.3 * k + 2.1 * d );
+      inputPoints[ k ][ d ] = gridOrigin[ d ]
+        + ( 2.0 + fraction * ( gridSize[ d ] - 5 ) ) * gridSpacing[ d ];
+    }
+  }
+
+  std::vector< OutputPointType > fullWeightsPoints( N );
+  std::vector< OutputPointType > separablePoints( N );
+  std::vector< OutputPointType > batchedPoints( N );
+  WeightsType weights( transform->GetNumberOfWeights() );
+  ParameterIndexArrayType indices( transform->GetNumberOfWeights() );
+  bool inside;
+
+  /** Time the full weights version. */
+  clock_t startClock = clock();
+  for ( unsigned int r = 0; r < R; ++r )
+  {
+    for ( unsigned int k = 0; k < N; ++k )
+    {
+      transform->TransformPoint( inputPoints[ k ], fullWeightsPoints[ k ],
+        weights, indices, inside );
+    }
+  }
+  const double fullWeightsTime
+    = static_cast<double>( clock() - startClock ) / CLOCKS_PER_SEC;
+
+  /** Time the separable version. */
+  startClock = clock();
+  for ( unsigned int r = 0; r < R; ++r )
+  {
+    for ( unsigned int k = 0; k < N; ++k )
+    {
+      separablePoints[ k ] = transform->TransformPoint( inputPoints[ k ] );
+    }
+  }
+  const double separableTime
+    = static_cast<double>( clock() - startClock ) / CLOCKS_PER_SEC;
+
+  /** Time the batched version. */
+  startClock = clock();
+  for ( unsigned int r = 0; r < R; ++r )
+  {
+    transform->TransformPoints( N, &inputPoints[ 0 ], &batchedPoints[ 0 ] );
+  }
+  const double batchedTime
+    = static_cast<double>( clock() - startClock ) / CLOCKS_PER_SEC;
+
+  /** Compare the results. */
+  unsigned long errors = 0;
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double tolerance = 1e-12 * ( 1.0 + vcl_abs( fullWeightsPoints[ k ][ d ] ) );
+      if ( vcl_abs( separablePoints[ k ][ d ] - fullWeightsPoints[ k ][ d ] ) > tolerance ) ++errors;
+      if ( batchedPoints[ k ][ d ] != separablePoints[ k ][ d ] ) ++errors;
+    }
+  }
+
+  std::cerr << Dimension << "D, spline order " << SplineOrder << ": "
+    << std::setprecision( 4 )
+    << "full weights " << fullWeightsTime << " s, "
+    << "separable " << separableTime << " s, "
+    << "batched " << batchedTime << " s";
+  if ( errors > 0 )
+  {
+    std::cerr << ", ERROR: " << errors << " differences";
+  }
+  std::cerr << std::endl;
+
+  return errors;
+
+} // end TimeTransformPoint()
+
+//-------------------------------------------------------------------------------------
+
+int main( void )
+{
+  /** The number of points and repetitions. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int N = 1000;
+  const unsigned int R = 2;
+#else
+  const unsigned int N = 10000;
+  const unsigned int R = 20;
+#endif
+  std::cerr << "N = " << N << ", repetitions = " << R << std::endl;
+
+  unsigned long errors = 0;
+  errors += TimeTransformPoint< 2, 1 >( N, R );
+  errors += TimeTransformPoint< 2, 2 >( N, R );
+  errors += TimeTransformPoint< 2, 3 >( N, R );
+  errors += TimeTransformPoint< 3, 1 >( N, R );
+  errors += TimeTransformPoint< 3, 2 >( N, R );
+  errors += TimeTransformPoint< 3, 3 >( N, R );
+
+  if ( errors > 0 )
+  {
+    std::cerr << "ERROR: the separable TransformPoint() differs from the "
+      << "full weights version." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
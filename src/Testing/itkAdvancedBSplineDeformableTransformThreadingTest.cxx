@@ -0,0 +1,240 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMultiThreader.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+/** This test checks that TransformPoint() and the sparse GetJacobian() of
+ * the AdvancedBSplineDeformableTransform can be called concurrently from
+ * multiple threads. Every thread repeatedly evaluates all test points with
+ * its own scratch buffers, and compares the results to those obtained in a
+ * single-threaded run. Any difference indicates that the methods write to
+ * shared state.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+const unsigned int SplineOrder = 3;
+typedef double CoordinateRepresentationType;
+
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, SplineOrder >    TransformType;
+typedef TransformType::JacobianType                   JacobianType;
+typedef TransformType::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+typedef TransformType::InputPointType                 InputPointType;
+typedef TransformType::OutputPointType                OutputPointType;
+typedef TransformType::ParametersType                 ParametersType;
+typedef TransformType::WeightsType                    WeightsType;
+typedef TransformType::ParameterIndexArrayType        ParameterIndexArrayType;
+typedef TransformType::ImageType                      CoefficientImageType;
+
+/** Data shared by all threads. */
+struct ThreadingTestDataStruct
+{
+  const TransformType *                     Transform;
+  std::vector< InputPointType >             InputPoints;
+  std::vector< OutputPointType >            OutputPoints;
+  std::vector< JacobianType >               Jacobians;
+  std::vector< NonZeroJacobianIndicesType > NonZeroJacobianIndices;
+  unsigned int                              NumberOfRepetitions;
+  std::vector< unsigned long >              NumberOfErrors; // one per thread
+};
+
+//-------------------------------------------------------------------------------------
+
+ITK_THREAD_RETURN_TYPE ThreadingTestCallback( void * arg )
+{
+  typedef itk::MultiThreader::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
+  const unsigned int threadID = infoStruct->ThreadID;
+  ThreadingTestDataStruct * data
+    = static_cast<ThreadingTestDataStruct *>( infoStruct->UserData );
+
+  const TransformType * transform = data->Transform;
+  const unsigned long nonzji = transform->GetNumberOfNonZeroJacobianIndices();
+  const unsigned long numberOfWeights = transform->GetNumberOfWeights();
+
+  /** Thread-local scratch buffers. */
+  JacobianType jacobian( Dimension, nonzji );
+  NonZeroJacobianIndicesType nzji( nonzji );
+  WeightsType weights( numberOfWeights );
+  ParameterIndexArrayType indices( numberOfWeights );
+  OutputPointType outputPoint;
+  bool inside;
+
+  unsigned long errors = 0;
+  const unsigned long numberOfPoints = data->InputPoints.size();
+  for ( unsigned int r = 0; r < data->NumberOfRepetitions; ++r )
+  {
+    /** Let every thread start at a different point, to maximize the
+     * chance that different threads evaluate different support regions.
+     */
+    for ( unsigned long k = 0; k < numberOfPoints; ++k )
+    {
+      const unsigned long p = ( k + threadID * 7919 ) % numberOfPoints;
+      const InputPointType & inputPoint = data->InputPoints[ p ];
+
+      transform->TransformPoint( inputPoint, outputPoint, weights, indices, inside );
+      transform->GetJacobian( inputPoint, jacobian, nzji );
+
+      for ( unsigned int d = 0; d < Dimension; ++d )
+      {
+        if ( outputPoint[ d ] != data->OutputPoints[ p ][ d ] ) ++errors;
+      }
+      if ( nzji != data->NonZeroJacobianIndices[ p ] ) ++errors;
+      const JacobianType & groundTruth = data->Jacobians[ p ];
+      for ( unsigned int i = 0; i < jacobian.rows(); ++i )
+      {
+        for ( unsigned int j = 0; j < jacobian.cols(); ++j )
+        {
+          if ( jacobian[ i ][ j ] != groundTruth[ i ][ j ] ) ++errors;
+        }
+      }
+    }
+  }
+
+  data->NumberOfErrors[ threadID ] = errors;
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ThreadingTestCallback()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  /** The number of test points and repetitions. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int N = 1000;
+  const unsigned int R = 2;
+#else
+  const unsigned int N = 10000;
+  const unsigned int R = 10;
+#endif
+  std::cerr << "N = " << N << ", repetitions = " << R << std::endl;
+
+  /** Create the transform. */
+  TransformType::Pointer transform = TransformType::New();
+
+  /** Setup the B-spline transform, using the same grid as in the
+   * AdvancedBSplineDeformableTransformTest.
+   */
+  CoefficientImageType::SizeType gridSize;
+  gridSize[ 0 ] = 44; gridSize[ 1 ] = 43; gridSize[ 2 ] = 35;
+  CoefficientImageType::IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  CoefficientImageType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  gridRegion.SetIndex( gridIndex );
+  CoefficientImageType::SpacingType gridSpacing;
+  gridSpacing[ 0 ] = 10.7832773148;
+  gridSpacing[ 1 ] = 11.2116431394;
+  gridSpacing[ 2 ] = 11.8648235177;
+  CoefficientImageType::PointType gridOrigin;
+  gridOrigin[ 0 ] = -237.6759555555;
+  gridOrigin[ 1 ] = -239.9488431747;
+  gridOrigin[ 2 ] = -344.2315805162;
+  CoefficientImageType::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  /** Generate deterministic, smoothly varying parameters. */
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 5.0 * vcl_sin( 0.01 * static_cast<double>( i ) );
+  }
+  transform->SetParameters( parameters );
+
+  /** Generate deterministic test points inside the valid region of the grid. */
+  ThreadingTestDataStruct data;
+  data.Transform = transform.GetPointer();
+  data.NumberOfRepetitions = R;
+  data.InputPoints.resize( N );
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double fraction = 0.5 + 0.4 * vcl_sin( 1.3 * k + 2.1 * d );
+      data.InputPoints[ k ][ d ] = gridOrigin[ d ]
+        + ( 1.0 + fraction * ( gridSize[ d ] - 3 ) ) * gridSpacing[ d ];
+    }
+  }
+
+  /** Compute the ground truth single-threaded, with the same TransformPoint()
+   * variant as used by the threads.
+   */
+  const unsigned long nonzji = transform->GetNumberOfNonZeroJacobianIndices();
+  WeightsType weights( transform->GetNumberOfWeights() );
+  ParameterIndexArrayType indices( transform->GetNumberOfWeights() );
+  bool inside;
+  data.OutputPoints.resize( N );
+  data.Jacobians.resize( N, JacobianType( Dimension, nonzji ) );
+  data.NonZeroJacobianIndices.resize( N, NonZeroJacobianIndicesType( nonzji ) );
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    transform->TransformPoint( data.InputPoints[ k ],
+      data.OutputPoints[ k ], weights, indices, inside );
+    transform->GetJacobian( data.InputPoints[ k ],
+      data.Jacobians[ k ], data.NonZeroJacobianIndices[ k ] );
+  }
+
+  /** Run the concurrent evaluation. */
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  unsigned int numberOfThreads = 8;
+  if ( argc > 1 )
+  {
+    numberOfThreads = atoi( argv[ 1 ] );
+  }
+  threader->SetNumberOfThreads( numberOfThreads );
+  numberOfThreads = threader->GetNumberOfThreads();
+  std::cerr << "Number of threads = " << numberOfThreads << std::endl;
+
+  data.NumberOfErrors.resize( numberOfThreads, 0 );
+  threader->SetSingleMethod( ThreadingTestCallback, &data );
+  threader->SingleMethodExecute();
+
+  /** Check the results. */
+  unsigned long totalErrors = 0;
+  for ( unsigned int t = 0; t < numberOfThreads; ++t )
+  {
+    if ( data.NumberOfErrors[ t ] > 0 )
+    {
+      std::cerr << "ERROR: thread " << t << " produced "
+        << data.NumberOfErrors[ t ] << " differences." << std::endl;
+    }
+    totalErrors += data.NumberOfErrors[ t ];
+  }
+
+  if ( totalErrors > 0 )
+  {
+    std::cerr << "ERROR: concurrent evaluation of the transform differs "
+      << "from serial evaluation." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  std::cerr << "Concurrent evaluation matches serial evaluation." << std::endl;
+  return 0;
+
+} // end main
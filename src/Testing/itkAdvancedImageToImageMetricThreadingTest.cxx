@@ -0,0 +1,299 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRandomSampler.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedKappaStatistic/itkAdvancedKappaStatisticImageToImageMetric.h"
+#include "vnl/vnl_math.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** This test checks that the multi-threaded evaluation of a metric gives
+ * the same value and derivative as its single-threaded evaluation, within
+ * round-off. AdvancedMeanSquares only implements the per-sample hooks of
+ * the generic threaded loop of AdvancedImageToImageMetric. The threaded
+ * AdvancedNormalizedCorrelation and AdvancedKappaStatistic metrics also
+ * keep extra sums per thread, which are combined after the threads
+ * finished. The metrics are evaluated at a number of positions, with
+ * UseMultiThread off, and on with 1 and with several threads.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                        ImageType;
+typedef itk::AdvancedImageToImageMetric< ImageType, ImageType > MetricBaseType;
+typedef MetricBaseType::MeasureType                           MeasureType;
+typedef MetricBaseType::DerivativeType                        DerivativeType;
+typedef MetricBaseType::ParametersType                        ParametersType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                                      MeanSquaresMetricType;
+typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+  ImageType, ImageType >                                      NormalizedCorrelationMetricType;
+typedef itk::AdvancedKappaStatisticImageToImageMetric<
+  ImageType, ImageType >                                      KappaMetricType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                                 InterpolatorType;
+typedef itk::ImageRandomSampler< ImageType >                  SamplerType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  double, Dimension, Dimension >                              TransformType;
+
+//-------------------------------------------------------------------------------------
+
+/** Create an image with a smooth pattern, shifted for the moving image.
+ * If binary is true, the pattern is thresholded to a 0/1 label image.
+ */
+ImageType::Pointer CreateImage( const double shift, const bool binary )
+{
+  ImageType::SizeType size; size.Fill( 64 );
+  ImageType::IndexType start; start.Fill( 0 );
+  ImageType::RegionType region( start, size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ] + shift;
+    const double y = it.GetIndex()[ 1 ] - 0.5 * shift;
+    const double r2 = ( x - 30.0 ) * ( x - 30.0 ) + ( y - 34.0 ) * ( y - 34.0 );
+    const double value = 100.0 * vcl_exp( -r2 / 200.0 )
+      + 20.0 * vcl_sin( 0.2 * x ) * vcl_cos( 0.15 * y );
+    if ( binary )
+    {
+      it.Set( value > 40.0 ? 1.0f : 0.0f );
+    }
+    else
+    {
+      it.Set( static_cast<float>( value ) );
+    }
+  }
+
+  return image;
+
+} // end CreateImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Compare a value to the reference, relative to the size of the reference.
+ * Returns false and reports when they differ.
+ */
+bool CompareValues( const std::string & description,
+  const MeasureType referenceValue, const MeasureType value )
+{
+  const double tolerance = 1e-10;
+  const double difference = vnl_math_abs( value - referenceValue );
+  if ( difference > tolerance * ( 1.0 + vnl_math_abs( referenceValue ) ) )
+  {
+    std::cerr << "ERROR: " << description << ": value " << value
+      << " differs from the single-threaded value " << referenceValue
+      << std::endl;
+    return false;
+  }
+  return true;
+
+} // end CompareValues()
+
+//-------------------------------------------------------------------------------------
+
+/** Compare a derivative to the reference, relative to the size of the
+ * reference. Returns false and reports when they differ.
+ */
+bool CompareDerivatives( const std::string & description,
+  const DerivativeType & referenceDerivative, const DerivativeType & derivative )
+{
+  const double tolerance = 1e-10;
+  if ( derivative.GetSize() != referenceDerivative.GetSize() )
+  {
+    std::cerr << "ERROR: " << description
+      << ": the derivative has the wrong size." << std::endl;
+    return false;
+  }
+  const double difference = ( derivative - referenceDerivative ).magnitude();
+  if ( difference > tolerance * ( 1.0 + referenceDerivative.magnitude() ) )
+  {
+    std::cerr << "ERROR: " << description << ": derivative differs by "
+      << difference << " from the single-threaded derivative "
+      << referenceDerivative << std::endl;
+    return false;
+  }
+  return true;
+
+} // end CompareDerivatives()
+
+//-------------------------------------------------------------------------------------
+
+/** Evaluate the metric at a number of positions, single-threaded and
+ * multi-threaded, and compare. Returns false on failure.
+ */
+bool TestMetric( const std::string & name, MetricBaseType * metric,
+  const std::vector< ParametersType > & positions )
+{
+  const unsigned int numberOfThreads = 4;
+
+  metric->Initialize();
+
+  bool passed = true;
+  for ( unsigned int k = 0; k < positions.size(); ++k )
+  {
+    /** The single-threaded reference. */
+    metric->SetUseMultiThread( false );
+    MeasureType referenceValue;
+    DerivativeType referenceDerivative;
+    metric->GetValueAndDerivative( positions[ k ], referenceValue, referenceDerivative );
+    const MeasureType referenceValueOnly = metric->GetValue( positions[ k ] );
+    if ( metric->GetNumberOfPixelsCounted() == 0 )
+    {
+      std::cerr << "ERROR: " << name << " counted no samples at position "
+        << k << "." << std::endl;
+      passed = false;
+      continue;
+    }
+
+    /** The threaded loop, with one and with several threads. */
+    metric->SetUseMultiThread( true );
+    const unsigned int threadCounts[ 2 ] = { 1, numberOfThreads };
+    for ( unsigned int t = 0; t < 2; ++t )
+    {
+      metric->SetNumberOfThreads( threadCounts[ t ] );
+      MeasureType value;
+      DerivativeType derivative;
+      metric->GetValueAndDerivative( positions[ k ], value, derivative );
+      const MeasureType valueOnly = metric->GetValue( positions[ k ] );
+
+      std::ostringstream description;
+      description << name << " at position " << k << " with "
+        << metric->GetNumberOfThreads() << " thread(s)";
+      passed &= CompareValues( description.str(), referenceValue, value );
+      passed &= CompareDerivatives( description.str(),
+        referenceDerivative, derivative );
+      passed &= CompareValues( description.str() + " (GetValue)",
+        referenceValueOnly, valueOnly );
+    }
+  }
+
+  std::cerr << name << ": " << ( passed ? "passed" : "FAILED" ) << std::endl;
+  return passed;
+
+} // end TestMetric()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  ImageType::Pointer fixedImage = CreateImage( 0.0, false );
+  ImageType::Pointer movingImage = CreateImage( 2.5, false );
+  ImageType::Pointer fixedLabelImage = CreateImage( 0.0, true );
+  ImageType::Pointer movingLabelImage = CreateImage( 2.5, true );
+
+  /** The positions: small deterministic perturbations of the identity. */
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::InputPointType center;
+  center.Fill( 31.5 );
+  transform->SetCenter( center );
+  const ParametersType identity = transform->GetParameters();
+  std::vector< ParametersType > positions;
+  for ( unsigned int k = 0; k < 8; ++k )
+  {
+    ParametersType position = identity;
+    for ( unsigned int p = 0; p < position.GetSize(); ++p )
+    {
+      const double scale = p < Dimension * Dimension ? 0.02 : 2.0;
+      position[ p ] += scale * vcl_sin( 1.3 * k + 0.7 * p );
+    }
+    positions.push_back( position );
+  }
+
+  bool passed = true;
+
+  /** The metrics, each with their own transform, interpolator and sampler. */
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 3000 );
+    sampler->SetSeed( 121212 );
+
+    MeanSquaresMetricType::Pointer metric = MeanSquaresMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    passed &= TestMetric( "AdvancedMeanSquares", metric, positions );
+  }
+
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 3000 );
+    sampler->SetSeed( 121212 );
+
+    NormalizedCorrelationMetricType::Pointer metric
+      = NormalizedCorrelationMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetSubtractMean( true );
+    passed &= TestMetric( "AdvancedNormalizedCorrelation", metric, positions );
+  }
+
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 3000 );
+    sampler->SetSeed( 121212 );
+
+    KappaMetricType::Pointer metric = KappaMetricType::New();
+    metric->SetFixedImage( fixedLabelImage );
+    metric->SetMovingImage( movingLabelImage );
+    metric->SetFixedImageRegion( fixedLabelImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetForegroundValue( 1.0 );
+    metric->ComplementOn();
+    passed &= TestMetric( "AdvancedKappaStatistic", metric, positions );
+  }
+
+  if ( !passed )
+  {
+    std::cerr << "Test failed." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Test passed." << std::endl;
+  return 0;
+
+} // end main
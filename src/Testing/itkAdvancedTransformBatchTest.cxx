@@ -0,0 +1,319 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedCombinationTransform.h"
+
+#include <vector>
+#include <string>
+#include <cmath>
+
+/** This test checks that the batched methods TransformPoints(),
+ * GetJacobians() and GetSpatialJacobians() give the same results as the
+ * corresponding single point methods, for a B-spline transform, an affine
+ * transform and combinations of the two. It also checks EvaluateOnGrid()
+ * against the single point methods.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+const unsigned int SplineOrder = 3;
+typedef double CoordinateRepresentationType;
+
+typedef itk::AdvancedTransform<
+  CoordinateRepresentationType, Dimension, Dimension >    TransformType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, SplineOrder >  BSplineTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  CoordinateRepresentationType, Dimension, Dimension >    AffineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  CoordinateRepresentationType, Dimension >               CombinationTransformType;
+
+typedef TransformType::JacobianType                   JacobianType;
+typedef TransformType::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+typedef TransformType::SpatialJacobianType            SpatialJacobianType;
+typedef TransformType::InputPointType                 InputPointType;
+typedef TransformType::OutputPointType                OutputPointType;
+typedef TransformType::ParametersType                 ParametersType;
+typedef TransformType::GridRegionType                 GridRegionType;
+typedef TransformType::GridIndexToPointMatrixType     GridIndexToPointMatrixType;
+typedef BSplineTransformType::ImageType               CoefficientImageType;
+
+//-------------------------------------------------------------------------------------
+
+/** Compare the batched methods of a transform with the single point methods.
+ * Returns the number of differences.
+ */
+unsigned long CompareBatchedWithSinglePoint( const std::string & name,
+  const TransformType * transform,
+  const std::vector< InputPointType > & inputPoints )
+{
+  const double tolerance = 1e-10;
+  const unsigned long N = inputPoints.size();
+
+  std::vector< OutputPointType > outputPoints( N );
+  std::vector< JacobianType > jacobians( N );
+  std::vector< NonZeroJacobianIndicesType > nzjis( N );
+  std::vector< SpatialJacobianType > spatialJacobians( N );
+
+  transform->TransformPoints( N, &inputPoints[ 0 ], &outputPoints[ 0 ] );
+  transform->GetJacobians( N, &inputPoints[ 0 ], &jacobians[ 0 ], &nzjis[ 0 ] );
+  transform->GetSpatialJacobians( N, &inputPoints[ 0 ], &spatialJacobians[ 0 ] );
+
+  unsigned long errors = 0;
+  JacobianType jacobian;
+  NonZeroJacobianIndicesType nzji;
+  SpatialJacobianType spatialJacobian;
+  for ( unsigned long p = 0; p < N; ++p )
+  {
+    const OutputPointType outputPoint = transform->TransformPoint( inputPoints[ p ] );
+    transform->GetJacobian( inputPoints[ p ], jacobian, nzji );
+    transform->GetSpatialJacobian( inputPoints[ p ], spatialJacobian );
+
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      if ( vcl_abs( outputPoint[ d ] - outputPoints[ p ][ d ] ) > tolerance ) ++errors;
+      for ( unsigned int e = 0; e < Dimension; ++e )
+      {
+        if ( vcl_abs( spatialJacobian( d, e ) - spatialJacobians[ p ]( d, e ) )
+          > tolerance ) ++errors;
+      }
+    }
+
+    if ( nzji != nzjis[ p ]
+      || jacobian.rows() != jacobians[ p ].rows()
+      || jacobian.cols() != jacobians[ p ].cols() )
+    {
+      ++errors;
+      continue;
+    }
+    for ( unsigned int i = 0; i < jacobian.rows(); ++i )
+    {
+      for ( unsigned int j = 0; j < jacobian.cols(); ++j )
+      {
+        if ( vcl_abs( jacobian[ i ][ j ] - jacobians[ p ][ i ][ j ] ) > tolerance ) ++errors;
+      }
+    }
+  }
+
+  std::cerr << name << ": " << errors << " differences." << std::endl;
+  return errors;
+
+} // end CompareBatchedWithSinglePoint()
+
+//-------------------------------------------------------------------------------------
+
+/** Compare EvaluateOnGrid() of a transform with the single point methods.
+ * Returns the number of differences, or 1 if the grid evaluation is not
+ * supported while it should be.
+ */
+unsigned long CompareGridWithSinglePoint( const std::string & name,
+  const TransformType * transform,
+  const InputPointType & origin,
+  const GridIndexToPointMatrixType & indexToPoint,
+  const GridRegionType & region,
+  const bool supported )
+{
+  const double tolerance = 1e-10;
+  const unsigned long N = region.GetNumberOfPixels();
+
+  std::vector< OutputPointType > outputPoints( N );
+  std::vector< SpatialJacobianType > spatialJacobians( N );
+  if ( !transform->EvaluateOnGrid( origin, indexToPoint, region,
+    &outputPoints[ 0 ], &spatialJacobians[ 0 ] ) )
+  {
+    std::cerr << name << ": grid evaluation not supported." << std::endl;
+    return supported ? 1 : 0;
+  }
+
+  /** Visit the grid in the same order: the first dimension runs fastest. */
+  unsigned long errors = 0;
+  GridRegionType::IndexType index = region.GetIndex();
+  SpatialJacobianType spatialJacobian;
+  for ( unsigned long p = 0; p < N; ++p )
+  {
+    InputPointType point;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      point[ d ] = origin[ d ];
+      for ( unsigned int e = 0; e < Dimension; ++e )
+      {
+        point[ d ] += indexToPoint( d, e ) * index[ e ];
+      }
+    }
+
+    const OutputPointType outputPoint = transform->TransformPoint( point );
+    transform->GetSpatialJacobian( point, spatialJacobian );
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      if ( vcl_abs( outputPoint[ d ] - outputPoints[ p ][ d ] ) > tolerance ) ++errors;
+      for ( unsigned int e = 0; e < Dimension; ++e )
+      {
+        if ( vcl_abs( spatialJacobian( d, e ) - spatialJacobians[ p ]( d, e ) )
+          > tolerance ) ++errors;
+      }
+    }
+
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      if ( ++index[ d ] < region.GetIndex()[ d ]
+        + static_cast<long>( region.GetSize()[ d ] ) ) break;
+      index[ d ] = region.GetIndex()[ d ];
+    }
+  }
+
+  std::cerr << name << ": " << errors << " differences." << std::endl;
+  return errors;
+
+} // end CompareGridWithSinglePoint()
+
+//-------------------------------------------------------------------------------------
+
+int main( void )
+{
+  const unsigned int N = 1000;
+
+  /** Setup the B-spline transform. */
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+
+  CoefficientImageType::SizeType gridSize;
+  gridSize[ 0 ] = 14; gridSize[ 1 ] = 13; gridSize[ 2 ] = 11;
+  CoefficientImageType::IndexType gridIndex;
+  gridIndex.Fill( 0 );
+  CoefficientImageType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  gridRegion.SetIndex( gridIndex );
+  CoefficientImageType::SpacingType gridSpacing;
+  gridSpacing[ 0 ] = 10.7832773148;
+  gridSpacing[ 1 ] = 11.2116431394;
+  gridSpacing[ 2 ] = 11.8648235177;
+  CoefficientImageType::PointType gridOrigin;
+  gridOrigin[ 0 ] = -37.6759555555;
+  gridOrigin[ 1 ] = -39.9488431747;
+  gridOrigin[ 2 ] = -44.2315805162;
+  CoefficientImageType::DirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( gridRegion );
+  bsplineTransform->SetGridDirection( gridDirection );
+
+  ParametersType bsplineParameters( bsplineTransform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < bsplineParameters.GetSize(); ++i )
+  {
+    bsplineParameters[ i ] = 5.0 * vcl_sin( 0.01 * static_cast<double>( i ) );
+  }
+  bsplineTransform->SetParameters( bsplineParameters );
+
+  /** Setup the affine transform: a small rotation, scaling and translation. */
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  ParametersType affineParameters( affineTransform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for ( unsigned int j = 0; j < Dimension; ++j )
+    {
+      affineParameters[ i * Dimension + j ] = ( i == j ? 1.02 : 0.03 * ( i + 1.0 - j ) );
+    }
+    affineParameters[ Dimension * Dimension + i ] = 1.5 - i;
+  }
+  affineTransform->SetParameters( affineParameters );
+
+  /** Generate deterministic test points; some of them lie outside the
+   * valid region of the B-spline grid.
+   */
+  std::vector< InputPointType > inputPoints( N );
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double fraction = 0.5 + 0.55 * vcl_sin( 1.3 * k + 2.1 * d );
+      inputPoints[ k ][ d ] = gridOrigin[ d ]
+        + ( 1.0 + fraction * ( gridSize[ d ] - 3 ) ) * gridSpacing[ d ];
+    }
+  }
+
+  /** Combinations of the two. */
+  CombinationTransformType::Pointer composition = CombinationTransformType::New();
+  composition->SetInitialTransform( affineTransform );
+  composition->SetCurrentTransform( bsplineTransform );
+  composition->SetUseComposition( true );
+
+  CombinationTransformType::Pointer addition = CombinationTransformType::New();
+  addition->SetInitialTransform( affineTransform );
+  addition->SetCurrentTransform( bsplineTransform );
+  addition->SetUseAddition( true );
+
+  CombinationTransformType::Pointer noInitial = CombinationTransformType::New();
+  noInitial->SetCurrentTransform( affineTransform );
+
+  /** Compare. */
+  unsigned long errors = 0;
+  errors += CompareBatchedWithSinglePoint( "B-spline", bsplineTransform, inputPoints );
+  errors += CompareBatchedWithSinglePoint( "Affine", affineTransform, inputPoints );
+  errors += CompareBatchedWithSinglePoint( "Composition", composition, inputPoints );
+  errors += CompareBatchedWithSinglePoint( "Addition", addition, inputPoints );
+  errors += CompareBatchedWithSinglePoint( "NoInitialTransform", noInitial, inputPoints );
+
+  /** A voxel grid that extends beyond the valid region of the B-spline grid. */
+  InputPointType gridPointOrigin;
+  GridIndexToPointMatrixType indexToPoint;
+  indexToPoint.Fill( 0.0 );
+  GridRegionType::IndexType voxelIndex;
+  GridRegionType::SizeType voxelSize;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridPointOrigin[ d ] = gridOrigin[ d ] + 0.37 * gridSpacing[ d ];
+    indexToPoint( d, d ) = 0.71 * gridSpacing[ d ] * ( 1.0 + 0.1 * d );
+    voxelIndex[ d ] = -2 + static_cast<long>( d );
+    voxelSize[ d ] = 17 + d;
+  }
+  GridRegionType voxelRegion( voxelIndex, voxelSize );
+
+  /** A composition with a scaling and translation maps the grid onto an
+   * axis-aligned grid, one with the rotated affine transform does not.
+   */
+  AffineTransformType::Pointer scalingTransform = AffineTransformType::New();
+  ParametersType scalingParameters( scalingTransform->GetNumberOfParameters() );
+  scalingParameters.Fill( 0.0 );
+  for ( unsigned int i = 0; i < Dimension; ++i )
+  {
+    scalingParameters[ i * Dimension + i ] = 0.95 + 0.05 * i;
+    scalingParameters[ Dimension * Dimension + i ] = 2.5 - i;
+  }
+  scalingTransform->SetParameters( scalingParameters );
+  CombinationTransformType::Pointer scaledComposition = CombinationTransformType::New();
+  scaledComposition->SetInitialTransform( scalingTransform );
+  scaledComposition->SetCurrentTransform( bsplineTransform );
+  scaledComposition->SetUseComposition( true );
+
+  errors += CompareGridWithSinglePoint( "B-spline grid", bsplineTransform,
+    gridPointOrigin, indexToPoint, voxelRegion, true );
+  errors += CompareGridWithSinglePoint( "Scaled composition grid", scaledComposition,
+    gridPointOrigin, indexToPoint, voxelRegion, true );
+  errors += CompareGridWithSinglePoint( "Composition grid", composition,
+    gridPointOrigin, indexToPoint, voxelRegion, false );
+
+  if ( errors > 0 )
+  {
+    std::cerr << "ERROR: batched evaluation differs from single point evaluation."
+      << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  std::cerr << "Batched evaluation matches single point evaluation." << std::endl;
+  return 0;
+
+} // end main
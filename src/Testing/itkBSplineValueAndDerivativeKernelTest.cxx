@@ -0,0 +1,212 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkBSplineValueAndDerivativeKernel.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+
+#include <ctime>
+#include <cmath>
+#include <vector>
+#include <iomanip>
+
+/** This test compares the BSplineValueAndDerivativeKernel with the
+ * BSplineInterpolateImageFunction, for spline orders 1 to 3 in 2D and 3D,
+ * with double and float coefficients, and times both. The kernel computes
+ * in the precision TReal, the interpolator in double precision. So with
+ * float computations they agree up to single precision round-off, and with
+ * double computations up to double round-off, also for float coefficients.
+ */
+
+//-------------------------------------------------------------------------------------
+
+template< unsigned int Dimension, unsigned int SplineOrder,
+  class TCoefficient, class TReal >
+unsigned long TestKernel( const unsigned int N, const double tolerance )
+{
+  typedef itk::Image< short, Dimension >                InputImageType;
+  typedef itk::Image< TCoefficient, Dimension >         CoefficientImageType;
+  typedef itk::BSplineInterpolateImageFunction<
+    InputImageType, double, TCoefficient >              InterpolatorType;
+  typedef itk::BSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >              DecompositionFilterType;
+  typedef itk::BSplineValueAndDerivativeKernel<
+    Dimension, SplineOrder, TCoefficient, TReal >       KernelType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+  typedef typename InterpolatorType::CovariantVectorType CovariantVectorType;
+
+  /** Create a smooth test image with a non-zero start index. */
+  typename InputImageType::Pointer image = InputImageType::New();
+  typename InputImageType::IndexType start;
+  typename InputImageType::SizeType size;
+  typename InputImageType::SpacingType spacing;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    start[ d ] = 3 + d;
+    size[ d ] = 40 - 5 * d;
+    spacing[ d ] = 1.0 + 0.25 * d;
+  }
+  typename InputImageType::RegionType region( start, size );
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->Allocate();
+  itk::ImageRegionIterator< InputImageType > it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 100.0 * vcl_sin( 0.2 * ( d + 1 ) * it.GetIndex()[ d ] );
+    }
+    it.Set( static_cast<short>( value ) );
+  }
+
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder( SplineOrder );
+  interpolator->SetInputImage( image );
+
+  typename DecompositionFilterType::Pointer decompositionFilter
+    = DecompositionFilterType::New();
+  decompositionFilter->SetSplineOrder( SplineOrder );
+  decompositionFilter->SetInput( image );
+  decompositionFilter->Update();
+  const TCoefficient * coefficients = decompositionFilter->GetOutput()->GetBufferPointer();
+  unsigned long coefficientSize[ Dimension ];
+  for ( unsigned int d = 0; d < Dimension; ++d ) coefficientSize[ d ] = size[ d ];
+
+  /** Deterministic points inside the image, away from the border. */
+  std::vector< ContinuousIndexType > points( N );
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double fraction = 0.5 + 0.45 * vcl_sin( 1.3 * k + 2.1 * d );
+      points[ k ][ d ] = start[ d ] + 2.0 + fraction * ( size[ d ] - 5.0 );
+    }
+  }
+
+  /** Time the interpolator. */
+  std::vector< double > values( N );
+  std::vector< CovariantVectorType > derivatives( N );
+  clock_t startClock = clock();
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    values[ k ] = interpolator->EvaluateAtContinuousIndex( points[ k ] );
+    derivatives[ k ] = interpolator->EvaluateDerivativeAtContinuousIndex( points[ k ] );
+  }
+  const double interpolatorTime
+    = static_cast<double>( clock() - startClock ) / CLOCKS_PER_SEC;
+
+  /** Time the kernel. */
+  std::vector< TReal > kernelValues( N );
+  std::vector< TReal > kernelDerivatives( N * Dimension );
+  unsigned long outside = 0;
+  startClock = clock();
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    double cindex[ Dimension ];
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      cindex[ d ] = points[ k ][ d ] - start[ d ];
+    }
+    if ( !KernelType::Evaluate( coefficients, coefficientSize, cindex,
+      kernelValues[ k ], &kernelDerivatives[ k * Dimension ] ) )
+    {
+      ++outside;
+    }
+  }
+  const double kernelTime
+    = static_cast<double>( clock() - startClock ) / CLOCKS_PER_SEC;
+
+  /** Compare the results. The kernel derivative is in index space. */
+  unsigned long errors = outside;
+  for ( unsigned int k = 0; k < N; ++k )
+  {
+    if ( vcl_abs( kernelValues[ k ] - values[ k ] )
+      > tolerance * ( 1.0 + vcl_abs( values[ k ] ) ) )
+    {
+      ++errors;
+    }
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double derivative = kernelDerivatives[ k * Dimension + d ] / spacing[ d ];
+      if ( vcl_abs( derivative - derivatives[ k ][ d ] )
+        > tolerance * ( 1.0 + vcl_abs( derivatives[ k ][ d ] ) ) )
+      {
+        ++errors;
+      }
+    }
+  }
+
+  std::cerr << Dimension << "D, spline order " << SplineOrder << ", "
+    << ( sizeof( TCoefficient ) == sizeof( float ) ? "float" : "double" )
+    << " coefficients, "
+    << ( sizeof( TReal ) == sizeof( float ) ? "float" : "double" ) << " computations: "
+    << std::setprecision( 4 )
+    << "interpolator " << interpolatorTime << " s, "
+    << "kernel " << kernelTime << " s";
+  if ( errors > 0 )
+  {
+    std::cerr << ", ERROR: " << errors << " differences";
+  }
+  std::cerr << std::endl;
+
+  return errors;
+
+} // end TestKernel()
+
+//-------------------------------------------------------------------------------------
+
+int main( void )
+{
+  /** The number of points. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  const unsigned int N = 2000;
+#else
+  const unsigned int N = 100000;
+#endif
+  std::cerr << "N = " << N << std::endl;
+
+  unsigned long errors = 0;
+  errors += TestKernel< 2, 1, double, double >( N, 1e-10 );
+  errors += TestKernel< 2, 2, double, double >( N, 1e-10 );
+  errors += TestKernel< 2, 3, double, double >( N, 1e-10 );
+  errors += TestKernel< 3, 1, double, double >( N, 1e-10 );
+  errors += TestKernel< 3, 2, double, double >( N, 1e-10 );
+  errors += TestKernel< 3, 3, double, double >( N, 1e-10 );
+
+  /** Single precision computations, as used for the float interpolator. */
+  errors += TestKernel< 2, 1, float, float >( N, 1e-4 );
+  errors += TestKernel< 2, 2, float, float >( N, 1e-4 );
+  errors += TestKernel< 2, 3, float, float >( N, 1e-4 );
+  errors += TestKernel< 3, 1, float, float >( N, 1e-4 );
+  errors += TestKernel< 3, 2, float, float >( N, 1e-4 );
+  errors += TestKernel< 3, 3, float, float >( N, 1e-4 );
+
+  /** Float coefficients with double computations, like the interpolator. */
+  errors += TestKernel< 2, 3, float, double >( N, 1e-10 );
+  errors += TestKernel< 3, 3, float, double >( N, 1e-10 );
+
+  if ( errors > 0 )
+  {
+    std::cerr << "ERROR: the BSplineValueAndDerivativeKernel differs from the "
+      << "BSplineInterpolateImageFunction." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -0,0 +1,345 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "FastBSplineResampler/itkFastBSplineResampleImageFilter.h"
+#include "vnl/vnl_math.h"
+
+#include <iostream>
+#include <string>
+
+/** This test compares the FastBSplineResampleImageFilter with the
+ * ResampleImageFilter using a BSplineInterpolateImageFunction, in 2D and 3D.
+ * The transform is an affine transform followed by a third order B-spline
+ * transform, and the input image, the output image and the B-spline grid
+ * all have non-identity directions. The output image extends beyond the
+ * input image and the B-spline grid only covers part of it, so that points
+ * outside the input image and outside the valid region of the B-spline are
+ * tested as well. The specialised kernel is tested with double and float
+ * interpolator coefficients. The fallback to the ResampleImageFilter is
+ * tested with a first order interpolator.
+ */
+
+//-------------------------------------------------------------------------------------
+
+/** A rotation in the plane of the first two dimensions. */
+template< class TMatrix >
+TMatrix CreateRotation( const double angle )
+{
+  TMatrix rotation;
+  rotation.SetIdentity();
+  rotation( 0, 0 ) = vcl_cos( angle );
+  rotation( 0, 1 ) = -vcl_sin( angle );
+  rotation( 1, 0 ) = vcl_sin( angle );
+  rotation( 1, 1 ) = vcl_cos( angle );
+  return rotation;
+
+} // end CreateRotation()
+
+//-------------------------------------------------------------------------------------
+
+/** Compare two images. Returns the number of differences. */
+template< class TImage >
+unsigned long CompareImages( const TImage * image, const TImage * reference,
+  const double tolerance )
+{
+  typedef itk::ImageRegionConstIterator< TImage > IteratorType;
+  IteratorType it( image, image->GetLargestPossibleRegion() );
+  IteratorType itRef( reference, reference->GetLargestPossibleRegion() );
+
+  unsigned long differences = 0;
+  for ( it.GoToBegin(), itRef.GoToBegin(); !it.IsAtEnd(); ++it, ++itRef )
+  {
+    const double value = it.Get();
+    const double referenceValue = itRef.Get();
+    if ( vnl_math_abs( value - referenceValue )
+      > tolerance * ( 1.0 + vnl_math_abs( referenceValue ) ) )
+    {
+      ++differences;
+    }
+  }
+
+  return differences;
+
+} // end CompareImages()
+
+//-------------------------------------------------------------------------------------
+
+/** Resample with both filters, and compare the results.
+ * Returns false on failure.
+ */
+template< class TImage, class TTransform, class TInterpolator >
+bool TestResampler( const std::string & name, const TImage * inputImage,
+  const TImage * outputGeometry, TTransform * transform,
+  const unsigned int splineOrder, const bool expectFastResampling )
+{
+  typedef itk::ResampleImageFilter< TImage, TImage, double >  ResamplerType;
+  typedef itk::FastBSplineResampleImageFilter<
+    TImage, TImage, double >                                  FastResamplerType;
+  const typename TImage::PixelType defaultPixelValue = -1000.0;
+
+  /** The reference. */
+  typename TInterpolator::Pointer interpolator = TInterpolator::New();
+  interpolator->SetSplineOrder( splineOrder );
+  typename ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( inputImage );
+  resampler->SetTransform( transform );
+  resampler->SetInterpolator( interpolator );
+  resampler->SetDefaultPixelValue( defaultPixelValue );
+  resampler->SetOutputParametersFromImage( outputGeometry );
+  resampler->Update();
+
+  /** The fast resampler, with its own interpolator. */
+  typename TInterpolator::Pointer fastInterpolator = TInterpolator::New();
+  fastInterpolator->SetSplineOrder( splineOrder );
+  typename FastResamplerType::Pointer fastResampler = FastResamplerType::New();
+  fastResampler->SetInput( inputImage );
+  fastResampler->SetTransform( transform );
+  fastResampler->SetInterpolator( fastInterpolator );
+  fastResampler->SetDefaultPixelValue( defaultPixelValue );
+  fastResampler->SetOutputParametersFromImage( outputGeometry );
+  fastResampler->Update();
+
+  /** Check if the expected path was taken. */
+  bool passed = true;
+  const bool usedFastResampling = fastResampler->GetWarningReport().empty();
+  if ( usedFastResampling != expectFastResampling )
+  {
+    std::cerr << "ERROR: " << name << ": the specialised kernel was "
+      << ( usedFastResampling ? "" : "not " ) << "used. "
+      << fastResampler->GetWarningReport() << std::endl;
+    passed = false;
+  }
+
+  /** Check that points outside the input image are tested. */
+  unsigned long numberOfDefaultPixels = 0;
+  itk::ImageRegionConstIterator< TImage > it( resampler->GetOutput(),
+    resampler->GetOutput()->GetLargestPossibleRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    if ( it.Get() == defaultPixelValue ) ++numberOfDefaultPixels;
+  }
+  if ( numberOfDefaultPixels == 0 )
+  {
+    std::cerr << "ERROR: " << name << ": no points outside the input image."
+      << std::endl;
+    passed = false;
+  }
+
+  /** The fallback path should give exactly the same result. */
+  const double tolerance = expectFastResampling ? 1e-5 : 0.0;
+  const unsigned long differences = CompareImages< TImage >(
+    fastResampler->GetOutput(), resampler->GetOutput(), tolerance );
+  if ( differences > 0 )
+  {
+    std::cerr << "ERROR: " << name << ": " << differences
+      << " pixels differ from the ResampleImageFilter." << std::endl;
+    passed = false;
+  }
+
+  std::cerr << name << ": " << ( passed ? "passed" : "FAILED" ) << std::endl;
+  return passed;
+
+} // end TestResampler()
+
+//-------------------------------------------------------------------------------------
+
+template< unsigned int Dimension >
+bool TestDimension( void )
+{
+  typedef itk::Image< float, Dimension >                    ImageType;
+  typedef typename ImageType::DirectionType                 DirectionType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension > ComboTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    double, Dimension, Dimension >                          AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, 3 >                                  BSplineTransformType;
+  typedef typename BSplineTransformType::ImageType          GridImageType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, double >                             InterpolatorType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, float >                              InterpolatorFloatType;
+
+  /** The input image, with a smooth pattern. */
+  typename ImageType::IndexType inputStart;
+  typename ImageType::SizeType inputSize;
+  typename ImageType::SpacingType inputSpacing;
+  typename ImageType::PointType inputOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    inputStart[ d ] = 2 + d;
+    inputSize[ d ] = Dimension == 2 ? 40 - 3 * d : 20 - 2 * d;
+    inputSpacing[ d ] = 1.1 + 0.2 * d;
+    inputOrigin[ d ] = -3.7 + 1.3 * d;
+  }
+  typename ImageType::Pointer inputImage = ImageType::New();
+  inputImage->SetRegions( typename ImageType::RegionType( inputStart, inputSize ) );
+  inputImage->SetSpacing( inputSpacing );
+  inputImage->SetOrigin( inputOrigin );
+  inputImage->SetDirection( CreateRotation< DirectionType >( 0.3 ) );
+  inputImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it(
+    inputImage, inputImage->GetLargestPossibleRegion() );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      value += 50.0 * vcl_sin( 0.3 * ( d + 1 ) * it.GetIndex()[ d ] );
+    }
+    it.Set( static_cast<float>( value ) );
+  }
+
+  /** The center of the input image. */
+  typename ImageType::IndexType centerIndex;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    centerIndex[ d ] = inputStart[ d ] + inputSize[ d ] / 2;
+  }
+  typename ImageType::PointType center;
+  inputImage->TransformIndexToPhysicalPoint( centerIndex, center );
+
+  /** The geometry of the output image: rotated, and larger than the input. */
+  typename ImageType::IndexType outputStart;
+  typename ImageType::SizeType outputSize;
+  typename ImageType::SpacingType outputSpacing;
+  typename ImageType::PointType outputOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    outputStart[ d ] = 0;
+    outputSize[ d ] = inputSize[ d ] + 8;
+    outputSpacing[ d ] = 1.0 + 0.15 * d;
+    outputOrigin[ d ] = inputOrigin[ d ] - 6.1;
+  }
+  typename ImageType::Pointer outputGeometry = ImageType::New();
+  outputGeometry->SetRegions( typename ImageType::RegionType( outputStart, outputSize ) );
+  outputGeometry->SetSpacing( outputSpacing );
+  outputGeometry->SetOrigin( outputOrigin );
+  outputGeometry->SetDirection( CreateRotation< DirectionType >( -0.2 ) );
+
+  /** The affine transform: a rotation, scaling and translation. */
+  typename AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  typename AffineTransformType::MatrixType matrix
+    = CreateRotation< typename AffineTransformType::MatrixType >( 0.1 );
+  typename AffineTransformType::OutputVectorType translation;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    matrix( d, d ) *= 1.05;
+    translation[ d ] = 1.3 - 0.9 * d;
+  }
+  affineTransform->SetCenter( center );
+  affineTransform->SetMatrix( matrix );
+  affineTransform->SetTranslation( translation );
+
+  /** The B-spline transform, with a rotated grid that only covers the
+   * central part of the image. The grid is not aligned with the voxels.
+   */
+  typename GridImageType::SizeType gridSize;
+  typename GridImageType::IndexType gridIndex;
+  typename GridImageType::SpacingType gridSpacing;
+  typename GridImageType::PointType gridOrigin;
+  for ( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSize[ d ] = Dimension == 2 ? 8 : 6;
+    gridIndex[ d ] = 0;
+    gridSpacing[ d ] = 4.37 + 0.11 * d;
+    gridOrigin[ d ] = center[ d ] - 0.5 * ( gridSize[ d ] - 1 ) * gridSpacing[ d ];
+  }
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion(
+    typename GridImageType::RegionType( gridIndex, gridSize ) );
+  bsplineTransform->SetGridDirection(
+    CreateRotation< typename BSplineTransformType::DirectionType >( 0.15 ) );
+  typename BSplineTransformType::ParametersType parameters(
+    bsplineTransform->GetNumberOfParameters() );
+  for ( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 1.5 * vcl_sin( 0.37 * static_cast<double>( i ) );
+  }
+  bsplineTransform->SetParametersByValue( parameters );
+
+  /** The affine transform followed by the B-spline transform. */
+  typename ComboTransformType::Pointer transform = ComboTransformType::New();
+  transform->SetUseComposition( true );
+  transform->SetInitialTransform( affineTransform );
+  transform->SetCurrentTransform( bsplineTransform );
+
+  /** Check that points outside the valid region of the B-spline are tested. */
+  unsigned long numberOfInside = 0;
+  unsigned long numberOfOutside = 0;
+  itk::ImageRegionIteratorWithIndex< ImageType > itOut(
+    outputGeometry, outputGeometry->GetLargestPossibleRegion() );
+  for ( itOut.GoToBegin(); !itOut.IsAtEnd(); ++itOut )
+  {
+    typename ImageType::PointType point;
+    outputGeometry->TransformIndexToPhysicalPoint( itOut.GetIndex(), point );
+    const typename AffineTransformType::OutputPointType affinePoint
+      = affineTransform->TransformPoint( point );
+    if ( bsplineTransform->TransformPoint( affinePoint ) == affinePoint )
+    {
+      ++numberOfOutside;
+    }
+    else
+    {
+      ++numberOfInside;
+    }
+  }
+  if ( numberOfInside == 0 || numberOfOutside == 0 )
+  {
+    std::cerr << "ERROR: " << Dimension << "D: all points are "
+      << ( numberOfInside == 0 ? "outside" : "inside" )
+      << " the valid region of the B-spline transform." << std::endl;
+    return false;
+  }
+
+  std::string name = Dimension == 2 ? "2D" : "3D";
+  bool passed = true;
+  passed &= TestResampler< ImageType, ComboTransformType, InterpolatorType >(
+    name + ", double coefficients", inputImage, outputGeometry, transform, 3, true );
+  passed &= TestResampler< ImageType, ComboTransformType, InterpolatorFloatType >(
+    name + ", float coefficients", inputImage, outputGeometry, transform, 3, true );
+  passed &= TestResampler< ImageType, ComboTransformType, InterpolatorType >(
+    name + ", fallback", inputImage, outputGeometry, transform, 1, false );
+
+  return passed;
+
+} // end TestDimension()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  bool passed = true;
+  passed &= TestDimension< 2 >();
+  passed &= TestDimension< 3 >();
+
+  if ( !passed )
+  {
+    std::cerr << "Test failed." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Test passed." << std::endl;
+  return 0;
+
+} // end main
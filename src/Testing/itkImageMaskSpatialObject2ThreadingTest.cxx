@@ -0,0 +1,177 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "itkMultiThreader.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <iostream>
+#include <vector>
+
+/** This test checks the thread-safe mask test of the ImageMaskSpatialObject2,
+ * which is used by the metrics to test the moving mask from several threads.
+ * IsInsideUsingWorldToIndexTransform() should give the same answer as
+ * IsInside() for points inside and outside a rotated mask, also when it
+ * is called by several threads at the same time.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+typedef itk::ImageMaskSpatialObject2< Dimension >   MaskSpatialObjectType;
+typedef MaskSpatialObjectType::ImageType            MaskImageType;
+typedef MaskSpatialObjectType::PointType            PointType;
+typedef MaskSpatialObjectType::TransformType        TransformType;
+typedef itk::MultiThreader                          ThreaderType;
+
+/** The data that is shared by the threads. The results are stored as
+ * bytes, since the bits of a std::vector<bool> can not be written by
+ * several threads. */
+struct ThreadDataType
+{
+  const MaskSpatialObjectType *   st_Mask;
+  const TransformType *           st_WorldToIndex;
+  const std::vector< PointType > * st_Points;
+  std::vector< unsigned char > *  st_Inside;
+};
+
+//-------------------------------------------------------------------------------------
+
+/** Each thread tests an interleaved part of the points. */
+ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg )
+{
+  ThreaderType::ThreadInfoStruct * info
+    = static_cast<ThreaderType::ThreadInfoStruct *>( arg );
+  ThreadDataType * data = static_cast<ThreadDataType *>( info->UserData );
+
+  const unsigned int numberOfPoints = data->st_Points->size();
+  for ( unsigned int i = info->ThreadID; i < numberOfPoints;
+    i += info->NumberOfThreads )
+  {
+    ( *data->st_Inside )[ i ] = data->st_Mask->IsInsideUsingWorldToIndexTransform(
+      ( *data->st_Points )[ i ], data->st_WorldToIndex );
+  }
+
+  return ITK_THREAD_RETURN_VALUE;
+
+} // end ThreaderCallback()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  /** Create a mask image with a rotated direction, of which a sphere is on. */
+  MaskImageType::SizeType size; size.Fill( 32 );
+  MaskImageType::IndexType start; start.Fill( 0 );
+  MaskImageType::RegionType region( start, size );
+  MaskImageType::SpacingType spacing;
+  spacing[ 0 ] = 1.0; spacing[ 1 ] = 1.5; spacing[ 2 ] = 2.0;
+  MaskImageType::PointType origin;
+  origin[ 0 ] = -10.0; origin[ 1 ] = 5.0; origin[ 2 ] = 3.0;
+  MaskImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction( 0, 0 ) = 0.8; direction( 0, 1 ) = -0.6;
+  direction( 1, 0 ) = 0.6; direction( 1, 1 ) = 0.8;
+
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->SetRegions( region );
+  maskImage->SetSpacing( spacing );
+  maskImage->SetOrigin( origin );
+  maskImage->SetDirection( direction );
+  maskImage->Allocate();
+
+  typedef itk::ImageRegionIteratorWithIndex< MaskImageType > IteratorType;
+  IteratorType it( maskImage, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double r2 = 0.0;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double x = it.GetIndex()[ d ] - 15.5;
+      r2 += x * x;
+    }
+    it.Set( r2 < 12.0 * 12.0 ? 1 : 0 );
+  }
+
+  MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage( maskImage );
+
+  TransformType::Pointer worldToIndex = TransformType::New();
+  if ( !mask->ComputeWorldToIndexTransform( worldToIndex ) )
+  {
+    std::cerr << "ERROR: the world-to-index transform could not be computed."
+      << std::endl;
+    return 1;
+  }
+
+  /** Generate random points in and around the mask. */
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer generator = RandomGeneratorType::GetInstance();
+  generator->SetSeed( 12345 );
+  const unsigned int numberOfPoints = 100000;
+  std::vector< PointType > points( numberOfPoints );
+  std::vector< bool > insideSerial( numberOfPoints );
+  unsigned long numberInside = 0;
+  for ( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    MaskImageType::PointType::VectorType offset;
+    MaskImageType::PointType::VectorType step;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      step[ d ] = generator->GetUniformVariate( -4.0, 36.0 ) * spacing[ d ];
+    }
+    offset = direction * step;
+    points[ i ] = origin + offset;
+    insideSerial[ i ] = mask->IsInside( points[ i ] );
+    if ( insideSerial[ i ] ) ++numberInside;
+  }
+  if ( numberInside == 0 || numberInside == numberOfPoints )
+  {
+    std::cerr << "ERROR: the test points should be both inside and outside "
+      << "the mask." << std::endl;
+    return 1;
+  }
+
+  /** Test the points with several threads. */
+  std::vector< unsigned char > insideThreaded( numberOfPoints, 0 );
+  ThreadDataType data;
+  data.st_Mask = mask;
+  data.st_WorldToIndex = worldToIndex;
+  data.st_Points = &points;
+  data.st_Inside = &insideThreaded;
+
+  ThreaderType::Pointer threader = ThreaderType::New();
+  threader->SetNumberOfThreads( 4 );
+  threader->SetSingleMethod( ThreaderCallback, &data );
+  threader->SingleMethodExecute();
+
+  unsigned long errors = 0;
+  for ( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    if ( insideSerial[ i ] != ( insideThreaded[ i ] != 0 ) ) ++errors;
+  }
+
+  std::cerr << "Points inside the mask: " << numberInside << " / "
+    << numberOfPoints << std::endl;
+  if ( errors > 0 )
+  {
+    std::cerr << "ERROR: the thread-safe mask test differs from IsInside() for "
+      << errors << " points." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Test passed." << std::endl;
+  return 0;
+
+} // end main
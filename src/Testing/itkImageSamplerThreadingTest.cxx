@@ -0,0 +1,283 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageGridSampler.h"
+#include "itkImageRandomSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageMaskSpatialObject2.h"
+#include "vnl/vnl_math.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+
+/** This test checks the multi-threaded GenerateData() of the image samplers.
+ * The grid sampler should give exactly the same samples as its
+ * single-threaded version. The random samplers should produce identical
+ * sample sets when they are run twice with the same seed and number of
+ * threads, and all samples should lie inside the input image. Finally, the
+ * direct mask sampling of the random coordinate sampler is tested, with
+ * and without threads: all samples should lie inside a small mask.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+typedef float                                         PixelType;
+typedef itk::Image< PixelType, Dimension >            ImageType;
+typedef itk::ImageSamplerBase< ImageType >            SamplerBaseType;
+typedef SamplerBaseType::ImageSampleContainerType     SampleContainerType;
+typedef itk::ImageGridSampler< ImageType >            GridSamplerType;
+typedef itk::ImageRandomSampler< ImageType >          RandomSamplerType;
+typedef itk::ImageRandomCoordinateSampler< ImageType > RandomCoordinateSamplerType;
+typedef itk::ImageMaskSpatialObject2< Dimension >     MaskSpatialObjectType;
+typedef MaskSpatialObjectType::ImageType              MaskImageType;
+
+//-------------------------------------------------------------------------------------
+
+/** Count the number of samples that differ between two sample containers. */
+unsigned long CompareSamples(
+  const SampleContainerType * samples1, const SampleContainerType * samples2 )
+{
+  if ( samples1->Size() != samples2->Size() )
+  {
+    std::cerr << "ERROR: number of samples differs: " << samples1->Size()
+      << " vs " << samples2->Size() << std::endl;
+    return vnl_math_max( samples1->Size(), samples2->Size() );
+  }
+
+  unsigned long errors = 0;
+  for ( unsigned long i = 0; i < samples1->Size(); ++i )
+  {
+    const SamplerBaseType::ImageSampleType & s1 = samples1->ElementAt( i );
+    const SamplerBaseType::ImageSampleType & s2 = samples2->ElementAt( i );
+    if ( s1.m_ImageCoordinates != s2.m_ImageCoordinates
+      || s1.m_ImageValue != s2.m_ImageValue )
+    {
+      ++errors;
+    }
+  }
+  return errors;
+
+} // end CompareSamples()
+
+//-------------------------------------------------------------------------------------
+
+/** Count the number of samples outside the image. */
+unsigned long CountSamplesOutsideImage(
+  const SampleContainerType * samples, const ImageType * image )
+{
+  unsigned long errors = 0;
+  ImageType::IndexType index;
+  for ( unsigned long i = 0; i < samples->Size(); ++i )
+  {
+    if ( !image->TransformPhysicalPointToIndex(
+      samples->ElementAt( i ).m_ImageCoordinates, index ) )
+    {
+      ++errors;
+    }
+  }
+  return errors;
+
+} // end CountSamplesOutsideImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Count the number of samples outside the mask. */
+unsigned long CountSamplesOutsideMask(
+  const SampleContainerType * samples, const MaskSpatialObjectType * mask )
+{
+  unsigned long errors = 0;
+  for ( unsigned long i = 0; i < samples->Size(); ++i )
+  {
+    if ( !mask->IsInside( samples->ElementAt( i ).m_ImageCoordinates ) )
+    {
+      ++errors;
+    }
+  }
+  return errors;
+
+} // end CountSamplesOutsideMask()
+
+//-------------------------------------------------------------------------------------
+
+/** Run a sampler twice and check that the results are identical. */
+template < class TSampler >
+unsigned long CheckReproducibility( const ImageType * image,
+  unsigned int numberOfThreads, unsigned long numberOfSamples,
+  const MaskSpatialObjectType * mask = 0 )
+{
+  typename TSampler::Pointer sampler1 = TSampler::New();
+  typename TSampler::Pointer sampler2 = TSampler::New();
+  sampler1->SetInput( image );
+  sampler2->SetInput( image );
+  sampler1->SetInputImageRegion( image->GetBufferedRegion() );
+  sampler2->SetInputImageRegion( image->GetBufferedRegion() );
+  sampler1->SetNumberOfSamples( numberOfSamples );
+  sampler2->SetNumberOfSamples( numberOfSamples );
+  sampler1->SetNumberOfThreads( numberOfThreads );
+  sampler2->SetNumberOfThreads( numberOfThreads );
+  sampler1->UseMultiThreadOn();
+  sampler2->UseMultiThreadOn();
+  sampler1->SetSeed( 12345 );
+  sampler2->SetSeed( 12345 );
+  if ( mask )
+  {
+    sampler1->SetMask( mask );
+    sampler2->SetMask( mask );
+  }
+
+  /** Take two consecutive sample sets. */
+  unsigned long errors = 0;
+  for ( unsigned int k = 0; k < 2; ++k )
+  {
+    sampler1->SelectNewSamplesOnUpdate();
+    sampler2->SelectNewSamplesOnUpdate();
+    sampler1->Update();
+    sampler2->Update();
+    errors += CompareSamples( sampler1->GetOutput(), sampler2->GetOutput() );
+    errors += CountSamplesOutsideImage( sampler1->GetOutput(), image );
+    if ( sampler1->GetOutput()->Size() != numberOfSamples ) ++errors;
+    if ( mask )
+    {
+      errors += CountSamplesOutsideMask( sampler1->GetOutput(), mask );
+    }
+  }
+  return errors;
+
+} // end CheckReproducibility()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  /** Create a test image with a smoothly varying intensity. */
+  ImageType::Pointer image = ImageType::New();
+  ImageType::SizeType size;
+  size[ 0 ] = 67; size[ 1 ] = 53; size[ 2 ] = 41;
+  ImageType::RegionType region;
+  region.SetSize( size );
+  ImageType::SpacingType spacing;
+  spacing[ 0 ] = 0.9; spacing[ 1 ] = 1.1; spacing[ 2 ] = 2.5;
+  ImageType::PointType origin;
+  origin[ 0 ] = -10.0; origin[ 1 ] = 3.0; origin[ 2 ] = 7.5;
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  typedef itk::ImageRegionIteratorWithIndex< ImageType > IteratorType;
+  IteratorType it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType & index = it.GetIndex();
+    it.Set( static_cast<PixelType>( 100.0 * vcl_sin( 0.1 * index[ 0 ] )
+      + 50.0 * vcl_cos( 0.2 * index[ 1 ] ) + index[ 2 ] ) );
+  }
+
+  /** The number of threads. */
+  unsigned int numberOfThreads = 4;
+  if ( argc > 1 )
+  {
+    numberOfThreads = atoi( argv[ 1 ] );
+  }
+  std::cerr << "Number of threads = " << numberOfThreads << std::endl;
+
+  unsigned long totalErrors = 0;
+
+  /** The threaded grid sampler should reproduce the single-threaded one. */
+  GridSamplerType::Pointer serialGridSampler = GridSamplerType::New();
+  GridSamplerType::Pointer threadedGridSampler = GridSamplerType::New();
+  GridSamplerType::SampleGridSpacingType gridSpacing;
+  gridSpacing[ 0 ] = 2; gridSpacing[ 1 ] = 3; gridSpacing[ 2 ] = 4;
+  serialGridSampler->SetInput( image );
+  serialGridSampler->SetInputImageRegion( region );
+  serialGridSampler->SetSampleGridSpacing( gridSpacing );
+  serialGridSampler->UseMultiThreadOff();
+  threadedGridSampler->SetInput( image );
+  threadedGridSampler->SetInputImageRegion( region );
+  threadedGridSampler->SetSampleGridSpacing( gridSpacing );
+  threadedGridSampler->SetNumberOfThreads( numberOfThreads );
+  threadedGridSampler->UseMultiThreadOn();
+  serialGridSampler->Update();
+  threadedGridSampler->Update();
+  unsigned long errors = CompareSamples(
+    serialGridSampler->GetOutput(), threadedGridSampler->GetOutput() );
+  std::cerr << "Grid sampler: " << errors << " errors." << std::endl;
+  totalErrors += errors;
+
+  /** The random samplers should be reproducible. */
+  errors = CheckReproducibility< RandomSamplerType >(
+    image, numberOfThreads, 5000 );
+  std::cerr << "Random sampler: " << errors << " errors." << std::endl;
+  totalErrors += errors;
+
+  errors = CheckReproducibility< RandomCoordinateSamplerType >(
+    image, numberOfThreads, 5000 );
+  std::cerr << "Random coordinate sampler: " << errors << " errors." << std::endl;
+  totalErrors += errors;
+
+  /** Create a small spherical mask, and sample it directly. */
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->SetRegions( region );
+  maskImage->SetSpacing( spacing );
+  maskImage->SetOrigin( origin );
+  maskImage->Allocate();
+  typedef itk::ImageRegionIteratorWithIndex< MaskImageType > MaskIteratorType;
+  MaskIteratorType mit( maskImage, region );
+  for ( mit.GoToBegin(); !mit.IsAtEnd(); ++mit )
+  {
+    const MaskImageType::IndexType & index = mit.GetIndex();
+    double r2 = 0.0;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double dist = static_cast<double>( index[ d ] ) - 0.3 * size[ d ];
+      r2 += dist * dist;
+    }
+    mit.Set( r2 < 16.0 ? 1 : 0 );
+  }
+  MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage( maskImage );
+
+  errors = CheckReproducibility< RandomCoordinateSamplerType >(
+    image, numberOfThreads, 5000, mask );
+  std::cerr << "Random coordinate sampler with mask: " << errors
+    << " errors." << std::endl;
+  totalErrors += errors;
+
+  RandomCoordinateSamplerType::Pointer serialMaskSampler
+    = RandomCoordinateSamplerType::New();
+  serialMaskSampler->SetInput( image );
+  serialMaskSampler->SetInputImageRegion( region );
+  serialMaskSampler->SetMask( mask );
+  serialMaskSampler->SetNumberOfSamples( 5000 );
+  serialMaskSampler->UseMultiThreadOff();
+  serialMaskSampler->Update();
+  errors = CountSamplesOutsideMask( serialMaskSampler->GetOutput(), mask );
+  if ( serialMaskSampler->GetOutput()->Size() != 5000 ) ++errors;
+  std::cerr << "Single-threaded random coordinate sampler with mask: "
+    << errors << " errors." << std::endl;
+  totalErrors += errors;
+
+  if ( totalErrors > 0 )
+  {
+    std::cerr << "ERROR: the multi-threaded samplers are not correct." << std::endl;
+    return 1;
+  }
+
+  /** Return a value. */
+  std::cerr << "The multi-threaded samplers are correct." << std::endl;
+  return 0;
+
+} // end main
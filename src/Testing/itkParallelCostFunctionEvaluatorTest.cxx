@@ -0,0 +1,262 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRandomSampler.h"
+#include "itkHardLimiterFunction.h"
+#include "itkExponentialLimiterFunction.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkParallelCostFunctionEvaluator.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "vnl/vnl_math.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** This test checks that the concurrent evaluation of a metric by the
+ * ParallelCostFunctionEvaluator, using evaluators created by
+ * AdvancedImageToImageMetric::CreateEvaluator(), gives the same values as
+ * the serial evaluation of the metric itself, for the AdvancedMeanSquares,
+ * AdvancedNormalizedCorrelation and ParzenWindowMutualInformation metrics.
+ * The evaluators share the image sampler, which they should not update.
+ */
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                        ImageType;
+typedef itk::AdvancedImageToImageMetric< ImageType, ImageType > MetricBaseType;
+typedef MetricBaseType::RealType                              RealType;
+typedef MetricBaseType::ParametersType                        ParametersType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                                      MeanSquaresMetricType;
+typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+  ImageType, ImageType >                                      NormalizedCorrelationMetricType;
+typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+  ImageType, ImageType >                                      MattesMetricType;
+typedef itk::HardLimiterFunction< RealType, Dimension >       FixedLimiterType;
+typedef itk::ExponentialLimiterFunction< RealType, Dimension > MovingLimiterType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                                 InterpolatorType;
+typedef itk::ImageRandomSampler< ImageType >                  SamplerType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  double, Dimension, Dimension >                              TransformType;
+typedef itk::ParallelCostFunctionEvaluator                    ParallelEvaluatorType;
+
+//-------------------------------------------------------------------------------------
+
+/** Create an image with a smooth pattern, shifted for the moving image. */
+ImageType::Pointer CreateImage( const double shift )
+{
+  ImageType::SizeType size; size.Fill( 64 );
+  ImageType::IndexType start; start.Fill( 0 );
+  ImageType::RegionType region( start, size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ] + shift;
+    const double y = it.GetIndex()[ 1 ] - 0.5 * shift;
+    const double r2 = ( x - 30.0 ) * ( x - 30.0 ) + ( y - 34.0 ) * ( y - 34.0 );
+    it.Set( static_cast<float>( 100.0 * vcl_exp( -r2 / 200.0 )
+      + 20.0 * vcl_sin( 0.2 * x ) * vcl_cos( 0.15 * y ) ) );
+  }
+
+  return image;
+
+} // end CreateImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Evaluate the metric at a number of positions, serially and with the
+ * parallel evaluator, and compare the values. Returns false on failure.
+ */
+bool TestMetric( const std::string & name, MetricBaseType * metric,
+  SamplerType * sampler, const std::vector< ParametersType > & positions )
+{
+  const unsigned int numberOfEvaluators = 4;
+  const double tolerance = 1e-10;
+
+  /** The evaluators do not use threads themselves. Do the same in the
+   * serial evaluation, so that the samples are summed in the same order.
+   */
+  metric->SetUseMultiThread( false );
+  metric->Initialize();
+
+  /** Create the evaluators. */
+  ParallelEvaluatorType::EvaluatorContainerType evaluators;
+  for ( unsigned int i = 0; i < numberOfEvaluators; ++i )
+  {
+    MetricBaseType::Pointer evaluator = metric->CreateEvaluator();
+    if ( evaluator.IsNull() )
+    {
+      std::cerr << "ERROR: " << name << " did not create an evaluator."
+        << std::endl;
+      return false;
+    }
+    if ( !evaluator->GetSamplerIsPreUpdated() )
+    {
+      std::cerr << "ERROR: the evaluators of " << name
+        << " should not update the image sampler." << std::endl;
+      return false;
+    }
+    evaluators.push_back( evaluator.GetPointer() );
+  }
+
+  ParallelEvaluatorType::Pointer parallelEvaluator = ParallelEvaluatorType::New();
+  parallelEvaluator->SetEvaluators( evaluators );
+  parallelEvaluator->AddSharedDataSource( sampler );
+
+  /** Evaluate concurrently. */
+  ParallelEvaluatorType::MeasureContainerType values;
+  ParallelEvaluatorType::ExceptionContainerType exceptions;
+  parallelEvaluator->GetValues( positions, values, exceptions );
+
+  /** Evaluate serially, and compare. */
+  bool passed = true;
+  for ( unsigned int k = 0; k < positions.size(); ++k )
+  {
+    if ( exceptions[ k ].st_Caught )
+    {
+      std::cerr << "ERROR: " << name << " threw an exception for position "
+        << k << ":\n" << exceptions[ k ].st_Exception << std::endl;
+      passed = false;
+      continue;
+    }
+    const double serialValue = metric->GetValue( positions[ k ] );
+    const double difference = vnl_math_abs( serialValue - values[ k ] );
+    if ( difference > tolerance * ( 1.0 + vnl_math_abs( serialValue ) ) )
+    {
+      std::cerr << "ERROR: " << name << " at position " << k
+        << ": serial value " << serialValue << ", concurrent value "
+        << values[ k ] << std::endl;
+      passed = false;
+    }
+  }
+
+  std::cerr << name << ": " << ( passed ? "passed" : "FAILED" ) << std::endl;
+  return passed;
+
+} // end TestMetric()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  ImageType::Pointer fixedImage = CreateImage( 0.0 );
+  ImageType::Pointer movingImage = CreateImage( 2.5 );
+
+  /** The positions: small deterministic perturbations of the identity. */
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::InputPointType center;
+  center.Fill( 31.5 );
+  transform->SetCenter( center );
+  const ParametersType identity = transform->GetParameters();
+  std::vector< ParametersType > positions;
+  for ( unsigned int k = 0; k < 16; ++k )
+  {
+    ParametersType position = identity;
+    for ( unsigned int p = 0; p < position.GetSize(); ++p )
+    {
+      const double scale = p < Dimension * Dimension ? 0.02 : 2.0;
+      position[ p ] += scale * vcl_sin( 1.3 * k + 0.7 * p );
+    }
+    positions.push_back( position );
+  }
+
+  bool passed = true;
+
+  /** The metrics, each with their own transform, interpolator and sampler. */
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 2000 );
+    sampler->SetSeed( 121212 );
+
+    MeanSquaresMetricType::Pointer metric = MeanSquaresMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    passed &= TestMetric( "AdvancedMeanSquares", metric, sampler, positions );
+  }
+
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 2000 );
+    sampler->SetSeed( 121212 );
+
+    NormalizedCorrelationMetricType::Pointer metric
+      = NormalizedCorrelationMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetSubtractMean( true );
+    passed &= TestMetric( "AdvancedNormalizedCorrelation", metric, sampler, positions );
+  }
+
+  {
+    TransformType::Pointer metricTransform = TransformType::New();
+    metricTransform->SetCenter( center );
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    sampler->SetNumberOfSamples( 2000 );
+    sampler->SetSeed( 121212 );
+
+    MattesMetricType::Pointer metric = MattesMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( metricTransform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetNumberOfFixedHistogramBins( 32 );
+    metric->SetNumberOfMovingHistogramBins( 32 );
+    metric->SetFixedKernelBSplineOrder( 0 );
+    metric->SetMovingKernelBSplineOrder( 3 );
+    metric->SetFixedImageLimiter( FixedLimiterType::New() );
+    metric->SetMovingImageLimiter( MovingLimiterType::New() );
+    passed &= TestMetric( "ParzenWindowMutualInformation", metric, sampler, positions );
+  }
+
+  if ( !passed )
+  {
+    std::cerr << "Test failed." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Test passed." << std::endl;
+  return 0;
+
+} // end main
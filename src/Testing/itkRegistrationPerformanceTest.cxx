@@ -0,0 +1,664 @@
+/*======================================================================
+
+  This file is part of the elastix software.
+
+  Copyright (c) University Medical Center Utrecht. All rights reserved.
+  See src/CopyrightElastix.txt or http://elastix.isi.uu.nl/legal.php for
+  details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE. See the above copyright notices for more information.
+
+======================================================================*/
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkMultiThreader.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include "itkImageRandomSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkHardLimiterFunction.h"
+#include "itkExponentialLimiterFunction.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "EulerTransform/itkEulerTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "AdaptiveStochasticGradientDescent/itkAdaptiveStochasticGradientDescentOptimizer.h"
+#include "elxTimer.h"
+#include "vnl/vnl_math.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+/** This benchmark times a fixed number of iterations of the most common
+ * registration stacks on synthetic 2D and 3D images of several sizes:
+ * - Euler + AdvancedMeanSquares + random sampler,
+ * - Affine + AdvancedMattesMutualInformation + random sampler,
+ * - BSpline + AdvancedMattesMutualInformation + random coordinate sampler,
+ * all optimized with the AdaptiveStochasticGradientDescent optimizer using
+ * fixed gain parameters, so that the amount of work does not depend on the
+ * convergence.
+ *
+ * The fixed image is a sum of Gaussian blobs at deterministic positions; the
+ * moving image is the same function, evaluated at smoothly deformed and
+ * shifted positions. No input data nor network access is needed.
+ *
+ * For every run one line of comma separated values is written, containing
+ * the initialization time, the total optimization time, the time spent in
+ * the sampler, the metric and the rest (the optimizer and the transform
+ * parameter updates), and the number of samples per second processed by
+ * the metric. All times are wall clock times in seconds.
+ *
+ * Usage: itkRegistrationPerformanceTest [outputDirectory] [full]
+ * When an output directory is given, the results are also written to
+ * outputDirectory/RegistrationPerformanceTest.csv. When "full" is given,
+ * also the largest image sizes are benchmarked.
+ */
+
+//-------------------------------------------------------------------------------------
+
+/** A single valued cost function that forwards to a metric, and measures
+ * the time spent in selecting new samples and in evaluating the metric.
+ * New samples are selected before every derivative evaluation, like
+ * elastix does when NewSamplesEveryIteration is true.
+ */
+
+template< class TImageSampler >
+class TimedCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef TimedCostFunction                 Self;
+  typedef itk::SingleValuedCostFunction     Superclass;
+  typedef itk::SmartPointer<Self>           Pointer;
+  typedef itk::SmartPointer<const Self>     ConstPointer;
+
+  itkNewMacro( Self );
+  itkTypeMacro( TimedCostFunction, SingleValuedCostFunction );
+
+  typedef typename Superclass::MeasureType        MeasureType;
+  typedef typename Superclass::DerivativeType     DerivativeType;
+  typedef typename Superclass::ParametersType     ParametersType;
+  typedef TImageSampler                           ImageSamplerType;
+
+  void SetMetric( Superclass * metric ) { this->m_Metric = metric; }
+  void SetImageSampler( ImageSamplerType * sampler ) { this->m_ImageSampler = sampler; }
+
+  double GetSamplerTime( void ) const { return this->m_SamplerTime; }
+  double GetMetricTime( void ) const { return this->m_MetricTime; }
+  unsigned long GetNumberOfEvaluations( void ) const { return this->m_NumberOfEvaluations; }
+  MeasureType GetLastValue( void ) const { return this->m_LastValue; }
+
+  virtual unsigned int GetNumberOfParameters( void ) const
+  {
+    return this->m_Metric->GetNumberOfParameters();
+  }
+
+  virtual MeasureType GetValue( const ParametersType & parameters ) const
+  {
+    this->SelectNewSamples();
+    this->m_Timer->StartTimer();
+    this->m_LastValue = this->m_Metric->GetValue( parameters );
+    this->m_Timer->StopTimer();
+    this->m_MetricTime += this->m_Timer->GetElapsedClockSec();
+    ++this->m_NumberOfEvaluations;
+    return this->m_LastValue;
+  }
+
+  virtual void GetDerivative( const ParametersType & parameters,
+    DerivativeType & derivative ) const
+  {
+    MeasureType value;
+    this->GetValueAndDerivative( parameters, value, derivative );
+  }
+
+  virtual void GetValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const
+  {
+    this->SelectNewSamples();
+    this->m_Timer->StartTimer();
+    this->m_Metric->GetValueAndDerivative( parameters, value, derivative );
+    this->m_Timer->StopTimer();
+    this->m_MetricTime += this->m_Timer->GetElapsedClockSec();
+    ++this->m_NumberOfEvaluations;
+    this->m_LastValue = value;
+  }
+
+protected:
+
+  TimedCostFunction()
+  {
+    this->m_Timer = tmr::Timer::New();
+    this->m_SamplerTime = 0.0;
+    this->m_MetricTime = 0.0;
+    this->m_NumberOfEvaluations = 0;
+    this->m_LastValue = 0.0;
+  }
+  virtual ~TimedCostFunction() {};
+
+  /** Select new samples and run the sampler, so that the
+   * Update() call inside the metric does not do anything.
+   */
+  void SelectNewSamples( void ) const
+  {
+    this->m_Timer->StartTimer();
+    this->m_ImageSampler->SelectNewSamplesOnUpdate();
+    this->m_ImageSampler->Update();
+    this->m_Timer->StopTimer();
+    this->m_SamplerTime += this->m_Timer->GetElapsedClockSec();
+  }
+
+private:
+
+  TimedCostFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );    // purposely not implemented
+
+  typename Superclass::Pointer        m_Metric;
+  typename ImageSamplerType::Pointer  m_ImageSampler;
+  tmr::Timer::Pointer                 m_Timer;
+  mutable double                      m_SamplerTime;
+  mutable double                      m_MetricTime;
+  mutable unsigned long               m_NumberOfEvaluations;
+  mutable MeasureType                 m_LastValue;
+
+}; // end class TimedCostFunction
+
+//-------------------------------------------------------------------------------------
+
+/** The results of a single benchmark run. */
+struct BenchmarkResultStruct
+{
+  std::string   Stack;
+  unsigned int  Dimension;
+  unsigned long ImageSize;
+  unsigned long NumberOfParameters;
+  unsigned long NumberOfIterations;
+  unsigned long NumberOfSamples;
+  double        InitializationTime;
+  double        TotalTime;
+  double        SamplerTime;
+  double        MetricTime;
+  double        OptimizerTime;
+  double        SamplesPerSecond;
+  double        FinalValue;
+  bool          Failed;
+};
+
+//-------------------------------------------------------------------------------------
+
+/** Write the header of the comma separated values. */
+void WriteHeader( std::ostream & os )
+{
+  os << "stack,dimension,imagesize,parameters,iterations,samples,threads,"
+    << "initialization_s,total_s,sampler_s,metric_s,optimizer_s,"
+    << "samples_per_s,final_value,status" << std::endl;
+
+} // end WriteHeader()
+
+//-------------------------------------------------------------------------------------
+
+/** Write one line of comma separated values. */
+void WriteResult( std::ostream & os, const BenchmarkResultStruct & result )
+{
+  os << result.Stack << ","
+    << result.Dimension << ","
+    << result.ImageSize << ","
+    << result.NumberOfParameters << ","
+    << result.NumberOfIterations << ","
+    << result.NumberOfSamples << ","
+    << itk::MultiThreader::GetGlobalDefaultNumberOfThreads() << ","
+    << std::setprecision( 6 )
+    << result.InitializationTime << ","
+    << result.TotalTime << ","
+    << result.SamplerTime << ","
+    << result.MetricTime << ","
+    << result.OptimizerTime << ","
+    << result.SamplesPerSecond << ","
+    << result.FinalValue << ","
+    << ( result.Failed ? "failed" : "ok" ) << std::endl;
+
+} // end WriteResult()
+
+//-------------------------------------------------------------------------------------
+
+/** The synthetic intensity function: a background value plus a sum of
+ * Gaussian blobs, with positions and widths relative to the image extent.
+ */
+
+template< unsigned int Dimension >
+double SyntheticIntensity( const double * x, const double extent )
+{
+  const unsigned int numberOfBlobs = 4 * Dimension;
+  double value = 10.0;
+  for ( unsigned int b = 0; b < numberOfBlobs; ++b )
+  {
+    double squaredDistance = 0.0;
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double center
+        = extent * ( 0.5 + 0.3 * vcl_sin( 1.7 * b + 2.3 * d + 0.5 ) );
+      squaredDistance += ( x[ d ] - center ) * ( x[ d ] - center );
+    }
+    const double sigma = extent * ( 0.08 + 0.04 * vcl_sin( 3.1 * b ) );
+    const double amplitude = 40.0 + 30.0 * vcl_cos( 2.9 * b );
+    value += amplitude * vcl_exp( -squaredDistance / ( 2.0 * sigma * sigma ) );
+  }
+  return value;
+
+} // end SyntheticIntensity()
+
+//-------------------------------------------------------------------------------------
+
+/** Create a synthetic image of size^Dimension voxels with unit spacing.
+ * The moving image is evaluated at x + u(x), with u a smooth sinusoidal
+ * deformation plus a small shift.
+ */
+
+template< class TImage >
+typename TImage::Pointer CreateSyntheticImage(
+  const unsigned long size, const bool moving )
+{
+  const unsigned int Dimension = TImage::ImageDimension;
+
+  typename TImage::SizeType imageSize;
+  imageSize.Fill( size );
+  typename TImage::RegionType region;
+  region.SetSize( imageSize );
+
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  const double extent = static_cast<double>( size - 1 );
+  const double pi = 3.14159265358979323846;
+  typename TImage::PointType point;
+  double x[ Dimension ];
+
+  itk::ImageRegionIteratorWithIndex< TImage > it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    for ( unsigned int d = 0; d < Dimension; ++d )
+    {
+      x[ d ] = point[ d ];
+      if ( moving )
+      {
+        const double other = point[ ( d + 1 ) % Dimension ];
+        x[ d ] += 0.03 * extent * vcl_sin( 2.0 * pi * other / extent )
+          + 0.02 * extent;
+      }
+    }
+    it.Set( static_cast<typename TImage::PixelType>(
+      SyntheticIntensity< Dimension >( x, extent ) ) );
+  }
+
+  return image;
+
+} // end CreateSyntheticImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Run a fixed number of ASGD iterations on a metric that has been
+ * completely set up, except for its initialization.
+ */
+
+template< class TImage >
+BenchmarkResultStruct RunRegistration(
+  const std::string & stack,
+  itk::AdvancedImageToImageMetric< TImage, TImage > * metric,
+  itk::ImageSamplerBase< TImage > * sampler,
+  const itk::Array< double > & initialParameters,
+  const itk::Array< double > & scales,
+  const double param_a,
+  const unsigned long numberOfIterations,
+  const unsigned long numberOfSamples )
+{
+  typedef itk::ImageSamplerBase< TImage >                 ImageSamplerType;
+  typedef TimedCostFunction< ImageSamplerType >           CostFunctionType;
+  typedef itk::AdaptiveStochasticGradientDescentOptimizer OptimizerType;
+
+  BenchmarkResultStruct result;
+  result.Stack = stack;
+  result.Dimension = TImage::ImageDimension;
+  result.ImageSize = metric->GetFixedImage()->GetLargestPossibleRegion().GetSize()[ 0 ];
+  result.NumberOfParameters = initialParameters.GetSize();
+  result.NumberOfIterations = numberOfIterations;
+  result.NumberOfSamples = numberOfSamples;
+  result.InitializationTime = 0.0;
+  result.TotalTime = 0.0;
+  result.SamplerTime = 0.0;
+  result.MetricTime = 0.0;
+  result.OptimizerTime = 0.0;
+  result.SamplesPerSecond = 0.0;
+  result.FinalValue = 0.0;
+  result.Failed = false;
+
+  tmr::Timer::Pointer timer = tmr::Timer::New();
+  typename CostFunctionType::Pointer costFunction = CostFunctionType::New();
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+
+  try
+  {
+    /** Initialize the metric, which includes the computation of the
+     * image extrema and the B-spline coefficients of the moving image.
+     */
+    timer->StartTimer();
+    metric->Initialize();
+    timer->StopTimer();
+    result.InitializationTime = timer->GetElapsedClockSec();
+
+    costFunction->SetMetric( metric );
+    costFunction->SetImageSampler( sampler );
+
+    optimizer->SetCostFunction( costFunction );
+    optimizer->SetInitialPosition( initialParameters );
+    optimizer->SetScales( scales );
+    optimizer->SetUseScales( true );
+    optimizer->SetMaximize( false );
+    optimizer->SetNumberOfIterations( numberOfIterations );
+    optimizer->SetParam_a( param_a );
+    optimizer->SetParam_A( 50.0 );
+    optimizer->SetParam_alpha( 0.602 );
+
+    timer->StartTimer();
+    optimizer->StartOptimization();
+    timer->StopTimer();
+    result.TotalTime = timer->GetElapsedClockSec();
+  }
+  catch ( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: " << stack << " " << result.Dimension << "D, size "
+      << result.ImageSize << " failed:\n" << excp << std::endl;
+    result.Failed = true;
+  }
+
+  result.SamplerTime = costFunction->GetSamplerTime();
+  result.MetricTime = costFunction->GetMetricTime();
+  result.OptimizerTime = vnl_math_max( 0.0,
+    result.TotalTime - result.SamplerTime - result.MetricTime );
+  if ( result.MetricTime > 0.0 )
+  {
+    result.SamplesPerSecond = static_cast<double>( numberOfSamples )
+      * costFunction->GetNumberOfEvaluations() / result.MetricTime;
+  }
+  result.FinalValue = costFunction->GetLastValue();
+
+  return result;
+
+} // end RunRegistration()
+
+//-------------------------------------------------------------------------------------
+
+/** Run the three registration stacks for a given dimension and image size. */
+
+template< unsigned int Dimension >
+std::vector< BenchmarkResultStruct > RunStacks( const unsigned long size,
+  const unsigned long numberOfIterations, const unsigned long numberOfSamples )
+{
+  typedef itk::Image< float, Dimension >                  ImageType;
+  typedef itk::AdvancedImageToImageMetric< ImageType, ImageType > MetricBaseType;
+  typedef typename MetricBaseType::RealType               RealType;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    ImageType, ImageType >                                MeanSquaresMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                MattesMetricType;
+  typedef itk::HardLimiterFunction< RealType, Dimension > FixedLimiterType;
+  typedef itk::ExponentialLimiterFunction<
+    RealType, Dimension >                                 MovingLimiterType;
+  typedef itk::BSplineInterpolateImageFunction<
+    ImageType, double, double >                           InterpolatorType;
+  typedef itk::ImageRandomSampler< ImageType >            RandomSamplerType;
+  typedef itk::ImageRandomCoordinateSampler< ImageType >  RandomCoordinateSamplerType;
+  typedef itk::EulerTransform< double, Dimension >        EulerTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<
+    double, Dimension, Dimension >                        AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, 3 >                                BSplineTransformType;
+  typedef typename BSplineTransformType::ImageType        CoefficientImageType;
+  typedef itk::Array< double >                            ParametersType;
+  typedef itk::Array< double >                            ScalesType;
+
+  std::vector< BenchmarkResultStruct > results;
+
+  /** Create the images. */
+  typename ImageType::Pointer fixedImage
+    = CreateSyntheticImage< ImageType >( size, false );
+  typename ImageType::Pointer movingImage
+    = CreateSyntheticImage< ImageType >( size, true );
+  const double extent = static_cast<double>( size - 1 );
+
+  typename ImageType::PointType center;
+  center.Fill( 0.5 * extent );
+
+  /** Euler + MeanSquares + random sampler. The rotations are scaled by
+   * the squared radius of the image, to get steps of comparable size.
+   */
+  {
+    typename EulerTransformType::Pointer transform = EulerTransformType::New();
+    transform->SetCenter( center );
+    const ParametersType initialParameters = transform->GetParameters();
+    const unsigned long numberOfRotations = Dimension == 2 ? 1 : 3;
+    ScalesType scales( initialParameters.GetSize() );
+    scales.Fill( 1.0 );
+    for ( unsigned int i = 0; i < numberOfRotations; ++i )
+    {
+      scales[ i ] = 0.25 * extent * extent;
+    }
+
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    typename RandomSamplerType::Pointer sampler = RandomSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    sampler->SetSeed( 121212 );
+
+    typename MeanSquaresMetricType::Pointer metric = MeanSquaresMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+
+    results.push_back( RunRegistration< ImageType >( "EulerMeanSquares",
+      metric, sampler, initialParameters, scales, 0.05,
+      numberOfIterations, numberOfSamples ) );
+  }
+
+  /** Affine + Mattes mutual information + random sampler. */
+  {
+    typename AffineTransformType::Pointer transform = AffineTransformType::New();
+    transform->SetCenter( center );
+    const ParametersType initialParameters = transform->GetParameters();
+    ScalesType scales( initialParameters.GetSize() );
+    scales.Fill( 1.0 );
+    for ( unsigned int i = 0; i < Dimension * Dimension; ++i )
+    {
+      scales[ i ] = 0.25 * extent * extent;
+    }
+
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    typename RandomSamplerType::Pointer sampler = RandomSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    sampler->SetSeed( 121212 );
+
+    typename MattesMetricType::Pointer metric = MattesMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetNumberOfFixedHistogramBins( 32 );
+    metric->SetNumberOfMovingHistogramBins( 32 );
+    metric->SetFixedKernelBSplineOrder( 0 );
+    metric->SetMovingKernelBSplineOrder( 3 );
+    metric->SetFixedImageLimiter( FixedLimiterType::New() );
+    metric->SetMovingImageLimiter( MovingLimiterType::New() );
+
+    results.push_back( RunRegistration< ImageType >( "AffineMattesMI",
+      metric, sampler, initialParameters, scales, 100.0,
+      numberOfIterations, numberOfSamples ) );
+  }
+
+  /** BSpline + Mattes mutual information + random coordinate sampler.
+   * The grid has 8 cubic B-spline intervals over the image in each
+   * dimension, and is slightly larger than the image to make sure that
+   * all samples lie inside its valid region.
+   */
+  {
+    const unsigned long numberOfIntervals = 8;
+    typename CoefficientImageType::SizeType gridSize;
+    gridSize.Fill( numberOfIntervals + 3 );
+    typename CoefficientImageType::IndexType gridIndex;
+    gridIndex.Fill( 0 );
+    typename CoefficientImageType::RegionType gridRegion( gridIndex, gridSize );
+    typename CoefficientImageType::SpacingType gridSpacing;
+    gridSpacing.Fill( 1.02 * extent / numberOfIntervals );
+    typename CoefficientImageType::PointType gridOrigin;
+    gridOrigin.Fill( -0.01 * extent - gridSpacing[ 0 ] );
+    typename CoefficientImageType::DirectionType gridDirection;
+    gridDirection.SetIdentity();
+
+    typename BSplineTransformType::Pointer transform = BSplineTransformType::New();
+    transform->SetGridOrigin( gridOrigin );
+    transform->SetGridSpacing( gridSpacing );
+    transform->SetGridRegion( gridRegion );
+    transform->SetGridDirection( gridDirection );
+    ParametersType initialParameters( transform->GetNumberOfParameters() );
+    initialParameters.Fill( 0.0 );
+    transform->SetParameters( initialParameters );
+    ScalesType scales( initialParameters.GetSize() );
+    scales.Fill( 1.0 );
+
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+    typename RandomCoordinateSamplerType::Pointer sampler
+      = RandomCoordinateSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+    sampler->SetSeed( 121212 );
+
+    typename MattesMetricType::Pointer metric = MattesMetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetNumberOfFixedHistogramBins( 32 );
+    metric->SetNumberOfMovingHistogramBins( 32 );
+    metric->SetFixedKernelBSplineOrder( 0 );
+    metric->SetMovingKernelBSplineOrder( 3 );
+    metric->SetFixedImageLimiter( FixedLimiterType::New() );
+    metric->SetMovingImageLimiter( MovingLimiterType::New() );
+
+    results.push_back( RunRegistration< ImageType >( "BSplineMattesMI",
+      metric, sampler, initialParameters, scales, 1000.0,
+      numberOfIterations, numberOfSamples ) );
+  }
+
+  return results;
+
+} // end RunStacks()
+
+//-------------------------------------------------------------------------------------
+
+int main( int argc, char *argv[] )
+{
+  /** The number of iterations and samples. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned long numberOfIterations = 10;
+#else
+  const unsigned long numberOfIterations = 100;
+#endif
+  const unsigned long numberOfSamples = 2048;
+
+  /** Parse the optional arguments. */
+  std::string outputFileName = "";
+  bool fullMode = false;
+  for ( int i = 1; i < argc; ++i )
+  {
+    if ( std::strcmp( argv[ i ], "full" ) == 0 )
+    {
+      fullMode = true;
+    }
+    else
+    {
+      outputFileName = std::string( argv[ i ] ) + "/RegistrationPerformanceTest.csv";
+    }
+  }
+
+  /** The image sizes per dimension. */
+  std::vector< unsigned long > sizes2D;
+  sizes2D.push_back( 64 );
+  sizes2D.push_back( 128 );
+  std::vector< unsigned long > sizes3D;
+  sizes3D.push_back( 32 );
+  sizes3D.push_back( 64 );
+  if ( fullMode )
+  {
+    sizes2D.push_back( 256 );
+    sizes3D.push_back( 128 );
+  }
+
+  /** Run the benchmarks. */
+  std::vector< BenchmarkResultStruct > results;
+  for ( unsigned int i = 0; i < sizes2D.size(); ++i )
+  {
+    const std::vector< BenchmarkResultStruct > r
+      = RunStacks< 2 >( sizes2D[ i ], numberOfIterations, numberOfSamples );
+    results.insert( results.end(), r.begin(), r.end() );
+  }
+  for ( unsigned int i = 0; i < sizes3D.size(); ++i )
+  {
+    const std::vector< BenchmarkResultStruct > r
+      = RunStacks< 3 >( sizes3D[ i ], numberOfIterations, numberOfSamples );
+    results.insert( results.end(), r.begin(), r.end() );
+  }
+
+  /** Report the results. */
+  WriteHeader( std::cout );
+  for ( unsigned int i = 0; i < results.size(); ++i )
+  {
+    WriteResult( std::cout, results[ i ] );
+  }
+
+  if ( outputFileName != "" )
+  {
+    std::ofstream outputFile( outputFileName.c_str() );
+    if ( !outputFile.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << outputFileName << std::endl;
+      return 1;
+    }
+    WriteHeader( outputFile );
+    for ( unsigned int i = 0; i < results.size(); ++i )
+    {
+      WriteResult( outputFile, results[ i ] );
+    }
+  }
+
+  /** Check whether all runs succeeded. */
+  for ( unsigned int i = 0; i < results.size(); ++i )
+  {
+    if ( results[ i ].Failed )
+    {
+      std::cerr << "ERROR: not all benchmarks succeeded." << std::endl;
+      return 1;
+    }
+  }
+
+  /** Return a value. */
+  return 0;
+
+} // end main
@@ -59,6 +59,46 @@ int TestZeroTimeOutput( void )
 } // end TestZeroTimeOutput()
 
 
+int TestClocks( void )
+{
+  tmr::Timer::Pointer pTmr = tmr::Timer::New();
+
+  /** Both clocks should be monotonic. */
+  const double wallClock = tmr::Timer::GetWallClockTime();
+  const double cpuTime = tmr::Timer::GetCPUTime();
+  pTmr->StartTimer();
+  double dummy = 0.0;
+  for ( unsigned int i = 0; i < 10000000; i++ )
+  {
+    dummy += vcl_sqrt( static_cast<double>( i ) );
+  }
+  pTmr->StopTimer();
+
+  if ( tmr::Timer::GetWallClockTime() < wallClock
+    || tmr::Timer::GetCPUTime() < cpuTime )
+  {
+    std::cerr << "GetWallClockTime() or GetCPUTime() is not monotonic.\n";
+    return 1;
+  }
+
+  if ( pTmr->GetElapsedWallClockSec() < 0.0 || pTmr->GetElapsedCPUTimeSec() < 0.0 )
+  {
+    std::cerr << "Negative elapsed wall clock or CPU time.\n";
+    return 1;
+  }
+
+  if ( pTmr->GetElapsedClockSec() != pTmr->GetElapsedWallClockSec() )
+  {
+    std::cerr << "GetElapsedClockSec() != GetElapsedWallClockSec()\n";
+    return 1;
+  }
+
+  /** Use the result, so that the loop is not optimized away. */
+  return dummy < 0.0 ? 1 : 0;
+
+} // end TestClocks()
+
+
 int main( int argc, char *argv[] )
 {
 #ifndef NDEBUG
@@ -84,6 +124,8 @@ int main( int argc, char *argv[] )
   std::cerr << "Elapsed time (Sec)  : " << pTmr->GetElapsedTimeSec() << std::endl;
   std::cerr << "Elapsed clock       : " << pTmr->GetElapsedClock() << std::endl;
   std::cerr << "Elapsed clock (Sec) : " << pTmr->GetElapsedClockSec() << std::endl;
+  std::cerr << "Wall clock (Sec)    : " << pTmr->GetElapsedWallClockSec() << std::endl;
+  std::cerr << "CPU time (Sec)      : " << pTmr->GetElapsedCPUTimeSec() << std::endl;
   std::cerr << std::endl;
 
   /** Print formatted. */
@@ -95,7 +137,7 @@ int main( int argc, char *argv[] )
   std::cerr << "Elapsed clock (Sec) : " << pTmr->PrintElapsedClockSec () << std::endl;
  
   /** Zero test. */
-  return TestStartStop() || TestZeroTimeOutput();
+  return TestStartStop() || TestZeroTimeOutput() || TestClocks();
 
 } // end main()
 